@@ -0,0 +1,94 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION__ACTIVATION_CHANNEL__INCLUDED
+#define GLOBAL_ACTION__ACTIVATION_CHANNEL__INCLUDED
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+// Layout of the shared memory ring a native client may map instead of receiving
+// activations as D-Bus method calls. The daemon is the only writer, the client
+// the only reader; a single eventfd write wakes the client up after each entry.
+
+#define ACTIVATION_CHANNEL_MAGIC    0x4c584741u // "LXGA"
+#define ACTIVATION_CHANNEL_VERSION  2u
+#define ACTIVATION_CHANNEL_CAPACITY 256u // must be a power of two
+
+typedef struct ActivationChannelEntry
+{
+    uint64_t pathHash;  // activationChannelPathHash(path)
+    uint64_t timestamp; // X server time of the key press, milliseconds
+} ActivationChannelEntry;
+
+typedef struct ActivationChannel
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t reserved;
+    volatile uint64_t written; // total number of published entries
+    ActivationChannelEntry entries[ACTIVATION_CHANNEL_CAPACITY];
+} ActivationChannel;
+
+
+// FNV-1a, computed over the action path as registered (without the "/global_key_shortcuts" prefix).
+inline uint64_t activationChannelPathHash(const char *path, size_t length)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= static_cast<unsigned char>(path[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// 'index' is the writer's own count of published entries, so a client scribbling
+// over the shared 'written' field cannot affect where the daemon writes.
+inline void activationChannelWrite(ActivationChannel *channel, uint64_t index, uint64_t pathHash, uint64_t timestamp)
+{
+    ActivationChannelEntry &entry = channel->entries[index & (ACTIVATION_CHANNEL_CAPACITY - 1)];
+    entry.pathHash = pathHash;
+    entry.timestamp = timestamp;
+    __sync_synchronize();
+    channel->written = index + 1;
+}
+
+// Copies entry number 'index' out of the ring.
+// Returns false if the writer has already overwritten it (reader fell behind).
+inline bool activationChannelRead(const ActivationChannel *channel, uint64_t index, ActivationChannelEntry &entry)
+{
+    entry = channel->entries[index & (ACTIVATION_CHANNEL_CAPACITY - 1)];
+    __sync_synchronize();
+    // the slot is rewritten before 'written' is bumped past index + capacity
+    return channel->written - index < ACTIVATION_CHANNEL_CAPACITY;
+}
+
+#endif // GLOBAL_ACTION__ACTIVATION_CHANNEL__INCLUDED
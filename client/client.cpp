@@ -29,8 +29,21 @@
 #include "client_p.h"
 #include "action_p.h"
 #include "org.lxqt.global_key_shortcuts.native.h"
+#include "activation_channel.h"
 
 #include <QDBusConnection>
+#include <QDBusUnixFileDescriptor>
+#include <QSocketNotifier>
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+
+static quint64 pathHash(const QString &path)
+{
+    QByteArray rawPath = path.toUtf8();
+    return activationChannelPathHash(rawPath.constData(), rawPath.length());
+}
 
 
 namespace GlobalKeyShortcut
@@ -41,11 +54,19 @@ ClientImpl::ClientImpl(Client *interface, QObject *parent)
     , mInterface(interface)
     , mServiceWatcher(new QDBusServiceWatcher("org.lxqt.global_key_shortcuts", QDBusConnection::sessionBus(), QDBusServiceWatcher::WatchForOwnerChange, this))
     , mDaemonPresent(false)
+    , mChannel(0)
+    , mChannelEventFd(-1)
+    , mChannelNotifier(0)
+    , mChannelRead(0)
 {
     connect(mServiceWatcher, SIGNAL(serviceUnregistered(QString)), this, SLOT(daemonDisappeared(QString)));
     connect(mServiceWatcher, SIGNAL(serviceRegistered(QString)), this, SLOT(daemonAppeared(QString)));
     mProxy = new org::lxqt::global_key_shortcuts::native("org.lxqt.global_key_shortcuts", "/native", QDBusConnection::sessionBus(), this);
     mDaemonPresent = mProxy->isValid();
+    if (mDaemonPresent)
+    {
+        openActivationChannel();
+    }
 
     connect(this, SIGNAL(emitShortcutGrabbed(QString)), mInterface, SIGNAL(shortcutGrabbed(QString)));
     connect(this, SIGNAL(emitGrabShortcutFailed()), mInterface, SIGNAL(grabShortcutFailed()));
@@ -66,10 +87,106 @@ ClientImpl::~ClientImpl()
         delete I.value();
     }
     mActions.clear();
+
+    closeActivationChannel();
+}
+
+void ClientImpl::openActivationChannel()
+{
+    closeActivationChannel();
+
+    if (!(QDBusConnection::sessionBus().connectionCapabilities() & QDBusConnection::UnixFileDescriptorPassing))
+    {
+        return;
+    }
+
+    QDBusPendingReply<QDBusUnixFileDescriptor, QDBusUnixFileDescriptor> reply = mProxy->openActivationChannel();
+    reply.waitForFinished();
+    if (reply.isError() || !reply.argumentAt<0>().isValid() || !reply.argumentAt<1>().isValid())
+    {
+        return; // older daemon or no memfd support: activations keep coming over D-Bus
+    }
+
+    void *memory = mmap(0, sizeof(ActivationChannel), PROT_READ, MAP_SHARED, reply.argumentAt<0>().fileDescriptor(), 0);
+    if (memory == MAP_FAILED)
+    {
+        return;
+    }
+
+    ActivationChannel *channel = reinterpret_cast<ActivationChannel *>(memory);
+    if ((channel->magic != ACTIVATION_CHANNEL_MAGIC) || (channel->version != ACTIVATION_CHANNEL_VERSION) || (channel->capacity != ACTIVATION_CHANNEL_CAPACITY))
+    {
+        munmap(memory, sizeof(ActivationChannel));
+        return;
+    }
+
+    mChannelEventFd = dup(reply.argumentAt<1>().fileDescriptor());
+    if (mChannelEventFd == -1)
+    {
+        munmap(memory, sizeof(ActivationChannel));
+        return;
+    }
+
+    mChannel = channel;
+    mChannelRead = mChannel->written;
+    mChannelNotifier = new QSocketNotifier(mChannelEventFd, QSocketNotifier::Read, this);
+    connect(mChannelNotifier, SIGNAL(activated(int)), this, SLOT(activationChannelReady()));
+
+    // the daemon keeps activating over D-Bus until it is told the ring is read, so any failure above loses nothing
+    mProxy->activationChannelAccepted();
+}
+
+void ClientImpl::closeActivationChannel()
+{
+    delete mChannelNotifier;
+    mChannelNotifier = 0;
+    if (mChannelEventFd != -1)
+    {
+        close(mChannelEventFd);
+        mChannelEventFd = -1;
+    }
+    if (mChannel)
+    {
+        munmap(mChannel, sizeof(ActivationChannel));
+        mChannel = 0;
+    }
+}
+
+void ClientImpl::activationChannelReady()
+{
+    quint64 counter;
+    if (read(mChannelEventFd, &counter, sizeof(counter)) != sizeof(counter))
+    {
+        return;
+    }
+
+    quint64 written = mChannel->written;
+    __sync_synchronize();
+    if (written - mChannelRead > ACTIVATION_CHANNEL_CAPACITY)
+    {
+        mChannelRead = written - ACTIVATION_CHANNEL_CAPACITY; // fell behind, the oldest entries are gone
+    }
+
+    for (; mChannelRead != written; ++mChannelRead)
+    {
+        ActivationChannelEntry entry;
+        if (!activationChannelRead(mChannel, mChannelRead, entry))
+        {
+            continue;
+        }
+
+        QHash<quint64, ActionImpl*>::const_iterator actionByPathHash = mActionsByPathHash.constFind(entry.pathHash);
+        if (actionByPathHash != mActionsByPathHash.constEnd())
+        {
+            actionByPathHash.value()->activated();
+        }
+    }
 }
 
 void ClientImpl::daemonDisappeared(const QString &)
 {
+    closeActivationChannel();
+
     mDaemonPresent = false;
     emit emitDaemonDisappeared();
     emit emitDaemonPresenceChanged(mDaemonPresent);
@@ -77,6 +194,8 @@ void ClientImpl::daemonDisappeared(const QString &)
 
 void ClientImpl::daemonAppeared(const QString &)
 {
+    openActivationChannel();
+
     QMap<QString, Action*>::iterator last = mActions.end();
     for (QMap<QString, Action*>::iterator I = mActions.begin(); I != last; ++I)
     {
@@ -139,6 +258,7 @@ Action *ClientImpl::addClientAction(const QString &shortcut, const QString &path
     }
 
     mActions[path] = globalAction;
+    mActionsByPathHash[pathHash(path)] = globalActionImpl;
 
 
     return globalAction;
@@ -198,6 +318,7 @@ bool ClientImpl::removeClientAction(const QString &path)
 
     mActions[path]->disconnect();
     mActions.remove(path);
+    mActionsByPathHash.remove(pathHash(path));
 
     return reply.argumentAt<0>();
 }
@@ -217,6 +338,7 @@ void ClientImpl::removeAction(ActionImpl *actionImpl)
 
     mActions[path]->disconnect();
     mActions.remove(path);
+    mActionsByPathHash.remove(pathHash(path));
 }
 
 void ClientImpl::grabShortcut(uint timeout)
@@ -31,6 +31,7 @@
 #include <QObject>
 #include <QString>
 #include <QMap>
+#include <QHash>
 #include <QDBusPendingCallWatcher>
 
 #include "action.h"
@@ -49,6 +50,9 @@ typedef ::OrgLxqtGlobal_key_shortcutsNativeInterface native;
 }
 
 class QDBusServiceWatcher;
+class QSocketNotifier;
+
+struct ActivationChannel;
 
 namespace GlobalKeyShortcut
 {
@@ -82,6 +86,9 @@ public slots:
     void daemonDisappeared(const QString &);
     void daemonAppeared(const QString &);
 
+private slots:
+    void activationChannelReady();
+
 signals:
     void emitShortcutGrabbed(const QString &);
     void emitGrabShortcutFailed();
@@ -92,12 +99,22 @@ signals:
     void emitDaemonAppeared();
     void emitDaemonPresenceChanged(bool);
 
+private:
+    void openActivationChannel();
+    void closeActivationChannel();
+
 private:
     Client *mInterface;
     org::lxqt::global_key_shortcuts::native *mProxy;
     QMap<QString, Action*> mActions;
     QDBusServiceWatcher *mServiceWatcher;
     bool mDaemonPresent;
+
+    ActivationChannel *mChannel;
+    int mChannelEventFd;
+    QSocketNotifier *mChannelNotifier;
+    quint64 mChannelRead;
+    QHash<quint64, ActionImpl*> mActionsByPathHash;
 };
 
 }
@@ -0,0 +1,74 @@
+#
+# Write a C++ header with the keysym names defined in the given X11 headers,
+# as two arrays of { "name", keysym } sorted for binary search:
+#   keysymsByName:  sorted by name (strcmp order), for name -> keysym
+#   keysymsByValue: sorted by keysym, aliases in header order, for keysym -> name
+#                   (the first alias is the one Xlib's XKeysymToString returns)
+# Only "#define [XF86]XK_name 0xvalue" lines are used, XF86 names keep the
+# "XF86" prefix like Xlib does.
+# Arguments:
+#   output: the header file to write
+#   ARGN:   the X11 keysym headers to read, missing ones are skipped
+#
+function (create_keysym_table output)
+    set(_byName)
+    set(_byValue)
+    set(_order 0)
+
+    foreach(_header ${ARGN})
+        if(EXISTS "${_header}")
+            file(STRINGS "${_header}" _defines REGEX "^#define[ \t]+(XF86)?XK_[A-Za-z0-9_]+[ \t]+0x[0-9A-Fa-f]+")
+            foreach(_define ${_defines})
+                if(_define MATCHES "^#define[ \t]+(XF86)?XK_([A-Za-z0-9_]+)[ \t]+0x([0-9A-Fa-f]+)")
+                    set(_name "${CMAKE_MATCH_1}${CMAKE_MATCH_2}")
+                    string(TOLOWER "${CMAKE_MATCH_3}" _value)
+
+                    # fixed width, so that sorting the strings sorts the numbers
+                    string(LENGTH "${_value}" _length)
+                    while(_length LESS 8)
+                        set(_value "0${_value}")
+                        math(EXPR _length "${_length} + 1")
+                    endwhile()
+                    set(_index "${_order}")
+                    string(LENGTH "${_index}" _length)
+                    while(_length LESS 6)
+                        set(_index "0${_index}")
+                        math(EXPR _length "${_length} + 1")
+                    endwhile()
+
+                    # space sorts before any character of a name, so "a" comes before "a0" as with strcmp
+                    list(APPEND _byName "${_name} ${_value}")
+                    list(APPEND _byValue "${_value} ${_index} ${_name}")
+                    math(EXPR _order "${_order} + 1")
+                endif()
+            endforeach()
+        else()
+            message(STATUS "${output}: ${_header} not found, its keysym names are left to Xlib")
+        endif()
+    endforeach()
+
+    list(SORT _byName)
+    list(SORT _byValue)
+
+    set(_content "// file generated by create_keysym_table.cmake, do not edit\n\n")
+    set(_content "${_content}static const KeysymName keysymsByName[] =\n{\n")
+    foreach(_entry ${_byName})
+        string(REPLACE " " ";" _fields "${_entry}")
+        list(GET _fields 0 _name)
+        list(GET _fields 1 _value)
+        set(_content "${_content}    { \"${_name}\", 0x${_value} },\n")
+    endforeach()
+    set(_content "${_content}};\n\nstatic const KeysymName keysymsByValue[] =\n{\n")
+    foreach(_entry ${_byValue})
+        string(REPLACE " " ";" _fields "${_entry}")
+        list(GET _fields 0 _value)
+        list(GET _fields 2 _name)
+        set(_content "${_content}    { \"${_name}\", 0x${_value} },\n")
+    endforeach()
+    set(_content "${_content}};\n")
+
+    # only touch the header when it changes, so re-running cmake does not rebuild the daemon
+    file(WRITE "${output}.tmp" "${_content}")
+    configure_file("${output}.tmp" "${output}" COPYONLY)
+    file(REMOVE "${output}.tmp")
+endfunction()
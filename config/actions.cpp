@@ -28,23 +28,68 @@
 #include "actions.h"
 
 #include "org.lxqt.global_key_shortcuts.daemon.h"
+#include "../daemon/string_pool.h"
+
+
+namespace
+{
+
+const int usageCacheLifetime = 2000; // ms
+
+// the per type maps repeat the general fields, interning makes them share one copy
+
+void intern(CommonActionInfo &info)
+{
+    info.shortcut = StringPool::intern(info.shortcut);
+    info.description = StringPool::intern(info.description);
+}
+
+GeneralActionInfo interned(GeneralActionInfo info)
+{
+    intern(info);
+    info.type = StringPool::intern(info.type);
+    info.info = StringPool::intern(info.info);
+    return info;
+}
+
+ClientActionInfo interned(ClientActionInfo info)
+{
+    intern(info);
+    info.path = StringPool::intern(info.path);
+    return info;
+}
+
+MethodActionInfo interned(MethodActionInfo info)
+{
+    intern(info);
+    info.service = StringPool::intern(info.service);
+    info.path = StringPool::intern(info.path);
+    info.interface = StringPool::intern(info.interface);
+    info.method = StringPool::intern(info.method);
+    return info;
+}
+
+CommandActionInfo interned(CommandActionInfo info)
+{
+    intern(info);
+    info.command = StringPool::intern(info.command);
+    info.arguments = StringPool::intern(info.arguments);
+    return info;
+}
+
+}
 
 Actions::Actions(QObject *parent)
     : QObject(parent)
     , mServiceWatcher(new QDBusServiceWatcher("org.lxqt.global_key_shortcuts", QDBusConnection::sessionBus(), QDBusServiceWatcher::WatchForOwnerChange, this))
+    , mGeneration(0ull)
     , mMultipleActionsBehaviour(MULTIPLE_ACTIONS_BEHAVIOUR_FIRST)
 {
     connect(mServiceWatcher, SIGNAL(serviceUnregistered(QString)), this, SLOT(on_daemonDisappeared(QString)));
     connect(mServiceWatcher, SIGNAL(serviceRegistered(QString)), this, SLOT(on_daemonAppeared(QString)));
     mDaemonProxy = new org::lxqt::global_key_shortcuts::daemon("org.lxqt.global_key_shortcuts", "/daemon", QDBusConnection::sessionBus(), this);
 
-    connect(mDaemonProxy, SIGNAL(actionAdded(qulonglong)), this, SLOT(on_actionAdded(qulonglong)));
-    connect(mDaemonProxy, SIGNAL(actionEnabled(qulonglong, bool)), this, SLOT(on_actionEnabled(qulonglong, bool)));
-    connect(mDaemonProxy, SIGNAL(clientActionSenderChanged(qulonglong, QString)), this, SLOT(on_clientActionSenderChanged(qulonglong, QString)));
-    connect(mDaemonProxy, SIGNAL(actionModified(qulonglong)), this, SLOT(on_actionModified(qulonglong)));
-    connect(mDaemonProxy, SIGNAL(actionRemoved(qulonglong)), this, SLOT(on_actionRemoved(qulonglong)));
-    connect(mDaemonProxy, SIGNAL(actionShortcutChanged(qulonglong)), this, SLOT(on_actionShortcutChanged(qulonglong)));
-    connect(mDaemonProxy, SIGNAL(actionsSwapped(qulonglong, qulonglong)), this, SLOT(on_actionsSwapped(qulonglong, qulonglong)));
+    connect(mDaemonProxy, SIGNAL(actionsChanged(qulonglong, QList_ActionChange)), this, SLOT(on_actionsChanged(qulonglong, QList_ActionChange)));
     connect(mDaemonProxy, SIGNAL(multipleActionsBehaviourChanged(uint)), this, SLOT(on_multipleActionsBehaviourChanged(uint)));
 
     QTimer::singleShot(0, this, SLOT(delayedInit()));
@@ -64,24 +109,57 @@ void Actions::delayedInit()
 
 void Actions::on_daemonDisappeared(const QString &)
 {
-    clear();
+    // keep the cache, it is brought up to date when the daemon comes back
     emit daemonDisappeared();
 }
 
 void Actions::on_daemonAppeared(const QString &)
 {
-    init();
+    resync();
     emit daemonAppeared();
 }
 
+bool Actions::resync()
+{
+    if (mGeneration)
+    {
+        QDBusPendingReply<bool, QList_ActionChange> reply = mDaemonProxy->getChangesSince(mGeneration);
+        reply.waitForFinished();
+        if (!reply.isError() && reply.argumentAt<0>())
+        {
+            QList_ActionChange changes = reply.argumentAt<1>();
+            QList_ActionChange::const_iterator M = changes.constEnd();
+            for (QList_ActionChange::const_iterator I = changes.constBegin(); I != M; ++I)
+            {
+                if (I->generation > mGeneration)
+                {
+                    mGeneration = I->generation;
+                    do_actionChanged(*I);
+                }
+            }
+
+            mMultipleActionsBehaviour = static_cast<MultipleActionsBehaviour>(getMultipleActionsBehaviour());
+            return true;
+        }
+    }
+
+    init();
+    return false;
+}
+
 void Actions::init()
 {
     clear();
 
+    // every change newer than this generation is not in the snapshot below and will arrive with actionsChanged
+    mGeneration = getActionsGeneration();
+
     mGeneralActionInfo = getAllActions();
-    GeneralActionInfos::const_iterator M = mGeneralActionInfo.constEnd();
-    for (GeneralActionInfos::const_iterator I = mGeneralActionInfo.constBegin(); I != M; ++I)
+    GeneralActionInfos::iterator M = mGeneralActionInfo.end();
+    for (GeneralActionInfos::iterator I = mGeneralActionInfo.begin(); I != M; ++I)
     {
+        I.value() = interned(I.value());
+
         if (I.value().type == "client")
         {
             QString shortcut;
@@ -95,7 +173,7 @@ void Actions::init()
                 info.description = description;
                 info.enabled = enabled;
                 info.path = path;
-                mClientActionInfo[I.key()] = info;
+                mClientActionInfo[I.key()] = interned(info);
 
                 updateClientActionSender(I.key());
             }
@@ -119,7 +197,7 @@ void Actions::init()
                 info.path = path;
                 info.interface = interface;
                 info.method = method;
-                mMethodActionInfo[I.key()] = info;
+                mMethodActionInfo[I.key()] = interned(info);
             }
         }
         else if (I.value().type == "command")
@@ -137,7 +215,7 @@ void Actions::init()
                 info.enabled = enabled;
                 info.command = command;
                 info.arguments = arguments;
-                mCommandActionInfo[I.key()] = info;
+                mCommandActionInfo[I.key()] = interned(info);
             }
         }
     }
@@ -151,6 +229,10 @@ void Actions::clear()
     mClientActionInfo.clear();
     mMethodActionInfo.clear();
     mCommandActionInfo.clear();
+    mClientActionSenders.clear();
+    mCachedUsage.clear();
+    StringPool::purge();
+    mGeneration = 0ull;
     mMultipleActionsBehaviour = MULTIPLE_ACTIONS_BEHAVIOUR_FIRST;
 }
 
@@ -219,209 +301,112 @@ MultipleActionsBehaviour Actions::multipleActionsBehaviour() const
     return mMultipleActionsBehaviour;
 }
 
-void Actions::do_actionAdded(qulonglong id)
+void Actions::on_actionsChanged(qulonglong generation, const QList_ActionChange &changes)
 {
-    QString shortcut;
-    QString description;
-    bool enabled;
-    QString type;
-    QString info;
-    if (getActionById(id, shortcut, description, enabled, type, info))
+    if (generation <= mGeneration)
     {
-        GeneralActionInfo generalActionInfo;
-        generalActionInfo.shortcut = shortcut;
-        generalActionInfo.description = description;
-        generalActionInfo.enabled = enabled;
-        generalActionInfo.type = type;
-        generalActionInfo.info = info;
-        mGeneralActionInfo[id] = generalActionInfo;
+        return;
     }
 
-    if (type == "client")
-    {
-        QDBusObjectPath path;
-        if (getClientActionInfoById(id, shortcut, description, enabled, path))
-        {
-            ClientActionInfo clientActionInfo;
-            clientActionInfo.shortcut = shortcut;
-            clientActionInfo.description = description;
-            clientActionInfo.enabled = enabled;
-            clientActionInfo.path = path;
-            mClientActionInfo[id] = clientActionInfo;
-        }
-    }
-    else if (type == "method")
+    if (!changes.isEmpty() && (changes.first().generation > mGeneration + 1))
     {
-        QString service;
-        QDBusObjectPath path;
-        QString interface;
-        QString method;
-        if (getMethodActionInfoById(id, shortcut, description, enabled, service, path, interface, method))
+        // some changes were lost, fetch them; listeners rebuild from a new snapshot on daemonAppeared
+        if (!resync())
         {
-            MethodActionInfo methodActionInfo;
-            methodActionInfo.shortcut = shortcut;
-            methodActionInfo.description = description;
-            methodActionInfo.enabled = enabled;
-            methodActionInfo.service = service;
-            methodActionInfo.path = path;
-            methodActionInfo.interface = interface;
-            methodActionInfo.method = method;
-            mMethodActionInfo[id] = methodActionInfo;
+            emit daemonAppeared();
         }
+        return;
     }
-    else if (type == "command")
+
+    QList_ActionChange::const_iterator M = changes.constEnd();
+    for (QList_ActionChange::const_iterator I = changes.constBegin(); I != M; ++I)
     {
-        QString command;
-        QStringList arguments;
-        if (getCommandActionInfoById(id, shortcut, description, enabled, command, arguments))
+        if (I->generation > mGeneration)
         {
-            CommandActionInfo commandActionInfo;
-            commandActionInfo.shortcut = shortcut;
-            commandActionInfo.description = description;
-            commandActionInfo.enabled = enabled;
-            commandActionInfo.command = command;
-            commandActionInfo.arguments = arguments;
-            mCommandActionInfo[id] = commandActionInfo;
+            mGeneration = I->generation;
+            do_actionChanged(*I);
         }
     }
+    mGeneration = generation;
 }
 
-void Actions::on_actionAdded(qulonglong id)
+void Actions::do_actionChanged(const ActionChange &change)
 {
-    do_actionAdded(id);
-    emit actionAdded(id);
-}
+    const qulonglong &id = change.id;
 
-void Actions::on_actionEnabled(qulonglong id, bool enabled)
-{
-    GeneralActionInfos::iterator GI = mGeneralActionInfo.find(id);
-    if (GI != mGeneralActionInfo.end())
+    if (change.kind == ACTION_CHANGE_REMOVED)
     {
-        GI.value().enabled = enabled;
-
-        if (GI.value().type == "client")
-        {
-            ClientActionInfos::iterator DI = mClientActionInfo.find(id);
-            if (DI != mClientActionInfo.end())
-            {
-                DI.value().enabled = enabled;
-            }
-        }
-        else if (GI.value().type == "method")
-        {
-            MethodActionInfos::iterator MI = mMethodActionInfo.find(id);
-            if (MI != mMethodActionInfo.end())
-            {
-                MI.value().enabled = enabled;
-            }
-        }
-        else if (GI.value().type == "command")
+        if (mGeneralActionInfo.contains(id))
         {
-            CommandActionInfos::iterator CI = mCommandActionInfo.find(id);
-            if (CI != mCommandActionInfo.end())
-            {
-                CI.value().enabled = enabled;
-            }
+            do_actionRemoved(id);
+            emit actionRemoved(id);
         }
+        return;
     }
-    emit actionEnabled(id, enabled);
-}
-
-void Actions::on_clientActionSenderChanged(qulonglong id, const QString &sender)
-{
-    mClientActionSenders[id] = sender;
-    emit actionModified(id);
-}
 
-void Actions::on_actionModified(qulonglong id)
-{
-    do_actionAdded(id);
-    emit actionModified(id);
-}
+    GeneralActionInfos::const_iterator GI = mGeneralActionInfo.constFind(id);
+    bool known = (GI != mGeneralActionInfo.constEnd());
+    bool enabledOnly = known
+            && (GI.value().enabled != change.general.enabled)
+            && (GI.value().shortcut == change.general.shortcut)
+            && (GI.value().description == change.general.description)
+            && (GI.value().type == change.general.type)
+            && (GI.value().info == change.general.info)
+            && (mClientActionSenders.value(id) == change.sender);
 
-void Actions::on_actionShortcutChanged(qulonglong id)
-{
-    do_actionAdded(id);
-    emit actionModified(id);
-}
+    mGeneralActionInfo[id] = interned(change.general);
 
-void Actions::on_actionsSwapped(qulonglong id1, qulonglong id2)
-{
-    GeneralActionInfos::iterator GI1 = mGeneralActionInfo.find(id1);
-    GeneralActionInfos::iterator GI2 = mGeneralActionInfo.find(id2);
-    if ((GI1 != mGeneralActionInfo.end()) && (GI2 != mGeneralActionInfo.end()))
+    if (change.general.type == "client")
     {
-        bool swapped = false;
+        ClientActionInfo clientActionInfo;
+        static_cast<CommonActionInfo &>(clientActionInfo) = change.general;
+        clientActionInfo.path = change.path;
+        mClientActionInfo[id] = interned(clientActionInfo);
 
-        if (GI1.value().type == GI2.value().type)
-        {
-            if (GI1.value().type == "client")
-            {
-                ClientActionInfos::iterator DI1 = mClientActionInfo.find(id1);
-                ClientActionInfos::iterator DI2 = mClientActionInfo.find(id2);
-                if ((DI1 != mClientActionInfo.end()) && (DI2 != mClientActionInfo.end()))
-                {
-                    ClientActionInfo clientActionInfo = DI1.value();
-                    DI1.value() = DI2.value();
-                    DI2.value() = clientActionInfo;
-                    swapped = true;
-                }
-            }
-            else if (GI1.value().type == "method")
-            {
-                MethodActionInfos::iterator MI1 = mMethodActionInfo.find(id1);
-                MethodActionInfos::iterator MI2 = mMethodActionInfo.find(id2);
-                if ((MI1 != mMethodActionInfo.end()) && (MI2 != mMethodActionInfo.end()))
-                {
-                    MethodActionInfo methodActionInfo = MI1.value();
-                    MI1.value() = MI2.value();
-                    MI2.value() = methodActionInfo;
-                    swapped = true;
-                }
-            }
-            else if (GI1.value().type == "command")
-            {
-                CommandActionInfos::iterator CI1 = mCommandActionInfo.find(id1);
-                CommandActionInfos::iterator CI2 = mCommandActionInfo.find(id2);
-                if ((CI1 != mCommandActionInfo.end()) && (CI2 != mCommandActionInfo.end()))
-                {
-                    CommandActionInfo commandActionInfo = CI1.value();
-                    CI1.value() = CI2.value();
-                    CI2.value() = commandActionInfo;
-                    swapped = true;
-                }
-            }
-        }
+        mClientActionSenders[id] = StringPool::intern(change.sender);
+    }
+    else if (change.general.type == "method")
+    {
+        MethodActionInfo methodActionInfo;
+        static_cast<CommonActionInfo &>(methodActionInfo) = change.general;
+        methodActionInfo.service = change.service;
+        methodActionInfo.path = change.path;
+        methodActionInfo.interface = change.interface;
+        methodActionInfo.method = change.method;
+        mMethodActionInfo[id] = interned(methodActionInfo);
+    }
+    else if (change.general.type == "command")
+    {
+        CommandActionInfo commandActionInfo;
+        static_cast<CommonActionInfo &>(commandActionInfo) = change.general;
+        commandActionInfo.command = change.command;
+        commandActionInfo.arguments = change.arguments;
+        mCommandActionInfo[id] = interned(commandActionInfo);
+    }
 
-        if (swapped)
-        {
-            GeneralActionInfo generalActionInfo = GI1.value();
-            GI1.value() = GI2.value();
-            GI2.value() = generalActionInfo;
-        }
-        else
-        {
-            do_actionRemoved(id1);
-            do_actionRemoved(id2);
-            do_actionAdded(id1);
-            do_actionAdded(id2);
-        }
+    if (!known)
+    {
+        emit actionAdded(id);
+    }
+    else if (enabledOnly)
+    {
+        emit actionEnabled(id, change.general.enabled);
+    }
+    else
+    {
+        emit actionModified(id);
     }
-    emit actionsSwapped(id1, id2);
 }
 
 void Actions::do_actionRemoved(qulonglong id)
 {
     mGeneralActionInfo.remove(id);
     mClientActionInfo.remove(id);
+    mClientActionSenders.remove(id);
     mMethodActionInfo.remove(id);
     mCommandActionInfo.remove(id);
-}
-
-void Actions::on_actionRemoved(qulonglong id)
-{
-    do_actionRemoved(id);
-    emit actionRemoved(id);
+    mCachedUsage.remove(id);
+    StringPool::purge();
 }
 
 void Actions::on_multipleActionsBehaviourChanged(uint behaviour)
@@ -445,6 +430,18 @@ bool Actions::getCommandActionInfoById(qulonglong id, QString &shortcut, QString
     return mDaemonProxy->getCommandActionInfoById(id, shortcut, description, enabled, command, arguments);
 }
 
+qulonglong Actions::getActionsGeneration()
+{
+    QDBusPendingReply<qulonglong> reply = mDaemonProxy->getActionsGeneration();
+    reply.waitForFinished();
+    if (reply.isError())
+    {
+        return 0ull;
+    }
+
+    return reply.argumentAt<0>();
+}
+
 QList<qulonglong> Actions::getAllActionIds()
 {
     QDBusPendingReply<QList<qulonglong> > reply = mDaemonProxy->getAllActionIds();
@@ -585,10 +582,51 @@ QString Actions::updateClientActionSender(qulonglong id)
     }
 
     QString sender = reply.argumentAt<0>();
-    mClientActionSenders[id] = sender;
+    mClientActionSenders[id] = StringPool::intern(sender);
     return sender;
 }
 
+bool Actions::commandActionUsage(qulonglong id, CommandActionUsage &usage)
+{
+    CachedUsages::const_iterator cachedUsage = mCachedUsage.constFind(id);
+    bool cached = (cachedUsage != mCachedUsage.constEnd());
+    if (cached)
+    {
+        usage = cachedUsage.value().usage;
+    }
+
+    if ((!cached || (cachedUsage.value().fetched.elapsed() > usageCacheLifetime)) && !mUsageFetching.contains(id))
+    {
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(mDaemonProxy->getCommandActionUsage(id), this);
+        mUsageFetches[watcher] = id;
+        mUsageFetching.insert(id);
+
+        connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher *)), this, SLOT(commandActionUsageFetched(QDBusPendingCallWatcher *)));
+    }
+
+    return cached;
+}
+
+void Actions::commandActionUsageFetched(QDBusPendingCallWatcher *call)
+{
+    qulonglong id = mUsageFetches.take(call);
+    mUsageFetching.remove(id);
+
+    QDBusPendingReply<bool, CommandActionUsage> reply = *call;
+    if (reply.isError() || !reply.argumentAt<0>())
+    {
+        mCachedUsage.remove(id);
+    }
+    else
+    {
+        CachedUsage &cachedUsage = mCachedUsage[id];
+        cachedUsage.usage = reply.argumentAt<1>();
+        cachedUsage.fetched.start();
+    }
+
+    call->deleteLater();
+}
+
 QString Actions::changeShortcut(const qulonglong &id, const QString &shortcut)
 {
     QDBusPendingReply<QString> reply = mDaemonProxy->changeShortcut(id, shortcut);
@@ -36,6 +36,8 @@
 #include <QMap>
 #include <QPair>
 #include <QDBusObjectPath>
+#include <QSet>
+#include <QTime>
 
 #include "../daemon/meta_types.h"
 
@@ -89,6 +91,10 @@ public:
     QString getClientActionSender(qulonglong id);
     QString updateClientActionSender(qulonglong id);
 
+    // never blocks: answers from a short lived cache and asks the daemon in the background
+    // when the entry is missing or stale
+    bool commandActionUsage(qulonglong id, CommandActionUsage &usage);
+
     QString changeShortcut(const qulonglong &id, const QString &shortcut);
 
     bool swapActions(const qulonglong &id1, const qulonglong &id2);
@@ -111,7 +117,6 @@ signals:
     void actionAdded(qulonglong id);
     void actionEnabled(qulonglong id, bool enabled);
     void actionModified(qulonglong id);
-    void actionsSwapped(qulonglong id1, qulonglong id2);
     void actionRemoved(qulonglong id);
 
     void multipleActionsBehaviourChanged(MultipleActionsBehaviour behaviour);
@@ -123,8 +128,10 @@ signals:
 
 private:
     void init();
+    bool resync();
     void clear();
 
+    qulonglong getActionsGeneration();
     QList<qulonglong> getAllActionIds();
 
     bool getActionById(qulonglong id, QString &shortcut, QString &description, bool &enabled, QString &type, QString &info);
@@ -142,19 +149,14 @@ private slots:
     void on_daemonDisappeared(const QString &);
     void on_daemonAppeared(const QString &);
 
-    void on_actionAdded(qulonglong id);
-    void on_actionEnabled(qulonglong id, bool enabled);
-    void on_clientActionSenderChanged(qulonglong id, const QString &sender);
-    void on_actionModified(qulonglong id);
-    void on_actionShortcutChanged(qulonglong id);
-    void on_actionsSwapped(qulonglong id1, qulonglong id2);
-    void on_actionRemoved(qulonglong id);
+    void on_actionsChanged(qulonglong generation, const QList_ActionChange &changes);
     void on_multipleActionsBehaviourChanged(uint behaviour);
 
     void grabShortcutFinished(QDBusPendingCallWatcher *call);
+    void commandActionUsageFetched(QDBusPendingCallWatcher *call);
 
 private:
-    void do_actionAdded(qulonglong id);
+    void do_actionChanged(const ActionChange &change);
     void do_actionRemoved(qulonglong id);
 
 private:
@@ -176,7 +178,19 @@ private:
     typedef QMap<qulonglong, CommandActionInfo> CommandActionInfos;
     CommandActionInfos mCommandActionInfo;
 
+    qulonglong mGeneration; // of the last change applied to the maps above
+
     MultipleActionsBehaviour mMultipleActionsBehaviour;
+
+    typedef struct CachedUsage
+    {
+        CommandActionUsage usage;
+        QTime fetched;
+    } CachedUsage;
+    typedef QMap<qulonglong, CachedUsage> CachedUsages;
+    CachedUsages mCachedUsage;
+    QMap<QDBusPendingCallWatcher *, qulonglong> mUsageFetches;
+    QSet<qulonglong> mUsageFetching;
 };
 
 #endif // GLOBAL_ACTION_CONFIG__ACTIONS__INCLUDED
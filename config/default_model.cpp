@@ -38,12 +38,10 @@ DefaultModel::DefaultModel(Actions *actions, const QColor &grayedOutColour, cons
     , mItalicFont(italicFont)
     , mHighlightedItalicFont(highlightedItalicFont)
 {
-    connect(actions, SIGNAL(daemonDisappeared()), SLOT(daemonDisappeared()));
     connect(actions, SIGNAL(daemonAppeared()), SLOT(daemonAppeared()));
     connect(actions, SIGNAL(actionAdded(qulonglong)), SLOT(actionAdded(qulonglong)));
     connect(actions, SIGNAL(actionModified(qulonglong)), SLOT(actionModified(qulonglong)));
     connect(actions, SIGNAL(actionEnabled(qulonglong, bool)), SLOT(actionEnabled(qulonglong, bool)));
-    connect(actions, SIGNAL(actionsSwapped(qulonglong, qulonglong)), SLOT(actionsSwapped(qulonglong, qulonglong)));
     connect(actions, SIGNAL(actionRemoved(qulonglong)), SLOT(actionRemoved(qulonglong)));
 
     mVerboseType["command"] = tr("Command");
@@ -74,19 +72,19 @@ QVariant DefaultModel::data(const QModelIndex &index, int role) const
             switch (index.column())
             {
             case 0:
-                return mContent.keys()[index.row()];
+                return mIds[index.row()];
 
             case 1:
-                return mContent[mContent.keys()[index.row()]].shortcut;
+                return mContent[mIds[index.row()]].shortcut;
 
             case 2:
-                return mContent[mContent.keys()[index.row()]].description;
+                return mContent[mIds[index.row()]].description;
 
             case 3:
-                return mVerboseType[mContent[mContent.keys()[index.row()]].type];
+                return mVerboseType[mContent[mIds[index.row()]].type];
 
             case 4:
-                return mContent[mContent.keys()[index.row()]].info;
+                return mContent[mIds[index.row()]].info;
             }
         break;
 
@@ -95,7 +93,7 @@ QVariant DefaultModel::data(const QModelIndex &index, int role) const
             switch (index.column())
             {
             case 1:
-                return mContent[mContent.keys()[index.row()]].shortcut;
+                return mContent[mIds[index.row()]].shortcut;
             }
         break;
 
@@ -103,7 +101,7 @@ QVariant DefaultModel::data(const QModelIndex &index, int role) const
     {
         if ((index.row() >= 0) && (index.row() < rowCount()))
         {
-            qulonglong id = mContent.keys()[index.row()];
+            qulonglong id = mIds[index.row()];
             bool multiple = (index.column() == 1) && (mShortcuts[mContent[id].shortcut].size() > 1);
             bool inactive = (mContent[id].type == "client") && (mActions->getClientActionSender(id).isEmpty());
             if (multiple || inactive)
@@ -113,16 +111,34 @@ QVariant DefaultModel::data(const QModelIndex &index, int role) const
         break;
 
     case Qt::ForegroundRole:
-        if (!mContent[mContent.keys()[index.row()]].enabled)
+        if (!mContent[mIds[index.row()]].enabled)
         {
             return mGrayedOutColour;
         }
         break;
 
+    case Qt::ToolTipRole:
+        if ((index.row() >= 0) && (index.row() < rowCount()) && (index.column() == 4) && (mContent[mIds[index.row()]].type == "command"))
+        {
+            // only asked for on hover, the first hover starts the fetch and a later one shows the result
+            CommandActionUsage usage;
+            if (mActions->commandActionUsage(mIds[index.row()], usage) && usage.launches)
+            {
+                return tr("Launched: %1, still running: %2\nCPU time: %3 s, wall time: %4 s\nLargest memory use: %5 MiB\nLast exit status: %6")
+                    .arg(usage.launches)
+                    .arg(usage.launches - usage.exited)
+                    .arg(usage.cpuTime / 1000.0, 0, 'f', 1)
+                    .arg(usage.wallTime / 1000.0, 0, 'f', 1)
+                    .arg(usage.maxRss / 1024.0, 0, 'f', 1)
+                    .arg(usage.lastExitStatus);
+            }
+        }
+        break;
+
     case Qt::CheckStateRole:
         if ((index.row() >= 0) && (index.row() < rowCount()) && (index.column() == 0))
         {
-            return mContent[mContent.keys()[index.row()]].enabled ? Qt::Checked : Qt::Unchecked;
+            return mContent[mIds[index.row()]].enabled ? Qt::Checked : Qt::Unchecked;
         }
         break;
 
@@ -193,7 +209,7 @@ bool DefaultModel::setData(const QModelIndex &index, const QVariant &value, int
     case Qt::EditRole:
         if ((index.row() >= 0) && (index.row() < rowCount()) && index.column() == 1)
         {
-            mActions->changeShortcut(mContent.keys()[index.row()], value.toString());
+            mActions->changeShortcut(mIds[index.row()], value.toString());
             return true;
         }
         break;
@@ -205,34 +221,28 @@ qulonglong DefaultModel::id(const QModelIndex &index) const
 {
     if ((index.row() >= 0) && (index.row() < rowCount()))
     {
-        return mContent.keys()[index.row()];
+        return mIds[index.row()];
     }
     return 0ull;
 }
 
-void DefaultModel::daemonDisappeared()
+void DefaultModel::daemonAppeared()
 {
+    QList<qulonglong> allIds = mActions->allActionIds();
+
     beginResetModel();
 
+    mIds = allIds;
     mContent.clear();
     mShortcuts.clear();
 
-    endResetModel();
-}
-
-void DefaultModel::daemonAppeared()
-{
-    QList<qulonglong> allIds = mActions->allActionIds();
-
-    beginInsertRows(QModelIndex(), 0, allIds.size() - 1);
-
     foreach(qulonglong id, allIds)
     {
         mContent[id] = mActions->actionById(id).second;
         mShortcuts[mContent[id].shortcut].insert(id);
     }
 
-    endInsertRows();
+    endResetModel();
 }
 
 void DefaultModel::actionAdded(qulonglong id)
@@ -242,22 +252,21 @@ void DefaultModel::actionAdded(qulonglong id)
         QPair<bool, GeneralActionInfo> result = mActions->actionById(id);
         if (result.first)
         {
-            QList<qulonglong> keys = mContent.keys();
-            int row = qBinaryFind(keys, mContent.lowerBound(id).key()) - keys.constBegin();
+            int row = qLowerBound(mIds, id) - mIds.constBegin();
 
             beginInsertRows(QModelIndex(), row, row);
 
+            mIds.insert(row, id);
             mContent[id] = result.second;
             mShortcuts[mContent[id].shortcut].insert(id);
 
             endInsertRows();
 
-            keys = mContent.keys();
             foreach(qulonglong siblingId, mShortcuts[mContent[id].shortcut])
             {
                 if (id != siblingId)
                 {
-                    int siblingRow = qBinaryFind(keys, siblingId) - keys.constBegin();
+                    int siblingRow = qBinaryFind(mIds, siblingId) - mIds.constBegin();
                     emit dataChanged(index(siblingRow, 1), index(siblingRow, 1));
                 }
             }
@@ -269,8 +278,7 @@ void DefaultModel::actionEnabled(qulonglong id, bool enabled)
 {
     if (mContent.contains(id))
     {
-        QList<qulonglong> keys = mContent.keys();
-        int row = qBinaryFind(keys, id) - keys.constBegin();
+        int row = qBinaryFind(mIds, id) - mIds.constBegin();
 
         mContent[id].enabled = enabled;
 
@@ -285,8 +293,7 @@ void DefaultModel::actionModified(qulonglong id)
         QPair<bool, GeneralActionInfo> result = mActions->actionById(id);
         if (result.first)
         {
-            QList<qulonglong> keys = mContent.keys();
-            int row = qBinaryFind(keys, id) - keys.constBegin();
+            int row = qBinaryFind(mIds, id) - mIds.constBegin();
 
             if (mContent[id].shortcut != result.second.shortcut)
             {
@@ -294,12 +301,12 @@ void DefaultModel::actionModified(qulonglong id)
                 mShortcuts[mContent[id].shortcut].remove(id);
                 foreach(qulonglong siblingId, mShortcuts[mContent[id].shortcut])
                 {
-                    int siblingRow = qBinaryFind(keys, siblingId) - keys.constBegin();
+                    int siblingRow = qBinaryFind(mIds, siblingId) - mIds.constBegin();
                     emit dataChanged(index(siblingRow, 1), index(siblingRow, 1));
                 }
                 foreach(qulonglong siblingId, mShortcuts[result.second.shortcut])
                 {
-                    int siblingRow = qBinaryFind(keys, siblingId) - keys.constBegin();
+                    int siblingRow = qBinaryFind(mIds, siblingId) - mIds.constBegin();
                     emit dataChanged(index(siblingRow, 1), index(siblingRow, 1));
                 }
             }
@@ -311,33 +318,16 @@ void DefaultModel::actionModified(qulonglong id)
     }
 }
 
-void DefaultModel::actionsSwapped(qulonglong id1, qulonglong id2)
-{
-    if (mContent.contains(id1) && mContent.contains(id2))
-    {
-        QList<qulonglong> keys = mContent.keys();
-        int row1 = qBinaryFind(keys, id1) - keys.constBegin();
-        int row2 = qBinaryFind(keys, id2) - keys.constBegin();
-
-        // swap
-        GeneralActionInfo tmp = mContent[id1];
-        mContent[id1] = mContent[id2];
-        mContent[id2] = tmp;
-
-        emit dataChanged(index(row1, 0), index(row1, 3));
-        emit dataChanged(index(row2, 0), index(row2, 3));
-    }
-}
-
 void DefaultModel::actionRemoved(qulonglong id)
 {
     if (mContent.contains(id))
     {
-        QList<qulonglong> keys = mContent.keys();
-        int row = qBinaryFind(keys, id) - keys.constBegin();
+        int row = qBinaryFind(mIds, id) - mIds.constBegin();
 
         beginRemoveRows(QModelIndex(), row, row);
 
+        mIds.removeAt(row);
+
         mShortcuts[mContent[id].shortcut].remove(id);
         QString shortcut = mContent[id].shortcut;
 
@@ -347,7 +337,7 @@ void DefaultModel::actionRemoved(qulonglong id)
 
         foreach(qulonglong siblingId, mShortcuts[shortcut])
         {
-            int siblingRow = qBinaryFind(keys, siblingId) - keys.constBegin();
+            int siblingRow = qBinaryFind(mIds, siblingId) - mIds.constBegin();
             emit dataChanged(index(siblingRow, 1), index(siblingRow, 1));
         }
     }
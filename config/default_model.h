@@ -67,18 +67,19 @@ public:
 
     qulonglong id(const QModelIndex &index) const;
 
+    const QMap<QString, QString> &verboseTypes() const { return mVerboseType; }
+
 public slots:
-    void daemonDisappeared();
     void daemonAppeared();
 
     void actionAdded(qulonglong id);
     void actionEnabled(qulonglong id, bool enabled);
     void actionModified(qulonglong id);
-    void actionsSwapped(qulonglong id1, qulonglong id2);
     void actionRemoved(qulonglong id);
 
 private:
     Actions *mActions;
+    QList<qulonglong> mIds; // sorted, index is the row
     QMap<qulonglong, GeneralActionInfo> mContent;
     QMap<QString, QOrderedSet<qulonglong> > mShortcuts;
 
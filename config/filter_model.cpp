@@ -0,0 +1,93 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "filter_model.h"
+#include "default_model.h"
+#include "search_index.h"
+
+
+FilterModel::FilterModel(DefaultModel *defaultModel, SearchIndex *searchIndex, QObject *parent)
+    : QSortFilterProxyModel(parent)
+    , mDefaultModel(defaultModel)
+    , mSearchIndex(searchIndex)
+    , mFiltering(false)
+{
+    // re-evaluate rows on dataChanged, the index is already up to date then
+    setDynamicSortFilter(true);
+    setSourceModel(defaultModel);
+
+    connect(searchIndex, SIGNAL(actionIndexed(qulonglong)), SLOT(actionIndexed(qulonglong)));
+    connect(searchIndex, SIGNAL(indexRebuilt()), SLOT(indexRebuilt()));
+}
+
+void FilterModel::setFilterText(const QString &text)
+{
+    mFilterText = text;
+    mFiltering = !SearchIndex::tokenize(text).isEmpty();
+    if (mFiltering)
+    {
+        mMatchingIds = mSearchIndex->find(text);
+    }
+    else
+    {
+        mMatchingIds.clear();
+    }
+
+    invalidateFilter();
+}
+
+void FilterModel::actionIndexed(qulonglong id)
+{
+    if (!mFiltering)
+    {
+        return;
+    }
+
+    if (mSearchIndex->matches(id, mFilterText))
+    {
+        mMatchingIds.insert(id);
+    }
+    else
+    {
+        mMatchingIds.remove(id);
+    }
+}
+
+void FilterModel::indexRebuilt()
+{
+    setFilterText(mFilterText);
+}
+
+bool FilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    if (!mFiltering)
+    {
+        return true;
+    }
+
+    return mMatchingIds.contains(mDefaultModel->id(mDefaultModel->index(sourceRow, 0, sourceParent)));
+}
@@ -0,0 +1,65 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_CONFIG__FILTER_MODEL__INCLUDED
+#define GLOBAL_ACTION_CONFIG__FILTER_MODEL__INCLUDED
+
+
+#include <QSortFilterProxyModel>
+#include <QSet>
+#include <QString>
+
+
+class DefaultModel;
+class SearchIndex;
+
+// Keeps the set of matching ids from SearchIndex, so accepting a row is a set lookup
+class FilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+public:
+    FilterModel(DefaultModel *defaultModel, SearchIndex *searchIndex, QObject *parent = 0);
+
+    void setFilterText(const QString &text);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
+
+private slots:
+    void actionIndexed(qulonglong id);
+    void indexRebuilt();
+
+private:
+    DefaultModel *mDefaultModel;
+    SearchIndex *mSearchIndex;
+
+    QString mFilterText;
+    bool mFiltering;
+    QSet<qulonglong> mMatchingIds;
+};
+
+#endif // GLOBAL_ACTION_CONFIG__FILTER_MODEL__INCLUDED
@@ -28,11 +28,12 @@
 #include "main_window.h"
 #include "actions.h"
 #include "default_model.h"
+#include "search_index.h"
+#include "filter_model.h"
 #include "edit_action_dialog.h"
 #include "shortcut_delegate.h"
 
 #include <QItemSelectionModel>
-#include <QSortFilterProxyModel>
 
 
 MainWindow::MainWindow(QWidget *parent)
@@ -57,11 +58,13 @@ MainWindow::MainWindow(QWidget *parent)
     highlightedItalicFont.setBold(!highlightedItalicFont.bold());
 
     mActions = new Actions(this);
+    // the index must see every change before the model does, so it connects to mActions first
+    mSearchIndex = new SearchIndex(mActions, this);
     mDefaultModel = new DefaultModel(mActions, grayedOutColour, highlightedFont, italicFont, highlightedItalicFont, this);
-    mSortFilterProxyModel = new QSortFilterProxyModel(this);
+    mSearchIndex->setTypeNames(mDefaultModel->verboseTypes());
+    mFilterModel = new FilterModel(mDefaultModel, mSearchIndex, this);
 
-    mSortFilterProxyModel->setSourceModel(mDefaultModel);
-    actions_TV->setModel(mSortFilterProxyModel);
+    actions_TV->setModel(mFilterModel);
 
     mSelectionModel = new QItemSelectionModel(actions_TV->model());
     actions_TV->setSelectionModel(mSelectionModel);
@@ -123,6 +126,11 @@ void MainWindow::on_multipleActionsBehaviour_CB_currentIndexChanged(int index)
     mActions->setMultipleActionsBehaviour(static_cast<MultipleActionsBehaviour>(index));
 }
 
+void MainWindow::on_filter_LE_textChanged(const QString &text)
+{
+    mFilterModel->setFilterText(text);
+}
+
 void MainWindow::selectionChanged(const QItemSelection &/*selected*/, const QItemSelection &/*deselected*/)
 {
     QModelIndexList rows = mSelectionModel->selectedRows();
@@ -133,8 +141,8 @@ void MainWindow::selectionChanged(const QItemSelection &/*selected*/, const QIte
     bool enableSwap = (rows.length() == 2);
     if (enableSwap)
     {
-        QPair<bool, GeneralActionInfo> info0 = mActions->actionById(mDefaultModel->id(mSortFilterProxyModel->mapToSource(rows[0])));
-        QPair<bool, GeneralActionInfo> info1 = mActions->actionById(mDefaultModel->id(mSortFilterProxyModel->mapToSource(rows[1])));
+        QPair<bool, GeneralActionInfo> info0 = mActions->actionById(mDefaultModel->id(mFilterModel->mapToSource(rows[0])));
+        QPair<bool, GeneralActionInfo> info1 = mActions->actionById(mDefaultModel->id(mFilterModel->mapToSource(rows[1])));
         enableSwap = (info0.first && info1.first && (info0.second.shortcut == info1.second.shortcut));
     }
     swap_PB->setEnabled(enableSwap);
@@ -153,13 +161,13 @@ void MainWindow::on_modify_PB_clicked()
 void MainWindow::on_swap_PB_clicked()
 {
     QModelIndexList rows = mSelectionModel->selectedRows();
-    mActions->swapActions(mDefaultModel->id(mSortFilterProxyModel->mapToSource(rows[0])), mDefaultModel->id(mSortFilterProxyModel->mapToSource(rows[1])));
+    mActions->swapActions(mDefaultModel->id(mFilterModel->mapToSource(rows[0])), mDefaultModel->id(mFilterModel->mapToSource(rows[1])));
 }
 
 void MainWindow::on_remove_PB_clicked()
 {
     foreach(QModelIndex rowIndex, mSelectionModel->selectedRows())
-        mActions->removeAction(mDefaultModel->id(mSortFilterProxyModel->mapToSource(rowIndex)));
+        mActions->removeAction(mDefaultModel->id(mFilterModel->mapToSource(rowIndex)));
 }
 
 void MainWindow::on_actions_TV_doubleClicked(const QModelIndex &index)
@@ -168,7 +176,7 @@ void MainWindow::on_actions_TV_doubleClicked(const QModelIndex &index)
     {
     case 0:
     {
-        qulonglong id = mDefaultModel->id(mSortFilterProxyModel->mapToSource(index));
+        qulonglong id = mDefaultModel->id(mFilterModel->mapToSource(index));
         mActions->enableAction(id, !mActions->isActionEnabled(id));
     }
         break;
@@ -187,7 +195,7 @@ void MainWindow::editAction(const QModelIndex &index)
 
     if (index.isValid())
     {
-        id = mDefaultModel->id(mSortFilterProxyModel->mapToSource(index));
+        id = mDefaultModel->id(mFilterModel->mapToSource(index));
     }
 
     if (!mEditActionDialog)
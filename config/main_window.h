@@ -36,7 +36,8 @@
 class Actions;
 class DefaultModel;
 class QItemSelectionModel;
-class QSortFilterProxyModel;
+class SearchIndex;
+class FilterModel;
 class EditActionDialog;
 
 class MainWindow : public QDialog, private Ui::MainWindow
@@ -65,12 +66,15 @@ protected slots:
 
     void on_multipleActionsBehaviour_CB_currentIndexChanged(int);
 
+    void on_filter_LE_textChanged(const QString &);
+
     void on_actions_TV_doubleClicked(const QModelIndex &);
 
 private:
     Actions *mActions;
     DefaultModel *mDefaultModel;
-    QSortFilterProxyModel *mSortFilterProxyModel;
+    SearchIndex *mSearchIndex;
+    FilterModel *mFilterModel;
     QItemSelectionModel *mSelectionModel;
     EditActionDialog *mEditActionDialog;
 
@@ -0,0 +1,190 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "search_index.h"
+#include "actions.h"
+
+#include <QRegExp>
+
+
+SearchIndex::SearchIndex(Actions *actions, QObject *parent)
+    : QObject(parent)
+    , mActions(actions)
+{
+    connect(actions, SIGNAL(daemonAppeared()), SLOT(daemonAppeared()));
+    connect(actions, SIGNAL(actionAdded(qulonglong)), SLOT(actionAdded(qulonglong)));
+    connect(actions, SIGNAL(actionModified(qulonglong)), SLOT(actionModified(qulonglong)));
+    connect(actions, SIGNAL(actionRemoved(qulonglong)), SLOT(actionRemoved(qulonglong)));
+}
+
+QStringList SearchIndex::tokenize(const QString &text)
+{
+    return text.toLower().split(QRegExp("\\W+"), QString::SkipEmptyParts);
+}
+
+void SearchIndex::setTypeNames(const QMap<QString, QString> &typeNames)
+{
+    mTypeNames = typeNames;
+
+    // entries indexed before the names were known
+    foreach(qulonglong id, mTokensById.keys())
+    {
+        remove(id);
+        insert(id);
+    }
+}
+
+void SearchIndex::insert(qulonglong id)
+{
+    QPair<bool, GeneralActionInfo> info = mActions->actionById(id);
+    if (!info.first)
+    {
+        return;
+    }
+
+    QStringList tokens = tokenize(info.second.shortcut + ' ' + info.second.description + ' ' + info.second.type + ' ' + mTypeNames.value(info.second.type) + ' ' + info.second.info);
+    tokens.removeDuplicates();
+
+    foreach(const QString &token, tokens)
+    {
+        mIdsByToken[token].insert(id);
+    }
+    mTokensById[id] = tokens;
+}
+
+void SearchIndex::remove(qulonglong id)
+{
+    TokensById::iterator tokensById = mTokensById.find(id);
+    if (tokensById == mTokensById.end())
+    {
+        return;
+    }
+
+    foreach(const QString &token, tokensById.value())
+    {
+        IdsByToken::iterator idsByToken = mIdsByToken.find(token);
+        if (idsByToken != mIdsByToken.end())
+        {
+            idsByToken.value().remove(id);
+            if (idsByToken.value().isEmpty())
+            {
+                mIdsByToken.erase(idsByToken);
+            }
+        }
+    }
+    mTokensById.erase(tokensById);
+}
+
+QSet<qulonglong> SearchIndex::findPrefix(const QString &prefix) const
+{
+    QSet<qulonglong> result;
+
+    IdsByToken::const_iterator lastIdsByToken = mIdsByToken.constEnd();
+    for (IdsByToken::const_iterator idsByToken = mIdsByToken.lowerBound(prefix); (idsByToken != lastIdsByToken) && idsByToken.key().startsWith(prefix); ++idsByToken)
+    {
+        result.unite(idsByToken.value());
+    }
+
+    return result;
+}
+
+QSet<qulonglong> SearchIndex::find(const QString &text) const
+{
+    QStringList queryTokens = tokenize(text);
+    if (queryTokens.isEmpty())
+    {
+        return mTokensById.keys().toSet();
+    }
+
+    QSet<qulonglong> result = findPrefix(queryTokens[0]);
+    for (int i = 1; (i < queryTokens.size()) && !result.isEmpty(); ++i)
+    {
+        result.intersect(findPrefix(queryTokens[i]));
+    }
+
+    return result;
+}
+
+bool SearchIndex::matches(qulonglong id, const QString &text) const
+{
+    TokensById::const_iterator tokensById = mTokensById.constFind(id);
+    if (tokensById == mTokensById.constEnd())
+    {
+        return false;
+    }
+
+    foreach(const QString &queryToken, tokenize(text))
+    {
+        bool found = false;
+        foreach(const QString &token, tokensById.value())
+        {
+            if (token.startsWith(queryToken))
+            {
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SearchIndex::daemonAppeared()
+{
+    mIdsByToken.clear();
+    mTokensById.clear();
+
+    foreach(qulonglong id, mActions->allActionIds())
+    {
+        insert(id);
+    }
+
+    emit indexRebuilt();
+}
+
+void SearchIndex::actionAdded(qulonglong id)
+{
+    insert(id);
+    emit actionIndexed(id);
+}
+
+void SearchIndex::actionModified(qulonglong id)
+{
+    remove(id);
+    insert(id);
+    emit actionIndexed(id);
+}
+
+void SearchIndex::actionRemoved(qulonglong id)
+{
+    remove(id);
+    emit actionIndexed(id);
+}
@@ -0,0 +1,86 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_CONFIG__SEARCH_INDEX__INCLUDED
+#define GLOBAL_ACTION_CONFIG__SEARCH_INDEX__INCLUDED
+
+
+#include <QObject>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+
+class Actions;
+
+// Token index over shortcut, description, type (as stored and as displayed) and info of every action.
+// Tokens are kept sorted, so a prefix lookup is a range scan.
+class SearchIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SearchIndex(Actions *actions, QObject *parent = 0);
+
+    static QStringList tokenize(const QString &text);
+
+    // the names the view shows for the types, so what the user reads can be searched for
+    void setTypeNames(const QMap<QString, QString> &typeNames);
+
+    // ids of actions that have a token starting with each of the query tokens
+    QSet<qulonglong> find(const QString &text) const;
+    bool matches(qulonglong id, const QString &text) const;
+
+signals:
+    void actionIndexed(qulonglong id);
+    void indexRebuilt();
+
+private slots:
+    void daemonAppeared();
+    void actionAdded(qulonglong id);
+    void actionModified(qulonglong id);
+    void actionRemoved(qulonglong id);
+
+private:
+    void insert(qulonglong id);
+    void remove(qulonglong id);
+
+    QSet<qulonglong> findPrefix(const QString &prefix) const;
+
+private:
+    Actions *mActions;
+
+    typedef QMap<QString, QSet<qulonglong> > IdsByToken;
+    IdsByToken mIdsByToken;
+
+    typedef QMap<qulonglong, QStringList> TokensById;
+    TokensById mTokensById;
+
+    QMap<QString, QString> mTypeNames;
+};
+
+#endif // GLOBAL_ACTION_CONFIG__SEARCH_INDEX__INCLUDED
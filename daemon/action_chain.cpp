@@ -0,0 +1,141 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "action_chain.h"
+#include "base_action.h"
+#include "log_target.h"
+
+#include <QMutexLocker>
+#include <QDBusPendingCallWatcher>
+
+
+ActionChain::ActionChain(LogTarget *logTarget, QMutex *dataMutex, QObject *parent)
+    : QObject(parent)
+    , mLogTarget(logTarget)
+    , mDataMutex(dataMutex)
+{
+}
+
+ActionChain::~ActionChain()
+{
+    QList<Chain>::const_iterator lastQueued = mQueued.constEnd();
+    for (QList<Chain>::const_iterator chain = mQueued.constBegin(); chain != lastQueued; ++chain)
+    {
+        release(chain->rest);
+    }
+
+    QHash<QDBusPendingCallWatcher *, Chain>::const_iterator lastWatched = mWatched.constEnd();
+    for (QHash<QDBusPendingCallWatcher *, Chain>::const_iterator watched = mWatched.constBegin(); watched != lastWatched; ++watched)
+    {
+        release(watched.value().rest);
+    }
+}
+
+void ActionChain::start(const ActionExecutor::IdsAndActions &candidates, qulonglong eventTime)
+{
+    int count = candidates.size();
+    for (int i = 0; i < count; ++i)
+    {
+        ActionCompletion completion = candidates[i].second->call(eventTime);
+
+        if (!completion.isPending())
+        {
+            if (completion.isSucceeded())
+            {
+                return;
+            }
+            continue;
+        }
+
+        Chain chain;
+        chain.id = candidates[i].first;
+        chain.call = completion.pendingCall();
+        chain.rest = candidates.mid(i + 1);
+        chain.eventTime = eventTime;
+
+        ActionExecutor::IdsAndActions::const_iterator lastRest = chain.rest.constEnd();
+        for (ActionExecutor::IdsAndActions::const_iterator action = chain.rest.constBegin(); action != lastRest; ++action)
+        {
+            action->second->ref();
+        }
+
+        {
+            QMutexLocker lock(&mQueuedMutex);
+            mQueued.push_back(chain);
+        }
+        QMetaObject::invokeMethod(this, "watchQueued", Qt::QueuedConnection);
+        return;
+    }
+}
+
+void ActionChain::watchQueued()
+{
+    QList<Chain> queued;
+    {
+        QMutexLocker lock(&mQueuedMutex);
+        queued.swap(mQueued);
+    }
+
+    QList<Chain>::const_iterator lastQueued = queued.constEnd();
+    for (QList<Chain>::const_iterator chain = queued.constBegin(); chain != lastQueued; ++chain)
+    {
+        // finished() is delivered even if the reply is already there
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(chain->call, this);
+        connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher *)), this, SLOT(callFinished(QDBusPendingCallWatcher *)));
+        mWatched.insert(watcher, *chain);
+    }
+}
+
+void ActionChain::callFinished(QDBusPendingCallWatcher *watcher)
+{
+    Chain chain = mWatched.take(watcher);
+    watcher->deleteLater();
+
+    // the X11 thread calls the same actions, client actions share their proxy state with it
+    QMutexLocker lock(mDataMutex);
+
+    if (!watcher->isError())
+    {
+        mLogTarget->log(LOG_DEBUG, "Action #%llu completed", chain.id);
+        release(chain.rest);
+        return;
+    }
+
+    mLogTarget->log(LOG_WARNING, "Action #%llu failed: %s", chain.id, qPrintable(watcher->error().message()));
+
+    start(chain.rest, chain.eventTime);
+    release(chain.rest);
+}
+
+void ActionChain::release(const ActionExecutor::IdsAndActions &actions)
+{
+    ActionExecutor::IdsAndActions::const_iterator lastActions = actions.constEnd();
+    for (ActionExecutor::IdsAndActions::const_iterator action = actions.constBegin(); action != lastActions; ++action)
+    {
+        action->second->release();
+    }
+}
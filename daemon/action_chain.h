@@ -0,0 +1,83 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__ACTION_CHAIN__INCLUDED
+#define GLOBAL_ACTION_DAEMON__ACTION_CHAIN__INCLUDED
+
+
+#include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QList>
+#include <QDBusPendingCall>
+
+#include "action_executor.h"
+
+
+class LogTarget;
+class QDBusPendingCallWatcher;
+
+// Falls through the candidates of MULTIPLE_ACTIONS_BEHAVIOUR_FIRST/LAST: the next one is called
+// only when the previous one failed. A pending D-Bus reply is waited for on the main thread's
+// event loop, so the thread that started the chain never blocks on a remote service.
+class ActionChain : public QObject
+{
+    Q_OBJECT
+public:
+    // dataMutex guards the actions, it is held while the chain calls them from the main thread
+    ActionChain(LogTarget *logTarget, QMutex *dataMutex, QObject *parent = 0);
+    ~ActionChain();
+
+    // may be called from any thread, with dataMutex held; eventTime is passed to the actions
+    void start(const ActionExecutor::IdsAndActions &candidates, qulonglong eventTime);
+
+private slots:
+    void watchQueued();
+    void callFinished(QDBusPendingCallWatcher *watcher);
+
+private:
+    typedef struct Chain
+    {
+        qulonglong id;
+        QDBusPendingCall call;
+        ActionExecutor::IdsAndActions rest; // referenced
+        qulonglong eventTime;
+    } Chain;
+
+    static void release(const ActionExecutor::IdsAndActions &actions);
+
+private:
+    LogTarget *mLogTarget;
+    QMutex *mDataMutex;
+
+    QMutex mQueuedMutex;
+    QList<Chain> mQueued;
+
+    QHash<QDBusPendingCallWatcher *, Chain> mWatched;
+};
+
+#endif // GLOBAL_ACTION_DAEMON__ACTION_CHAIN__INCLUDED
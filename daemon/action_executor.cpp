@@ -0,0 +1,143 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "action_executor.h"
+#include "base_action.h"
+#include "client_action.h"
+#include "log_target.h"
+#include "trace.h"
+
+#include <QRunnable>
+#include <QMutex>
+#include <QMutexLocker>
+#include <cstring>
+
+
+namespace
+{
+
+class ActionRunnable : public QRunnable
+{
+public:
+    ActionRunnable(LogTarget *logTarget, QMutex *dataMutex, const ActionExecutor::IdsAndActions &actions, qulonglong eventTime)
+        : mLogTarget(logTarget)
+        , mDataMutex(dataMutex)
+        , mActions(actions)
+        , mEventTime(eventTime)
+    {
+        ActionExecutor::IdsAndActions::const_iterator lastActions = mActions.constEnd();
+        for (ActionExecutor::IdsAndActions::const_iterator action = mActions.constBegin(); action != lastActions; ++action)
+        {
+            action->second->ref();
+        }
+    }
+
+    ~ActionRunnable()
+    {
+        ActionExecutor::IdsAndActions::const_iterator lastActions = mActions.constEnd();
+        for (ActionExecutor::IdsAndActions::const_iterator action = mActions.constBegin(); action != lastActions; ++action)
+        {
+            action->second->release();
+        }
+    }
+
+    void run()
+    {
+        ActionExecutor::IdsAndActions::const_iterator lastActions = mActions.constEnd();
+        for (ActionExecutor::IdsAndActions::const_iterator action = mActions.constBegin(); action != lastActions; ++action)
+        {
+            quint64 start = Trace::now();
+            // a pool thread may wait for the reply, it is what bounds the parallelism
+            ActionCompletion completion = call(action->second);
+            completion.waitForFinished();
+            mLogTarget->log(LOG_DEBUG, "Action #%llu %s in %llu us", action->first, completion.isSucceeded() ? "completed" : "failed", static_cast<unsigned long long>(Trace::now() - start));
+        }
+    }
+
+private:
+    ActionCompletion call(BaseAction *action)
+    {
+        if (strcmp(action->type(), ClientAction::id()))
+        {
+            return action->call(mEventTime);
+        }
+        // only queues a D-Bus signal, but a removed client detaches its actions under the lock
+        QMutexLocker lock(mDataMutex);
+        return action->call(mEventTime);
+    }
+
+private:
+    LogTarget *mLogTarget;
+    QMutex *mDataMutex;
+    ActionExecutor::IdsAndActions mActions;
+    qulonglong mEventTime;
+};
+
+}
+
+
+ActionExecutor::ActionExecutor(LogTarget *logTarget, QMutex *dataMutex, int maxThreads)
+    : mLogTarget(logTarget)
+    , mDataMutex(dataMutex)
+{
+    setMaxThreads(maxThreads);
+}
+
+ActionExecutor::~ActionExecutor()
+{
+    mPool.waitForDone();
+}
+
+void ActionExecutor::setMaxThreads(int maxThreads)
+{
+    mPool.setMaxThreadCount(qMax(1, maxThreads));
+}
+
+int ActionExecutor::maxThreads() const
+{
+    return mPool.maxThreadCount();
+}
+
+void ActionExecutor::run(const IdsAndActions &actions, bool strict, qulonglong eventTime)
+{
+    if (actions.isEmpty())
+    {
+        return;
+    }
+
+    if (strict)
+    {
+        mPool.start(new ActionRunnable(mLogTarget, mDataMutex, actions, eventTime));
+        return;
+    }
+
+    IdsAndActions::const_iterator lastActions = actions.constEnd();
+    for (IdsAndActions::const_iterator action = actions.constBegin(); action != lastActions; ++action)
+    {
+        mPool.start(new ActionRunnable(mLogTarget, mDataMutex, IdsAndActions() << *action, eventTime));
+    }
+}
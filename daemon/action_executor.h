@@ -0,0 +1,71 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__ACTION_EXECUTOR__INCLUDED
+#define GLOBAL_ACTION_DAEMON__ACTION_EXECUTOR__INCLUDED
+
+
+#include <QThreadPool>
+#include <QList>
+#include <QPair>
+
+
+class LogTarget;
+class BaseAction;
+class QMutex;
+
+// Runs the actions bound to one shortcut off the X11 thread on a bounded pool,
+// so a slow action does not hold back the others.
+class ActionExecutor
+{
+public:
+    typedef QPair<qulonglong, BaseAction *> IdAndAction;
+    typedef QList<IdAndAction> IdsAndActions;
+
+    // dataMutex guards the client actions, their proxy state is shared with the X11 thread
+    ActionExecutor(LogTarget *logTarget, QMutex *dataMutex, int maxThreads);
+    // waits for the running actions
+    ~ActionExecutor();
+
+    void setMaxThreads(int maxThreads);
+    int maxThreads() const;
+
+    // strict: one after another in the given order, otherwise each action on its own;
+    // may be called with dataMutex held; eventTime is passed to the actions
+    void run(const IdsAndActions &actions, bool strict, qulonglong eventTime);
+
+private:
+    ActionExecutor(const ActionExecutor &);
+    ActionExecutor &operator = (const ActionExecutor &);
+
+private:
+    LogTarget *mLogTarget;
+    QMutex *mDataMutex;
+    QThreadPool mPool;
+};
+
+#endif // GLOBAL_ACTION_DAEMON__ACTION_EXECUTOR__INCLUDED
@@ -31,7 +31,8 @@
 
 BaseAction::BaseAction(LogTarget *logTarget, const QString &description)
     : mLogTarget(logTarget)
-    , mDescription(description)
+    , mRefs(1)
+    , mDescription(StringPool::intern(description))
     , mEnabled(true)
 {
 }
@@ -30,6 +30,11 @@
 
 
 #include <QString>
+#include <QStringList>
+#include <QAtomicInt>
+
+#include "string_pool.h"
+#include "action_completion.h"
 
 class LogTarget;
 
@@ -41,22 +46,44 @@ public:
 
     virtual const char *type() const = 0;
 
-    virtual bool call() = 0;
+    // eventTime is the X server time of the key press, milliseconds;
+    // a pending completion is finished by the D-Bus reply, the caller must not block the event loop waiting for it
+    virtual ActionCompletion call(qulonglong eventTime) = 0;
+
+    // an action running on the executor is kept alive by its reference,
+    // so the owner releases it instead of deleting it
+    void ref() { mRefs.ref(); }
+    void release() { if (!mRefs.deref()) delete this; }
 
     const QString &description() const { return mDescription; }
-    void setDescription(const QString &description) { mDescription = description; }
+    void setDescription(const QString &description) { mDescription = StringPool::intern(description); }
 
     void setEnabled(bool value = true) { mEnabled = value; }
     void setDisabled(bool value = true) { mEnabled = !value; }
     bool isEnabled() const { return mEnabled; }
 
+    // empty means the action belongs to every profile
+    const QStringList &profiles() const { return mProfiles; }
+    void setProfiles(const QStringList &profiles) { mProfiles = StringPool::intern(profiles); }
+    bool inProfile(const QString &profile) const { return mProfiles.isEmpty() || mProfiles.contains(profile); }
+
+    // WM_CLASS class of the focused window the action is restricted to, empty means any
+    const QString &context() const { return mContext; }
+    void setContext(const QString &context) { mContext = StringPool::intern(context); }
+    bool inContext(const QString &windowClass) const { return mContext.isEmpty() || !mContext.compare(windowClass, Qt::CaseInsensitive); }
+
 protected:
     LogTarget *mLogTarget;
 
 private:
+    QAtomicInt mRefs;
+
     QString mDescription;
 
     bool mEnabled;
+
+    QStringList mProfiles;
+    QString mContext;
 };
 
 #endif // GLOBAL_ACTION_DAEMON__BASE_ACTION__INCLUDED
@@ -0,0 +1,666 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QDBusObjectPath>
+#include <QDBusArgument>
+#include <QProcessEnvironment>
+#include <QtAlgorithms>
+
+#include "meta_types.h"
+#include "trace.h"
+
+#include "churn_benchmark.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+extern "C" {
+#include <X11/keysym.h>
+#ifdef HAVE_XTEST
+#include <X11/extensions/XTest.h>
+#endif
+}
+
+
+static const char *service = "org.lxqt.global_key_shortcuts";
+static const char *nativeInterface = "org.lxqt.global_key_shortcuts.native";
+static const char *daemonInterface = "org.lxqt.global_key_shortcuts.daemon";
+
+// a key press left unanswered this long is counted as lost
+static const quint64 probeTimeout = 1000000ull;
+// time for the daemon to come up, and for it to drop the actions of the vanished clients
+static const int settleTimeout = 10000;
+
+static const char churnKeys[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+static const int churnShortcuts = sizeof(churnKeys) - 1;
+
+// rarely bound elsewhere, so the grabs do not fail on a desktop
+static QString churnShortcut(int index)
+{
+    return QString("Shift+Control+Alt+Meta+") + QChar(churnKeys[index % churnShortcuts]);
+}
+
+static quint64 percentile(const QVector<quint64> &sorted, double fraction)
+{
+    if (sorted.isEmpty())
+    {
+        return 0;
+    }
+    int index = static_cast<int>(fraction * sorted.size());
+    return sorted[qMin(index, sorted.size() - 1)];
+}
+
+static void printLatencies(const char *title, QVector<quint64> latencies)
+{
+    qSort(latencies);
+    printf("%s (us): p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu\n",
+           title,
+           percentile(latencies, 0.5),
+           percentile(latencies, 0.9),
+           percentile(latencies, 0.99),
+           percentile(latencies, 0.999),
+           latencies.isEmpty() ? 0ull : latencies.last());
+}
+
+
+ChurnClient::ChurnClient(const QString &address, int index, int actions, int generations)
+    : QThread()
+    , mAddress(address)
+    , mIndex(index)
+    , mActions(actions)
+    , mGenerations(generations)
+    , mFailures(0)
+{
+    mLatencies.reserve(mActions * mGenerations * 6);
+}
+
+QDBusMessage ChurnClient::call(QDBusConnection &connection, const QString &method, const QList<QVariant> &arguments)
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(service, "/native", nativeInterface, method);
+    message.setArguments(arguments);
+
+    quint64 start = Trace::now();
+    QDBusMessage reply = connection.call(message, QDBus::Block);
+    mLatencies.push_back(Trace::now() - start);
+
+    if (reply.type() != QDBusMessage::ReplyMessage)
+    {
+        ++mFailures;
+    }
+    return reply;
+}
+
+void ChurnClient::run()
+{
+    for (int generation = 0; generation < mGenerations; ++generation)
+    {
+        QString name = QString("churn_client_%1_%2").arg(mIndex).arg(generation);
+
+        {
+            QDBusConnection connection = QDBusConnection::connectToBus(mAddress, name);
+            if (!connection.isConnected())
+            {
+                mFailures += mActions;
+                QDBusConnection::disconnectFromBus(name);
+                continue;
+            }
+
+            for (int i = 0; i < mActions; ++i)
+            {
+                call(connection, "addClientAction", QList<QVariant>()
+                     << churnShortcut(mIndex + i)
+                     << QVariant::fromValue(QDBusObjectPath(QString("/churn/%1").arg(i)))
+                     << QString("Churn action %1").arg(i));
+            }
+            for (int i = 0; i < mActions; ++i)
+            {
+                QVariant path = QVariant::fromValue(QDBusObjectPath(QString("/churn/%1").arg(i)));
+
+                call(connection, "changeClientActionShortcut", QList<QVariant>() << path << churnShortcut(mIndex + i + 1));
+                call(connection, "enableClientAction", QList<QVariant>() << path << false);
+                call(connection, "enableClientAction", QList<QVariant>() << path << true);
+                call(connection, "modifyClientAction", QList<QVariant>() << path << QString("Churned action %1").arg(i));
+            }
+            // the other half goes with the bus name
+            for (int i = 0; i < mActions; i += 2)
+            {
+                call(connection, "removeClientAction", QList<QVariant>() << QVariant::fromValue(QDBusObjectPath(QString("/churn/%1").arg(i))));
+            }
+        }
+
+        QDBusConnection::disconnectFromBus(name);
+    }
+}
+
+
+KeyPressProbe::KeyPressProbe(Display *display, int interval, QObject *parent)
+    : QObject(parent)
+    , mDisplay(display)
+    , mPressed(0)
+    , mLost(0)
+{
+    mTimer.setInterval(interval);
+    connect(&mTimer, SIGNAL(timeout()), this, SLOT(press()));
+}
+
+void KeyPressProbe::start()
+{
+    mTimer.start();
+}
+
+void KeyPressProbe::stop()
+{
+    mTimer.stop();
+    if (mPressed)
+    {
+        ++mLost;
+        mPressed = 0;
+    }
+}
+
+void KeyPressProbe::press()
+{
+    if (mPressed)
+    {
+        if (Trace::now() - mPressed < probeTimeout)
+        {
+            return;
+        }
+        ++mLost;
+    }
+
+#ifdef HAVE_XTEST
+    static const KeySym keySyms[] = {XK_Shift_L, XK_Control_L, XK_Alt_L, XK_F12};
+    static const int keys = sizeof(keySyms) / sizeof(keySyms[0]);
+
+    for (int i = 0; i < keys; ++i)
+    {
+        XTestFakeKeyEvent(mDisplay, XKeysymToKeycode(mDisplay, keySyms[i]), True, CurrentTime);
+    }
+    for (int i = keys - 1; i >= 0; --i)
+    {
+        XTestFakeKeyEvent(mDisplay, XKeysymToKeycode(mDisplay, keySyms[i]), False, CurrentTime);
+    }
+    XFlush(mDisplay);
+#endif
+
+    mPressed = Trace::now();
+}
+
+void KeyPressProbe::activated()
+{
+    if (mPressed)
+    {
+        mLatencies.push_back(Trace::now() - mPressed);
+        mPressed = 0;
+    }
+}
+
+void KeyPressProbe::shortcutChanged(const QString &/*oldShortcut*/, const QString &/*newShortcut*/)
+{
+}
+
+
+ChurnBenchmark::ChurnBenchmark(const QString &daemon, const QString &displayName, int clients, int actions, int generations)
+    : QObject()
+    , mDaemon(daemon)
+    , mDisplayName(displayName)
+    , mClients(clients)
+    , mActions(actions)
+    , mGenerations(generations)
+    , mConfigFile(QDir::temp().filePath(QString("churn_benchmark_%1.conf").arg(QCoreApplication::applicationPid())))
+    , mRunning(0)
+{
+}
+
+ChurnBenchmark::~ChurnBenchmark()
+{
+    if (mDaemonProcess.state() != QProcess::NotRunning)
+    {
+        callDaemon("quit");
+        if (!mDaemonProcess.waitForFinished(settleTimeout))
+        {
+            mDaemonProcess.kill();
+            mDaemonProcess.waitForFinished();
+        }
+    }
+    QDBusConnection::disconnectFromBus("churn_benchmark_control");
+    QDBusConnection::disconnectFromBus("churn_benchmark_probe");
+
+    if (mBus.state() != QProcess::NotRunning)
+    {
+        mBus.terminate();
+        if (!mBus.waitForFinished(settleTimeout))
+        {
+            mBus.kill();
+            mBus.waitForFinished();
+        }
+    }
+
+    QFile::remove(mConfigFile);
+
+    while (!mChurnClients.isEmpty())
+    {
+        delete mChurnClients.takeFirst();
+    }
+}
+
+bool ChurnBenchmark::startBus()
+{
+    mBus.start("dbus-daemon", QStringList() << "--session" << "--nofork" << "--print-address");
+    if (!mBus.waitForStarted() || !mBus.waitForReadyRead(settleTimeout))
+    {
+        return false;
+    }
+    mAddress = QString::fromLocal8Bit(mBus.readLine()).trimmed();
+    return !mAddress.isEmpty();
+}
+
+bool ChurnBenchmark::startDaemon()
+{
+    // an empty config, so the only actions are the ones the clients add
+    QFile config(mConfigFile);
+    if (!config.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        fprintf(stderr, "Cannot create %s\n", qPrintable(mConfigFile));
+        return false;
+    }
+    config.close();
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert("DBUS_SESSION_BUS_ADDRESS", mAddress);
+    mDaemonProcess.setProcessEnvironment(environment);
+    mDaemonProcess.setProcessChannelMode(QProcess::ForwardedChannels);
+
+    QStringList arguments;
+    arguments << "--no-daemon" << "--log-level=warning" << QString("--config-file=") + mConfigFile;
+    if (!mDisplayName.isEmpty())
+    {
+        arguments << QString("--display=") + mDisplayName;
+    }
+    mDaemonProcess.start(mDaemon, arguments);
+    if (!mDaemonProcess.waitForStarted())
+    {
+        fprintf(stderr, "Cannot start %s\n", qPrintable(mDaemon));
+        return false;
+    }
+
+    quint64 start = Trace::now();
+    while (Trace::now() - start < settleTimeout * 1000ull)
+    {
+        QDBusMessage reply = callDaemon("isReady");
+        if ((reply.type() == QDBusMessage::ReplyMessage) && reply.arguments().value(0).toBool())
+        {
+            return true;
+        }
+        if (mDaemonProcess.state() == QProcess::NotRunning)
+        {
+            break;
+        }
+        usleep(50000);
+    }
+    fprintf(stderr, "%s did not get ready\n", qPrintable(mDaemon));
+    return false;
+}
+
+QDBusMessage ChurnBenchmark::callDaemon(const QString &method)
+{
+    QDBusConnection connection = QDBusConnection::connectToBus(mAddress, "churn_benchmark_control");
+    return connection.call(QDBusMessage::createMethodCall(service, "/daemon", daemonInterface, method), QDBus::Block);
+}
+
+QMap<QString, qulonglong> ChurnBenchmark::memoryUsage()
+{
+    QMap<QString, qulonglong> result;
+    QDBusMessage reply = callDaemon("getMemoryUsage");
+    if (reply.type() == QDBusMessage::ReplyMessage)
+    {
+        reply.arguments().value(0).value<QDBusArgument>() >> result;
+    }
+    return result;
+}
+
+int ChurnBenchmark::clientActions()
+{
+    QMap<qulonglong, GeneralActionInfo> actions;
+    QDBusMessage reply = callDaemon("getAllActions");
+    if (reply.type() != QDBusMessage::ReplyMessage)
+    {
+        return -1;
+    }
+    reply.arguments().value(0).value<QDBusArgument>() >> actions;
+
+    int result = 0;
+    foreach(const GeneralActionInfo &action, actions)
+    {
+        if (action.type == "client")
+        {
+            ++result;
+        }
+    }
+    return result;
+}
+
+bool ChurnBenchmark::waitDrained(int expectedActions, qulonglong expectedTables, int &actionsLeft, qulonglong &tables)
+{
+    // the daemon drops the actions of a vanished client once the bus tells it, so give it time
+    quint64 start = Trace::now();
+    for (;;)
+    {
+        actionsLeft = clientActions();
+        tables = memoryUsage().value("tables");
+        if ((actionsLeft == expectedActions) && (!expectedTables || (tables == expectedTables)))
+        {
+            return true;
+        }
+        if (Trace::now() - start >= settleTimeout * 1000ull)
+        {
+            return false;
+        }
+        usleep(100000);
+    }
+}
+
+void ChurnBenchmark::clientFinished()
+{
+    if (!--mRunning)
+    {
+        mLoop.quit();
+    }
+}
+
+int ChurnBenchmark::run()
+{
+    Display *display = XOpenDisplay(mDisplayName.isEmpty() ? 0 : qPrintable(mDisplayName));
+    if (!display)
+    {
+        printf("No X display, skipped\n");
+        return skipReturnCode;
+    }
+
+    if (!startBus())
+    {
+        printf("Cannot start a private dbus-daemon, skipped\n");
+        XCloseDisplay(display);
+        return skipReturnCode;
+    }
+
+    if (!startDaemon())
+    {
+        XCloseDisplay(display);
+        return EXIT_FAILURE;
+    }
+
+    bool probing = false;
+#ifdef HAVE_XTEST
+    int eventBase, errorBase, majorVersion, minorVersion;
+    probing = XTestQueryExtension(display, &eventBase, &errorBase, &majorVersion, &minorVersion);
+#endif
+
+    KeyPressProbe probe(display, 20);
+    QDBusConnection probeConnection = QDBusConnection::connectToBus(mAddress, "churn_benchmark_probe");
+    QDBusObjectPath probePath("/churn/probe");
+    if (probing)
+    {
+        probeConnection.registerObject(probePath.path(), &probe, QDBusConnection::ExportAllSlots);
+
+        QDBusMessage message = QDBusMessage::createMethodCall(service, "/native", nativeInterface, "addClientAction");
+        message.setArguments(QList<QVariant>() << QString(KeyPressProbe::shortcut()) << QVariant::fromValue(probePath) << QString("Key press probe"));
+        QDBusMessage reply = probeConnection.call(message, QDBus::Block);
+        if ((reply.type() != QDBusMessage::ReplyMessage) || reply.arguments().value(0).toString().isEmpty())
+        {
+            fprintf(stderr, "Cannot bind the probe to %s, key press latency is not measured\n", KeyPressProbe::shortcut());
+            probing = false;
+        }
+    }
+
+    int probeActions = probing ? 1 : 0;
+
+    // the daemon keeps the keys of every shortcut it has seen, one client using them all
+    // fills that cache, so the tables can be compared before and after the churn
+    ChurnClient warmUp(mAddress, mClients, churnShortcuts, 1);
+    warmUp.start();
+    warmUp.wait();
+    int actionsLeft = -1;
+    qulonglong tablesBefore = 0;
+    if (warmUp.failures() || !waitDrained(probeActions, 0, actionsLeft, tablesBefore))
+    {
+        fprintf(stderr, "The warm-up client did not drain, %d client actions left\n", actionsLeft);
+        XCloseDisplay(display);
+        return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < mClients; ++i)
+    {
+        ChurnClient *client = new ChurnClient(mAddress, i, mActions, mGenerations);
+        connect(client, SIGNAL(finished()), this, SLOT(clientFinished()));
+        mChurnClients.push_back(client);
+    }
+
+    quint64 start = Trace::now();
+    mRunning = mClients;
+    foreach(ChurnClient *client, mChurnClients)
+    {
+        client->start();
+    }
+    if (probing)
+    {
+        probe.start();
+    }
+    if (mRunning)
+    {
+        mLoop.exec();
+    }
+    quint64 elapsed = Trace::now() - start;
+    probe.stop();
+
+    QVector<quint64> latencies;
+    int failures = 0;
+    foreach(const ChurnClient *client, mChurnClients)
+    {
+        latencies += client->latencies();
+        failures += client->failures();
+    }
+
+    qulonglong tablesAfter = 0;
+    bool consistent = waitDrained(probeActions, tablesBefore, actionsLeft, tablesAfter);
+
+    if (probing)
+    {
+        QDBusMessage message = QDBusMessage::createMethodCall(service, "/native", nativeInterface, "removeClientAction");
+        message.setArguments(QList<QVariant>() << QVariant::fromValue(probePath));
+        probeConnection.call(message, QDBus::Block);
+    }
+    probeConnection.unregisterObject(probePath.path());
+
+    printf("%d clients x %d generations x %d actions\n", mClients, mGenerations, mActions);
+    printf("API calls: %d in %.3f s, %.0f calls/s, %d failed\n",
+           latencies.size(), elapsed / 1e6, elapsed ? latencies.size() * 1e6 / elapsed : 0.0, failures);
+    printLatencies("API call latency", latencies);
+    if (probing)
+    {
+        printf("Key presses: %d activated, %d lost\n", probe.latencies().size(), probe.lost());
+        printLatencies("Key press latency", probe.latencies());
+    }
+    else
+    {
+        printf("Key press latency: not measured (no XTest)\n");
+    }
+    printf("Tables: %s, %d client actions left (%d expected), %llu bytes of tables (%llu before)\n",
+           consistent ? "consistent" : "INCONSISTENT", actionsLeft, probeActions, tablesAfter, tablesBefore);
+
+    XCloseDisplay(display);
+
+    return (consistent && !failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static bool parseCount(const char *str, int &count)
+{
+    char *end;
+    long value = strtol(str, &end, 10);
+    if (*end || (value < 1) || (value > 1000000))
+    {
+        fprintf(stderr, "Invalid count: %s\n", str);
+        return false;
+    }
+    count = static_cast<int>(value);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QString daemon;
+    QString displayName;
+    int clients = 32;
+    int actions = 100;
+    int generations = 5;
+    bool printHelp = false;
+    bool wrongArgs = false;
+
+    static struct option longOptions[] =
+    {
+        {"daemon", required_argument, 0, 'd'},
+        {"display", required_argument, 0, 'D'},
+        {"clients", required_argument, 0, 'c'},
+        {"actions", required_argument, 0, 'a'},
+        {"generations", required_argument, 0, 'g'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    for (;;)
+    {
+        int optionIndex = 0;
+
+        int c = getopt_long(argc, argv, "h?", longOptions, &optionIndex);
+
+        if (c == -1)
+        {
+            break;
+        }
+
+        switch (c)
+        {
+        case 'd':
+            daemon = QString::fromLocal8Bit(optarg);
+            break;
+
+        case 'D':
+            displayName = QString::fromLocal8Bit(optarg);
+            break;
+
+        case 'c':
+            if (!parseCount(optarg, clients))
+            {
+                wrongArgs = true;
+                printHelp = true;
+            }
+            break;
+
+        case 'a':
+            if (!parseCount(optarg, actions))
+            {
+                wrongArgs = true;
+                printHelp = true;
+            }
+            break;
+
+        case 'g':
+            if (!parseCount(optarg, generations))
+            {
+                wrongArgs = true;
+                printHelp = true;
+            }
+            break;
+
+        case '?':
+        case 'h':
+            printHelp = true;
+            break;
+
+        default:
+            wrongArgs = true;
+            printHelp = true;
+        }
+    }
+
+    if (daemon.isEmpty() && !printHelp)
+    {
+        fprintf(stderr, "No daemon given\n");
+        wrongArgs = true;
+        printHelp = true;
+    }
+
+    if (printHelp)
+    {
+        printf("Global key shortcuts daemon churn benchmark\n"
+               "\n"
+               "Runs the daemon on a private D-Bus, has native clients add, change, enable\n"
+               "and remove actions and then vanish, all at once, and presses a shortcut\n"
+               "meanwhile. Reports throughput, call and key press latency, and whether\n"
+               "the daemon's tables drain back once all clients are gone.\n"
+               "\n"
+               "Usage %s --daemon=FILENAME [OPTIONS]\n"
+               "\n"
+               "Possible options are:\n"
+               "\n"
+               "  --daemon=FILENAME\n"
+               "      The daemon executable to run.\n"
+               "\n"
+               "  --display=NAME\n"
+               "      X display for the daemon and the key presses, $DISPLAY by default.\n"
+               "\n"
+               "  --clients=COUNT\n"
+               "      Clients running at once, 32 by default.\n"
+               "\n"
+               "  --actions=COUNT\n"
+               "      Actions of each client, 100 by default.\n"
+               "\n"
+               "  --generations=COUNT\n"
+               "      Times each client connects, churns and vanishes, 5 by default.\n"
+               "\n"
+               "  --help\n"
+               "  -h\n"
+               "  -?\n"
+               "      Print this help.\n"
+               "\n"
+               "Exits with %d if there is no X display or no dbus-daemon to run on.\n"
+               , argv[0], ChurnBenchmark::skipReturnCode);
+        return wrongArgs ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    QCoreApplication app(argc, argv);
+
+    ChurnBenchmark benchmark(daemon, displayName, clients, actions, generations);
+    return benchmark.run();
+}
@@ -0,0 +1,152 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__CHURN_BENCHMARK__INCLUDED
+#define GLOBAL_ACTION_DAEMON__CHURN_BENCHMARK__INCLUDED
+
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QEventLoop>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QList>
+#include <QMap>
+#include <QDBusConnection>
+#include <QDBusMessage>
+
+extern "C" {
+#include <X11/Xlib.h>
+}
+
+
+// One native client of a logout/login storm. Every generation connects under a new bus name,
+// adds its actions, changes, disables, re-enables and modifies them, removes half of them
+// and then vanishes with the rest still registered, as an application that quits does.
+class ChurnClient : public QThread
+{
+public:
+    ChurnClient(const QString &address, int index, int actions, int generations);
+
+    const QVector<quint64> &latencies() const { return mLatencies; } // microseconds, one per call
+    int failures() const { return mFailures; }
+
+private:
+    void run();
+    QDBusMessage call(QDBusConnection &connection, const QString &method, const QList<QVariant> &arguments);
+
+private:
+    QString mAddress;
+    int mIndex;
+    int mActions;
+    int mGenerations;
+
+    QVector<quint64> mLatencies;
+    int mFailures;
+};
+
+// A client action on a shortcut of its own, pressed through XTest;
+// times the activation arriving over the bus while the churn goes on.
+class KeyPressProbe : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.lxqt.global_key_shortcuts.client")
+public:
+    KeyPressProbe(Display *display, int interval, QObject *parent = 0);
+
+    static const char *shortcut() { return "Shift+Control+Alt+F12"; }
+
+    void start();
+    void stop();
+
+    const QVector<quint64> &latencies() const { return mLatencies; } // microseconds, one per activation
+    int lost() const { return mLost; }
+
+public slots:
+    void activated();
+    void shortcutChanged(const QString &oldShortcut, const QString &newShortcut);
+
+private slots:
+    void press();
+
+private:
+    Display *mDisplay;
+    QTimer mTimer;
+
+    quint64 mPressed; // 0 while no activation is due
+    QVector<quint64> mLatencies;
+    int mLost;
+};
+
+// Runs the daemon on a private bus, lets the clients loose on it and reports
+// throughput, call latency, key press latency and whether the tables drain back.
+class ChurnBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    ChurnBenchmark(const QString &daemon, const QString &displayName, int clients, int actions, int generations);
+    ~ChurnBenchmark();
+
+    // EXIT_SUCCESS, EXIT_FAILURE, or skipReturnCode when there is no display or no dbus-daemon
+    int run();
+
+    static const int skipReturnCode = 77;
+
+private slots:
+    void clientFinished();
+
+private:
+    bool startBus();
+    bool startDaemon();
+    QDBusMessage callDaemon(const QString &method);
+    QMap<QString, qulonglong> memoryUsage();
+    int clientActions();
+    // until only expectedActions client actions are left and, unless 0, the tables take expectedTables bytes
+    bool waitDrained(int expectedActions, qulonglong expectedTables, int &actionsLeft, qulonglong &tables);
+
+private:
+    QString mDaemon;
+    QString mDisplayName;
+    int mClients;
+    int mActions;
+    int mGenerations;
+
+    QProcess mBus;
+    QString mAddress;
+    QProcess mDaemonProcess;
+    QString mConfigFile;
+
+    QList<ChurnClient *> mChurnClients;
+    int mRunning;
+    QEventLoop mLoop;
+};
+
+#endif // GLOBAL_ACTION_DAEMON__CHURN_BENCHMARK__INCLUDED
@@ -0,0 +1,351 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+#include <QMutexLocker>
+#include <QDBusArgument>
+
+#include "meta_types.h"
+#include "command_action.h"
+#include "config_saver.h"
+#include "keysym_table.h"
+#include "core.h"
+
+#include "core_benchmark.h"
+
+extern "C" {
+#include <X11/keysym.h>
+}
+
+
+MockX11Connection::MockX11Connection(Core *core)
+    : X11Connection(core)
+{
+    QHash<KeyCode, KeycodeTable::KeySymsByGroup> keys;
+    QList<KeySym> all = keySyms();
+    for (int i = 0; i < all.size(); ++i)
+    {
+        // one group with one level
+        keys[static_cast<KeyCode>(8 + i)] = KeycodeTable::KeySymsByGroup() << (QList<KeySym>() << all[i]);
+    }
+    keycodeTable().rebuild(keys);
+}
+
+QList<KeySym> MockX11Connection::keySyms()
+{
+    QList<KeySym> result;
+    for (KeySym keySym = XK_a; keySym <= XK_z; ++keySym)
+    {
+        result.push_back(keySym);
+    }
+    for (KeySym keySym = XK_0; keySym <= XK_9; ++keySym)
+    {
+        result.push_back(keySym);
+    }
+    for (KeySym keySym = XK_F1; keySym <= XK_F35; ++keySym)
+    {
+        result.push_back(keySym);
+    }
+    for (KeySym keySym = XK_KP_0; keySym <= XK_KP_9; ++keySym)
+    {
+        result.push_back(keySym);
+    }
+    // Latin-1, fills the keyboard up to 177 keys
+    for (KeySym keySym = XK_nobreakspace; keySym <= XK_ydiaeresis; ++keySym)
+    {
+        if (keysymToString(keySym))
+        {
+            result.push_back(keySym);
+        }
+    }
+    return result;
+}
+
+QStringList MockX11Connection::allShortcuts()
+{
+    static const char *const modifierNames[] = {"Shift+", "Control+", "Alt+", "Meta+", "Level3+", "Level5+"};
+
+    QStringList keyNames;
+    foreach(KeySym keySym, keySyms())
+    {
+        keyNames.push_back(QString::fromLatin1(keysymToString(keySym)));
+    }
+
+    // unmodified keys first, so small tables look like a real config
+    QStringList result;
+    for (int modifiers = 0; modifiers < (1 << 6); ++modifiers)
+    {
+        QString prefix;
+        for (int i = 0; i < 6; ++i)
+        {
+            if (modifiers & (1 << i))
+            {
+                prefix += modifierNames[i];
+            }
+        }
+        foreach(const QString &keyName, keyNames)
+        {
+            result.push_back(prefix + keyName);
+        }
+    }
+    return result;
+}
+
+
+CoreBenchmark::CoreBenchmark()
+    : QObject()
+{
+}
+
+void CoreBenchmark::initTestCase()
+{
+    mShortcuts = MockX11Connection::allShortcuts();
+}
+
+void CoreBenchmark::cleanupTestCase()
+{
+    QMap<int, Core *>::const_iterator lastCore = mCores.constEnd();
+    for (QMap<int, Core *>::const_iterator core = mCores.constBegin(); core != lastCore; ++core)
+    {
+        QFile::remove(configFile(core.key()));
+        delete core.value();
+    }
+    mCores.clear();
+}
+
+void CoreBenchmark::addBindingsRows()
+{
+    QTest::addColumn<int>("bindings");
+
+    QTest::newRow("10") << 10;
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("100k") << 100000;
+}
+
+Core *CoreBenchmark::createCore()
+{
+    // never started: no display, no D-Bus, and the grabs stay deferred
+    Core *result = new Core(false, true, LOG_ERR, true, MULTIPLE_ACTIONS_BEHAVIOUR_FIRST, QString());
+    result->mX11Connections.push_back(new MockX11Connection(result));
+    return result;
+}
+
+Core *CoreBenchmark::core(int bindings)
+{
+    QMap<int, Core *>::const_iterator cached = mCores.constFind(bindings);
+    if (cached != mCores.constEnd())
+    {
+        return cached.value();
+    }
+
+    Core *result = createCore();
+
+    // more bindings than keys share them, as several actions bound to one shortcut do
+    for (int i = 0; i < bindings; ++i)
+    {
+        Core::ConfigEntry entry;
+        entry.id = 0;
+        entry.shortcut = mShortcuts[i % mShortcuts.size()];
+        entry.enabled = true;
+        entry.description = QString("Action #%1").arg(i);
+        entry.exec = QStringList() << "true" << QString::number(i);
+        entry.allowActivation = true;
+        entry.launchPolicy = CommandAction::launchPolicyName(CommandAction::LAUNCH_ALWAYS);
+        result->registerConfigEntry(entry);
+    }
+
+    result->mConfigFile = configFile(bindings);
+    result->mSaveAllowed = true;
+
+    mCores[bindings] = result;
+    return result;
+}
+
+QString CoreBenchmark::configFile(int bindings) const
+{
+    return QDir::temp().filePath(QString("core_benchmark_%1_%2.conf").arg(QCoreApplication::applicationPid()).arg(bindings));
+}
+
+void CoreBenchmark::shortcutToKeySym_data()
+{
+    QTest::addColumn<QString>("shortcut");
+
+    QTest::newRow("key") << QString("F5");
+    QTest::newRow("modifier") << QString("Control+F5");
+    QTest::newRow("all modifiers") << QString("Shift+Control+Alt+Meta+Level3+Level5+F5");
+}
+
+void CoreBenchmark::shortcutToKeySym()
+{
+    QFETCH(QString, shortcut);
+
+    Core *benchmarked = core(10);
+    X11Connection *connection = benchmarked->primaryConnection();
+
+    Core::KeySymShortcut keySymShortcut;
+    QBENCHMARK
+    {
+        keySymShortcut = benchmarked->ShortcutToKeySym(connection, shortcut);
+    }
+    QVERIFY(keySymShortcut.first != NoSymbol);
+}
+
+void CoreBenchmark::keySymToShortcut_data()
+{
+    shortcutToKeySym_data();
+}
+
+void CoreBenchmark::keySymToShortcut()
+{
+    QFETCH(QString, shortcut);
+
+    Core *benchmarked = core(10);
+    X11Connection *connection = benchmarked->primaryConnection();
+
+    Core::KeySymShortcut keySymShortcut = benchmarked->ShortcutToKeySym(connection, shortcut);
+    QString result;
+    QBENCHMARK
+    {
+        result = benchmarked->KeySymToShortcut(keySymShortcut);
+    }
+    QCOMPARE(result, shortcut);
+}
+
+void CoreBenchmark::resolveKeyPress_data()
+{
+    addBindingsRows();
+}
+
+void CoreBenchmark::resolveKeyPress()
+{
+    QFETCH(int, bindings);
+
+    Core *benchmarked = core(bindings);
+
+    // the bound keys in turn, so no single map path stays in the cache
+    QList<Core::KeySymShortcut> keys = benchmarked->mShortcutByKeySym.keys();
+    QVERIFY(!keys.isEmpty());
+
+    QMutexLocker lock(&benchmarked->mDataMutex);
+
+    int next = 0;
+    int resolved = 0;
+    QBENCHMARK
+    {
+        const Core::KeySymShortcut &key = keys[next];
+        next = (next + 1) % keys.size();
+
+        QString shortcut;
+        ActionExecutor::IdsAndActions actions;
+        if (benchmarked->resolveKeyPress(key.first, key.second, QString(), shortcut, actions) && !actions.isEmpty())
+        {
+            ++resolved;
+        }
+    }
+    QVERIFY(resolved);
+}
+
+void CoreBenchmark::saveConfig_data()
+{
+    addBindingsRows();
+}
+
+void CoreBenchmark::saveConfig()
+{
+    QFETCH(int, bindings);
+
+    Core *benchmarked = core(bindings);
+
+    // the snapshot and the write of the config saver thread
+    QBENCHMARK
+    {
+        benchmarked->saveConfig();
+        benchmarked->mConfigSaver->flush();
+    }
+    QVERIFY(QFile::exists(benchmarked->mConfigFile));
+}
+
+void CoreBenchmark::loadConfig_data()
+{
+    addBindingsRows();
+}
+
+void CoreBenchmark::loadConfig()
+{
+    QFETCH(int, bindings);
+
+    Core *saved = core(bindings);
+    saved->saveConfig();
+    saved->mConfigSaver->flush();
+
+    // QSettings keeps a parsed file cached, only the first load of it reads the disk as startup does
+    int loaded = 0;
+    QBENCHMARK_ONCE
+    {
+        Core *benchmarked = createCore();
+
+        QSettings settings(saved->mConfigFile, QSettings::IniFormat);
+        Core::ConfigEntries configEntries = Core::readConfigEntries(settings);
+        foreach(const Core::ConfigEntry &configEntry, configEntries)
+        {
+            benchmarked->registerConfigEntry(configEntry);
+        }
+
+        loaded = benchmarked->mShortcutAndActionById.size();
+        delete benchmarked;
+    }
+    QCOMPARE(loaded, bindings);
+}
+
+void CoreBenchmark::getAllActions_data()
+{
+    addBindingsRows();
+}
+
+void CoreBenchmark::getAllActions()
+{
+    QFETCH(int, bindings);
+
+    Core *benchmarked = core(bindings);
+
+    // the reply as the adaptor hands it to QtDBus, marshalled into a message that is never sent
+    QMap<qulonglong, GeneralActionInfo> result;
+    QBENCHMARK
+    {
+        benchmarked->getAllActions(result);
+
+        QDBusArgument argument;
+        argument << result;
+    }
+    QCOMPARE(result.size(), bindings);
+}
+
+
+QTEST_MAIN(CoreBenchmark)
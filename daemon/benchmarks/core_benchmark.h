@@ -0,0 +1,97 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__CORE_BENCHMARK__INCLUDED
+#define GLOBAL_ACTION_DAEMON__CORE_BENCHMARK__INCLUDED
+
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+#include "x11_connection.h"
+
+
+class Core;
+
+// A keyboard with a fixed single group layout instead of an X display, keycodes are handed out from 8 up.
+class MockX11Connection : public X11Connection
+{
+public:
+    explicit MockX11Connection(Core *core);
+
+    // every shortcut the keyboard can produce, in the form Core normalizes to
+    static QStringList allShortcuts();
+
+private:
+    static QList<KeySym> keySyms();
+};
+
+// Core internals without X or D-Bus, run with ctest or directly with the QtTest options;
+// -xml -o FILE keeps the results to compare between commits.
+class CoreBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    CoreBenchmark();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void shortcutToKeySym_data();
+    void shortcutToKeySym();
+    void keySymToShortcut_data();
+    void keySymToShortcut();
+
+    void resolveKeyPress_data();
+    void resolveKeyPress();
+
+    void saveConfig_data();
+    void saveConfig();
+    void loadConfig_data();
+    void loadConfig();
+
+    void getAllActions_data();
+    void getAllActions();
+
+private:
+    static void addBindingsRows();
+    static Core *createCore();
+    // shared between the benchmarks, built on first use
+    Core *core(int bindings);
+    QString configFile(int bindings) const;
+
+private:
+    QStringList mShortcuts;
+    QMap<int, Core *> mCores;
+};
+
+#endif // GLOBAL_ACTION_DAEMON__CORE_BENCHMARK__INCLUDED
@@ -28,60 +28,66 @@
 #include "client_action.h"
 #include "client_proxy.h"
 #include "log_target.h"
+#include "trace.h"
 
 
 ClientAction::ClientAction(LogTarget *logTarget, const QDBusObjectPath &path, const QString &description)
     : BaseAction(logTarget, description)
     , mProxy(0)
-    , mPath(path)
+    , mPath(StringPool::intern(path))
 {
 }
 
-ClientAction::ClientAction(LogTarget *logTarget, const QDBusConnection &connection, const QString &service, const QDBusObjectPath &path, const QString &description)
+ClientAction::ClientAction(LogTarget *logTarget, ClientProxy *proxy, const QDBusObjectPath &path, const QString &description)
     : BaseAction(logTarget, description)
     , mProxy(0)
-    , mPath(path)
+    , mPath(StringPool::intern(path))
 {
-    appeared(connection, service);
+    appeared(proxy);
 }
 
 ClientAction::~ClientAction()
 {
-    delete mProxy;
+    disappeared();
 }
 
-bool ClientAction::call()
+ActionCompletion ClientAction::call(qulonglong eventTime)
 {
     if (!isEnabled())
     {
         return false;
     }
 
+    TRACE_SPAN("dispatch", "client action");
+
     if (!mProxy)
     {
         mLogTarget->log(LOG_WARNING, "No native client: \"%s\"", qPrintable(mService));
         return false;
     }
 
-    mProxy->emitActivated();
+    mProxy->emitActivated(mPath, eventTime);
 
     return true;
 }
 
-void ClientAction::appeared(const QDBusConnection &connection, const QString &service)
+void ClientAction::appeared(ClientProxy *proxy)
 {
     if (mProxy) // should never happen
     {
         return;
     }
-    mService = service;
-    mProxy = new ClientProxy(mService, QDBusObjectPath("/global_key_shortcuts" + mPath.path()), connection);
+    mService = proxy->service();
+    mProxy = proxy;
 }
 
 void ClientAction::disappeared()
 {
+    if (mProxy)
+    {
+        mProxy->release(mPath);
+    }
     mService.clear();
-    delete mProxy;
     mProxy = 0;
 }
 
@@ -89,6 +95,6 @@ void ClientAction::shortcutChanged(const QString &oldShortcut, const QString &ne
 {
     if (mProxy)
     {
-        mProxy->emitShortcutChanged(oldShortcut, newShortcut);
+        mProxy->emitShortcutChanged(mPath, oldShortcut, newShortcut);
     }
 }
@@ -33,7 +33,6 @@
 
 #include <QString>
 #include <QDBusObjectPath>
-#include <QDBusConnection>
 
 
 class ClientProxy;
@@ -42,21 +41,21 @@ class ClientAction : public BaseAction
 {
 public:
     ClientAction(LogTarget *logTarget, const QDBusObjectPath &path, const QString &description);
-    ClientAction(LogTarget *logTarget, const QDBusConnection &connection, const QString &service, const QDBusObjectPath &path, const QString &description);
+    ClientAction(LogTarget *logTarget, ClientProxy *proxy, const QDBusObjectPath &path, const QString &description);
     ~ClientAction();
 
     static const char *id() { return "client"; }
 
     virtual const char *type() const { return id(); }
 
-    virtual bool call();
+    virtual ActionCompletion call(qulonglong eventTime);
 
     void shortcutChanged(const QString &oldShortcut, const QString &newShortcut);
 
     const QString &service() const { return mService; }
     const QDBusObjectPath &path() const { return mPath; }
 
-    void appeared(const QDBusConnection &connection, const QString &service);
+    void appeared(ClientProxy *proxy);
     void disappeared();
 
     bool isPresent() const { return mProxy; }
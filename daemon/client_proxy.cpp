@@ -26,25 +26,165 @@
  * END_COMMON_COPYRIGHT_HEADER */
 
 #include "client_proxy.h"
+#include "activation_channel.h"
 
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
 
-#include "org.lxqt.global_key_shortcuts.client.h"
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS (1024 + 9)
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
 
 
-ClientProxy::ClientProxy(const QString &service, const QDBusObjectPath &path, const QDBusConnection &connection, QObject *parent)
-    : QObject(parent)
+static int createSharedMemory(size_t size)
 {
-    org::lxqt::global_key_shortcuts::client *iface = new org::lxqt::global_key_shortcuts::client(service, path.path(), connection, this);
-    connect(this, SIGNAL(activated()), iface, SLOT(activated()));
-    connect(this, SIGNAL(shortcutChanged(QString, QString)), iface, SLOT(shortcutChanged(QString, QString)));
+#ifdef SYS_memfd_create
+    int fd = syscall(SYS_memfd_create, "lxqt-globalkeys-activation", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (ftruncate(fd, size) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    // the client must not be able to truncate the memory under our mapping
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+    return fd;
+#else
+    Q_UNUSED(size);
+    return -1;
+#endif
 }
 
-void ClientProxy::emitActivated()
+
+
+ClientProxy::ClientProxy(const QDBusConnection &connection, const QString &service)
+    : mConnection(connection)
+    , mService(service)
+    , mChannel(0)
+    , mChannelAccepted(false)
+    , mChannelWritten(0)
+    , mChannelMemoryFd(-1)
+    , mChannelEventFd(-1)
+{
+}
+
+ClientProxy::~ClientProxy()
+{
+    if (mChannel)
+    {
+        munmap(mChannel, sizeof(ActivationChannel));
+    }
+    if (mChannelMemoryFd != -1)
+    {
+        close(mChannelMemoryFd);
+    }
+    if (mChannelEventFd != -1)
+    {
+        close(mChannelEventFd);
+    }
+}
+
+QDBusMessage ClientProxy::createCall(const QDBusObjectPath &path, const QString &method) const
 {
-    emit activated();
+    return QDBusMessage::createMethodCall(mService, "/global_key_shortcuts" + path.path(), "org.lxqt.global_key_shortcuts.client", method);
 }
 
-void ClientProxy::emitShortcutChanged(const QString &oldShortcut, const QString &newShortcut)
+void ClientProxy::emitActivated(const QDBusObjectPath &path, qulonglong eventTime)
 {
-    emit shortcutChanged(oldShortcut, newShortcut);
+    if (mChannelAccepted)
+    {
+        QByteArray rawPath = path.path().toUtf8();
+        activationChannelWrite(mChannel, mChannelWritten++, activationChannelPathHash(rawPath.constData(), rawPath.length()), eventTime);
+
+        uint64_t one = 1;
+        ssize_t written = write(mChannelEventFd, &one, sizeof(one)); // EAGAIN: counter is already non-zero, client is awake anyway
+        Q_UNUSED(written);
+        return;
+    }
+
+    MessageByPath::iterator activated = mActivatedByPath.find(path.path());
+    if (activated == mActivatedByPath.end())
+    {
+        activated = mActivatedByPath.insert(path.path(), createCall(path, "activated"));
+    }
+    mConnection.send(activated.value());
+}
+
+void ClientProxy::emitShortcutChanged(const QDBusObjectPath &path, const QString &oldShortcut, const QString &newShortcut)
+{
+    QDBusMessage message = createCall(path, "shortcutChanged");
+    message << oldShortcut << newShortcut;
+    mConnection.send(message);
+}
+
+void ClientProxy::release(const QDBusObjectPath &path)
+{
+    mActivatedByPath.remove(path.path());
+}
+
+bool ClientProxy::openActivationChannel(int &memoryFd, int &eventFd)
+{
+    if (!mChannel)
+    {
+        int newMemoryFd = createSharedMemory(sizeof(ActivationChannel));
+        if (newMemoryFd == -1)
+        {
+            return false;
+        }
+
+        void *memory = mmap(0, sizeof(ActivationChannel), PROT_READ | PROT_WRITE, MAP_SHARED, newMemoryFd, 0);
+        if (memory == MAP_FAILED)
+        {
+            close(newMemoryFd);
+            return false;
+        }
+
+        int newEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (newEventFd == -1)
+        {
+            munmap(memory, sizeof(ActivationChannel));
+            close(newMemoryFd);
+            return false;
+        }
+
+        mChannel = reinterpret_cast<ActivationChannel *>(memory);
+        mChannel->magic = ACTIVATION_CHANNEL_MAGIC;
+        mChannel->version = ACTIVATION_CHANNEL_VERSION;
+        mChannel->capacity = ACTIVATION_CHANNEL_CAPACITY;
+        mChannel->written = 0;
+        mChannelWritten = 0;
+        mChannelMemoryFd = newMemoryFd;
+        mChannelEventFd = newEventFd;
+    }
+
+    memoryFd = mChannelMemoryFd;
+    eventFd = mChannelEventFd;
+    return true;
+}
+
+bool ClientProxy::acceptActivationChannel()
+{
+    if (!mChannel)
+    {
+        return false;
+    }
+
+    mChannelAccepted = true;
+    mActivatedByPath.clear();
+    return true;
 }
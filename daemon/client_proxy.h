@@ -29,29 +29,54 @@
 #define GLOBAL_ACTION_DAEMON__CLIENT_PROXY__INCLUDED
 
 
-#include <QObject>
+#include <QString>
+#include <QHash>
 #include <QDBusObjectPath>
 #include <QDBusConnection>
+#include <QDBusMessage>
 
+#include <stdint.h>
 
-class ClientAction;
 
-class ClientProxy : public QObject
-{
-    Q_OBJECT
+struct ActivationChannel;
 
-    friend class ClientAction;
 
+// One proxy per native client bus name, shared by all its actions.
+// Calls are addressed by path, so no per-action QObject or interface is needed.
+class ClientProxy
+{
 public:
-    ClientProxy(const QString &service, const QDBusObjectPath &path, const QDBusConnection &connection, QObject *parent = 0);
+    ClientProxy(const QDBusConnection &connection, const QString &service);
+    ~ClientProxy();
+
+    const QString &service() const { return mService; }
+
+    // eventTime, the X server time of the key press, is only carried by the ring
+    void emitActivated(const QDBusObjectPath &path, qulonglong eventTime);
+    void emitShortcutChanged(const QDBusObjectPath &path, const QString &oldShortcut, const QString &newShortcut);
+
+    void release(const QDBusObjectPath &path);
+
+    // Once opened and accepted by the client, activations bypass the bus and go through the shared ring.
+    // Until the client has mapped and checked the ring, they keep going over the bus.
+    bool openActivationChannel(int &memoryFd, int &eventFd);
+    bool acceptActivationChannel();
+
+private:
+    QDBusMessage createCall(const QDBusObjectPath &path, const QString &method) const;
+
+private:
+    QDBusConnection mConnection;
+    QString mService;
 
-signals:
-    void activated();
-    void shortcutChanged(const QString &oldShortcut, const QString &newShortcut);
+    typedef QHash<QString, QDBusMessage> MessageByPath;
+    MessageByPath mActivatedByPath;
 
-protected:
-    void emitActivated();
-    void emitShortcutChanged(const QString &oldShortcut, const QString &newShortcut);
+    ActivationChannel *mChannel;
+    bool mChannelAccepted;
+    uint64_t mChannelWritten;
+    int mChannelMemoryFd;
+    int mChannelEventFd;
 };
 
 #endif // GLOBAL_ACTION_DAEMON__CLIENT_PROXY__INCLUDED
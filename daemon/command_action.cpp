@@ -27,34 +27,134 @@
 
 #include "command_action.h"
 
-#include <QProcess>
+#include <QMutexLocker>
 
 #include <errno.h>
 #include <string.h>
 
+#include "executable_resolver.h"
+#include "process_tracker.h"
 #include "log_target.h"
+#include "metrics.h"
 #include "string_utils.h"
+#include "trace.h"
 
 
-CommandAction::CommandAction(LogTarget *logTarget, const QString &command, const QStringList &args, const QString &description)
+// presses this soon after a launch are dropped by LAUNCH_COALESCE
+static const quint64 coalesceWindow = 1000000; // us
+
+
+CommandAction::CommandAction(LogTarget *logTarget, Metrics *metrics, ExecutableResolver *executables, ProcessTracker *processes, const QString &command, const QStringList &args, const QString &description)
     : BaseAction(logTarget, description)
-    , mCommand(command)
-    , mArgs(args)
+    , mMetrics(metrics)
+    , mExecutables(executables)
+    , mProcesses(processes)
+    , mCommand(StringPool::intern(command))
+    , mArgs(StringPool::intern(args))
+    , mLaunchPolicy(LAUNCH_ALWAYS)
+    , mLastLaunch(0)
+{
+    mExecutables->registerCommand(mCommand);
+}
+
+CommandAction::~CommandAction()
+{
+    mProcesses->forget(this);
+    mExecutables->unregisterCommand(mCommand);
+}
+
+const char *CommandAction::launchPolicyName(LaunchPolicy policy)
+{
+    switch (policy)
+    {
+    case LAUNCH_SINGLE_INSTANCE:
+        return "single";
+
+    case LAUNCH_COALESCE:
+        return "coalesce";
+
+    default:
+        return "always";
+    }
+}
+
+bool CommandAction::launchPolicyFromName(const QString &name, LaunchPolicy &policy)
+{
+    if (name == "always")
+    {
+        policy = LAUNCH_ALWAYS;
+    }
+    else if (name == "single")
+    {
+        policy = LAUNCH_SINGLE_INSTANCE;
+    }
+    else if (name == "coalesce")
+    {
+        policy = LAUNCH_COALESCE;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+int CommandAction::running() const
+{
+    return mProcesses->running(this);
+}
+
+CommandActionUsage CommandAction::usage() const
 {
+    return mProcesses->usage(this);
 }
 
-bool CommandAction::call()
+ActionCompletion CommandAction::call(qulonglong eventTime)
 {
+    Q_UNUSED(eventTime);
+
     if (!isEnabled())
     {
         return false;
     }
 
-    bool result = QProcess::startDetached(mCommand, mArgs);
-    if (!result)
+    TRACE_SPAN("dispatch", "command action");
+
+    QMutexLocker lock(&mLaunchMutex);
+
+    // a dropped press still counts as handled, FIRST/LAST must not fall through to another action
+    switch (mLaunchPolicy)
+    {
+    case LAUNCH_SINGLE_INSTANCE:
+        if (mProcesses->running(this))
+        {
+            mLogTarget->log(LOG_DEBUG, "Command \"%s\" is still running, not launched again", qPrintable(mCommand));
+            return true;
+        }
+        break;
+
+    case LAUNCH_COALESCE:
+        if (mLastLaunch && (Trace::now() - mLastLaunch < coalesceWindow))
+        {
+            mLogTarget->log(LOG_DEBUG, "Command \"%s\" was just launched, press coalesced", qPrintable(mCommand));
+            return true;
+        }
+        break;
+
+    default:
+        ;
+    }
+
+    QString executable = mExecutables->executable(mCommand);
+    error_t error = ENOENT;
+    if (executable.isEmpty() || !mProcesses->spawn(this, executable, mArgs, error))
     {
-        mLogTarget->log(LOG_WARNING, "Failed to launch command \"%s\"%s", qPrintable(mCommand), qPrintable(joinToString(mArgs, " \"", "\" \"", "\"")));
+        mMetrics->increment(Metrics::SPAWN_FAILURES);
+        mLogTarget->log(LOG_WARNING, "Failed to launch command \"%s\"%s: %s", qPrintable(mCommand), qPrintable(joinToString(mArgs, " \"", "\" \"", "\"")), strerror(error));
+        return false;
     }
 
-    return result;
+    mLastLaunch = Trace::now();
+
+    return true;
 }
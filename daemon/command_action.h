@@ -33,26 +33,58 @@
 
 #include <QString>
 #include <QStringList>
+#include <QMutex>
 
+#include "meta_types.h"
+
+
+class Metrics;
+class ExecutableResolver;
+class ProcessTracker;
 
 class CommandAction : public BaseAction
 {
 public:
-    CommandAction(LogTarget *logTarget, const QString &command, const QStringList &args, const QString &description);
+    typedef enum LaunchPolicy
+    {
+        LAUNCH_ALWAYS = 0,
+        LAUNCH_SINGLE_INSTANCE, // not while a process of this action is running
+        LAUNCH_COALESCE         // presses shortly after a launch are dropped
+    } LaunchPolicy;
+
+    CommandAction(LogTarget *logTarget, Metrics *metrics, ExecutableResolver *executables, ProcessTracker *processes, const QString &command, const QStringList &args, const QString &description);
+    ~CommandAction();
 
     static const char *id() { return "command"; }
 
     virtual const char *type() const { return id(); }
 
-    virtual bool call();
+    virtual ActionCompletion call(qulonglong eventTime);
 
     QString command() const { return mCommand; }
 
     QStringList args() const { return mArgs; }
 
+    LaunchPolicy launchPolicy() const { return mLaunchPolicy; }
+    void setLaunchPolicy(LaunchPolicy value) { mLaunchPolicy = value; }
+
+    static const char *launchPolicyName(LaunchPolicy policy);
+    static bool launchPolicyFromName(const QString &name, LaunchPolicy &policy);
+
+    // processes started by this action that have not exited yet
+    int running() const;
+    CommandActionUsage usage() const;
+
 private:
+    Metrics *mMetrics;
+    ExecutableResolver *mExecutables;
+    ProcessTracker *mProcesses;
     QString mCommand;
     QStringList mArgs;
+
+    LaunchPolicy mLaunchPolicy;
+    QMutex mLaunchMutex; // presses may arrive on several threads at once
+    quint64 mLastLaunch;
 };
 
 #endif // GLOBAL_ACTION_DAEMON__COMMAND_ACTION__INCLUDED
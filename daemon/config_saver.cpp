@@ -0,0 +1,167 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "config_saver.h"
+#include "log_target.h"
+#include "trace.h"
+
+#include <QSettings>
+#include <QFile>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+
+
+ConfigSaver::ConfigSaver(LogTarget *logTarget, QObject *parent)
+    : QThread(parent)
+    , mLogTarget(logTarget)
+    , mQuit(false)
+    , mPending(false)
+    , mWriting(false)
+{
+}
+
+ConfigSaver::~ConfigSaver()
+{
+    {
+        QMutexLocker lock(&mMutex);
+        mQuit = true;
+        mRequested.wakeOne();
+    }
+    wait();
+}
+
+void ConfigSaver::save(const QString &fileName, const Sections &sections)
+{
+    QMutexLocker lock(&mMutex);
+
+    mFileName = fileName;
+    mSections = sections;
+    mPending = true;
+
+    mRequested.wakeOne();
+}
+
+void ConfigSaver::flush()
+{
+    QMutexLocker lock(&mMutex);
+
+    while (mPending || mWriting)
+    {
+        mWritten.wait(&mMutex);
+    }
+}
+
+bool ConfigSaver::isBusy() const
+{
+    QMutexLocker lock(&mMutex);
+
+    return mPending || mWriting;
+}
+
+QByteArray ConfigSaver::lastHash() const
+{
+    QMutexLocker lock(&mMutex);
+
+    return mLastHash;
+}
+
+void ConfigSaver::run()
+{
+    Trace::setThreadName("config");
+
+    QMutexLocker lock(&mMutex);
+
+    for (;;)
+    {
+        while (!mPending && !mQuit)
+        {
+            mRequested.wait(&mMutex);
+        }
+
+        // a pending snapshot is still written when quitting
+        if (!mPending)
+        {
+            break;
+        }
+
+        QString fileName = mFileName;
+        Sections sections = mSections;
+        mPending = false;
+        mWriting = true;
+
+        lock.unlock();
+        write(fileName, sections);
+
+        QByteArray hash;
+        QFile file(fileName);
+        if (file.open(QIODevice::ReadOnly))
+        {
+            hash = QCryptographicHash::hash(file.readAll(), QCryptographicHash::Md5);
+        }
+        lock.relock();
+
+        mLastHash = hash;
+        mWriting = false;
+        mWritten.wakeAll();
+    }
+}
+
+void ConfigSaver::write(const QString &fileName, const Sections &sections)
+{
+    TRACE_SPAN("config", "write config");
+
+    QSettings settings(fileName, QSettings::IniFormat);
+
+    settings.clear();
+
+    Sections::const_iterator lastSection = sections.constEnd();
+    for (Sections::const_iterator section = sections.constBegin(); section != lastSection; ++section)
+    {
+        if (!section->first.isEmpty())
+        {
+            settings.beginGroup(section->first);
+        }
+
+        Values::const_iterator lastValue = section->second.constEnd();
+        for (Values::const_iterator value = section->second.constBegin(); value != lastValue; ++value)
+        {
+            settings.setValue(value->first, value->second);
+        }
+
+        if (!section->first.isEmpty())
+        {
+            settings.endGroup();
+        }
+    }
+
+    settings.sync();
+
+    if (settings.status() != QSettings::NoError)
+    {
+        mLogTarget->log(LOG_WARNING, "Cannot write config file: %s", qPrintable(fileName));
+    }
+}
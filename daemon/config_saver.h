@@ -0,0 +1,87 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__CONFIG_SAVER__INCLUDED
+#define GLOBAL_ACTION_DAEMON__CONFIG_SAVER__INCLUDED
+
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+#include <QVariant>
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+
+
+class LogTarget;
+
+// Writes the config file on its own thread, so D-Bus requests never wait for the disk.
+// Saves requested while a write is in progress are coalesced, only the latest snapshot is written.
+class ConfigSaver : public QThread
+{
+public:
+    typedef QList<QPair<QString, QVariant> > Values;
+    typedef QPair<QString, Values> Section; // empty name: General
+    typedef QList<Section> Sections;
+
+    ConfigSaver(LogTarget *logTarget, QObject *parent = 0);
+    ~ConfigSaver();
+
+    void save(const QString &fileName, const Sections &sections);
+    // blocks until the latest snapshot is on disk
+    void flush();
+
+    // a snapshot is waiting or being written
+    bool isBusy() const;
+    // of the file as last written by us
+    QByteArray lastHash() const;
+
+private:
+    ConfigSaver(const ConfigSaver &);
+    ConfigSaver &operator = (const ConfigSaver &);
+
+    void run();
+    void write(const QString &fileName, const Sections &sections);
+
+private:
+    LogTarget *mLogTarget;
+
+    mutable QMutex mMutex;
+    QWaitCondition mRequested;
+    QWaitCondition mWritten;
+
+    bool mQuit;
+    bool mPending;
+    bool mWriting;
+    QString mFileName;
+    Sections mSections;
+    QByteArray mLastHash;
+};
+
+#endif // GLOBAL_ACTION_DAEMON__CONFIG_SAVER__INCLUDED
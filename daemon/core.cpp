@@ -29,12 +29,16 @@
 
 #include <QSettings>
 #include <QTimer>
+#include <QFile>
 #include <QDBusConnectionInterface>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QCryptographicHash>
 
 #include <stddef.h>
 #include <stdlib.h>
 #include <unistd.h>
-#include <poll.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <errno.h>
@@ -43,30 +47,41 @@
 
 #include <stdexcept>
 
-#include "pipe_utils.h"
 #include "string_utils.h"
 #include "daemon_adaptor.h"
 #include "native_adaptor.h"
+#include "metrics_adaptor.h"
 #include "base_action.h"
 #include "method_action.h"
 #include "client_action.h"
+#include "client_proxy.h"
 #include "command_action.h"
+#include "trace.h"
+#include "config_saver.h"
+#include "action_executor.h"
+#include "action_chain.h"
+#include "name_owner_cache.h"
+#include "executable_resolver.h"
+#include "process_tracker.h"
+#include "string_pool.h"
+#include "keysym_table.h"
 
 #include "core.h"
 
 
-enum
-{
-    X11_OP_StringToKeycode,
-    X11_OP_KeycodeToString,
-    X11_OP_XGrabKey,
-    X11_OP_XUngrabKey,
-    X11_OP_XGrabKeyboard,
-    X11_OP_XUngrabKeyboard
-};
+static Core *s_Core = 0;
 
+// number of change records kept for getChangesSince
+static const int actionChangeJournalSize = 1024;
+
+// actions of one key press running at the same time, unless MaxParallelActions says otherwise
+static const int defaultMaxParallelActions = 4;
 
-static Core *s_Core = 0;
+
+static inline QPair<QString, QVariant> configValue(const char *key, const QVariant &value)
+{
+    return qMakePair(QString(key), value);
+}
 
 
 void unixSignalHandler(int signalNumber)
@@ -367,24 +382,60 @@ static const char *strLevel(int level)
     }
 }
 
+// fallback for an empty or unknown name
+static int logLevel(const QString &name, int fallback)
+{
+    if (name == "error")
+    {
+        return LOG_ERR;
+    }
+    if (name == "warning")
+    {
+        return LOG_WARNING;
+    }
+    if (name == "notice")
+    {
+        return LOG_NOTICE;
+    }
+    if (name == "info")
+    {
+        return LOG_INFO;
+    }
+    if (name == "debug")
+    {
+        return LOG_DEBUG;
+    }
+    return fallback;
+}
+
 
-Core::Core(bool useSyslog, bool minLogLevelSet, int minLogLevel, const QStringList &configFiles, bool multipleActionsBehaviourSet, MultipleActionsBehaviour multipleActionsBehaviour, QObject *parent)
-    : QThread(parent)
+Core::Core(bool useSyslog, bool minLogLevelSet, int minLogLevel, bool multipleActionsBehaviourSet, MultipleActionsBehaviour multipleActionsBehaviour, const QString &metricsFile, QObject *parent)
+    : QObject(parent)
     , LogTarget()
     , mReady(false)
     , mUseSyslog(useSyslog)
     , mMinLogLevel(minLogLevel)
-    , mDisplay(0)
-    , mInterClientCommunicationWindow(0)
+    , mMinLogLevelSet(minLogLevelSet)
+    , mOldX11ErrorHandler(0)
     , mDaemonAdaptor(0)
     , mNativeAdaptor(0)
+    , mMetricsAdaptor(0)
     , mLastId(0ull)
-    , mGrabbingShortcut(false)
+    , mGrabSyncDeferred(true)
+    // start above anything a previous daemon instance could have handed out
+    , mActionsGeneration(static_cast<qulonglong>(QDateTime::currentDateTime().toTime_t()) * 1000000ull)
+    , mActionChangesFlushQueued(false)
     , AltMask(Mod1Mask)
     , MetaMask(Mod4Mask)
     , Level3Mask(Mod5Mask)
     , Level5Mask(Mod3Mask)
     , mMultipleActionsBehaviour(multipleActionsBehaviour)
+    , mMultipleActionsBehaviourSet(multipleActionsBehaviourSet)
+    , mActionExecutor(new ActionExecutor(this, &mDataMutex, defaultMaxParallelActions))
+    , mActionChain(new ActionChain(this, &mDataMutex))
+    , mNameOwners(new NameOwnerCache(QDBusConnection::sessionBus(), this))
+    , mExecutables(new ExecutableResolver(this, this))
+    , mProcesses(new ProcessTracker(this, this))
     , mAllowGrabLocks(false)
     , mAllowGrabBaseSpecial(false)
     , mAllowGrabMiscSpecial(true)
@@ -393,108 +444,98 @@ Core::Core(bool useSyslog, bool minLogLevelSet, int minLogLevel, const QStringLi
     , mAllowGrabPrintable(false)
 
     , mSaveAllowed(false)
+    , mConfigSaver(new ConfigSaver(this))
+    , mConfigWatcher(new QFileSystemWatcher(this))
+    , mConfigReloadTimer(new QTimer(this))
 
     , mShortcutGrabTimeout(new QTimer(this))
     , mShortcutGrabRequested(false)
+
+    , mMetricsFile(metricsFile)
+    , mMetricsTimer(new QTimer(this))
 {
     s_Core = this;
 
-    initBothPipeEnds(mX11ErrorPipe);
-    initBothPipeEnds(mX11RequestPipe);
-    initBothPipeEnds(mX11ResponsePipe);
-
     mConfigFile = QString(getenv("HOME")) + "/.config/global_key_shortcutss.ini";
 
+    mConfigSaver->start();
+}
+
+bool Core::start(const QStringList &configFiles, const QStringList &displayNames, uint metricsInterval)
+{
     try
     {
-        error_t c_error;
-
         openlog("lxqt-global-action-daemon", LOG_PID, LOG_USER);
 
         ::signal(SIGTERM, ::unixSignalHandler);
         ::signal(SIGINT, ::unixSignalHandler);
-
-
-        if (!QDBusConnection::sessionBus().registerService("org.lxqt.global_key_shortcuts"))
+        if (Trace::isEnabled())
         {
-            throw std::runtime_error(std::string("Cannot register service 'org.lxqt.global_key_shortcuts'"));
+            ::signal(SIGUSR1, ::unixSignalHandler);
         }
 
 
-        if ((c_error = createPipe(mX11ErrorPipe)))
         {
-            throw std::runtime_error(std::string("Cannot create error signal pipe: ") + std::string(strerror(c_error)));
-        }
-
-        if ((c_error = createPipe(mX11RequestPipe)))
-        {
-            throw std::runtime_error(std::string("Cannot create X11 request pipe: ") + std::string(strerror(c_error)));
+            TRACE_SPAN("startup", "register D-Bus service");
+            if (!QDBusConnection::sessionBus().registerService("org.lxqt.global_key_shortcuts"))
+            {
+                throw std::runtime_error(std::string("Cannot register service 'org.lxqt.global_key_shortcuts'"));
+            }
         }
 
-        if ((c_error = createPipe(mX11ResponsePipe)))
-        {
-            throw std::runtime_error(std::string("Cannot create X11 response pipe: ") + std::string(strerror(c_error)));
-        }
 
+        quint64 phaseStart = Trace::now();
 
-        start();
+        XInitThreads();
 
+        mOldX11ErrorHandler = XSetErrorHandler(::x11ErrorHandler);
 
-        char signal;
-        error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &signal, sizeof(signal));
-        if (error > 0)
+        // every display gets its own connection and event loop, all of them are known
+        // to the error handler before any of them starts
+        if (displayNames.isEmpty())
         {
-            throw std::runtime_error(std::string("Cannot read X11 start signal: ") + std::string(strerror(c_error)));
+            mX11Connections.push_back(new X11Connection(this, QString()));
         }
-        if (error < 0)
+        else
         {
-            throw std::runtime_error(std::string("Cannot read X11 start signal"));
+            foreach(const QString &displayName, displayNames)
+            {
+                mX11Connections.push_back(new X11Connection(this, displayName));
+            }
         }
-        if (signal)
+
+        // the answers to the first grabs come before the D-Bus objects are up
+        connect(this, SIGNAL(onGrabsSwitched()), this, SLOT(grabsSwitched()), Qt::QueuedConnection);
+
+        // the X11 threads discover the screens and the keymaps while the config is parsed here,
+        // they join to resolve keycodes and grab
+        foreach(X11Connection *connection, mX11Connections)
         {
-            throw std::runtime_error(std::string("Cannot start X11 thread"));
+            connection->start();
         }
 
+        ConfigEntries configEntries;
 
         {
+            TRACE_SPAN("startup", "parse config");
+
             size_t fm = configFiles.size();
             for (size_t fi = 0; fi < fm; ++fi)
             {
                 mConfigFile = configFiles[fi];
 
+                TRACE_SPAN("startup", "load config file");
+
                 QSettings settings(mConfigFile, QSettings::IniFormat, this);
 
                 QString iniValue;
 
-                if (!minLogLevelSet)
+                if (!mMinLogLevelSet)
                 {
-                    iniValue = settings.value(/* General/ */"LogLevel").toString();
-                    if (!iniValue.isEmpty())
-                    {
-                        if (iniValue == "error")
-                        {
-                            mMinLogLevel = LOG_ERR;
-                        }
-                        else if (iniValue == "warning")
-                        {
-                            mMinLogLevel = LOG_WARNING;
-                        }
-                        else if (iniValue == "notice")
-                        {
-                            mMinLogLevel = LOG_NOTICE;
-                        }
-                        else if (iniValue == "info")
-                        {
-                            mMinLogLevel = LOG_INFO;
-                        }
-                        else if (iniValue == "debug")
-                        {
-                            mMinLogLevel = LOG_DEBUG;
-                        }
-                    }
+                    mMinLogLevel = logLevel(settings.value(/* General/ */"LogLevel").toString(), mMinLogLevel);
                 }
 
-                if (!multipleActionsBehaviourSet)
+                if (!mMultipleActionsBehaviourSet)
                 {
                     iniValue = settings.value(/* General/ */"MultipleActionsBehaviour").toString();
                     if (!iniValue.isEmpty())
@@ -518,77 +559,43 @@ Core::Core(bool useSyslog, bool minLogLevelSet, int minLogLevel, const QStringLi
                     }
                 }
 
-                mAllowGrabLocks = settings.value(/* General/ */"AllowGrabLocks", mAllowGrabLocks).toBool();
-                mAllowGrabBaseSpecial = settings.value(/* General/ */"AllowGrabBaseSpecial", mAllowGrabBaseSpecial).toBool();
-                mAllowGrabMiscSpecial = settings.value(/* General/ */"AllowGrabMiscSpecial", mAllowGrabMiscSpecial).toBool();
-                mAllowGrabBaseKeypad = settings.value(/* General/ */"AllowGrabBaseKeypad", mAllowGrabBaseKeypad).toBool();
-                mAllowGrabMiscKeypad = settings.value(/* General/ */"AllowGrabMiscKeypad", mAllowGrabMiscKeypad).toBool();
+                readAllowGrab(settings);
 
-                foreach(QString section, settings.childGroups())
-                {
-                    if (section != "General")
-                    {
-                        settings.beginGroup(section);
+                mActiveProfile = settings.value(/* General/ */"ActiveProfile").toString();
 
-                        QString shortcut = section;
-                        int pos = shortcut.indexOf('.');
-                        if (pos != -1)
-                        {
-                            shortcut = shortcut.left(pos);
-                        }
+                mActionExecutor->setMaxThreads(settings.value(/* General/ */"MaxParallelActions", mActionExecutor->maxThreads()).toInt());
+                mStrictOrderShortcuts = settings.value(/* General/ */"StrictOrderShortcuts").toStringList().toSet();
 
-                        qulonglong id = 0ull;
+                configEntries.append(readConfigEntries(settings));
+            }
+        }
+        startupPhaseDone("parse config", phaseStart);
 
-                        bool enabled = settings.value("Enabled", true).toBool();
+        {
+            TRACE_SPAN("startup", "wait for X11 threads");
 
-                        QString description = settings.value("Comment").toString();
+            foreach(X11Connection *connection, mX11Connections)
+            {
+                connection->waitStarted();
+            }
+        }
+        startupPhaseDone("wait for X11 threads", phaseStart);
 
-                        if (settings.contains("Exec"))
-                        {
-                            QStringList values = settings.value("Exec").toStringList();
-                            id = registerCommandAction(shortcut, values[0], values.mid(1), description);
-                        }
-                        else
-                        {
-                            iniValue = settings.value("path").toString();
-                            if (!iniValue.isEmpty())
-                            {
-                                QString path = iniValue;
-
-                                if (settings.contains("interface"))
-                                {
-                                    QString interface = settings.value("interface").toString();
-
-                                    iniValue = settings.value("service").toString();
-                                    if (!iniValue.isEmpty())
-                                    {
-                                        QString service = iniValue;
-
-                                        iniValue = settings.value("method").toString();
-                                        if (!iniValue.isEmpty())
-                                        {
-                                            QString method = iniValue;
-
-                                            id = registerMethodAction(shortcut, service, QDBusObjectPath(path), interface, method, description);
-                                        }
-                                    }
-                                }
-                                else
-                                {
-                                    id = registerClientAction(shortcut, QDBusObjectPath(path), description);
-                                }
-                            }
-                        }
-                        if (id)
-                        {
-                            mShortcutAndActionById[id].second->setEnabled(enabled);
-                        }
+        {
+            TRACE_SPAN("startup", "register actions");
 
-                        settings.endGroup();
-                    }
-                }
+            foreach(const ConfigEntry &configEntry, configEntries)
+            {
+                registerConfigEntry(configEntry);
             }
+
+            QMutexLocker lock(&mDataMutex);
+
+            mGrabSyncDeferred = false;
+            syncGrabs();
         }
+        startupPhaseDone("register actions and grab", phaseStart);
+
         log(LOG_DEBUG, "Config file: %s", qPrintable(mConfigFile));
 
 
@@ -619,93 +626,166 @@ Core::Core(bool useSyslog, bool minLogLevelSet, int minLogLevel, const QStringLi
         log(LOG_DEBUG, "AllowGrabMiscSpecial: %s", mAllowGrabMiscSpecial ? "true" : "false");
         log(LOG_DEBUG, "AllowGrabBaseKeypad: %s",  mAllowGrabBaseKeypad  ? "true" : "false");
         log(LOG_DEBUG, "AllowGrabMiscKeypad: %s",  mAllowGrabMiscKeypad  ? "true" : "false");
+        log(LOG_DEBUG, "ActiveProfile: '%s'", qPrintable(mActiveProfile));
+        log(LOG_DEBUG, "MaxParallelActions: %d", mActionExecutor->maxThreads());
 
         mSaveAllowed = true;
         saveConfig();
 
 
 
-        mDaemonAdaptor = new DaemonAdaptor(this);
+        TRACE_SPAN("startup", "register D-Bus objects");
+
+        mDaemonAdaptor = new DaemonAdaptor(&mMetrics, this);
         if (!QDBusConnection::sessionBus().registerObject("/daemon", mDaemonAdaptor))
         {
             throw std::runtime_error(std::string("Cannot create daemon adaptor"));
         }
 
-        mNativeAdaptor = new NativeAdaptor(this);
+        mNativeAdaptor = new NativeAdaptor(&mMetrics, this);
         if (!QDBusConnection::sessionBus().registerObject("/native", mNativeAdaptor))
         {
             throw std::runtime_error(std::string("Cannot create daemon native client adaptor"));
         }
 
+        mMetricsAdaptor = new MetricsAdaptor(&mMetrics, this);
+        if (!QDBusConnection::sessionBus().registerObject("/metrics", mMetricsAdaptor))
+        {
+            throw std::runtime_error(std::string("Cannot create metrics adaptor"));
+        }
+
         connect(QDBusConnection::sessionBus().interface(), SIGNAL(serviceOwnerChanged(QString, QString, QString)), this, SLOT(serviceOwnerChanged(QString, QString, QString)));
 
-        connect(mDaemonAdaptor, SIGNAL(onAddMethodAction(QPair<QString, qulonglong>&, QString, QString, QDBusObjectPath, QString, QString, QString)), this, SLOT(addMethodAction(QPair<QString, qulonglong>&, QString, QString, QDBusObjectPath, QString, QString, QString)));
-        connect(mDaemonAdaptor, SIGNAL(onAddCommandAction(QPair<QString, qulonglong>&, QString, QString, QStringList, QString)), this, SLOT(addCommandAction(QPair<QString, qulonglong>&, QString, QString, QStringList, QString)));
+        connect(mDaemonAdaptor, SIGNAL(onAddMethodAction(QPair<QString, qulonglong>&, QString, QString, QDBusObjectPath, QString, QString, QString, QDBusMessage)), this, SLOT(addMethodAction(QPair<QString, qulonglong>&, QString, QString, QDBusObjectPath, QString, QString, QString, QDBusMessage)));
+        connect(mDaemonAdaptor, SIGNAL(onAddCommandAction(QPair<QString, qulonglong>&, QString, QString, QStringList, QString, QDBusMessage)), this, SLOT(addCommandAction(QPair<QString, qulonglong>&, QString, QString, QStringList, QString, QDBusMessage)));
         connect(mDaemonAdaptor, SIGNAL(onModifyActionDescription(bool &, qulonglong, QString)), this, SLOT(modifyActionDescription(bool &, qulonglong, QString)));
         connect(mDaemonAdaptor, SIGNAL(onModifyMethodAction(bool &, qulonglong, QString, QDBusObjectPath, QString, QString, QString)), this, SLOT(modifyMethodAction(bool &, qulonglong, QString, QDBusObjectPath, QString, QString, QString)));
         connect(mDaemonAdaptor, SIGNAL(onModifyCommandAction(bool &, qulonglong, QString, QStringList, QString)), this, SLOT(modifyCommandAction(bool &, qulonglong, QString, QStringList, QString)));
         connect(mDaemonAdaptor, SIGNAL(onEnableAction(bool &, qulonglong, bool)), this, SLOT(enableAction(bool &, qulonglong, bool)));
         connect(mDaemonAdaptor, SIGNAL(onIsActionEnabled(bool &, qulonglong)), this, SLOT(isActionEnabled(bool &, qulonglong)));
         connect(mDaemonAdaptor, SIGNAL(onGetClientActionSender(QString &, qulonglong)), this, SLOT(getClientActionSender(QString &, qulonglong)));
-        connect(mDaemonAdaptor, SIGNAL(onChangeShortcut(QString &, qulonglong, QString)), this, SLOT(changeShortcut(QString &, qulonglong, QString)));
+        connect(mDaemonAdaptor, SIGNAL(onChangeShortcut(QString &, qulonglong, QString, QDBusMessage)), this, SLOT(changeShortcut(QString &, qulonglong, QString, QDBusMessage)));
         connect(mDaemonAdaptor, SIGNAL(onSwapActions(bool &, qulonglong, qulonglong)), this, SLOT(swapActions(bool &, qulonglong, qulonglong)));
         connect(mDaemonAdaptor, SIGNAL(onRemoveAction(bool &, qulonglong)), this, SLOT(removeAction(bool &, qulonglong)));
         connect(mDaemonAdaptor, SIGNAL(onSetMultipleActionsBehaviour(MultipleActionsBehaviour)), this, SLOT(setMultipleActionsBehaviour(MultipleActionsBehaviour)));
         connect(mDaemonAdaptor, SIGNAL(onGetMultipleActionsBehaviour(MultipleActionsBehaviour &)), this, SLOT(getMultipleActionsBehaviour(MultipleActionsBehaviour &)));
+        connect(mDaemonAdaptor, SIGNAL(onSetActiveProfile(bool &, QString)), this, SLOT(setActiveProfile(bool &, QString)));
+        connect(mDaemonAdaptor, SIGNAL(onGetActiveProfile(QString &)), this, SLOT(getActiveProfile(QString &)));
+        connect(mDaemonAdaptor, SIGNAL(onGetProfiles(QStringList &)), this, SLOT(getProfiles(QStringList &)));
+        connect(mDaemonAdaptor, SIGNAL(onSetActionProfiles(bool &, qulonglong, QStringList)), this, SLOT(setActionProfiles(bool &, qulonglong, QStringList)));
+        connect(mDaemonAdaptor, SIGNAL(onGetActionProfiles(QStringList &, qulonglong)), this, SLOT(getActionProfiles(QStringList &, qulonglong)));
+        connect(mDaemonAdaptor, SIGNAL(onSetActionContext(bool &, qulonglong, QString)), this, SLOT(setActionContext(bool &, qulonglong, QString)));
+        connect(mDaemonAdaptor, SIGNAL(onGetActionContext(QString &, qulonglong)), this, SLOT(getActionContext(QString &, qulonglong)));
+        connect(mDaemonAdaptor, SIGNAL(onSetMethodActionAllowActivation(bool &, qulonglong, bool)), this, SLOT(setMethodActionAllowActivation(bool &, qulonglong, bool)));
+        connect(mDaemonAdaptor, SIGNAL(onGetMethodActionAllowActivation(QPair<bool, bool>&, qulonglong)), this, SLOT(getMethodActionAllowActivation(QPair<bool, bool>&, qulonglong)));
+        connect(mDaemonAdaptor, SIGNAL(onSetCommandActionLaunchPolicy(bool &, qulonglong, QString)), this, SLOT(setCommandActionLaunchPolicy(bool &, qulonglong, QString)));
+        connect(mDaemonAdaptor, SIGNAL(onGetCommandActionLaunchPolicy(QString &, qulonglong)), this, SLOT(getCommandActionLaunchPolicy(QString &, qulonglong)));
+        connect(mDaemonAdaptor, SIGNAL(onGetRunningProcesses(QMap<qulonglong, uint>&)), this, SLOT(getRunningProcesses(QMap<qulonglong, uint>&)));
+        connect(mDaemonAdaptor, SIGNAL(onGetCommandActionsUsage(QMap<qulonglong, CommandActionUsage>&)), this, SLOT(getCommandActionsUsage(QMap<qulonglong, CommandActionUsage>&)));
+        connect(mDaemonAdaptor, SIGNAL(onGetCommandActionUsage(QPair<bool, CommandActionUsage>&, qulonglong)), this, SLOT(getCommandActionUsage(QPair<bool, CommandActionUsage>&, qulonglong)));
+        connect(mDaemonAdaptor, SIGNAL(onGetActionsGeneration(qulonglong &)), this, SLOT(getActionsGeneration(qulonglong &)));
+        connect(mDaemonAdaptor, SIGNAL(onGetChangesSince(QPair<bool, QList_ActionChange>&, qulonglong)), this, SLOT(getChangesSince(QPair<bool, QList_ActionChange>&, qulonglong)));
         connect(mDaemonAdaptor, SIGNAL(onGetAllActionIds(QList<qulonglong>&)), this, SLOT(getAllActionIds(QList<qulonglong>&)));
         connect(mDaemonAdaptor, SIGNAL(onGetActionById(QPair<bool, GeneralActionInfo>&, qulonglong)), this, SLOT(getActionById(QPair<bool, GeneralActionInfo>&, qulonglong)));
         connect(mDaemonAdaptor, SIGNAL(onGetAllActions(QMap<qulonglong, GeneralActionInfo>&)), this, SLOT(getAllActions(QMap<qulonglong, GeneralActionInfo>&)));
         connect(mDaemonAdaptor, SIGNAL(onGetClientActionInfoById(QPair<bool, ClientActionInfo>&, qulonglong)), this, SLOT(getClientActionInfoById(QPair<bool, ClientActionInfo>&, qulonglong)));
         connect(mDaemonAdaptor, SIGNAL(onGetMethodActionInfoById(QPair<bool, MethodActionInfo>&, qulonglong)), this, SLOT(getMethodActionInfoById(QPair<bool, MethodActionInfo>&, qulonglong)));
         connect(mDaemonAdaptor, SIGNAL(onGetCommandActionInfoById(QPair<bool, CommandActionInfo>&, qulonglong)), this, SLOT(getCommandActionInfoById(QPair<bool, CommandActionInfo>&, qulonglong)));
+        connect(mDaemonAdaptor, SIGNAL(onGetMemoryUsage(QMap<QString, qulonglong>&)), this, SLOT(getMemoryUsage(QMap<QString, qulonglong>&)));
+        connect(mDaemonAdaptor, SIGNAL(onIsReady(bool &)), this, SLOT(isReady(bool &)));
         connect(mDaemonAdaptor, SIGNAL(onGrabShortcut(uint, QString &, bool &, bool &, bool &, QDBusMessage)), this, SLOT(grabShortcut(uint, QString &, bool &, bool &, bool &, QDBusMessage)));
         connect(mDaemonAdaptor, SIGNAL(onCancelShortcutGrab()), this, SLOT(cancelShortcutGrab()));
         connect(mDaemonAdaptor, SIGNAL(onQuit()), qApp, SLOT(quit()));
 
-        connect(mNativeAdaptor, SIGNAL(onAddClientAction(QPair<QString, qulonglong>&, QString, QDBusObjectPath, QString, QString)), this, SLOT(addClientAction(QPair<QString, qulonglong>&, QString, QDBusObjectPath, QString, QString)));
+        connect(mNativeAdaptor, SIGNAL(onAddClientAction(QPair<QString, qulonglong>&, QString, QDBusObjectPath, QString, QString, QDBusMessage)), this, SLOT(addClientAction(QPair<QString, qulonglong>&, QString, QDBusObjectPath, QString, QString, QDBusMessage)));
         connect(mNativeAdaptor, SIGNAL(onModifyClientAction(qulonglong &, QDBusObjectPath, QString, QString)), this, SLOT(modifyClientAction(qulonglong &, QDBusObjectPath, QString, QString)));
         connect(mNativeAdaptor, SIGNAL(onEnableClientAction(bool &, QDBusObjectPath, bool, QString)), this, SLOT(enableClientAction(bool &, QDBusObjectPath, bool, QString)));
         connect(mNativeAdaptor, SIGNAL(onIsClientActionEnabled(bool &, QDBusObjectPath, QString)), this, SLOT(isClientActionEnabled(bool &, QDBusObjectPath, QString)));
-        connect(mNativeAdaptor, SIGNAL(onChangeClientActionShortcut(QPair<QString, qulonglong>&, QDBusObjectPath, QString, QString)), this, SLOT(changeClientActionShortcut(QPair<QString, qulonglong>&, QDBusObjectPath, QString, QString)));
+        connect(mNativeAdaptor, SIGNAL(onChangeClientActionShortcut(QPair<QString, qulonglong>&, QDBusObjectPath, QString, QString, QDBusMessage)), this, SLOT(changeClientActionShortcut(QPair<QString, qulonglong>&, QDBusObjectPath, QString, QString, QDBusMessage)));
         connect(mNativeAdaptor, SIGNAL(onRemoveClientAction(bool &, QDBusObjectPath, QString)), this, SLOT(removeClientAction(bool &, QDBusObjectPath, QString)));
         connect(mNativeAdaptor, SIGNAL(onDeactivateClientAction(bool &, QDBusObjectPath, QString)), this, SLOT(deactivateClientAction(bool &, QDBusObjectPath, QString)));
         connect(mNativeAdaptor, SIGNAL(onGrabShortcut(uint, QString &, bool &, bool &, bool &, QDBusMessage)), this, SLOT(grabShortcut(uint, QString &, bool &, bool &, bool &, QDBusMessage)));
         connect(mNativeAdaptor, SIGNAL(onCancelShortcutGrab()), this, SLOT(cancelShortcutGrab()));
+        connect(mNativeAdaptor, SIGNAL(onOpenActivationChannel(QPair<int, int>&, QString)), this, SLOT(openActivationChannel(QPair<int, int>&, QString)));
+        connect(mNativeAdaptor, SIGNAL(onActivationChannelAccepted(QString)), this, SLOT(activationChannelAccepted(QString)));
 
         mShortcutGrabTimeout->setSingleShot(true);
 
         connect(this, SIGNAL(onShortcutGrabbed()), this, SLOT(shortcutGrabbed()), Qt::QueuedConnection);
         connect(mShortcutGrabTimeout, SIGNAL(timeout()), this, SLOT(shortcutGrabTimedout()));
 
+        mConfigReloadTimer->setSingleShot(true);
+        mConfigReloadTimer->setInterval(200);
+        connect(mConfigReloadTimer, SIGNAL(timeout()), this, SLOT(reloadConfig()));
+        connect(mConfigWatcher, SIGNAL(fileChanged(QString)), this, SLOT(configFileChanged()));
+        connect(mConfigWatcher, SIGNAL(directoryChanged(QString)), this, SLOT(configFileChanged()));
+        mConfigWatcher->addPath(QFileInfo(mConfigFile).absolutePath());
+        watchConfigFile();
+
+        if (!mMetricsFile.isEmpty())
+        {
+            connect(mMetricsTimer, SIGNAL(timeout()), this, SLOT(dumpMetrics()));
+            mMetricsTimer->start(metricsInterval * 1000);
+        }
+
+
+        startupPhaseDone("register D-Bus objects", phaseStart);
 
         log(LOG_NOTICE, "Started");
 
         mReady = true;
+        mDaemonAdaptor->emit_ready();
     }
     catch (const std::exception &err)
     {
         log(LOG_CRIT, "%s", err.what());
     }
+
+    return mReady;
 }
 
 Core::~Core()
 {
     log(LOG_INFO, "Stopping");
 
-    closeBothPipeEnds(mX11ErrorPipe);
-    closeBothPipeEnds(mX11RequestPipe);
-    closeBothPipeEnds(mX11ResponsePipe);
+    if (!mMetricsFile.isEmpty())
+    {
+        dumpMetrics();
+    }
 
-    mX11EventLoopActive = false;
-    wakeX11Thread();
-    wait();
+    foreach(X11Connection *connection, mX11Connections)
+    {
+        connection->stop();
+    }
+    // out of the list first, the error handler must not find a connection being destroyed
+    while (!mX11Connections.isEmpty())
+    {
+        delete mX11Connections.takeFirst();
+    }
+    if (mOldX11ErrorHandler)
+    {
+        XSetErrorHandler(mOldX11ErrorHandler);
+    }
 
     delete mDaemonAdaptor;
 
+    // writes out a save that is still pending
+    delete mConfigSaver;
+
+    // waits for the actions still running
+    delete mActionExecutor;
+    delete mActionChain;
+
     ShortcutAndActionById::iterator lastShortcutAndActionById = mShortcutAndActionById.end();
     for (ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.begin(); shortcutAndActionById != lastShortcutAndActionById; ++shortcutAndActionById)
     {
-        delete shortcutAndActionById.value().second;
+        shortcutAndActionById.value().second->release();
+    }
+
+    ClientProxyBySender::iterator lastClientProxyBySender = mClientProxyBySender.end();
+    for (ClientProxyBySender::iterator clientProxyBySender = mClientProxyBySender.begin(); clientProxyBySender != lastClientProxyBySender; ++clientProxyBySender)
+    {
+        delete clientProxyBySender.value();
     }
 
     log(LOG_NOTICE, "Stopped");
@@ -713,1522 +793,2044 @@ Core::~Core()
     closelog();
 }
 
-void Core::saveConfig()
+Core::ConfigEntries Core::readConfigEntries(QSettings &settings)
 {
-    if (!mSaveAllowed)
+    ConfigEntries result;
+
+    foreach(QString section, settings.childGroups())
     {
-        return;
-    }
+        if (section == "General")
+        {
+            continue;
+        }
 
-    QSettings settings(mConfigFile, QSettings::IniFormat);
+        settings.beginGroup(section);
 
-    settings.clear();
+        ConfigEntry entry;
 
-    switch (mMultipleActionsBehaviour)
-    {
-    case MULTIPLE_ACTIONS_BEHAVIOUR_FIRST:
-        settings.setValue(/* General/ */"MultipleActionsBehaviour", "first");
-        break;
+        entry.id = 0ull;
+        entry.allowActivation = true;
+        entry.launchPolicy = CommandAction::launchPolicyName(CommandAction::LAUNCH_ALWAYS);
+        entry.shortcut = section;
+        int pos = entry.shortcut.indexOf('.');
+        if (pos != -1)
+        {
+            entry.id = entry.shortcut.mid(pos + 1).toULongLong();
+            entry.shortcut = entry.shortcut.left(pos);
+        }
 
-    case MULTIPLE_ACTIONS_BEHAVIOUR_LAST:
-        settings.setValue(/* General/ */"MultipleActionsBehaviour", "last");
-        break;
+        entry.shortcut = StringPool::intern(entry.shortcut);
+        entry.enabled = settings.value("Enabled", true).toBool();
+        entry.description = StringPool::intern(settings.value("Comment").toString());
+        entry.profiles = StringPool::intern(settings.value("Profiles").toStringList());
+        entry.context = StringPool::intern(settings.value("Context").toString());
 
-    case MULTIPLE_ACTIONS_BEHAVIOUR_ALL:
-        settings.setValue(/* General/ */"MultipleActionsBehaviour", "all");
-        break;
+        bool valid;
+        if (settings.contains("Exec"))
+        {
+            entry.exec = StringPool::intern(settings.value("Exec").toStringList());
+            entry.launchPolicy = settings.value("LaunchPolicy", entry.launchPolicy).toString();
+            valid = !entry.exec.isEmpty();
+        }
+        else
+        {
+            entry.path = StringPool::intern(settings.value("path").toString());
+            valid = !entry.path.isEmpty();
+            if (settings.contains("interface"))
+            {
+                entry.interface = StringPool::intern(settings.value("interface").toString());
+                entry.service = StringPool::intern(settings.value("service").toString());
+                entry.method = StringPool::intern(settings.value("method").toString());
+                entry.allowActivation = settings.value("AllowActivation", true).toBool();
+                valid = valid && !entry.service.isEmpty() && !entry.method.isEmpty();
+            }
+        }
 
-    case MULTIPLE_ACTIONS_BEHAVIOUR_NONE:
-        settings.setValue(/* General/ */"MultipleActionsBehaviour", "none");
-        break;
+        settings.endGroup();
 
-    default:
-        ;
+        if (valid)
+        {
+            result.push_back(entry);
+        }
     }
 
-    settings.setValue(/* General/ */"AllowGrabLocks",       mAllowGrabLocks);
-    settings.setValue(/* General/ */"AllowGrabBaseSpecial", mAllowGrabBaseSpecial);
-    settings.setValue(/* General/ */"AllowGrabMiscSpecial", mAllowGrabMiscSpecial);
-    settings.setValue(/* General/ */"AllowGrabBaseKeypad",  mAllowGrabBaseKeypad);
-    settings.setValue(/* General/ */"AllowGrabMiscKeypad",  mAllowGrabMiscKeypad);
+    return result;
+}
+
+qulonglong Core::registerConfigEntry(const ConfigEntry &entry)
+{
+    qulonglong id = 0ull;
 
-    ShortcutAndActionById::const_iterator lastShortcutAndActionById = mShortcutAndActionById.end();
-    for (ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.begin(); shortcutAndActionById != lastShortcutAndActionById; ++shortcutAndActionById)
+    switch (entry.type())
     {
-        const BaseAction *action = shortcutAndActionById.value().second;
-        QString section = shortcutAndActionById.value().first + "." + QString::number(shortcutAndActionById.key());
+    case ConfigEntry::COMMAND:
+        id = registerCommandAction(entry.shortcut, entry.exec[0], entry.exec.mid(1), entry.description);
+        break;
 
-        settings.beginGroup(section);
+    case ConfigEntry::METHOD:
+        id = registerMethodAction(entry.shortcut, entry.service, QDBusObjectPath(entry.path), entry.interface, entry.method, entry.description);
+        break;
 
-        settings.setValue("Enabled", action->isEnabled());
-        settings.setValue("Comment", action->description());
+    default:
+        id = registerClientAction(entry.shortcut, QDBusObjectPath(entry.path), entry.description);
+    }
 
-        if (!strcmp(action->type(), CommandAction::id()))
-        {
-            const CommandAction *commandAction = dynamic_cast<const CommandAction *>(action);
-            settings.setValue("Exec", QVariant(QStringList() << commandAction->command() += commandAction->args()));
-        }
-        else if (!strcmp(action->type(), MethodAction::id()))
+    if (id)
+    {
+        QMutexLocker lock(&mDataMutex);
+
+        ShortcutAndAction &shortcutAndAction = mShortcutAndActionById[id];
+        shortcutAndAction.second->setEnabled(entry.enabled);
+        shortcutAndAction.second->setProfiles(entry.profiles);
+        shortcutAndAction.second->setContext(entry.context);
+        if (entry.type() == ConfigEntry::METHOD)
         {
-            const MethodAction *methodAction = dynamic_cast<const MethodAction *>(action);
-            settings.setValue("service",   methodAction->service());
-            settings.setValue("path",      methodAction->path().path());
-            settings.setValue("interface", methodAction->interface());
-            settings.setValue("method",    methodAction->method());
+            dynamic_cast<MethodAction *>(shortcutAndAction.second)->setAllowActivation(entry.allowActivation);
         }
-        else if (!strcmp(action->type(), ClientAction::id()))
+        else if (entry.type() == ConfigEntry::COMMAND)
         {
-            const ClientAction *clientAction = dynamic_cast<const ClientAction *>(action);
-            settings.setValue("path",  clientAction->path().path());
+            CommandAction::LaunchPolicy launchPolicy;
+            if (CommandAction::launchPolicyFromName(entry.launchPolicy, launchPolicy))
+            {
+                dynamic_cast<CommandAction *>(shortcutAndAction.second)->setLaunchPolicy(launchPolicy);
+            }
+            else
+            {
+                log(LOG_WARNING, "Unknown launch policy '%s' of action #%llu", qPrintable(entry.launchPolicy), id);
+            }
         }
-
-        settings.endGroup();
     }
-}
 
-void Core::unixSignalHandler(int signalNumber)
-{
-    log(LOG_INFO, "Signal #%d received", signalNumber);
-    qApp->quit();
+    return id;
 }
 
-void Core::log(int level, const char *format, ...) const
+Core::ConfigEntry Core::configEntry(qulonglong id, const ShortcutAndAction &shortcutAndAction) const
 {
-    if (level > mMinLogLevel)
-    {
-        return;
-    }
+    ConfigEntry result;
 
-    va_list ap;
-    va_start(ap, format);
-    if (mUseSyslog)
+    result.id = id;
+    result.shortcut = shortcutAndAction.first;
+    result.allowActivation = true;
+    result.launchPolicy = CommandAction::launchPolicyName(CommandAction::LAUNCH_ALWAYS);
+
+    const BaseAction *action = shortcutAndAction.second;
+
+    result.enabled = action->isEnabled();
+    result.description = action->description();
+    result.profiles = action->profiles();
+    result.context = action->context();
+
+    if (!strcmp(action->type(), CommandAction::id()))
     {
-        vsyslog(LOG_MAKEPRI(LOG_USER, level), format, ap);
+        const CommandAction *commandAction = dynamic_cast<const CommandAction *>(action);
+        result.exec = QStringList() << commandAction->command() << commandAction->args();
+        result.launchPolicy = CommandAction::launchPolicyName(commandAction->launchPolicy());
     }
-    else
+    else if (!strcmp(action->type(), MethodAction::id()))
     {
-        fprintf(stderr, "[%s] ", strLevel(level));
-        vfprintf(stderr, format, ap);
-        fprintf(stderr, "\n");
+        const MethodAction *methodAction = dynamic_cast<const MethodAction *>(action);
+        result.service = methodAction->service();
+        result.path = methodAction->path().path();
+        result.interface = methodAction->interface();
+        result.method = methodAction->method();
+        result.allowActivation = methodAction->allowActivation();
     }
-    va_end(ap);
-}
-
-int Core::x11ErrorHandler(Display */*display*/, XErrorEvent *errorEvent)
-{
-    if (error_t error = writeAll(mX11ErrorPipe[STDOUT_FILENO], errorEvent, sizeof(XErrorEvent)))
+    else if (!strcmp(action->type(), ClientAction::id()))
     {
-        log(LOG_CRIT, "Cannot write to error signal pipe: %s", strerror(error));
-        qApp->quit();
-        return 0;
+        const ClientAction *clientAction = dynamic_cast<const ClientAction *>(action);
+        result.path = clientAction->path().path();
     }
 
-    return 0;
+    return result;
 }
 
-bool Core::waitForX11Error(int level, uint timeout)
+QByteArray Core::configFileHash() const
 {
-    pollfd *fds = new pollfd[1];
-    fds[0].fd = mX11ErrorPipe[STDIN_FILENO];
-    fds[0].events = POLLIN | POLLERR | POLLHUP;
-    if (poll(fds, 1, timeout) < 0)
+    QFile file(mConfigFile);
+    if (!file.open(QIODevice::ReadOnly))
     {
-        return true;
+        return QByteArray();
     }
 
-    bool result = false;
+    return QCryptographicHash::hash(file.readAll(), QCryptographicHash::Md5);
+}
 
-    while (fds[0].revents & POLLIN)
+void Core::watchConfigFile()
+{
+    if (!mConfigWatcher->files().contains(mConfigFile) && QFile::exists(mConfigFile))
     {
-        XErrorEvent errorEvent;
-        if (error_t error = readAll(mX11ErrorPipe[STDIN_FILENO], &errorEvent, sizeof(errorEvent)))
-        {
-            log(LOG_CRIT, "Cannot read from error signal pipe: %s", strerror(error));
-            qApp->quit();
-        }
-
-        char errorString[1024];
-        XGetErrorText(errorEvent.display, errorEvent.error_code, errorString, 1023);
-        log(level, "X11 error: type: %d, serial: %lu, error_code: %d '%s', request_code: %d (%s), minor_code: %d, resourceid: %lu", errorEvent.type, errorEvent.serial, errorEvent.error_code, errorString, errorEvent.request_code, x11opcodeToString(errorEvent.request_code), errorEvent.minor_code, errorEvent.resourceid);
-
-        result = true;
-
-        if (poll(fds, 1, 0) < 0)
-        {
-            return true;
-        }
+        mConfigWatcher->addPath(mConfigFile);
     }
-
-    return result;
 }
 
-void Core::lockX11Error()
+void Core::readAllowGrab(QSettings &settings)
 {
-    mX11ErrorMutex.lock();
-    waitForX11Error(false, 0);
+    // a missing key keeps the current value, the built-in default at startup
+    mAllowGrabLocks = settings.value(/* General/ */"AllowGrabLocks", mAllowGrabLocks).toBool();
+    mAllowGrabBaseSpecial = settings.value(/* General/ */"AllowGrabBaseSpecial", mAllowGrabBaseSpecial).toBool();
+    mAllowGrabMiscSpecial = settings.value(/* General/ */"AllowGrabMiscSpecial", mAllowGrabMiscSpecial).toBool();
+    mAllowGrabBaseKeypad = settings.value(/* General/ */"AllowGrabBaseKeypad", mAllowGrabBaseKeypad).toBool();
+    mAllowGrabMiscKeypad = settings.value(/* General/ */"AllowGrabMiscKeypad", mAllowGrabMiscKeypad).toBool();
 }
 
-bool Core::checkX11Error(int level, uint timeout)
+void Core::configFileChanged()
 {
-//    unsigned long serial = NextRequest(mDisplay);
-//    log(LOG_DEBUG, "X11 error: serial: %lu", serial);
-
-    bool result = waitForX11Error(level, timeout);
-    mX11ErrorMutex.unlock();
-    return result;
+    // editors tend to write in several steps, reload once they are done
+    mConfigReloadTimer->start();
 }
 
-void Core::wakeX11Thread()
+void Core::reloadConfig()
 {
-    if (mInterClientCommunicationWindow)
+    // an editor replacing the file by renaming drops it from the watcher
+    watchConfigFile();
+
+    // our own write is still on its way, look again once it has landed
+    if (mConfigSaver->isBusy())
     {
-        XClientMessageEvent dummyEvent;
-        memset(&dummyEvent, 0, sizeof(dummyEvent));
-        dummyEvent.type = ClientMessage;
-        dummyEvent.window = mInterClientCommunicationWindow;
-        dummyEvent.format = 32;
+        mConfigReloadTimer->start();
+        return;
+    }
 
-        lockX11Error();
-        XSendEvent(mDisplay, mInterClientCommunicationWindow, 0, 0, reinterpret_cast<XEvent *>(&dummyEvent));
-        checkX11Error();
-        XFlush(mDisplay);
+    QByteArray hash = configFileHash();
+    if (hash.isEmpty() || (hash == mConfigFileHash) || (hash == mConfigSaver->lastHash()))
+    {
+        return;
     }
-}
+    mConfigFileHash = hash;
 
-bool Core::isEscape(KeySym keySym, unsigned int modifiers)
-{
-    return ((keySym == XK_Escape) && (!modifiers));
-}
+    log(LOG_NOTICE, "Config file changed, reloading: %s", qPrintable(mConfigFile));
 
-bool Core::isModifier(KeySym keySym)
-{
-    switch (keySym)
-    {
-    case XK_Shift_L:
-    case XK_Shift_R:
-    case XK_Control_L:
-    case XK_Control_R:
-    case XK_Meta_L:
-    case XK_Meta_R:
-    case XK_Alt_L:
-    case XK_Alt_R:
-    case XK_Super_L:
-    case XK_Super_R:
-    case XK_Hyper_L:
-    case XK_Hyper_R:
-    case XK_ISO_Level3_Shift:
-    case XK_ISO_Level5_Shift:
-    case XK_ISO_Group_Shift:
-        return true;
+    TRACE_SPAN("config", "reload config");
 
-    }
-    return false;
-}
+    QSettings settings(mConfigFile, QSettings::IniFormat);
 
-bool Core::isAllowed(KeySym keySym, unsigned int modifiers)
-{
-    switch (keySym)
+    if (!mMinLogLevelSet)
     {
-    case XK_Scroll_Lock:
-    case XK_Num_Lock:
-    case XK_Caps_Lock:
-    case XK_ISO_Lock:
-    case XK_ISO_Level3_Lock:
-    case XK_ISO_Level5_Lock:
-    case XK_ISO_Group_Lock:
-    case XK_ISO_Next_Group_Lock:
-    case XK_ISO_Prev_Group_Lock:
-    case XK_ISO_First_Group_Lock:
-    case XK_ISO_Last_Group_Lock:
-        if (!modifiers)
+        int minLogLevel = logLevel(settings.value(/* General/ */"LogLevel").toString(), mMinLogLevel);
+        if (minLogLevel != mMinLogLevel)
         {
-            return mAllowGrabLocks;
+            mMinLogLevel = minLogLevel;
+            log(LOG_NOTICE, "MinLogLevel: %s", strLevel(mMinLogLevel));
         }
-        break;
+    }
 
-    case XK_Home:
-    case XK_Left:
-    case XK_Up:
-    case XK_Right:
-    case XK_Down:
-    case XK_Page_Up:
-    case XK_Page_Down:
-    case XK_End:
-    case XK_Delete:
-    case XK_Insert:
-    case XK_BackSpace:
-    case XK_Tab:
-    case XK_Return:
-    case XK_space:
-        if (!modifiers)
-        {
-            return mAllowGrabBaseSpecial;
-        }
-        break;
+    {
+        QMutexLocker lock(&mDataMutex);
 
-    case XK_Pause:
-    case XK_Print:
-    case XK_Linefeed:
-    case XK_Clear:
-    case XK_Multi_key:
-    case XK_Codeinput:
-    case XK_SingleCandidate:
-    case XK_MultipleCandidate:
-    case XK_PreviousCandidate:
-    case XK_Begin:
-    case XK_Select:
-    case XK_Execute:
-    case XK_Undo:
-    case XK_Redo:
-    case XK_Menu:
-    case XK_Find:
-    case XK_Cancel:
-    case XK_Help:
-    case XK_Sys_Req:
-    case XK_Break:
-        if (!modifiers)
-        {
-            return mAllowGrabMiscSpecial;
-        }
-        break;
+        // they only gate which key grabShortcut records, the passive grabs of the bindings do not depend on them
+        readAllowGrab(settings);
+    }
 
-    case XK_KP_Enter:
-    case XK_KP_Home:
-    case XK_KP_Left:
-    case XK_KP_Up:
-    case XK_KP_Right:
-    case XK_KP_Down:
-    case XK_KP_Page_Up:
-    case XK_KP_Page_Down:
-    case XK_KP_End:
-    case XK_KP_Begin:
-    case XK_KP_Insert:
-    case XK_KP_Delete:
-    case XK_KP_Multiply:
-    case XK_KP_Add:
-    case XK_KP_Subtract:
-    case XK_KP_Decimal:
-    case XK_KP_Divide:
-    case XK_KP_0:
-    case XK_KP_1:
-    case XK_KP_2:
-    case XK_KP_3:
-    case XK_KP_4:
-    case XK_KP_5:
-    case XK_KP_6:
-    case XK_KP_7:
-    case XK_KP_8:
-    case XK_KP_9:
-        if (!modifiers)
-        {
-            return mAllowGrabBaseKeypad;
+    if (!mMultipleActionsBehaviourSet)
+    {
+        QString iniValue = settings.value(/* General/ */"MultipleActionsBehaviour").toString();
+        MultipleActionsBehaviour behaviour = mMultipleActionsBehaviour;
+        if (iniValue == "first")
+        {
+            behaviour = MULTIPLE_ACTIONS_BEHAVIOUR_FIRST;
         }
-        break;
-
-    case XK_KP_Space:
-    case XK_KP_Tab:
-    case XK_KP_F1:
-    case XK_KP_F2:
-    case XK_KP_F3:
-    case XK_KP_F4:
-    case XK_KP_Equal:
-    case XK_KP_Separator:
-        if (!modifiers)
+        else if (iniValue == "last")
         {
-            return mAllowGrabMiscKeypad;
+            behaviour = MULTIPLE_ACTIONS_BEHAVIOUR_LAST;
         }
-        break;
-
-    case XK_grave:
-    case XK_1:
-    case XK_2:
-    case XK_3:
-    case XK_4:
-    case XK_5:
-    case XK_6:
-    case XK_7:
-    case XK_8:
-    case XK_9:
-    case XK_0:
-    case XK_minus:
-    case XK_equal:
-    case XK_Q:
-    case XK_W:
-    case XK_E:
-    case XK_R:
-    case XK_T:
-    case XK_Y:
-    case XK_U:
-    case XK_I:
-    case XK_O:
-    case XK_P:
-    case XK_bracketleft:
-    case XK_bracketright:
-    case XK_backslash:
-    case XK_A:
-    case XK_S:
-    case XK_D:
-    case XK_F:
-    case XK_G:
-    case XK_H:
-    case XK_J:
-    case XK_K:
-    case XK_L:
-    case XK_semicolon:
-    case XK_apostrophe:
-    case XK_Z:
-    case XK_X:
-    case XK_C:
-    case XK_V:
-    case XK_B:
-    case XK_N:
-    case XK_M:
-    case XK_comma:
-    case XK_period:
-    case XK_slash:
-        if (!(modifiers & ~(ShiftMask | Level3Mask | Level5Mask)))
-        {
-            return mAllowGrabPrintable;
+        else if (iniValue == "all")
+        {
+            behaviour = MULTIPLE_ACTIONS_BEHAVIOUR_ALL;
+        }
+        else if (iniValue == "none")
+        {
+            behaviour = MULTIPLE_ACTIONS_BEHAVIOUR_NONE;
         }
-        break;
 
-    }
-    return true;
-}
+        if (behaviour != mMultipleActionsBehaviour)
+        {
+            {
+                QMutexLocker lock(&mDataMutex);
 
-void Core::run()
-{
-    mX11EventLoopActive = true;
-
-    XInitThreads();
-
-    int (*oldx11ErrorHandler)(Display * display, XErrorEvent * errorEvent) = XSetErrorHandler(::x11ErrorHandler);
-
-    mDisplay = XOpenDisplay(NULL);
-    XSynchronize(mDisplay, True);
-
-    lockX11Error();
+                mMultipleActionsBehaviour = behaviour;
+            }
+            mDaemonAdaptor->emit_multipleActionsBehaviourChanged(behaviour);
+        }
+    }
 
-    Window rootWindow = DefaultRootWindow(mDisplay);
+    mActionExecutor->setMaxThreads(settings.value(/* General/ */"MaxParallelActions", mActionExecutor->maxThreads()).toInt());
 
-    XSelectInput(mDisplay, rootWindow, KeyPressMask);
+    {
+        QMutexLocker lock(&mDataMutex);
 
-    mInterClientCommunicationWindow = XCreateSimpleWindow(mDisplay, rootWindow, 0, 0, 1, 1, 0, 0, 0);
+        mStrictOrderShortcuts = settings.value(/* General/ */"StrictOrderShortcuts").toStringList().toSet();
+    }
 
-    XSelectInput(mDisplay, mInterClientCommunicationWindow, StructureNotifyMask);
+    ConfigEntries candidates = readConfigEntries(settings);
 
-    if (checkX11Error())
+    ConfigEntryById live;
     {
-        return;
-    }
+        QMutexLocker lock(&mDataMutex);
 
-    QSet<unsigned int> allModifiers;
-    unsigned int allShifts = ShiftMask | ControlMask | AltMask | MetaMask | Level3Mask | Level5Mask;
-    unsigned int ignoreMask = 0xff ^ allShifts;
-    for (unsigned int i = 0; i < 0x100; ++i)
-    {
-        unsigned int ignoreLocks = i & ignoreMask;
-        allModifiers.insert(ignoreLocks);
+        ShortcutAndActionById::const_iterator lastShortcutAndActionById = mShortcutAndActionById.constEnd();
+        for (ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.constBegin(); shortcutAndActionById != lastShortcutAndActionById; ++shortcutAndActionById)
+        {
+            live[shortcutAndActionById.key()] = configEntry(shortcutAndActionById.key(), shortcutAndActionById.value());
+        }
     }
 
+    // the mutators below would otherwise rewrite the file and touch the grabs after every step
+    mSaveAllowed = false;
+    mGrabSyncDeferred = true;
+
+    bool rewrite = false;
+    QSet<qulonglong> keptIds;
 
-    char signal = 0;
-    if (write(mX11ResponsePipe[STDOUT_FILENO], &signal, sizeof(signal)) == sizeof(signal))
+    // additions and changes go first, so a shortcut moving from a removed binding to a new one stays grabbed
+    foreach(const ConfigEntry &candidate, candidates)
     {
-        XEvent event;
-        while (mX11EventLoopActive)
+        ConfigEntryById::const_iterator current = live.constFind(candidate.id);
+        if ((current != live.constEnd()) && !keptIds.contains(candidate.id) && current.value().sameAction(candidate))
         {
-            XNextEvent(mDisplay, &event);
-            if (!mX11EventLoopActive)
-            {
-                break;
-            }
+            keptIds.insert(candidate.id);
+            applyConfigEntry(current.value(), candidate);
+        }
+        else
+        {
+            // new ids are handed out by the daemon, the file has to learn them
+            rewrite = true;
 
-            switch (event.type)
+            qulonglong id = addConfigEntry(candidate);
+            if (id)
             {
-            case KeyPress:
-            {
-                QMutexLocker lock(&mDataMutex);
-
-                if (mGrabbingShortcut)
-                {
-//                    log(LOG_DEBUG, "KeyPress %08x %08x", event.xkey.state, event.xkey.keycode);
-
-                    bool ignoreKey = false;
-                    bool cancel = false;
-                    QString shortcut;
-
-                    int keysymsPerKeycode;
-                    lockX11Error();
-                    KeySym *keySyms = XGetKeyboardMapping(mDisplay, event.xkey.keycode, 1, &keysymsPerKeycode);
-                    checkX11Error();
-
-                    if (keysymsPerKeycode)
-                    {
-                        if (keySyms[0])
-                        {
-                            KeySym keySym = 0;
-
-//                            log(LOG_DEBUG, "keysymsPerKeycode %d", keysymsPerKeycode);
-
-//                            for (int i = 0; i < keysymsPerKeycode; ++i)
-//                                log(LOG_DEBUG, "keySym #%d %08x", i, keySyms[i]);
-
-                            if ((keysymsPerKeycode >= 2) && keySyms[1] && (keySyms[0] >= XK_a) && (keySyms[0] <= XK_z))
-                            {
-                                keySym = keySyms[1];
-                            }
-                            else if (keysymsPerKeycode >= 1)
-                            {
-                                keySym = keySyms[0];
-                            }
-
-                            if (keySym)
-                            {
-                                if (isEscape(keySym, event.xkey.state & allShifts))
-                                {
-                                    cancel = true;
-                                }
-                                else
-                                {
-                                    if (isModifier(keySym) || !isAllowed(keySym, event.xkey.state & allShifts))
-                                    {
-                                        ignoreKey = true;
-                                    }
-                                    else
-                                    {
-                                        char *str = XKeysymToString(keySym);
-
-                                        if (str && *str)
-                                        {
-                                            if (event.xkey.state & ShiftMask)
-                                            {
-                                                shortcut += "Shift+";
-                                            }
-                                            if (event.xkey.state & ControlMask)
-                                            {
-                                                shortcut += "Control+";
-                                            }
-                                            if (event.xkey.state & AltMask)
-                                            {
-                                                shortcut += "Alt+";
-                                            }
-                                            if (event.xkey.state & MetaMask)
-                                            {
-                                                shortcut += "Meta+";
-                                            }
-                                            if (event.xkey.state & Level3Mask)
-                                            {
-                                                shortcut += "Level3+";
-                                            }
-                                            if (event.xkey.state & Level5Mask)
-                                            {
-                                                shortcut += "Level5+";
-                                            }
-
-                                            shortcut += str;
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    if (!ignoreKey)
-                    {
-                        IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(shortcut);
-                        if ((idsByShortcut == mIdsByShortcut.end()) || (idsByShortcut.value().isEmpty()))
-                        {
-                            log(LOG_DEBUG, "grabShortcut: checking %s", qPrintable(shortcut));
-                            lockX11Error();
-                            XUngrabKeyboard(mDisplay, CurrentTime);
-                            checkX11Error();
-
-                            QSet<unsigned int>::const_iterator lastAllModifiers = allModifiers.end();
-                            for (QSet<unsigned int>::const_iterator modifiers = allModifiers.begin(); modifiers != lastAllModifiers; ++modifiers)
-                            {
-                                log(LOG_DEBUG, "grabShortcut: checking %02x + %02x", event.xkey.keycode, event.xkey.state | *modifiers);
-                                lockX11Error();
-                                XGrabKey(mDisplay, event.xkey.keycode, event.xkey.state | *modifiers, rootWindow, False, GrabModeAsync, GrabModeAsync);
-                                ignoreKey |= checkX11Error(LOG_DEBUG);
-                            }
-
-                            lockX11Error();
-                            XUngrabKey(mDisplay, event.xkey.keycode, event.xkey.state, rootWindow);
-                            checkX11Error();
-
-                            if (ignoreKey)
-                            {
-                                lockX11Error();
-                                XGrabKeyboard(mDisplay, rootWindow, False, GrabModeAsync, GrabModeAsync, CurrentTime);
-                                checkX11Error();
-                            }
-                        }
-                        else
-                        {
-                            log(LOG_DEBUG, "grabShortcut: already grabbed %s", qPrintable(shortcut));
-                            lockX11Error();
-                            XUngrabKeyboard(mDisplay, CurrentTime);
-                            checkX11Error();
-                        }
-                    }
-                    if (!ignoreKey)
-                    {
-                        mGrabbingShortcut = false;
-
-                        if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], &cancel, sizeof(cancel)))
-                        {
-                            log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
-                            close(mX11RequestPipe[STDIN_FILENO]);
-                            mX11EventLoopActive = false;
-                            break;
-                        }
-                        if (!cancel)
-                        {
-                            size_t length = shortcut.length();
-                            if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], &length, sizeof(length)))
-                            {
-                                log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
-                                close(mX11RequestPipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-                            if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], qPrintable(shortcut), length))
-                            {
-                                log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
-                                close(mX11RequestPipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-                        }
-
-                        emit onShortcutGrabbed();
-                    }
-                }
-                else
-                {
-                    QString shortcut = mShortcutByX11[qMakePair(static_cast<KeyCode>(event.xkey.keycode), event.xkey.state & allShifts)];
-                    log(LOG_DEBUG, "KeyPress %08x %08x %s", event.xkey.state & allShifts, event.xkey.keycode, qPrintable(shortcut));
-
-                    IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(shortcut);
-                    if (idsByShortcut != mIdsByShortcut.end())
-                    {
-                        Ids &ids = idsByShortcut.value();
-                        switch (mMultipleActionsBehaviour)
-                        {
-                        case MULTIPLE_ACTIONS_BEHAVIOUR_FIRST:
-                        {
-                            Ids::iterator lastIds = ids.end();
-                            for (Ids::iterator idi = ids.begin(); idi != lastIds; ++idi)
-                                if (mShortcutAndActionById[*idi].second->call())
-                                {
-                                    break;
-                                }
-                        }
-                        break;
-
-                        case MULTIPLE_ACTIONS_BEHAVIOUR_LAST:
-                        {
-                            Ids::iterator firstIds = ids.begin();
-                            for (Ids::iterator idi = ids.end(); idi != firstIds;)
-                            {
-                                --idi;
-                                if (mShortcutAndActionById[*idi].second->call())
-                                {
-                                    break;
-                                }
-                            }
-                        }
-                        break;
-
-                        case MULTIPLE_ACTIONS_BEHAVIOUR_NONE:
-                            if (ids.size() == 1)
-                            {
-                                mShortcutAndActionById[*(ids.begin())].second->call();
-                            }
-                            break;
-
-                        case MULTIPLE_ACTIONS_BEHAVIOUR_ALL:
-                        {
-                            Ids::iterator lastIds = ids.end();
-                            for (Ids::iterator idi = ids.begin(); idi != lastIds; ++idi)
-                            {
-                                mShortcutAndActionById[*idi].second->call();
-                            }
-                        }
-                        break;
-
-                        default:
-                            ;
-                        }
-                    }
-                }
+                keptIds.insert(id);
             }
-            break;
+        }
+    }
 
-            default:
+    ConfigEntryById::const_iterator lastLive = live.constEnd();
+    for (ConfigEntryById::const_iterator current = live.constBegin(); current != lastLive; ++current)
+    {
+        if (!keptIds.contains(current.key()))
+        {
+            bool removed;
+            removeAction(removed, current.key());
+            if (!removed)
             {
-                pollfd *fds = new pollfd[1];
-                fds[0].fd = mX11RequestPipe[STDIN_FILENO];
-                fds[0].events = POLLIN | POLLERR | POLLHUP;
-                if (poll(fds, 1, 0) >= 0)
-                {
-                    if (fds[0].revents & POLLIN)
-                    {
-                        size_t X11Operation;
-                        if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &X11Operation, sizeof(X11Operation)))
-                        {
-                            log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
-                            close(mX11ResponsePipe[STDIN_FILENO]);
-                            mX11EventLoopActive = false;
-                            break;
-                        }
-//                            log(LOG_DEBUG, "X11Operation: %d", X11Operation);
-
-                        switch (X11Operation)
-                        {
-                        case X11_OP_StringToKeycode:
-                        {
-                            bool x11Error = false;
-                            KeyCode keyCode = 0;
-                            size_t length;
-                            if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &length, sizeof(length)))
-                            {
-                                log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
-                                close(mX11ResponsePipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-                            if (length)
-                            {
-                                char *str = new char[length + 1];
-                                str[length] = '\0';
-                                if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], str, length))
-                                {
-                                    log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
-                                    close(mX11ResponsePipe[STDIN_FILENO]);
-                                    mX11EventLoopActive = false;
-                                    break;
-                                }
-                                KeySym keySym = XStringToKeysym(str);
-                                delete[] str;
-                                lockX11Error();
-                                keyCode = XKeysymToKeycode(mDisplay, keySym);
-                                x11Error = checkX11Error();
-                            }
-
-                            signal = x11Error ? 1 : 0;
-                            if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], &signal, sizeof(signal)))
-                            {
-                                log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
-                                close(mX11RequestPipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-
-                            if (!x11Error)
-                                if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], &keyCode, sizeof(keyCode)))
-                                {
-                                    log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
-                                    close(mX11RequestPipe[STDIN_FILENO]);
-                                    mX11EventLoopActive = false;
-                                    break;
-                                }
-                        }
-                        break;
-
-                        case X11_OP_KeycodeToString:
-                        {
-                            KeyCode keyCode;
-                            bool x11Error = false;
-                            if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &keyCode, sizeof(keyCode)))
-                            {
-                                log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
-                                close(mX11ResponsePipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-                            int keysymsPerKeycode;
-                            lockX11Error();
-                            KeySym *keySyms = XGetKeyboardMapping(mDisplay, keyCode, 1, &keysymsPerKeycode);
-                            x11Error = checkX11Error();
-                            char *str = NULL;
-
-                            if (!x11Error)
-                            {
-                                KeySym keySym = 0;
-                                if ((keysymsPerKeycode >= 2) && keySyms[1] && (keySyms[0] >= XK_a) && (keySyms[0] <= XK_z))
-                                {
-                                    keySym = keySyms[1];
-                                }
-                                else if (keysymsPerKeycode >= 1)
-                                {
-                                    keySym = keySyms[0];
-                                }
-
-                                if (keySym)
-                                {
-                                    str = XKeysymToString(keySym);
-                                }
-                            }
-
-                            signal = x11Error ? 1 : 0;
-                            if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], &signal, sizeof(signal)))
-                            {
-                                log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
-                                close(mX11RequestPipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-
-                            if (!x11Error)
-                            {
-                                size_t length = 0;
-                                if (str)
-                                {
-                                    length = strlen(str);
-                                }
-                                if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], &length, sizeof(length)))
-                                {
-                                    log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
-                                    close(mX11RequestPipe[STDIN_FILENO]);
-                                    mX11EventLoopActive = false;
-                                    break;
-                                }
-                                if (length)
-                                {
-                                    if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], str, length))
-                                    {
-                                        log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
-                                        close(mX11RequestPipe[STDIN_FILENO]);
-                                        mX11EventLoopActive = false;
-                                        break;
-                                    }
-                                }
-                            }
-                        }
-                        break;
-
-                        case X11_OP_XGrabKey:
-                        {
-                            X11Shortcut X11shortcut;
-                            bool x11Error = false;
-                            if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &X11shortcut.first, sizeof(X11shortcut.first)))
-                            {
-                                log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
-                                close(mX11ResponsePipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-                            if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &X11shortcut.second, sizeof(X11shortcut.second)))
-                            {
-                                log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
-                                close(mX11ResponsePipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-
-                            QSet<unsigned int>::const_iterator lastAllModifiers = allModifiers.end();
-                            for (QSet<unsigned int>::const_iterator modifiers = allModifiers.begin(); modifiers != lastAllModifiers; ++modifiers)
-                            {
-                                lockX11Error();
-                                XGrabKey(mDisplay, X11shortcut.first, X11shortcut.second | *modifiers, rootWindow, False, GrabModeAsync, GrabModeAsync);
-                                bool x11e = checkX11Error();
-                                if (x11e)
-                                {
-                                    log(LOG_DEBUG, "XGrabKey: %02x + %02x", X11shortcut.first, X11shortcut.second | *modifiers);
-                                }
-                                x11Error |= x11e;
-                            }
-
-                            signal = x11Error ? 1 : 0;
-                            if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], &signal, sizeof(signal)))
-                            {
-                                log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
-                                close(mX11RequestPipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-                        }
-                        break;
-
-                        case X11_OP_XUngrabKey:
-                        {
-                            X11Shortcut X11shortcut;
-                            bool x11Error = false;
-                            if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &X11shortcut.first, sizeof(X11shortcut.first)))
-                            {
-                                log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
-                                close(mX11ResponsePipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-                            if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &X11shortcut.second, sizeof(X11shortcut.second)))
-                            {
-                                log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
-                                close(mX11ResponsePipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-
-                            lockX11Error();
-                            QSet<unsigned int>::const_iterator lastAllModifiers = allModifiers.end();
-                            for (QSet<unsigned int>::const_iterator modifiers = allModifiers.begin(); modifiers != lastAllModifiers; ++modifiers)
-                            {
-                                XUngrabKey(mDisplay, X11shortcut.first, X11shortcut.second | *modifiers, rootWindow);
-                            }
-                            x11Error = checkX11Error();
-
-                            signal = x11Error ? 1 : 0;
-                            if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], &signal, sizeof(signal)))
-                            {
-                                log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
-                                close(mX11RequestPipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-                        }
-                        break;
-
-                        case X11_OP_XGrabKeyboard:
-                        {
-                            lockX11Error();
-                            int result = XGrabKeyboard(mDisplay, rootWindow, False, GrabModeAsync, GrabModeAsync, CurrentTime);
-                            bool x11Error = checkX11Error();
-                            if (!result && x11Error)
-                            {
-                                result = -1;
-                            }
-
-                            if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], &result, sizeof(result)))
-                            {
-                                log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
-                                close(mX11RequestPipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-                            mDataMutex.lock();
-                            mGrabbingShortcut = true;
-                            mDataMutex.unlock();
-                        }
-                        break;
-
-                        case X11_OP_XUngrabKeyboard:
-                        {
-                            lockX11Error();
-                            XUngrabKeyboard(mDisplay, CurrentTime);
-                            bool x11Error = checkX11Error();
-
-                            signal = x11Error ? 1 : 0;
-                            if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], &signal, sizeof(signal)))
-                            {
-                                log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
-                                close(mX11RequestPipe[STDIN_FILENO]);
-                                mX11EventLoopActive = false;
-                                break;
-                            }
-
-                            mDataMutex.lock();
-                            mGrabbingShortcut = false;
-                            mDataMutex.unlock();
-                        }
-                        break;
-
-                        }
-                    }
-                }
-            }
+                // an active client action cannot go away, put it back into the file
+                rewrite = true;
             }
         }
     }
 
-    lockX11Error();
-    XUngrabKey(mDisplay, AnyKey, AnyModifier, rootWindow);
-    XSetErrorHandler(oldx11ErrorHandler);
-    XCloseDisplay(mDisplay);
-    checkX11Error(0);
-}
-
-void Core::serviceOwnerChanged(const QString &name, const QString &oldOwner, const QString &newOwner)
-{
-    if (!oldOwner.isEmpty() && newOwner.isEmpty())
+    // switched last, so that the grab set is diffed against the reloaded bindings only once
+    QString activeProfile = settings.value(/* General/ */"ActiveProfile").toString();
+    if (activeProfile != mActiveProfile)
     {
-        serviceDisappeared(oldOwner);
+        bool result;
+        setActiveProfile(result, activeProfile);
     }
-}
-
-void Core::serviceDisappeared(const QString &sender)
-{
-    log(LOG_DEBUG, "serviceDisappeared '%s'", qPrintable(sender));
 
-    QMutexLocker lock(&mDataMutex);
+    mSaveAllowed = true;
 
-    ClientPathsBySender::iterator clientPathsBySender = mClientPathsBySender.find(sender);
-    if (clientPathsBySender != mClientPathsBySender.end())
     {
-        ClientPaths::const_iterator lastClientPath = clientPathsBySender.value().end();
-        for (ClientPaths::const_iterator clientPath = clientPathsBySender.value().begin(); clientPath != lastClientPath; ++clientPath)
-        {
-            const QDBusObjectPath &path = *clientPath;
-
-            IdByClientPath::iterator idByClientPath = mIdByClientPath.find(path);
-            if (idByClientPath != mIdByClientPath.end())
-            {
-                const qulonglong &id = idByClientPath.value();
-
-                log(LOG_INFO, "Disactivating client action for '%s' @ %s", qPrintable(sender), qPrintable(path.path()));
-
-                ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
-                if (shortcutAndActionById != mShortcutAndActionById.end())
-                {
-                    const QString &shortcut = shortcutAndActionById.value().first;
-
-                    dynamic_cast<ClientAction *>(shortcutAndActionById.value().second)->disappeared();
-                    mDaemonAdaptor->emit_clientActionSenderChanged(id, QString());
-
-                    X11Shortcut X11shortcut = mX11ByShortcut[shortcut];
+        QMutexLocker lock(&mDataMutex);
 
-                    IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(shortcut);
-                    if (idsByShortcut != mIdsByShortcut.end())
-                    {
-                        idsByShortcut.value().remove(id);
-                        if (idsByShortcut.value().isEmpty())
-                        {
-                            mIdsByShortcut.erase(idsByShortcut);
+        mGrabSyncDeferred = false;
+        syncGrabs();
 
-                            if (!remoteXUngrabKey(X11shortcut))
-                            {
-                                log(LOG_WARNING, "Cannot ungrab shortcut '%s'", qPrintable(shortcut));
-                            }
-                        }
-                    }
-                }
-            }
-            mSenderByClientPath.remove(path);
+        if (rewrite)
+        {
+            saveConfig();
         }
-        mClientPathsBySender.erase(clientPathsBySender);
     }
 }
 
-KeyCode Core::remoteStringToKeycode(const QString &str)
+void Core::applyConfigEntry(const ConfigEntry &current, const ConfigEntry &candidate)
 {
-    size_t X11Operation = X11_OP_StringToKeycode;
-    size_t length = str.length();
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11Operation, sizeof(X11Operation)))
-    {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return 0;
-    }
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &length, sizeof(length)))
+    const qulonglong &id = current.id;
+    bool result;
+
+    if (current.shortcut != candidate.shortcut)
     {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return 0;
+        QString newShortcut;
+        changeShortcut(newShortcut, id, candidate.shortcut, QDBusMessage());
+        if (newShortcut.isEmpty())
+        {
+            log(LOG_WARNING, "Cannot change shortcut of action #%llu to '%s'", id, qPrintable(candidate.shortcut));
+        }
     }
-    if (length)
+
+    switch (candidate.type())
     {
-        if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], qPrintable(str), length))
+    case ConfigEntry::COMMAND:
+        if ((current.exec != candidate.exec) || (current.description != candidate.description))
+        {
+            modifyCommandAction(result, id, candidate.exec[0], candidate.exec.mid(1), candidate.description);
+        }
+        if (current.launchPolicy != candidate.launchPolicy)
+        {
+            setCommandActionLaunchPolicy(result, id, candidate.launchPolicy);
+        }
+        break;
+
+    case ConfigEntry::METHOD:
+        if ((current.service != candidate.service) || (current.path != candidate.path) || (current.interface != candidate.interface) || (current.method != candidate.method) || (current.description != candidate.description))
+        {
+            modifyMethodAction(result, id, candidate.service, QDBusObjectPath(candidate.path), candidate.interface, candidate.method, candidate.description);
+        }
+        if (current.allowActivation != candidate.allowActivation)
         {
-            log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-            qApp->quit();
-            return 0;
+            setMethodActionAllowActivation(result, id, candidate.allowActivation);
         }
+        break;
+
+    default:
+        ; // the description of a client action belongs to the client
     }
-    wakeX11Thread();
 
-    char signal;
-    if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &signal, sizeof(signal)))
+    if (current.enabled != candidate.enabled)
     {
-        log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-        qApp->quit();
-        return 0;
+        enableAction(result, id, candidate.enabled);
     }
-    if (signal)
+
+    if (current.profiles != candidate.profiles)
     {
-        return 0;
+        setActionProfiles(result, id, candidate.profiles);
     }
 
-    KeyCode keyCode;
-    if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &keyCode, sizeof(keyCode)))
+    if (current.context != candidate.context)
     {
-        log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-        qApp->quit();
-        return 0;
+        setActionContext(result, id, candidate.context);
     }
-    return keyCode;
 }
 
-QString Core::remoteKeycodeToString(KeyCode keyCode)
+qulonglong Core::addConfigEntry(const ConfigEntry &entry)
 {
-    QString result;
+    QPair<QString, qulonglong> result(QString(), 0ull);
 
-    size_t X11Operation = X11_OP_KeycodeToString;
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11Operation, sizeof(X11Operation)))
+    switch (entry.type())
     {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return QString();
-    }
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &keyCode, sizeof(keyCode)))
-    {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return QString();
-    }
-    wakeX11Thread();
+    case ConfigEntry::COMMAND:
+        addCommandAction(result, entry.shortcut, entry.exec[0], entry.exec.mid(1), entry.description, QDBusMessage());
+        break;
 
-    char signal;
-    if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &signal, sizeof(signal)))
-    {
-        log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-        qApp->quit();
-        return QString();
-    }
-    if (signal)
-    {
-        return QString();
-    }
+    case ConfigEntry::METHOD:
+        addMethodAction(result, entry.shortcut, entry.service, QDBusObjectPath(entry.path), entry.interface, entry.method, entry.description, QDBusMessage());
+        break;
 
-    size_t length;
-    if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &length, sizeof(length)))
-    {
-        log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-        qApp->quit();
-        return QString();
-    }
-    if (length)
+    default:
     {
-        char *str = new char[length + 1];
-        str[length] = '\0';
-        if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], str, length))
+        QMutexLocker lock(&mDataMutex);
+
+        if (mIdByClientPath.contains(QDBusObjectPath(entry.path)))
         {
-            log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-            qApp->quit();
-            return QString();
+            log(LOG_WARNING, "Action already registered for '%s'", qPrintable(entry.path));
+            return 0ull;
         }
-        result = str;
 
-        delete[] str;
+        KeyGrab keyGrab;
+        result = addOrRegisterClientAction(entry.shortcut, QDBusObjectPath(entry.path), entry.description, QString(), keyGrab);
+        actionChanged(ACTION_CHANGE_ADDED, result.second);
+    }
     }
 
-    return result;
-}
+    if (!result.second)
+    {
+        log(LOG_WARNING, "Cannot add action for '%s' from config file", qPrintable(entry.shortcut));
+        return 0ull;
+    }
 
-bool Core::remoteXGrabKey(const X11Shortcut &X11shortcut)
-{
-    size_t X11Operation = X11_OP_XGrabKey;
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11Operation, sizeof(X11Operation)))
+    if (!entry.enabled)
     {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return false;
+        bool enabled;
+        enableAction(enabled, result.second, false);
     }
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11shortcut.first, sizeof(X11shortcut.first)))
+
+    if (!entry.profiles.isEmpty())
     {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return false;
+        bool profilesSet;
+        setActionProfiles(profilesSet, result.second, entry.profiles);
     }
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11shortcut.second, sizeof(X11shortcut.second)))
+
+    if (!entry.context.isEmpty())
     {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return false;
+        bool contextSet;
+        setActionContext(contextSet, result.second, entry.context);
     }
-    wakeX11Thread();
 
-    char signal;
-    if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &signal, sizeof(signal)))
+    if ((entry.type() == ConfigEntry::METHOD) && !entry.allowActivation)
     {
-        log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-        qApp->quit();
-        return false;
+        bool allowActivationSet;
+        setMethodActionAllowActivation(allowActivationSet, result.second, false);
     }
-    if (signal)
+
+    if ((entry.type() == ConfigEntry::COMMAND) && (entry.launchPolicy != CommandAction::launchPolicyName(CommandAction::LAUNCH_ALWAYS)))
     {
-        return false;
+        bool launchPolicySet;
+        setCommandActionLaunchPolicy(launchPolicySet, result.second, entry.launchPolicy);
     }
 
-    return true;
+    return result.second;
 }
 
-bool Core::remoteXUngrabKey(const X11Shortcut &X11shortcut)
+void Core::startupPhaseDone(const char *phase, quint64 &phaseStart) const
 {
-    size_t X11Operation = X11_OP_XUngrabKey;
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11Operation, sizeof(X11Operation)))
-    {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return false;
-    }
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11shortcut.first, sizeof(X11shortcut.first)))
-    {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return false;
-    }
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11shortcut.second, sizeof(X11shortcut.second)))
-    {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return false;
-    }
-    wakeX11Thread();
+    quint64 now = Trace::now();
+    log(LOG_INFO, "Startup: %s took %llu us", phase, static_cast<unsigned long long>(now - phaseStart));
+    phaseStart = now;
+}
 
-    char signal;
-    if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &signal, sizeof(signal)))
+void Core::saveConfig()
+{
+    if (!mSaveAllowed)
     {
-        log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-        qApp->quit();
-        return false;
+        return;
     }
-    if (signal)
+
+    mMetrics.increment(Metrics::CONFIG_SAVES);
+
+    TRACE_SPAN("config", "save config");
+
+    // only a snapshot is taken here, the file is written by the config saver thread
+    ConfigSaver::Sections sections;
+
+    ConfigSaver::Values general;
+
+    switch (mMultipleActionsBehaviour)
     {
-        return false;
+    case MULTIPLE_ACTIONS_BEHAVIOUR_FIRST:
+        general.push_back(configValue("MultipleActionsBehaviour", "first"));
+        break;
+
+    case MULTIPLE_ACTIONS_BEHAVIOUR_LAST:
+        general.push_back(configValue("MultipleActionsBehaviour", "last"));
+        break;
+
+    case MULTIPLE_ACTIONS_BEHAVIOUR_ALL:
+        general.push_back(configValue("MultipleActionsBehaviour", "all"));
+        break;
+
+    case MULTIPLE_ACTIONS_BEHAVIOUR_NONE:
+        general.push_back(configValue("MultipleActionsBehaviour", "none"));
+        break;
+
+    default:
+        ;
     }
 
-    return true;
-}
+    general.push_back(configValue("AllowGrabLocks",       mAllowGrabLocks));
+    general.push_back(configValue("AllowGrabBaseSpecial", mAllowGrabBaseSpecial));
+    general.push_back(configValue("AllowGrabMiscSpecial", mAllowGrabMiscSpecial));
+    general.push_back(configValue("AllowGrabBaseKeypad",  mAllowGrabBaseKeypad));
+    general.push_back(configValue("AllowGrabMiscKeypad",  mAllowGrabMiscKeypad));
 
-QString Core::grabOrReuseKey(const X11Shortcut &X11shortcut, const QString &shortcut)
-{
-    IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(shortcut);
-    if ((idsByShortcut != mIdsByShortcut.end()) && (!idsByShortcut.value().isEmpty()))
+    if (!mActiveProfile.isEmpty())
     {
-        return shortcut;
+        general.push_back(configValue("ActiveProfile", mActiveProfile));
     }
 
-    if (!remoteXGrabKey(X11shortcut))
+    general.push_back(configValue("MaxParallelActions", mActionExecutor->maxThreads()));
+
+    if (!mStrictOrderShortcuts.isEmpty())
     {
-        log(LOG_WARNING, "Cannot grab shortcut '%s'", qPrintable(shortcut));
-        return QString();
+        QStringList strictOrderShortcuts = mStrictOrderShortcuts.toList();
+        strictOrderShortcuts.sort();
+        general.push_back(configValue("StrictOrderShortcuts", strictOrderShortcuts));
     }
 
-    return shortcut;
-}
+    sections.push_back(qMakePair(QString(), general));
 
+    ShortcutAndActionById::const_iterator lastShortcutAndActionById = mShortcutAndActionById.end();
+    for (ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.begin(); shortcutAndActionById != lastShortcutAndActionById; ++shortcutAndActionById)
+    {
+        const BaseAction *action = shortcutAndActionById.value().second;
+        QString section = shortcutAndActionById.value().first + "." + QString::number(shortcutAndActionById.key());
 
-Core::X11Shortcut Core::ShortcutToX11(const QString &shortcut)
-{
-    X11Shortcut result(0, 0);
+        ConfigSaver::Values values;
 
-    QStringList parts = shortcut.split('+');
+        values.push_back(configValue("Enabled", action->isEnabled()));
+        values.push_back(configValue("Comment", action->description()));
+        if (!action->profiles().isEmpty())
+        {
+            values.push_back(configValue("Profiles", action->profiles()));
+        }
+        if (!action->context().isEmpty())
+        {
+            values.push_back(configValue("Context", action->context()));
+        }
 
-    size_t m = parts.size();
-    for (size_t i = 0; i < m - 1; ++i)
-    {
-        if (parts[i] == "Shift")
-        {
-            result.second |= ShiftMask;
-        }
-        else if (parts[i] == "Control")
-        {
-            result.second |= ControlMask;
-        }
-        else if (parts[i] == "Alt")
-        {
-            result.second |= AltMask;
-        }
-        else if (parts[i] == "Meta")
-        {
-            result.second |= MetaMask;
-        }
-        else if (parts[i] == "Level3")
-        {
-            result.second |= Level3Mask;
-        }
-        else if (parts[i] == "Level5")
+        if (!strcmp(action->type(), CommandAction::id()))
         {
-            result.second |= Level5Mask;
+            const CommandAction *commandAction = dynamic_cast<const CommandAction *>(action);
+            values.push_back(configValue("Exec", QStringList() << commandAction->command() += commandAction->args()));
+            if (commandAction->launchPolicy() != CommandAction::LAUNCH_ALWAYS)
+            {
+                values.push_back(configValue("LaunchPolicy", CommandAction::launchPolicyName(commandAction->launchPolicy())));
+            }
         }
-        else
+        else if (!strcmp(action->type(), MethodAction::id()))
         {
-            throw false;
+            const MethodAction *methodAction = dynamic_cast<const MethodAction *>(action);
+            values.push_back(configValue("service",   methodAction->service()));
+            values.push_back(configValue("path",      methodAction->path().path()));
+            values.push_back(configValue("interface", methodAction->interface()));
+            values.push_back(configValue("method",    methodAction->method()));
+            if (!methodAction->allowActivation())
+            {
+                values.push_back(configValue("AllowActivation", false));
+            }
         }
-    }
-    if (m)
-    {
-        KeyCode keyCode = remoteStringToKeycode(parts[m - 1]);
-        if (!keyCode)
+        else if (!strcmp(action->type(), ClientAction::id()))
         {
-            throw false;
+            const ClientAction *clientAction = dynamic_cast<const ClientAction *>(action);
+            values.push_back(configValue("path",  clientAction->path().path()));
         }
 
-        result.first = keyCode;
+        sections.push_back(qMakePair(section, values));
     }
 
-    return result;
+    mConfigSaver->save(mConfigFile, sections);
 }
 
-QString Core::X11ToShortcut(const X11Shortcut &X11shortcut)
+void Core::unixSignalHandler(int signalNumber)
 {
-    QString result;
-
-    if (X11shortcut.second & ShiftMask)
-    {
-        result += "Shift+";
-    }
-    if (X11shortcut.second & ControlMask)
+    log(LOG_INFO, "Signal #%d received", signalNumber);
+    if (signalNumber == SIGUSR1)
     {
-        result += "Control+";
+        QMetaObject::invokeMethod(this, "writeTrace", Qt::QueuedConnection);
+        return;
     }
-    if (X11shortcut.second & AltMask)
+    qApp->quit();
+}
+
+void Core::writeTrace()
+{
+    if (!Trace::write())
     {
-        result += "Alt+";
+        log(LOG_WARNING, "Cannot write trace file");
     }
-    if (X11shortcut.second & MetaMask)
+}
+
+void Core::log(int level, const char *format, ...) const
+{
+    if (level > mMinLogLevel)
     {
-        result += "Meta+";
+        return;
     }
-    if (X11shortcut.second & Level3Mask)
+
+    va_list ap;
+    va_start(ap, format);
+    if (mUseSyslog)
     {
-        result += "Level3+";
+        vsyslog(LOG_MAKEPRI(LOG_USER, level), format, ap);
     }
-    if (X11shortcut.second & Level5Mask)
+    else
     {
-        result += "Level5+";
+        fprintf(stderr, "[%s] ", strLevel(level));
+        vfprintf(stderr, format, ap);
+        fprintf(stderr, "\n");
     }
+    va_end(ap);
+}
 
-    QString key = remoteKeycodeToString(X11shortcut.first);
-    if (key.isEmpty())
+int Core::x11ErrorHandler(Display *display, XErrorEvent *errorEvent)
+{
+    foreach(X11Connection *connection, mX11Connections)
     {
-        throw false;
+        if (connection->display() == display)
+        {
+            return connection->x11ErrorHandler(errorEvent);
+        }
     }
 
-    result += key;
+    mMetrics.x11Error(errorEvent->request_code);
+    return 0;
+}
 
-    return result;
+bool Core::isEscape(KeySym keySym, unsigned int modifiers)
+{
+    return ((keySym == XK_Escape) && (!modifiers));
 }
 
-QString Core::checkShortcut(const QString &shortcut, X11Shortcut &X11shortcut)
+bool Core::isModifier(KeySym keySym)
 {
-    if (shortcut.isEmpty())
-        return QString();
+    return keysymClass(keySym) == KEYSYM_CLASS_MODIFIER;
+}
 
-    QString usedShortcut;
+bool Core::isAllowed(KeySym keySym, unsigned int modifiers)
+{
+    unsigned int keyClass = keysymClass(keySym);
 
-    try
+    // a printable key with nothing but the modifiers that pick another symbol from it types text,
+    // the other classes are only gated when no modifier is held at all
+    if (keyClass == KEYSYM_CLASS_PRINTABLE)
     {
-        X11shortcut = ShortcutToX11(shortcut);
+        return (modifiers & ~(ShiftMask | Level3Mask | Level5Mask)) || mAllowGrabPrintable;
     }
-    catch (bool)
+    if (!keyClass || modifiers)
     {
-        log(LOG_WARNING, "Cannot extract keycode and modifiers from shortcut '%s'", qPrintable(shortcut));
-        return QString();
+        return true;
     }
 
-    try
-    {
-        ShortcutByX11::const_iterator shortcutByX11 = mShortcutByX11.find(X11shortcut);
-        if (shortcutByX11 != mShortcutByX11.end())
-        {
-            usedShortcut = shortcutByX11.value();
-        }
-        else
-        {
-            usedShortcut = X11ToShortcut(X11shortcut);
-            mShortcutByX11[X11shortcut] = usedShortcut;
-        }
-    }
-    catch (bool)
-    {
-        log(LOG_WARNING, "Cannot get back shortcut '%s'", qPrintable(shortcut));
-        return QString();
-    }
+    // modifiers are isModifier's business
+    unsigned int allowedClasses = KEYSYM_CLASS_MODIFIER |
+        (mAllowGrabLocks       ? KEYSYM_CLASS_LOCK         : KEYSYM_CLASS_NONE) |
+        (mAllowGrabBaseSpecial ? KEYSYM_CLASS_BASE_SPECIAL : KEYSYM_CLASS_NONE) |
+        (mAllowGrabMiscSpecial ? KEYSYM_CLASS_MISC_SPECIAL : KEYSYM_CLASS_NONE) |
+        (mAllowGrabBaseKeypad  ? KEYSYM_CLASS_BASE_KEYPAD  : KEYSYM_CLASS_NONE) |
+        (mAllowGrabMiscKeypad  ? KEYSYM_CLASS_MISC_KEYPAD  : KEYSYM_CLASS_NONE);
 
-    if (shortcut != usedShortcut)
-    {
-        log(LOG_INFO, "Using shortcut '%s' instead of '%s'", qPrintable(usedShortcut), qPrintable(shortcut));
-    }
+    return (keyClass & allowedClasses) != 0;
+}
 
-    X11ByShortcut::const_iterator x11ByShortcut = mX11ByShortcut.find(usedShortcut);
-    if (x11ByShortcut == mX11ByShortcut.end())
+void Core::serviceOwnerChanged(const QString &name, const QString &oldOwner, const QString &newOwner)
+{
+    if (!oldOwner.isEmpty() && newOwner.isEmpty())
     {
-        mX11ByShortcut[usedShortcut] = X11shortcut;
+        serviceDisappeared(oldOwner);
     }
-
-    return usedShortcut;
 }
 
-QPair<QString, qulonglong> Core::addOrRegisterClientAction(const QString &shortcut, const QDBusObjectPath &path, const QString &description, const QString &sender)
+void Core::serviceDisappeared(const QString &sender)
 {
-    X11Shortcut X11shortcut;
+    log(LOG_DEBUG, "serviceDisappeared '%s'", qPrintable(sender));
 
-    QString newShortcut = checkShortcut(shortcut, X11shortcut);
-//    if (newShortcut.isEmpty())
-//    {
-//        return qMakePair(QString(), 0ull);
-//    }
+    TRACE_SPAN("core", "service disappeared");
 
-    IdByClientPath::iterator idByNativeClient = mIdByClientPath.find(path);
-    if (idByNativeClient != mIdByClientPath.end())
+    QMutexLocker lock(&mDataMutex);
+
+    ClientPathsBySender::iterator clientPathsBySender = mClientPathsBySender.find(sender);
+    if (clientPathsBySender != mClientPathsBySender.end())
     {
-        qulonglong id = idByNativeClient.value();
-        ShortcutAndAction &shortcutAndAction = mShortcutAndActionById[id];
-        if (newShortcut != shortcutAndAction.first)
-        {
-            mShortcutAndActionById[id].first = newShortcut;
-        }
+        mMetrics.increment(Metrics::CLIENTS_DISCONNECTED);
 
-        if (!newShortcut.isEmpty())
+        // a client leaving with hundreds of actions releases its keys in one request to the X11 thread
+        QSet<QString> releasedShortcuts;
+
+        ClientPaths::const_iterator lastClientPath = clientPathsBySender.value().end();
+        for (ClientPaths::const_iterator clientPath = clientPathsBySender.value().begin(); clientPath != lastClientPath; ++clientPath)
         {
-            newShortcut = grabOrReuseKey(X11shortcut, newShortcut);
-            mIdsByShortcut[newShortcut].insert(id);
-        }
+            const QDBusObjectPath &path = *clientPath;
 
-        dynamic_cast<ClientAction*>(shortcutAndAction.second)->appeared(QDBusConnection::sessionBus(), sender);
+            IdByClientPath::iterator idByClientPath = mIdByClientPath.find(path);
+            if (idByClientPath != mIdByClientPath.end())
+            {
+                const qulonglong &id = idByClientPath.value();
 
-        return qMakePair(newShortcut, id);
-    }
+                log(LOG_INFO, "Disactivating client action for '%s' @ %s", qPrintable(sender), qPrintable(path.path()));
 
-    qulonglong id = ++mLastId;
+                ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+                if (shortcutAndActionById != mShortcutAndActionById.end())
+                {
+                    const QString &shortcut = shortcutAndActionById.value().first;
 
-    if (!sender.isEmpty() && !newShortcut.isEmpty())
-    {
-        newShortcut = grabOrReuseKey(X11shortcut, newShortcut);
-        mIdsByShortcut[newShortcut].insert(id);
-    }
+                    dynamic_cast<ClientAction *>(shortcutAndActionById.value().second)->disappeared();
+                    mDaemonAdaptor->emit_clientActionSenderChanged(id, QString());
+                    actionChanged(ACTION_CHANGE_MODIFIED, id);
 
-    mIdByClientPath[path] = id;
-    ClientAction *clientAction = sender.isEmpty() ? new ClientAction(this, path, description) : new ClientAction(this, QDBusConnection::sessionBus(), sender, path, description);
-    mShortcutAndActionById[id] = qMakePair<QString, BaseAction *>(newShortcut, clientAction);
+                    IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(shortcut);
+                    if (idsByShortcut != mIdsByShortcut.end())
+                    {
+                        idsByShortcut.value().remove(id);
+                        if (idsByShortcut.value().isEmpty())
+                        {
+                            mIdsByShortcut.erase(idsByShortcut);
+                        }
+                    }
+                    releasedShortcuts.insert(shortcut);
+                }
+            }
+            mSenderByClientPath.remove(path);
+        }
+        mClientPathsBySender.erase(clientPathsBySender);
 
-    log(LOG_INFO, "addClientAction shortcut:'%s' id:%llu", qPrintable(newShortcut), id);
+        syncGrabs(releasedShortcuts);
+    }
 
-    return qMakePair(newShortcut, id);
+    delete mClientProxyBySender.take(sender);
 }
 
-void Core::addClientAction(QPair<QString, qulonglong> &result, const QString &shortcut, const QDBusObjectPath &path, const QString &description, const QString &sender)
+void Core::openActivationChannel(QPair<int, int> &result, const QString &sender)
 {
-    log(LOG_INFO, "addClientAction shortcut:'%s' path:'%s' description:'%s' sender:'%s'", qPrintable(shortcut), qPrintable(path.path()), qPrintable(description), qPrintable(sender));
+    log(LOG_INFO, "openActivationChannel sender:'%s'", qPrintable(sender));
 
     QMutexLocker lock(&mDataMutex);
 
-    SenderByClientPath::iterator senderByClientPath = mSenderByClientPath.find(path);
-    if (senderByClientPath != mSenderByClientPath.end())
+    if (!clientProxy(sender)->openActivationChannel(result.first, result.second))
     {
-        log(LOG_WARNING, "Action already registered for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
-        result = qMakePair(QString(), 0ull);
-        return;
+        log(LOG_WARNING, "Cannot create activation channel for '%s': %s", qPrintable(sender), strerror(errno));
+        result = qMakePair(-1, -1);
     }
+}
 
-    QString useShortcut = shortcut;
-    if (shortcut.isEmpty())
+void Core::activationChannelAccepted(const QString &sender)
+{
+    log(LOG_INFO, "activationChannelAccepted sender:'%s'", qPrintable(sender));
+
+    QMutexLocker lock(&mDataMutex);
+
+    ClientProxyBySender::iterator clientProxyBySender = mClientProxyBySender.find(sender);
+    if ((clientProxyBySender == mClientProxyBySender.end()) || !clientProxyBySender.value()->acceptActivationChannel())
     {
-        IdByClientPath::ConstIterator idByClientPath = mIdByClientPath.find(path);
-        if (idByClientPath != mIdByClientPath.constEnd())
-        {
-            useShortcut = mShortcutAndActionById[idByClientPath.value()].first;;
-        }
+        log(LOG_WARNING, "No activation channel opened for '%s'", qPrintable(sender));
     }
+}
 
-    mSenderByClientPath[path] = sender;
+ClientProxy *Core::clientProxy(const QString &sender)
+{
+    ClientProxyBySender::iterator clientProxyBySender = mClientProxyBySender.find(sender);
+    if (clientProxyBySender == mClientProxyBySender.end())
+    {
+        clientProxyBySender = mClientProxyBySender.insert(sender, new ClientProxy(QDBusConnection::sessionBus(), sender));
+    }
+    return clientProxyBySender.value();
+}
 
-    mClientPathsBySender[sender].insert(path);
+Core::KeyGrab Core::grabOrReuseKey(const QString &shortcut, bool wanted)
+{
+    // an inactive action does not need the key, it is grabbed once it gets enabled or its profile gets activated
+    if (!wanted || mGrabSyncDeferred)
+    {
+        return KEY_GRABBED;
+    }
 
-    result = addOrRegisterClientAction(useShortcut, path, description, sender);
+    // the action is bound already, so it takes part in the grab mode
+    syncGrab(shortcut);
 
-    saveConfig();
+    // usable as long as one display has it
+    if (isShortcutGrabbed(shortcut))
+    {
+        return KEY_GRABBED;
+    }
+    if (isShortcutGrabPending(shortcut))
+    {
+        return KEY_GRAB_PENDING;
+    }
 
-    mDaemonAdaptor->emit_clientActionSenderChanged(result.second, sender);
+    log(LOG_WARNING, "Cannot grab shortcut '%s'", qPrintable(shortcut));
+    return KEY_NOT_GRABBED;
+}
 
-    mDaemonAdaptor->emit_actionAdded(result.second);
+void Core::unbindShortcut(const QString &shortcut, qulonglong id)
+{
+    IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(shortcut);
+    if (idsByShortcut != mIdsByShortcut.end())
+    {
+        idsByShortcut.value().remove(id);
+        if (idsByShortcut.value().isEmpty())
+        {
+            mIdsByShortcut.erase(idsByShortcut);
+        }
+    }
 }
 
-qulonglong Core::registerClientAction(const QString &shortcut, const QDBusObjectPath &path, const QString &description)
+bool Core::awaitGrab(const QDBusMessage &message, GrabReplyKind kind, qulonglong id, const QString &shortcut, const QString &oldShortcut)
 {
-    log(LOG_INFO, "registerClientAction shortcut:'%s' path:'%s' description:'%s'", qPrintable(shortcut), qPrintable(path.path()), qPrintable(description));
+    // an in-process call takes the grab as done, grabsSwitched logs if it is not
+    if (message.type() != QDBusMessage::MethodCallMessage)
+    {
+        return false;
+    }
 
-    QMutexLocker lock(&mDataMutex);
+    message.setDelayedReply(true);
+
+    GrabReply grabReply;
+    grabReply.kind = kind;
+    grabReply.reply = message.createReply();
+    grabReply.id = id;
+    grabReply.shortcut = shortcut;
+    grabReply.oldShortcut = oldShortcut;
+    mGrabReplies.push_back(grabReply);
 
-    return addOrRegisterClientAction(shortcut, path, description, QString()).second;
+    log(LOG_DEBUG, "Reply for action #%llu delayed until '%s' is grabbed", id, qPrintable(shortcut));
+    return true;
 }
 
-void Core::addMethodAction(QPair<QString, qulonglong> &result, const QString &shortcut, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description)
+void Core::answerGrabReply(const GrabReply &grabReply)
 {
-    log(LOG_INFO, "addMethodAction shortcut:'%s' service:'%s' path:'%s' interface:'%s' method:'%s' description:'%s'", qPrintable(shortcut), qPrintable(service), qPrintable(path.path()), qPrintable(interface), qPrintable(method), qPrintable(description));
-
-    QMutexLocker lock(&mDataMutex);
-
-    X11Shortcut X11shortcut;
-    QString newShortcut = checkShortcut(shortcut, X11shortcut);
-    if (newShortcut.isEmpty())
+    bool grabbed = isShortcutGrabbed(grabReply.shortcut);
+    if (!grabbed)
     {
-        result = qMakePair(QString(), 0ull);
-        return;
+        log(LOG_WARNING, "Cannot grab shortcut '%s'", qPrintable(grabReply.shortcut));
     }
 
-    newShortcut = grabOrReuseKey(X11shortcut, newShortcut);
-    if (newShortcut.isEmpty())
+    QDBusMessage reply = grabReply.reply;
+    switch (grabReply.kind)
     {
-        result = qMakePair(QString(), 0ull);
-        return;
+    case GRAB_REPLY_ADD_ACTION:
+    {
+        QPair<QString, qulonglong> result = finishAddAction(grabReply.id, grabReply.shortcut, grabbed);
+        reply << result.first << result.second;
+        if (result.second)
+        {
+            mDaemonAdaptor->emit_actionAdded(result.second);
+        }
     }
+    break;
 
+    case GRAB_REPLY_ADD_CLIENT_ACTION:
+    case GRAB_REPLY_REGISTER_CLIENT_ACTION:
+    {
+        QString shortcut = grabbed ? grabReply.shortcut : QString();
+        // a new action does not keep a shortcut it cannot have, a known one keeps the one it is saved with
+        ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(grabReply.id);
+        if (!grabbed && (grabReply.kind == GRAB_REPLY_ADD_CLIENT_ACTION) && (shortcutAndActionById != mShortcutAndActionById.end()) && (shortcutAndActionById.value().first == grabReply.shortcut))
+        {
+            unbindShortcut(grabReply.shortcut, grabReply.id);
+            syncGrab(grabReply.shortcut);
+            shortcutAndActionById.value().first = QString();
 
-    qulonglong id = ++mLastId;
+            saveConfig();
 
-    mIdsByShortcut[newShortcut].insert(id);
-    mShortcutAndActionById[id] = qMakePair<QString, BaseAction *>(newShortcut, new MethodAction(this, QDBusConnection::sessionBus(), service, path, interface, method, description));
+            actionChanged(ACTION_CHANGE_MODIFIED, grabReply.id);
+        }
+        reply << shortcut << grabReply.id;
+    }
+    break;
+
+    case GRAB_REPLY_CHANGE_SHORTCUT:
+    {
+        QString shortcut = finishChangeShortcut(grabReply.id, grabReply.oldShortcut, grabReply.shortcut, grabbed);
+        reply << shortcut;
+        if (!shortcut.isEmpty())
+        {
+            mDaemonAdaptor->emit_actionShortcutChanged(grabReply.id);
+        }
+    }
+    break;
+    }
+
+    QDBusConnection::sessionBus().send(reply);
+}
+
+QPair<QString, qulonglong> Core::finishAddAction(qulonglong id, const QString &shortcut, bool grabbed)
+{
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
+    {
+        // removed while its key was being grabbed
+        unbindShortcut(shortcut, id);
+        syncGrab(shortcut);
+        return qMakePair(QString(), 0ull);
+    }
+
+    if (!grabbed)
+    {
+        unbindShortcut(shortcut, id);
+        syncGrab(shortcut);
+        mShortcutAndActionById.take(id).second->release();
+        return qMakePair(QString(), 0ull);
+    }
+
+    log(LOG_INFO, "Action #%llu added with shortcut '%s'", id, qPrintable(shortcut));
+
+    saveConfig();
+
+    actionChanged(ACTION_CHANGE_ADDED, id);
+
+    return qMakePair(shortcut, id);
+}
+
+QString Core::finishChangeShortcut(qulonglong id, const QString &oldShortcut, const QString &newShortcut, bool grabbed)
+{
+    // another change may have come first while the key was being grabbed
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (!grabbed || (shortcutAndActionById == mShortcutAndActionById.end()) || (shortcutAndActionById.value().first != oldShortcut))
+    {
+        unbindShortcut(newShortcut, id);
+        syncGrab(newShortcut);
+        return QString();
+    }
+
+    unbindShortcut(oldShortcut, id);
+    syncGrab(oldShortcut);
+
+    shortcutAndActionById.value().first = newShortcut;
+
+    if (!strcmp(shortcutAndActionById.value().second->type(), ClientAction::id()))
+    {
+        dynamic_cast<ClientAction *>(shortcutAndActionById.value().second)->shortcutChanged(oldShortcut, newShortcut);
+    }
+
+    saveConfig();
+
+    actionChanged(ACTION_CHANGE_MODIFIED, id);
+
+    return newShortcut;
+}
+
+bool Core::resolveKeyPress(KeySym keySym, unsigned int state, const QString &activeWindowClass, QString &shortcut, ActionExecutor::IdsAndActions &actions) const
+{
+    // the whole path from the key to the actions, so its cost shows up as one span per press
+    TRACE_SPAN("dispatch", "resolve");
+
+    // value(), not operator[], a key nobody is bound to must not leave an entry behind
+    shortcut = mShortcutByKeySym.value(qMakePair(keySym, state));
+
+    IdsByShortcut::const_iterator idsByShortcut = mIdsByShortcut.constFind(shortcut);
+    if ((idsByShortcut == mIdsByShortcut.constEnd()) || idsByShortcut.value().isEmpty())
+    {
+        return false;
+    }
+
+    // only the enabled actions of the active profile whose context matches the focused window take part,
+    // the behaviour applies among them
+    const Ids &ids = idsByShortcut.value();
+    Ids::const_iterator lastIds = ids.constEnd();
+    for (Ids::const_iterator idi = ids.constBegin(); idi != lastIds; ++idi)
+    {
+        ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.constFind(*idi);
+        if (shortcutAndActionById == mShortcutAndActionById.constEnd())
+        {
+            continue;
+        }
+        BaseAction *action = shortcutAndActionById.value().second;
+        if (isActive(action) && action->inContext(activeWindowClass))
+        {
+            actions.push_back(qMakePair(*idi, action));
+        }
+    }
+
+    return true;
+}
+
+void Core::dispatch(const QString &shortcut, qulonglong eventTime, ActionExecutor::IdsAndActions &actions)
+{
+    switch (mMultipleActionsBehaviour)
+    {
+    case MULTIPLE_ACTIONS_BEHAVIOUR_FIRST:
+        mActionChain->start(actions, eventTime);
+        break;
+
+    case MULTIPLE_ACTIONS_BEHAVIOUR_LAST:
+    {
+        ActionExecutor::IdsAndActions reversed;
+        ActionExecutor::IdsAndActions::const_iterator firstActions = actions.constBegin();
+        for (ActionExecutor::IdsAndActions::const_iterator action = actions.constEnd(); action != firstActions;)
+        {
+            --action;
+            reversed.push_back(*action);
+        }
+        mActionChain->start(reversed, eventTime);
+    }
+    break;
+
+    case MULTIPLE_ACTIONS_BEHAVIOUR_NONE:
+        if (actions.size() == 1)
+        {
+            actions.first().second->call(eventTime);
+        }
+        break;
+
+    case MULTIPLE_ACTIONS_BEHAVIOUR_ALL:
+    {
+        // strict shortcuts keep the binding order, client actions included
+        if (mStrictOrderShortcuts.contains(shortcut))
+        {
+            mActionExecutor->run(actions, true, eventTime);
+            break;
+        }
+
+        // client actions only queue a D-Bus signal, the others may block and go to the executor,
+        // so the key press takes as long as the slowest action rather than all of them
+        ActionExecutor::IdsAndActions offloaded;
+        ActionExecutor::IdsAndActions::iterator lastActions = actions.end();
+        for (ActionExecutor::IdsAndActions::iterator action = actions.begin(); action != lastActions; ++action)
+        {
+            if (!strcmp(action->second->type(), ClientAction::id()))
+            {
+                action->second->call(eventTime);
+            }
+            else
+            {
+                offloaded.push_back(*action);
+            }
+        }
+        mActionExecutor->run(offloaded, false, eventTime);
+    }
+    break;
+
+    default:
+        ;
+    }
+}
+
+bool Core::isActive(const BaseAction *action) const
+{
+    return action->isEnabled() && action->inProfile(mActiveProfile);
+}
+
+bool Core::isShortcutWanted(const QString &shortcut) const
+{
+    IdsByShortcut::const_iterator idsByShortcut = mIdsByShortcut.find(shortcut);
+    if (idsByShortcut == mIdsByShortcut.end())
+    {
+        return false;
+    }
+
+    Ids::const_iterator lastIds = idsByShortcut.value().end();
+    for (Ids::const_iterator idi = idsByShortcut.value().begin(); idi != lastIds; ++idi)
+    {
+        if (isActive(mShortcutAndActionById[*idi].second))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Core::isShortcutContextBound(const QString &shortcut) const
+{
+    IdsByShortcut::const_iterator idsByShortcut = mIdsByShortcut.find(shortcut);
+    if (idsByShortcut == mIdsByShortcut.end())
+    {
+        return false;
+    }
+
+    bool bound = false;
+    Ids::const_iterator lastIds = idsByShortcut.value().end();
+    for (Ids::const_iterator idi = idsByShortcut.value().begin(); idi != lastIds; ++idi)
+    {
+        const BaseAction *action = mShortcutAndActionById[*idi].second;
+        if (isActive(action))
+        {
+            if (action->context().isEmpty())
+            {
+                return false;
+            }
+            bound = true;
+        }
+    }
+
+    return bound;
+}
+
+bool Core::isShortcutGrabbed(const QString &shortcut) const
+{
+    foreach(X11Connection *connection, mX11Connections)
+    {
+        if (connection->mGrabbedShortcuts.contains(shortcut))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Core::isShortcutGrabPending(const QString &shortcut) const
+{
+    foreach(X11Connection *connection, mX11Connections)
+    {
+        X11ByShortcut::const_iterator x11ByShortcut = connection->mX11ByShortcut.constFind(shortcut);
+        if (x11ByShortcut == connection->mX11ByShortcut.constEnd())
+        {
+            continue;
+        }
+        foreach(const X11Shortcut &key, x11ByShortcut.value())
+        {
+            if (connection->mPendingGrabs.contains(key))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void Core::updateGrabbedShortcuts(X11Connection *connection, const QSet<QString> &shortcuts, bool answered)
+{
+    foreach(const QString &shortcut, shortcuts)
+    {
+        bool grabbed = false;
+        bool pending = false;
+        const X11Shortcuts &shortcutKeys = connection->mX11ByShortcut[shortcut];
+        foreach(const X11Shortcut &key, shortcutKeys)
+        {
+            if (connection->mPendingGrabs.contains(key))
+            {
+                pending = true;
+            }
+            else if (connection->mGrabs.contains(key))
+            {
+                grabbed = true;
+                break;
+            }
+        }
+
+        if (grabbed)
+        {
+            connection->mGrabbedShortcuts.insert(shortcut);
+        }
+        else
+        {
+            connection->mGrabbedShortcuts.remove(shortcut);
+            if (answered && !pending && isShortcutWanted(shortcut))
+            {
+                log(LOG_WARNING, "Cannot grab shortcut '%s' on display '%s'", qPrintable(shortcut), DisplayString(connection->display()));
+            }
+        }
+    }
+}
+
+void Core::syncGrab(const QString &shortcut)
+{
+    if (shortcut.isEmpty())
+    {
+        return;
+    }
+
+    syncGrabs(QSet<QString>() << shortcut);
+}
+
+void Core::syncGrabs()
+{
+    if (mGrabSyncDeferred)
+    {
+        return;
+    }
+
+    QSet<QString> shortcuts;
+    foreach(X11Connection *connection, mX11Connections)
+    {
+        shortcuts.unite(connection->mGrabbedShortcuts);
+    }
+    IdsByShortcut::const_iterator lastIdsByShortcut = mIdsByShortcut.constEnd();
+    for (IdsByShortcut::const_iterator idsByShortcut = mIdsByShortcut.constBegin(); idsByShortcut != lastIdsByShortcut; ++idsByShortcut)
+    {
+        shortcuts.insert(idsByShortcut.key());
+    }
+
+    syncGrabs(shortcuts);
+}
+
+void Core::syncGrabs(const QSet<QString> &shortcuts)
+{
+    if (mGrabSyncDeferred)
+    {
+        return;
+    }
+
+    TRACE_SPAN("grab", "sync grabs");
+
+    foreach(X11Connection *connection, mX11Connections)
+    {
+        // a key is shared by the shortcuts it is called for in the groups of the keymap,
+        // it is grabbed as long as one of them is wanted, in sync mode if one of those is context-bound
+        QSet<X11Shortcut> keys;
+        foreach(const QString &shortcut, shortcuts)
+        {
+            // the key may not exist on every display
+            X11ByShortcut::const_iterator x11ByShortcut = connection->mX11ByShortcut.constFind(shortcut);
+            if (!shortcut.isEmpty() && (x11ByShortcut != connection->mX11ByShortcut.constEnd()))
+            {
+                keys.unite(x11ByShortcut.value().toSet());
+            }
+        }
+
+        QList<X11Shortcut> ungrab;
+        QList<X11Shortcut> grab;
+        QList<bool> sync;
+        QSet<QString> affected;
+        foreach(const X11Shortcut &key, keys)
+        {
+            bool wanted = false;
+            bool keySync = false;
+            const QStringList &keyShortcuts = connection->mShortcutsByX11[key];
+            foreach(const QString &keyShortcut, keyShortcuts)
+            {
+                affected.insert(keyShortcut);
+                if (isShortcutWanted(keyShortcut))
+                {
+                    wanted = true;
+                    keySync |= isShortcutContextBound(keyShortcut);
+                }
+            }
+
+            QMap<X11Shortcut, bool>::const_iterator grabbed = connection->mGrabs.constFind(key);
+            if (!wanted)
+            {
+                if (grabbed != connection->mGrabs.constEnd())
+                {
+                    ungrab.push_back(key);
+                }
+            }
+            // a grab in the wrong mode is simply grabbed again
+            else if ((grabbed == connection->mGrabs.constEnd()) || (grabbed.value() != keySync))
+            {
+                grab.push_back(key);
+                sync.push_back(keySync);
+            }
+        }
+
+        if (ungrab.isEmpty() && grab.isEmpty())
+        {
+            continue;
+        }
+
+        log(LOG_DEBUG, "syncGrabs: ungrabbing %d, grabbing %d keys on display '%s'", ungrab.size(), grab.size(), DisplayString(connection->display()));
+
+        // the other displays have their own X11 thread, they are synced whatever happens here;
+        // the grabs count as requested, grabsSwitched drops the ones the display refuses
+        qulonglong ticket = connection->remoteXSwitchGrabs(ungrab, grab, sync);
+
+        foreach(const X11Shortcut &key, ungrab)
+        {
+            connection->mGrabs.remove(key);
+            connection->mPendingGrabs.remove(key);
+        }
+        for (int i = 0; i < grab.size(); ++i)
+        {
+            if (ticket)
+            {
+                connection->mGrabs[grab[i]] = sync[i];
+                connection->mPendingGrabs[grab[i]] = ticket;
+            }
+            else
+            {
+                connection->mGrabs.remove(grab[i]);
+                connection->mPendingGrabs.remove(grab[i]);
+            }
+        }
+        if (!ticket)
+        {
+            log(LOG_WARNING, "Cannot switch grabs on display '%s'", DisplayString(connection->display()));
+        }
+
+        updateGrabbedShortcuts(connection, affected, !ticket);
+    }
+}
+
+void Core::grabsSwitched()
+{
+    QMutexLocker lock(&mDataMutex);
+
+    TRACE_SPAN("grab", "grabs switched");
+
+    foreach(X11Connection *connection, mX11Connections)
+    {
+        X11Connection::GrabResults results = connection->takeGrabResults();
+        if (results.isEmpty())
+        {
+            continue;
+        }
+
+        QSet<QString> affected;
+        foreach(const X11Connection::GrabResult &result, results)
+        {
+            if (!result.grabbed)
+            {
+                mMetrics.increment(Metrics::GRAB_FAILURES);
+            }
+
+            // a later request of the key has the last word
+            QMap<X11Shortcut, qulonglong>::iterator pendingGrab = connection->mPendingGrabs.find(result.key);
+            if ((pendingGrab == connection->mPendingGrabs.end()) || (pendingGrab.value() != result.ticket))
+            {
+                continue;
+            }
+            connection->mPendingGrabs.erase(pendingGrab);
+
+            if (!result.grabbed)
+            {
+                log(LOG_DEBUG, "Cannot grab key %02x + %02x on display '%s'", result.key.first, result.key.second, DisplayString(connection->display()));
+                connection->mGrabs.remove(result.key);
+            }
+
+            foreach(const QString &shortcut, connection->mShortcutsByX11.value(result.key))
+            {
+                affected.insert(shortcut);
+            }
+        }
+
+        updateGrabbedShortcuts(connection, affected, true);
+    }
+
+    // the calls whose shortcut every display has answered for, in the order they came
+    GrabReplies waiting;
+    GrabReplies answered;
+    foreach(const GrabReply &grabReply, mGrabReplies)
+    {
+        if (isShortcutGrabPending(grabReply.shortcut))
+        {
+            waiting.push_back(grabReply);
+        }
+        else
+        {
+            answered.push_back(grabReply);
+        }
+    }
+    mGrabReplies = waiting;
+
+    foreach(const GrabReply &grabReply, answered)
+    {
+        answerGrabReply(grabReply);
+    }
+}
+
+
+Core::KeySymShortcut Core::ShortcutToKeySym(X11Connection *connection, const QString &shortcut)
+{
+    KeySymShortcut result(NoSymbol, 0);
+
+    QStringList parts = shortcut.split('+');
+
+    size_t m = parts.size();
+    for (size_t i = 0; i < m - 1; ++i)
+    {
+        if (parts[i] == "Shift")
+        {
+            result.second |= ShiftMask;
+        }
+        else if (parts[i] == "Control")
+        {
+            result.second |= ControlMask;
+        }
+        else if (parts[i] == "Alt")
+        {
+            result.second |= AltMask;
+        }
+        else if (parts[i] == "Meta")
+        {
+            result.second |= MetaMask;
+        }
+        else if (parts[i] == "Level3")
+        {
+            result.second |= Level3Mask;
+        }
+        else if (parts[i] == "Level5")
+        {
+            result.second |= Level5Mask;
+        }
+        else
+        {
+            throw false;
+        }
+    }
+    if (m)
+    {
+        // whatever level it is typed on, the key is called by its name
+        KeySym name = connection->mKeycodeTable.name(keysymFromString(qPrintable(parts[m - 1])));
+        if (name == NoSymbol)
+        {
+            throw false;
+        }
+
+        result.first = name;
+    }
+
+    return result;
+}
+
+QString Core::KeySymToShortcut(const KeySymShortcut &keySymShortcut)
+{
+    QString result;
+    const unsigned int &modifiers = keySymShortcut.second;
+
+    if (modifiers & ShiftMask)
+    {
+        result += "Shift+";
+    }
+    if (modifiers & ControlMask)
+    {
+        result += "Control+";
+    }
+    if (modifiers & AltMask)
+    {
+        result += "Alt+";
+    }
+    if (modifiers & MetaMask)
+    {
+        result += "Meta+";
+    }
+    if (modifiers & Level3Mask)
+    {
+        result += "Level3+";
+    }
+    if (modifiers & Level5Mask)
+    {
+        result += "Level5+";
+    }
+
+    const char *key = keysymToString(keySymShortcut.first);
+    if (!key || !*key)
+    {
+        throw false;
+    }
+
+    result += key;
+
+    return result;
+}
+
+QString Core::checkShortcut(const QString &shortcut)
+{
+    if (shortcut.isEmpty())
+        return QString();
+
+    QString usedShortcut;
+
+    X11Connection *primary = primaryConnection();
+    KeySymShortcut keySymShortcut;
+
+    try
+    {
+        keySymShortcut = ShortcutToKeySym(primary, shortcut);
+    }
+    catch (bool)
+    {
+        log(LOG_WARNING, "Cannot extract keysym and modifiers from shortcut '%s'", qPrintable(shortcut));
+        return QString();
+    }
+
+    try
+    {
+        ShortcutByKeySym::const_iterator shortcutByKeySym = mShortcutByKeySym.constFind(keySymShortcut);
+        if (shortcutByKeySym != mShortcutByKeySym.constEnd())
+        {
+            usedShortcut = shortcutByKeySym.value();
+        }
+        else
+        {
+            usedShortcut = KeySymToShortcut(keySymShortcut);
+            mShortcutByKeySym[keySymShortcut] = usedShortcut;
+        }
+    }
+    catch (bool)
+    {
+        log(LOG_WARNING, "Cannot get back shortcut '%s'", qPrintable(shortcut));
+        return QString();
+    }
+
+    if (shortcut != usedShortcut)
+    {
+        log(LOG_INFO, "Using shortcut '%s' instead of '%s'", qPrintable(usedShortcut), qPrintable(shortcut));
+    }
+
+    // every key called so in any group of the keymap, each display has a keymap of its own
+    foreach(X11Connection *connection, mX11Connections)
+    {
+        if (connection->mX11ByShortcut.contains(usedShortcut))
+        {
+            continue;
+        }
+
+        QList<KeyCode> keyCodes = connection->mKeycodeTable.keycodes(keySymShortcut.first);
+        if (keyCodes.isEmpty())
+        {
+            log(LOG_INFO, "Shortcut '%s' has no key on display '%s'", qPrintable(usedShortcut), DisplayString(connection->display()));
+            continue;
+        }
+
+        X11Shortcuts &X11shortcuts = connection->mX11ByShortcut[usedShortcut];
+        foreach(KeyCode keyCode, keyCodes)
+        {
+            X11Shortcut X11shortcut(keyCode, keySymShortcut.second);
+            X11shortcuts.push_back(X11shortcut);
+            connection->mShortcutsByX11[X11shortcut].push_back(usedShortcut);
+        }
+    }
+
+    return usedShortcut;
+}
+
+QPair<QString, qulonglong> Core::addOrRegisterClientAction(const QString &shortcut, const QDBusObjectPath &path, const QString &description, const QString &sender, KeyGrab &keyGrab)
+{
+    QString newShortcut = checkShortcut(shortcut);
+//    if (newShortcut.isEmpty())
+//    {
+//        return qMakePair(QString(), 0ull);
+//    }
+
+    keyGrab = KEY_GRABBED;
+
+    IdByClientPath::iterator idByNativeClient = mIdByClientPath.find(path);
+    if (idByNativeClient != mIdByClientPath.end())
+    {
+        qulonglong id = idByNativeClient.value();
+        ShortcutAndAction &shortcutAndAction = mShortcutAndActionById[id];
+        if (newShortcut != shortcutAndAction.first)
+        {
+            mShortcutAndActionById[id].first = newShortcut;
+        }
+
+        if (!newShortcut.isEmpty())
+        {
+            mIdsByShortcut[newShortcut].insert(id);
+            // the action keeps the shortcut it is saved with, the caller learns it cannot have it
+            keyGrab = grabOrReuseKey(newShortcut, isActive(shortcutAndAction.second));
+            if (keyGrab == KEY_NOT_GRABBED)
+            {
+                newShortcut = QString();
+            }
+        }
+
+        dynamic_cast<ClientAction*>(shortcutAndAction.second)->appeared(clientProxy(sender));
+
+        return qMakePair(newShortcut, id);
+    }
+
+    qulonglong id = ++mLastId;
+
+    mIdByClientPath[path] = id;
+    ClientAction *clientAction = sender.isEmpty() ? new ClientAction(this, path, description) : new ClientAction(this, clientProxy(sender), path, description);
+    mShortcutAndActionById[id] = qMakePair<QString, BaseAction *>(newShortcut, clientAction);
+
+    if (!sender.isEmpty() && !newShortcut.isEmpty())
+    {
+        mIdsByShortcut[newShortcut].insert(id);
+        keyGrab = grabOrReuseKey(newShortcut);
+        if (keyGrab == KEY_NOT_GRABBED)
+        {
+            unbindShortcut(newShortcut, id);
+            newShortcut = QString();
+            mShortcutAndActionById[id].first = newShortcut;
+        }
+    }
+
+    log(LOG_INFO, "addClientAction shortcut:'%s' id:%llu", qPrintable(newShortcut), id);
+
+    return qMakePair(newShortcut, id);
+}
+
+void Core::addClientAction(QPair<QString, qulonglong> &result, const QString &shortcut, const QDBusObjectPath &path, const QString &description, const QString &sender, const QDBusMessage &message)
+{
+    log(LOG_INFO, "addClientAction shortcut:'%s' path:'%s' description:'%s' sender:'%s'", qPrintable(shortcut), qPrintable(path.path()), qPrintable(description), qPrintable(sender));
+
+    QMutexLocker lock(&mDataMutex);
+
+    SenderByClientPath::iterator senderByClientPath = mSenderByClientPath.find(path);
+    if (senderByClientPath != mSenderByClientPath.end())
+    {
+        log(LOG_WARNING, "Action already registered for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
+        result = qMakePair(QString(), 0ull);
+        return;
+    }
+
+    QString useShortcut = shortcut;
+    if (shortcut.isEmpty())
+    {
+        IdByClientPath::ConstIterator idByClientPath = mIdByClientPath.find(path);
+        if (idByClientPath != mIdByClientPath.constEnd())
+        {
+            useShortcut = mShortcutAndActionById[idByClientPath.value()].first;;
+        }
+    }
+
+    mSenderByClientPath[path] = sender;
+
+    if (!mClientPathsBySender.contains(sender))
+    {
+        mMetrics.increment(Metrics::CLIENTS_CONNECTED);
+    }
+    mClientPathsBySender[sender].insert(path);
+
+    bool registered = mIdByClientPath.contains(path);
+    KeyGrab keyGrab;
+    result = addOrRegisterClientAction(useShortcut, path, description, sender, keyGrab);
+
+    saveConfig();
+
+    actionChanged(ACTION_CHANGE_ADDED, result.second);
+
+    mDaemonAdaptor->emit_clientActionSenderChanged(result.second, sender);
+
+    mDaemonAdaptor->emit_actionAdded(result.second);
+
+    // the action is there already, only the shortcut in the reply waits for the displays
+    if (keyGrab == KEY_GRAB_PENDING)
+    {
+        awaitGrab(message, registered ? GRAB_REPLY_REGISTER_CLIENT_ACTION : GRAB_REPLY_ADD_CLIENT_ACTION, result.second, result.first);
+    }
+}
+
+qulonglong Core::registerClientAction(const QString &shortcut, const QDBusObjectPath &path, const QString &description)
+{
+    log(LOG_INFO, "registerClientAction shortcut:'%s' path:'%s' description:'%s'", qPrintable(shortcut), qPrintable(path.path()), qPrintable(description));
+
+    QMutexLocker lock(&mDataMutex);
+
+    KeyGrab keyGrab;
+    return addOrRegisterClientAction(shortcut, path, description, QString(), keyGrab).second;
+}
+
+void Core::addMethodAction(QPair<QString, qulonglong> &result, const QString &shortcut, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description, const QDBusMessage &message)
+{
+    log(LOG_INFO, "addMethodAction shortcut:'%s' service:'%s' path:'%s' interface:'%s' method:'%s' description:'%s'", qPrintable(shortcut), qPrintable(service), qPrintable(path.path()), qPrintable(interface), qPrintable(method), qPrintable(description));
+
+    QMutexLocker lock(&mDataMutex);
+
+    QString newShortcut = checkShortcut(shortcut);
+    if (newShortcut.isEmpty())
+    {
+        result = qMakePair(QString(), 0ull);
+        return;
+    }
+
+    qulonglong id = ++mLastId;
+
+    mIdsByShortcut[newShortcut].insert(id);
+    mShortcutAndActionById[id] = qMakePair<QString, BaseAction *>(newShortcut, new MethodAction(this, QDBusConnection::sessionBus(), mNameOwners, service, path, interface, method, description));
+
+    KeyGrab keyGrab = grabOrReuseKey(newShortcut);
+    if ((keyGrab == KEY_GRAB_PENDING) && awaitGrab(message, GRAB_REPLY_ADD_ACTION, id, newShortcut))
+    {
+        // answered by grabsSwitched, the adaptor must not announce anything yet
+        result = qMakePair(QString(), 0ull);
+        return;
+    }
+
+    result = finishAddAction(id, newShortcut, keyGrab != KEY_NOT_GRABBED);
+}
+
+qulonglong Core::registerMethodAction(const QString &shortcut, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description)
+{
+    QPair<QString, qulonglong> result;
+    addMethodAction(result, shortcut, service, path, interface, method, description, QDBusMessage());
+    return result.second;
+}
+
+void Core::addCommandAction(QPair<QString, qulonglong> &result, const QString &shortcut, const QString &command, const QStringList &arguments, const QString &description, const QDBusMessage &message)
+{
+    log(LOG_INFO, "addCommandAction shortcut:'%s' command:'%s' arguments:'%s' description:'%s'", qPrintable(shortcut), qPrintable(command), qPrintable(joinToString(arguments, "", "' '", "")), qPrintable(description));
+
+    QMutexLocker lock(&mDataMutex);
+
+    QString newShortcut = checkShortcut(shortcut);
+    if (newShortcut.isEmpty())
+    {
+        result = qMakePair(QString(), 0ull);
+        return;
+    }
+
+    qulonglong id = ++mLastId;
 
-    log(LOG_INFO, "addMethodAction shortcut:'%s' id:%llu", qPrintable(newShortcut), id);
+    mIdsByShortcut[newShortcut].insert(id);
+    mShortcutAndActionById[id] = qMakePair<QString, BaseAction *>(newShortcut, new CommandAction(this, &mMetrics, mExecutables, mProcesses, command, arguments, description));
 
-    saveConfig();
+    KeyGrab keyGrab = grabOrReuseKey(newShortcut);
+    if ((keyGrab == KEY_GRAB_PENDING) && awaitGrab(message, GRAB_REPLY_ADD_ACTION, id, newShortcut))
+    {
+        // answered by grabsSwitched, the adaptor must not announce anything yet
+        result = qMakePair(QString(), 0ull);
+        return;
+    }
 
-    result = qMakePair(newShortcut, id);
+    result = finishAddAction(id, newShortcut, keyGrab != KEY_NOT_GRABBED);
 }
 
-qulonglong Core::registerMethodAction(const QString &shortcut, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description)
+qulonglong Core::registerCommandAction(const QString &shortcut, const QString &command, const QStringList &arguments, const QString &description)
 {
     QPair<QString, qulonglong> result;
-    addMethodAction(result, shortcut, service, path, interface, method, description);
+    addCommandAction(result, shortcut, command, arguments, description, QDBusMessage());
     return result.second;
 }
 
-void Core::addCommandAction(QPair<QString, qulonglong> &result, const QString &shortcut, const QString &command, const QStringList &arguments, const QString &description)
+void Core::modifyClientAction(qulonglong &result, const QDBusObjectPath &path, const QString &description, const QString &sender)
+{
+    log(LOG_INFO, "modifyClientAction path:'%s' description:'%s' sender:'%s'", qPrintable(path.path()), qPrintable(description), qPrintable(sender));
+
+    QMutexLocker lock(&mDataMutex);
+
+    IdByClientPath::iterator idByNativeClient = mIdByClientPath.find(path);
+    if (idByNativeClient == mIdByClientPath.end())
+    {
+        log(LOG_WARNING, "No action registered for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
+        result = 0ull;
+        return;
+    }
+
+    SenderByClientPath::Iterator senderByClientPath = mSenderByClientPath.find(path);
+    if (senderByClientPath == mSenderByClientPath.end())
+    {
+        log(LOG_WARNING, "No action activated for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
+        result = 0ull;
+        return;
+    }
+
+    if (senderByClientPath.value() != sender)
+    {
+        log(LOG_WARNING, "Sender mismatch: caller: %s owner: %s", qPrintable(senderByClientPath.value()), qPrintable(sender));
+        result = 0ull;
+        return;
+    }
+
+    qulonglong id = idByNativeClient.value();
+
+    mShortcutAndActionById[id].second->setDescription(description);
+
+    saveConfig();
+
+    actionChanged(ACTION_CHANGE_MODIFIED, id);
+
+    result = id;
+
+    mDaemonAdaptor->emit_actionModified(result);
+}
+
+void Core::modifyActionDescription(bool &result, const qulonglong &id, const QString &description)
+{
+    log(LOG_INFO, "modifyActionDescription id:%llu description:'%s'", id, qPrintable(description));
+
+    QMutexLocker lock(&mDataMutex);
+
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
+    {
+        log(LOG_WARNING, "No action registered with id #%llu", id);
+        result = false;
+        return;
+    }
+
+    BaseAction *action = shortcutAndActionById.value().second;
+
+    if ((strcmp(action->type(), MethodAction::id())) && (strcmp(action->type(), CommandAction::id())))
+    {
+        log(LOG_WARNING, "modifyActionDescription attempts to modify action of type '%s'", action->type());
+        result = false;
+        return;
+    }
+
+    action->setDescription(description);
+
+    saveConfig();
+
+    actionChanged(ACTION_CHANGE_MODIFIED, id);
+
+    result = true;
+}
+
+void Core::modifyMethodAction(bool &result, const qulonglong &id, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description)
+{
+    log(LOG_INFO, "modifyMethodAction id:%llu service:'%s' path:'%s' interface:'%s' method:'%s' description:'%s'", id, qPrintable(service), qPrintable(path.path()), qPrintable(interface), qPrintable(method), qPrintable(description));
+
+    QMutexLocker lock(&mDataMutex);
+
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
+    {
+        log(LOG_WARNING, "No action registered with id #%llu", id);
+        result = false;
+        return;
+    }
+
+    BaseAction *action = shortcutAndActionById.value().second;
+
+    if (strcmp(action->type(), MethodAction::id()))
+    {
+        log(LOG_WARNING, "modifyMethodAction attempts to modify action of type '%s'", action->type());
+        result = false;
+        return;
+    }
+
+    // the replacement keeps what is not part of the method call
+    MethodAction *modified = new MethodAction(this, QDBusConnection::sessionBus(), mNameOwners, service, path, interface, method, description);
+    modified->setEnabled(action->isEnabled());
+    modified->setProfiles(action->profiles());
+    modified->setContext(action->context());
+    modified->setAllowActivation(dynamic_cast<const MethodAction *>(action)->allowActivation());
+
+    action->release();
+    shortcutAndActionById.value().second = modified;
+
+    syncGrab(shortcutAndActionById.value().first);
+
+    saveConfig();
+
+    actionChanged(ACTION_CHANGE_MODIFIED, id);
+
+    result = true;
+}
+
+void Core::modifyCommandAction(bool &result, const qulonglong &id, const QString &command, const QStringList &arguments, const QString &description)
+{
+    log(LOG_INFO, "modifyCommandAction id:%llu command:'%s' arguments:'%s' description:'%s'", id, qPrintable(command), qPrintable(joinToString(arguments, "", "' '", "")), qPrintable(description));
+
+    QMutexLocker lock(&mDataMutex);
+
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
+    {
+        log(LOG_WARNING, "No action registered with id #%llu", id);
+        result = false;
+        return;
+    }
+
+    BaseAction *action = shortcutAndActionById.value().second;
+
+    if (strcmp(action->type(), CommandAction::id()))
+    {
+        log(LOG_WARNING, "modifyMethodAction attempts to modify action of type '%s'", action->type());
+        result = false;
+        return;
+    }
+
+    // the replacement keeps what is not part of the command
+    CommandAction *modified = new CommandAction(this, &mMetrics, mExecutables, mProcesses, command, arguments, description);
+    modified->setEnabled(action->isEnabled());
+    modified->setProfiles(action->profiles());
+    modified->setContext(action->context());
+    modified->setLaunchPolicy(dynamic_cast<const CommandAction *>(action)->launchPolicy());
+    mProcesses->transfer(action, modified);
+
+    action->release();
+    shortcutAndActionById.value().second = modified;
+
+    syncGrab(shortcutAndActionById.value().first);
+
+    saveConfig();
+
+    actionChanged(ACTION_CHANGE_MODIFIED, id);
+
+    result = true;
+}
+
+void Core::enableClientAction(bool &result, const QDBusObjectPath &path, bool enabled, const QString &sender)
+{
+    log(LOG_INFO, "enableClientAction path:'%s' enabled:%s sender:'%s'", qPrintable(path.path()), enabled ? " true" : "false", qPrintable(sender));
+
+    QMutexLocker lock(&mDataMutex);
+
+    IdByClientPath::iterator idByNativeClient = mIdByClientPath.find(path);
+    if (idByNativeClient == mIdByClientPath.end())
+    {
+        log(LOG_WARNING, "No action registered for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
+        result = false;
+        return;
+    }
+
+    SenderByClientPath::Iterator senderByClientPath = mSenderByClientPath.find(path);
+    if (senderByClientPath == mSenderByClientPath.end())
+    {
+        log(LOG_WARNING, "No action activated for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
+        result = false;
+        return;
+    }
+
+    if (senderByClientPath.value() != sender)
+    {
+        log(LOG_WARNING, "Sender mismatch: caller: %s owner: %s", qPrintable(senderByClientPath.value()), qPrintable(sender));
+        result = false;
+        return;
+    }
+
+    qulonglong id = idByNativeClient.value();
+
+    ShortcutAndAction &shortcutAndAction = mShortcutAndActionById[id];
+    shortcutAndAction.second->setEnabled(enabled);
+
+    // a shortcut with no enabled action left is released, so the key reaches applications again
+    syncGrab(shortcutAndAction.first);
+
+    saveConfig();
+
+    actionChanged(ACTION_CHANGE_MODIFIED, id);
+
+    result = true;
+
+    mDaemonAdaptor->emit_actionEnabled(id, result);
+}
+
+void Core::isClientActionEnabled(bool &enabled, const QDBusObjectPath &path, const QString &sender)
+{
+    log(LOG_INFO, "isClientActionEnabled path:'%s' sender:'%s'", qPrintable(path.path()), qPrintable(sender));
+
+    enabled = false;
+
+    QMutexLocker lock(&mDataMutex);
+    IdByClientPath::iterator idByNativeClient = mIdByClientPath.find(path);
+    if (idByNativeClient == mIdByClientPath.end())
+    {
+        log(LOG_WARNING, "No action registered for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
+        return;
+    }
+
+    SenderByClientPath::Iterator senderByClientPath = mSenderByClientPath.find(path);
+    if (senderByClientPath == mSenderByClientPath.end())
+    {
+        log(LOG_WARNING, "No action activated for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
+        return;
+    }
+
+    if (senderByClientPath.value() != sender)
+    {
+        log(LOG_WARNING, "Sender mismatch: caller: %s owner: %s", qPrintable(senderByClientPath.value()), qPrintable(sender));
+        return;
+    }
+
+    enabled = mShortcutAndActionById[idByNativeClient.value()].second->isEnabled();
+}
+
+void Core::enableAction(bool &result, qulonglong id, bool enabled)
+{
+    log(LOG_INFO, "enableAction id:%llu enabled:%s", id, enabled ? "true" : " false");
+
+    QMutexLocker lock(&mDataMutex);
+
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
+    {
+        log(LOG_WARNING, "No action registered with id #%llu", id);
+        result = false;
+        return;
+    }
+
+    shortcutAndActionById.value().second->setEnabled(enabled);
+
+    syncGrab(shortcutAndActionById.value().first);
+
+    saveConfig();
+
+    actionChanged(ACTION_CHANGE_MODIFIED, id);
+
+    result = true;
+}
+
+void Core::isActionEnabled(bool &enabled, qulonglong id)
+{
+    log(LOG_INFO, "isActionEnabled id:%llu", id);
+
+    enabled = false;
+
+    QMutexLocker lock(&mDataMutex);
+
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
+    {
+        log(LOG_WARNING, "No action registered with id #%llu", id);
+        return;
+    }
+
+    enabled = shortcutAndActionById.value().second->isEnabled();
+}
+
+void Core::getClientActionSender(QString &sender, qulonglong id)
 {
-    log(LOG_INFO, "addCommandAction shortcut:'%s' command:'%s' arguments:'%s' description:'%s'", qPrintable(shortcut), qPrintable(command), qPrintable(joinToString(arguments, "", "' '", "")), qPrintable(description));
+    log(LOG_INFO, "getClientActionSender id:'%llu'", id);
+
+    sender.clear();
 
     QMutexLocker lock(&mDataMutex);
 
-    X11Shortcut X11shortcut;
-    QString newShortcut = checkShortcut(shortcut, X11shortcut);
-    if (newShortcut.isEmpty())
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
     {
-        result = qMakePair(QString(), 0ull);
+        log(LOG_WARNING, "No action registered with id #%llu", id);
         return;
     }
 
-    newShortcut = grabOrReuseKey(X11shortcut, newShortcut);
-    if (newShortcut.isEmpty())
+    BaseAction *action = shortcutAndActionById.value().second;
+    if (!strcmp(action->type(), ClientAction::id()))
     {
-        result = qMakePair(QString(), 0ull);
-        return;
+        sender = dynamic_cast<ClientAction *>(action)->service();
     }
-
-
-    qulonglong id = ++mLastId;
-
-    mIdsByShortcut[newShortcut].insert(id);
-    mShortcutAndActionById[id] = qMakePair<QString, BaseAction *>(newShortcut, new CommandAction(this, command, arguments, description));
-
-    log(LOG_INFO, "addCommandAction shortcut:'%s' id:%llu", qPrintable(newShortcut), id);
-
-    saveConfig();
-
-    result = qMakePair(newShortcut, id);
 }
 
-qulonglong Core::registerCommandAction(const QString &shortcut, const QString &command, const QStringList &arguments, const QString &description)
+void Core::changeClientActionShortcut(QPair<QString, qulonglong> &result, const QDBusObjectPath &path, const QString &shortcut, const QString &sender, const QDBusMessage &message)
 {
-    QPair<QString, qulonglong> result;
-    addCommandAction(result, shortcut, command, arguments, description);
-    return result.second;
-}
+    log(LOG_INFO, "changeClientActionShortcut path:'%s' shortcut:'%s' sender:'%s'", qPrintable(path.path()), qPrintable(shortcut), qPrintable(sender));
 
-void Core::modifyClientAction(qulonglong &result, const QDBusObjectPath &path, const QString &description, const QString &sender)
-{
-    log(LOG_INFO, "modifyClientAction path:'%s' description:'%s' sender:'%s'", qPrintable(path.path()), qPrintable(description), qPrintable(sender));
+    if (shortcut.isEmpty())
+    {
+        result = qMakePair(QString(), 0ull);
+        return;
+    }
 
     QMutexLocker lock(&mDataMutex);
 
@@ -2236,7 +2838,7 @@ void Core::modifyClientAction(qulonglong &result, const QDBusObjectPath &path, c
     if (idByNativeClient == mIdByClientPath.end())
     {
         log(LOG_WARNING, "No action registered for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
-        result = 0ull;
+        result = qMakePair(QString(), 0ull);
         return;
     }
 
@@ -2244,61 +2846,69 @@ void Core::modifyClientAction(qulonglong &result, const QDBusObjectPath &path, c
     if (senderByClientPath == mSenderByClientPath.end())
     {
         log(LOG_WARNING, "No action activated for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
-        result = 0ull;
+        result = qMakePair(QString(), 0ull);
         return;
     }
 
     if (senderByClientPath.value() != sender)
     {
         log(LOG_WARNING, "Sender mismatch: caller: %s owner: %s", qPrintable(senderByClientPath.value()), qPrintable(sender));
-        result = 0ull;
+        result = qMakePair(QString(), 0ull);
         return;
     }
 
     qulonglong id = idByNativeClient.value();
 
-    mShortcutAndActionById[id].second->setDescription(description);
+    QString newShortcut = checkShortcut(shortcut);
+    if (newShortcut.isEmpty())
+    {
+        result = qMakePair(QString(), id);
+        return;
+    }
 
-    saveConfig();
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
 
-    result = id;
+    QString oldShortcut = shortcutAndActionById.value().first;
 
-    mDaemonAdaptor->emit_actionModified(result);
-}
+    if (oldShortcut == newShortcut)
+    {
+        saveConfig();
 
-void Core::modifyActionDescription(bool &result, const qulonglong &id, const QString &description)
-{
-    log(LOG_INFO, "modifyActionDescription id:%llu description:'%s'", id, qPrintable(description));
+        dynamic_cast<ClientAction *>(shortcutAndActionById.value().second)->shortcutChanged(oldShortcut, newShortcut);
 
-    QMutexLocker lock(&mDataMutex);
+        actionChanged(ACTION_CHANGE_MODIFIED, id);
 
-    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
-    if (shortcutAndActionById == mShortcutAndActionById.end())
-    {
-        log(LOG_WARNING, "No action registered with id #%llu", id);
-        result = false;
+        mDaemonAdaptor->emit_actionShortcutChanged(id);
+
+        result = qMakePair(newShortcut, id);
         return;
     }
 
-    BaseAction *action = shortcutAndActionById.value().second;
-
-    if ((strcmp(action->type(), MethodAction::id())) && (strcmp(action->type(), CommandAction::id())))
+    // bound to both until the new key is answered for, so the old one is not given up for nothing
+    mIdsByShortcut[newShortcut].insert(id);
+    KeyGrab keyGrab = grabOrReuseKey(newShortcut, isActive(shortcutAndActionById.value().second));
+    if ((keyGrab == KEY_GRAB_PENDING) && awaitGrab(message, GRAB_REPLY_CHANGE_SHORTCUT, id, newShortcut, oldShortcut))
     {
-        log(LOG_WARNING, "modifyActionDescription attempts to modify action of type '%s'", action->type());
-        result = false;
+        result = qMakePair(QString(), id);
         return;
     }
 
-    action->setDescription(description);
-
-    saveConfig();
-
-    result = true;
+    result = qMakePair(finishChangeShortcut(id, oldShortcut, newShortcut, keyGrab != KEY_NOT_GRABBED), id);
+    if (!result.first.isEmpty())
+    {
+        mDaemonAdaptor->emit_actionShortcutChanged(id);
+    }
 }
 
-void Core::modifyMethodAction(bool &result, const qulonglong &id, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description)
+void Core::changeShortcut(QString &result, const qulonglong &id, const QString &shortcut, const QDBusMessage &message)
 {
-    log(LOG_INFO, "modifyMethodAction id:%llu service:'%s' path:'%s' interface:'%s' method:'%s' description:'%s'", id, qPrintable(service), qPrintable(path.path()), qPrintable(interface), qPrintable(method), qPrintable(description));
+    log(LOG_INFO, "changeShortcut id:%llu shortcut:'%s'", id, qPrintable(shortcut));
+
+    if (shortcut.isEmpty())
+    {
+        result = QString();
+        return;
+    }
 
     QMutexLocker lock(&mDataMutex);
 
@@ -2306,109 +2916,92 @@ void Core::modifyMethodAction(bool &result, const qulonglong &id, const QString
     if (shortcutAndActionById == mShortcutAndActionById.end())
     {
         log(LOG_WARNING, "No action registered with id #%llu", id);
-        result = false;
+        result = QString();
         return;
     }
 
-    BaseAction *action = shortcutAndActionById.value().second;
-
-    if (strcmp(action->type(), MethodAction::id()))
+    QString newShortcut = checkShortcut(shortcut);
+    if (newShortcut.isEmpty())
     {
-        log(LOG_WARNING, "modifyMethodAction attempts to modify action of type '%s'", action->type());
-        result = false;
+        result = QString();
         return;
     }
 
-    delete action;
-    shortcutAndActionById.value().second = new MethodAction(this, QDBusConnection::sessionBus(), service, path, interface, method, description);
-
-    saveConfig();
-
-    result = true;
-}
+    QString oldShortcut = shortcutAndActionById.value().first;
 
-void Core::modifyCommandAction(bool &result, const qulonglong &id, const QString &command, const QStringList &arguments, const QString &description)
-{
-    log(LOG_INFO, "modifyCommandAction id:%llu command:'%s' arguments:'%s' description:'%s'", id, qPrintable(command), qPrintable(joinToString(arguments, "", "' '", "")), qPrintable(description));
+    if (oldShortcut == newShortcut)
+    {
+        saveConfig();
 
-    QMutexLocker lock(&mDataMutex);
+        actionChanged(ACTION_CHANGE_MODIFIED, id);
 
-    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
-    if (shortcutAndActionById == mShortcutAndActionById.end())
-    {
-        log(LOG_WARNING, "No action registered with id #%llu", id);
-        result = false;
+        result = newShortcut;
         return;
     }
 
-    BaseAction *action = shortcutAndActionById.value().second;
-
-    if (strcmp(action->type(), CommandAction::id()))
+    // bound to both until the new key is answered for, so the old one is not given up for nothing
+    mIdsByShortcut[newShortcut].insert(id);
+    KeyGrab keyGrab = grabOrReuseKey(newShortcut, isActive(shortcutAndActionById.value().second));
+    if ((keyGrab == KEY_GRAB_PENDING) && awaitGrab(message, GRAB_REPLY_CHANGE_SHORTCUT, id, newShortcut, oldShortcut))
     {
-        log(LOG_WARNING, "modifyMethodAction attempts to modify action of type '%s'", action->type());
-        result = false;
+        // answered by grabsSwitched, the adaptor must not announce anything yet
+        result = QString();
         return;
     }
 
-    delete action;
-    shortcutAndActionById.value().second = new CommandAction(this, command, arguments, description);
-
-    saveConfig();
-
-    result = true;
+    result = finishChangeShortcut(id, oldShortcut, newShortcut, keyGrab != KEY_NOT_GRABBED);
 }
 
-void Core::enableClientAction(bool &result, const QDBusObjectPath &path, bool enabled, const QString &sender)
+void Core::swapActions(bool &result, const qulonglong &id1, const qulonglong &id2)
 {
-    log(LOG_INFO, "enableClientAction path:'%s' enabled:%s sender:'%s'", qPrintable(path.path()), enabled ? " true" : "false", qPrintable(sender));
+    log(LOG_INFO, "swapActions id1:%llu id2:%llu", id1, id2);
 
     QMutexLocker lock(&mDataMutex);
 
-    IdByClientPath::iterator idByNativeClient = mIdByClientPath.find(path);
-    if (idByNativeClient == mIdByClientPath.end())
+    ShortcutAndActionById::iterator shortcutAndActionById1 = mShortcutAndActionById.find(id1);
+    if (shortcutAndActionById1 == mShortcutAndActionById.end())
     {
-        log(LOG_WARNING, "No action registered for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
+        log(LOG_WARNING, "No action registered with id #%llu", id1);
         result = false;
         return;
     }
 
-    SenderByClientPath::Iterator senderByClientPath = mSenderByClientPath.find(path);
-    if (senderByClientPath == mSenderByClientPath.end())
+    ShortcutAndActionById::iterator shortcutAndActionById2 = mShortcutAndActionById.find(id2);
+    if (shortcutAndActionById2 == mShortcutAndActionById.end())
     {
-        log(LOG_WARNING, "No action activated for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
+        log(LOG_WARNING, "No action registered with id #%llu", id2);
         result = false;
         return;
     }
 
-    if (senderByClientPath.value() != sender)
+    if (shortcutAndActionById1.value().first != shortcutAndActionById2.value().first)
     {
-        log(LOG_WARNING, "Sender mismatch: caller: %s owner: %s", qPrintable(senderByClientPath.value()), qPrintable(sender));
+        log(LOG_WARNING, "swapActions attempts to swap action assigned to different shortcuts");
         result = false;
         return;
     }
 
-    qulonglong id = idByNativeClient.value();
-
-    mShortcutAndActionById[id].second->setEnabled(enabled);
+    std::swap(shortcutAndActionById1.value().second, shortcutAndActionById2.value().second);
 
     saveConfig();
 
-    result = true;
+    actionChanged(ACTION_CHANGE_MODIFIED, id1);
+    actionChanged(ACTION_CHANGE_MODIFIED, id2);
 
-    mDaemonAdaptor->emit_actionEnabled(id, result);
+    result = true;
 }
 
-void Core::isClientActionEnabled(bool &enabled, const QDBusObjectPath &path, const QString &sender)
+void Core::removeClientAction(bool &result, const QDBusObjectPath &path, const QString &sender)
 {
-    log(LOG_INFO, "isClientActionEnabled path:'%s' sender:'%s'", qPrintable(path.path()), qPrintable(sender));
-
-    enabled = false;
+    log(LOG_INFO, "removeClientAction path:'%s' sender:'%s'", qPrintable(path.path()), qPrintable(sender));
 
     QMutexLocker lock(&mDataMutex);
+
     IdByClientPath::iterator idByNativeClient = mIdByClientPath.find(path);
     if (idByNativeClient == mIdByClientPath.end())
     {
         log(LOG_WARNING, "No action registered for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
+        result = false;
         return;
     }
 
@@ -2416,44 +3009,57 @@ void Core::isClientActionEnabled(bool &enabled, const QDBusObjectPath &path, con
     if (senderByClientPath == mSenderByClientPath.end())
     {
         log(LOG_WARNING, "No action activated for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
+        result = false;
         return;
     }
 
     if (senderByClientPath.value() != sender)
     {
         log(LOG_WARNING, "Sender mismatch: caller: %s owner: %s", qPrintable(senderByClientPath.value()), qPrintable(sender));
+        result = false;
         return;
     }
 
-    enabled = mShortcutAndActionById[idByNativeClient.value()].second->isEnabled();
-}
+    qulonglong id = idByNativeClient.value();
 
-void Core::enableAction(bool &result, qulonglong id, bool enabled)
-{
-    log(LOG_INFO, "enableAction id:%llu enabled:%s", id, enabled ? "true" : " false");
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    QString shortcut = shortcutAndActionById.value().first;
 
-    QMutexLocker lock(&mDataMutex);
+    // an action chain may still hold the action and call it, the proxy goes away with the client
+    dynamic_cast<ClientAction *>(shortcutAndActionById.value().second)->disappeared();
+    shortcutAndActionById.value().second->release();
+    mShortcutAndActionById.erase(shortcutAndActionById);
+    mIdByClientPath.remove(path);
 
-    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
-    if (shortcutAndActionById == mShortcutAndActionById.end())
+    IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(shortcut);
+    if (idsByShortcut != mIdsByShortcut.end())
     {
-        log(LOG_WARNING, "No action registered with id #%llu", id);
-        result = false;
-        return;
+        idsByShortcut.value().remove(id);
+        if (idsByShortcut.value().isEmpty())
+        {
+            mIdsByShortcut.erase(idsByShortcut);
+        }
     }
+    syncGrab(shortcut);
 
-    shortcutAndActionById.value().second->setEnabled(enabled);
+    mSenderByClientPath.remove(path);
+
+    mClientPathsBySender[sender].remove(path);
+    if (mClientPathsBySender[sender].isEmpty())
+        mClientPathsBySender.remove(sender);
 
     saveConfig();
 
+    actionChanged(ACTION_CHANGE_REMOVED, id);
+
     result = true;
+
+    mDaemonAdaptor->emit_actionRemoved(id);
 }
 
-void Core::isActionEnabled(bool &enabled, qulonglong id)
+void Core::removeAction(bool &result, const qulonglong &id)
 {
-    log(LOG_INFO, "isActionEnabled id:%llu", id);
-
-    enabled = false;
+    log(LOG_INFO, "removeAction id:%llu", id);
 
     QMutexLocker lock(&mDataMutex);
 
@@ -2461,43 +3067,64 @@ void Core::isActionEnabled(bool &enabled, qulonglong id)
     if (shortcutAndActionById == mShortcutAndActionById.end())
     {
         log(LOG_WARNING, "No action registered with id #%llu", id);
+        result = false;
         return;
     }
 
-    enabled = shortcutAndActionById.value().second->isEnabled();
-}
-
-void Core::getClientActionSender(QString &sender, qulonglong id)
-{
-    log(LOG_INFO, "getClientActionSender id:'%llu'", id);
-
-    sender.clear();
+    BaseAction *action = shortcutAndActionById.value().second;
 
-    QMutexLocker lock(&mDataMutex);
+    bool isClientAction = !strcmp(action->type(), ClientAction::id());
 
-    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
-    if (shortcutAndActionById == mShortcutAndActionById.end())
+    if (isClientAction)
     {
-        log(LOG_WARNING, "No action registered with id #%llu", id);
-        return;
+        ClientAction *clientAction = dynamic_cast<ClientAction*>(action);
+        if (clientAction->isPresent())
+        {
+            log(LOG_WARNING, "Cannot remove active client action by id");
+            result = false;
+            return;
+        }
+        else
+        {
+            const QDBusObjectPath &path = clientAction->path();
+
+            SenderByClientPath::Iterator senderByClientPath = mSenderByClientPath.find(path);
+            if (senderByClientPath != mSenderByClientPath.end())
+            {
+                log(LOG_WARNING, "Action is currently registered for '%s'", qPrintable(path.path()));
+                result = false;
+                return;
+            }
+        }
     }
 
-    BaseAction *action = shortcutAndActionById.value().second;
-    if (!strcmp(action->type(), ClientAction::id()))
+    QString shortcut = shortcutAndActionById.value().first;
+
+
+    action->release();
+    mShortcutAndActionById.erase(shortcutAndActionById);
+
+    IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(shortcut);
+    if (idsByShortcut != mIdsByShortcut.end())
     {
-        sender = dynamic_cast<ClientAction *>(action)->service();
+        idsByShortcut.value().remove(id);
+        if (idsByShortcut.value().isEmpty())
+        {
+            mIdsByShortcut.erase(idsByShortcut);
+        }
     }
+    syncGrab(shortcut);
+
+    saveConfig();
+
+    actionChanged(ACTION_CHANGE_REMOVED, id);
+
+    result = true;
 }
 
-void Core::changeClientActionShortcut(QPair<QString, qulonglong> &result, const QDBusObjectPath &path, const QString &shortcut, const QString &sender)
+void Core::deactivateClientAction(bool &result, const QDBusObjectPath &path, const QString &sender)
 {
-    log(LOG_INFO, "changeClientActionShortcut path:'%s' shortcut:'%s' sender:'%s'", qPrintable(path.path()), qPrintable(shortcut), qPrintable(sender));
-
-    if (shortcut.isEmpty())
-    {
-        result = qMakePair(QString(), 0ull);
-        return;
-    }
+    log(LOG_INFO, "deactivateClientAction path:'%s' sender:'%s'", qPrintable(path.path()), qPrintable(sender));
 
     QMutexLocker lock(&mDataMutex);
 
@@ -2505,7 +3132,7 @@ void Core::changeClientActionShortcut(QPair<QString, qulonglong> &result, const
     if (idByNativeClient == mIdByClientPath.end())
     {
         log(LOG_WARNING, "No action registered for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
-        result = qMakePair(QString(), 0ull);
+        result = false;
         return;
     }
 
@@ -2513,384 +3140,383 @@ void Core::changeClientActionShortcut(QPair<QString, qulonglong> &result, const
     if (senderByClientPath == mSenderByClientPath.end())
     {
         log(LOG_WARNING, "No action activated for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
-        result = qMakePair(QString(), 0ull);
+        result = false;
         return;
     }
 
     if (senderByClientPath.value() != sender)
     {
         log(LOG_WARNING, "Sender mismatch: caller: %s owner: %s", qPrintable(senderByClientPath.value()), qPrintable(sender));
-        result = qMakePair(QString(), 0ull);
+        result = false;
         return;
     }
 
     qulonglong id = idByNativeClient.value();
 
-    X11Shortcut X11shortcut;
-    QString newShortcut = checkShortcut(shortcut, X11shortcut);
-    if (newShortcut.isEmpty())
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    QString shortcut = shortcutAndActionById.value().first;
+
+    dynamic_cast<ClientAction*>(shortcutAndActionById.value().second)->disappeared();
+
+    IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(shortcut);
+    if (idsByShortcut != mIdsByShortcut.end())
     {
-        result = qMakePair(QString(), id);
-        return;
+        idsByShortcut.value().remove(id);
+        if (idsByShortcut.value().isEmpty())
+        {
+            mIdsByShortcut.erase(idsByShortcut);
+        }
     }
+    syncGrab(shortcut);
 
-    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    mSenderByClientPath.remove(path);
 
-    QString oldShortcut = shortcutAndActionById.value().first;
+    mClientPathsBySender[sender].remove(path);
+    if (mClientPathsBySender[sender].isEmpty())
+        mClientPathsBySender.remove(sender);
+
+    actionChanged(ACTION_CHANGE_MODIFIED, id);
+
+    result = true;
+
+    mDaemonAdaptor->emit_clientActionSenderChanged(id, QString());
+}
+
+void Core::setMultipleActionsBehaviour(const MultipleActionsBehaviour &behaviour)
+{
+    QMutexLocker lock(&mDataMutex);
+
+    mMultipleActionsBehaviour = behaviour;
+
+    saveConfig();
+}
+
+void Core::getMultipleActionsBehaviour(MultipleActionsBehaviour &result) const
+{
+    QMutexLocker lock(&mDataMutex);
+
+    result = mMultipleActionsBehaviour;
+}
+
+void Core::setActiveProfile(bool &result, const QString &profile)
+{
+    log(LOG_INFO, "setActiveProfile profile:'%s'", qPrintable(profile));
 
-    if (oldShortcut != newShortcut)
     {
-        newShortcut = grabOrReuseKey(X11shortcut, newShortcut);
-        if (newShortcut.isEmpty())
+        QMutexLocker lock(&mDataMutex);
+
+        if (profile == mActiveProfile)
         {
-            result = qMakePair(QString(), id);
+            result = true;
             return;
         }
 
-        IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(oldShortcut);
-        if (idsByShortcut != mIdsByShortcut.end())
-        {
-            idsByShortcut.value().remove(id);
-            if (idsByShortcut.value().isEmpty())
-            {
-                mIdsByShortcut.erase(idsByShortcut);
-
-                if (!remoteXUngrabKey(mX11ByShortcut[oldShortcut]))
-                {
-                    log(LOG_WARNING, "Cannot ungrab shortcut '%s'", qPrintable(shortcut));
-                }
-            }
-        }
+        // the X11 thread waits for the lock on key press, so it never sees a half switched table
+        mActiveProfile = profile;
+        syncGrabs();
 
-        mIdsByShortcut[newShortcut].insert(id);
-        shortcutAndActionById.value().first = newShortcut;
+        saveConfig();
     }
 
-    saveConfig();
+    mDaemonAdaptor->emit_activeProfileChanged(profile);
 
-    dynamic_cast<ClientAction *>(shortcutAndActionById.value().second)->shortcutChanged(oldShortcut, newShortcut);
+    result = true;
+}
 
-    mDaemonAdaptor->emit_actionShortcutChanged(id);
+void Core::getActiveProfile(QString &result) const
+{
+    QMutexLocker lock(&mDataMutex);
 
-    result = qMakePair(newShortcut, id);
+    result = mActiveProfile;
 }
 
-void Core::changeShortcut(QString &result, const qulonglong &id, const QString &shortcut)
+void Core::getProfiles(QStringList &result) const
 {
-    log(LOG_INFO, "changeShortcut id:%llu shortcut:'%s'", id, qPrintable(shortcut));
+    QMutexLocker lock(&mDataMutex);
 
-    if (shortcut.isEmpty())
+    QSet<QString> profiles;
+
+    ShortcutAndActionById::const_iterator lastShortcutAndActionById = mShortcutAndActionById.end();
+    for (ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.begin(); shortcutAndActionById != lastShortcutAndActionById; ++shortcutAndActionById)
     {
-        result = QString();
-        return;
+        profiles.unite(shortcutAndActionById.value().second->profiles().toSet());
     }
 
+    result = profiles.toList();
+    result.sort();
+}
+
+void Core::setActionProfiles(bool &result, const qulonglong &id, const QStringList &profiles)
+{
+    log(LOG_INFO, "setActionProfiles id:%llu profiles:'%s'", id, qPrintable(profiles.join("' '")));
+
     QMutexLocker lock(&mDataMutex);
 
     ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
     if (shortcutAndActionById == mShortcutAndActionById.end())
     {
         log(LOG_WARNING, "No action registered with id #%llu", id);
-        result = QString();
-        return;
-    }
-
-    X11Shortcut X11shortcut;
-    QString newShortcut = checkShortcut(shortcut, X11shortcut);
-    if (newShortcut.isEmpty())
-    {
-        result = QString();
+        result = false;
         return;
     }
 
-    QString oldShortcut = shortcutAndActionById.value().first;
-
-    if (oldShortcut != newShortcut)
-    {
-        newShortcut = grabOrReuseKey(X11shortcut, newShortcut);
-        if (newShortcut.isEmpty())
-        {
-            result = QString();
-            return;
-        }
-
-        IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(oldShortcut);
-        if (idsByShortcut != mIdsByShortcut.end())
-        {
-            idsByShortcut.value().remove(id);
-            if (idsByShortcut.value().isEmpty())
-            {
-                mIdsByShortcut.erase(idsByShortcut);
-
-                if (!remoteXUngrabKey(mX11ByShortcut[oldShortcut]))
-                {
-                    log(LOG_WARNING, "Cannot ungrab shortcut '%s'", qPrintable(shortcut));
-                }
-            }
-        }
-
-        mIdsByShortcut[newShortcut].insert(id);
-        shortcutAndActionById.value().first = newShortcut;
+    shortcutAndActionById.value().second->setProfiles(profiles);
 
-        if (!strcmp(shortcutAndActionById.value().second->type(), ClientAction::id()))
-        {
-            dynamic_cast<ClientAction *>(shortcutAndActionById.value().second)->shortcutChanged(oldShortcut, newShortcut);
-        }
-    }
+    syncGrab(shortcutAndActionById.value().first);
 
     saveConfig();
 
-    result = newShortcut;
+    actionChanged(ACTION_CHANGE_MODIFIED, id);
+
+    result = true;
 }
 
-void Core::swapActions(bool &result, const qulonglong &id1, const qulonglong &id2)
+void Core::getActionProfiles(QStringList &result, const qulonglong &id) const
 {
-    log(LOG_INFO, "swapActions id1:%llu id2:%llu", id1, id2);
+    log(LOG_INFO, "getActionProfiles id:%llu", id);
+
+    result.clear();
 
     QMutexLocker lock(&mDataMutex);
 
-    ShortcutAndActionById::iterator shortcutAndActionById1 = mShortcutAndActionById.find(id1);
-    if (shortcutAndActionById1 == mShortcutAndActionById.end())
+    ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
     {
-        log(LOG_WARNING, "No action registered with id #%llu", id1);
-        result = false;
+        log(LOG_WARNING, "No action registered with id #%llu", id);
         return;
     }
 
-    ShortcutAndActionById::iterator shortcutAndActionById2 = mShortcutAndActionById.find(id2);
-    if (shortcutAndActionById2 == mShortcutAndActionById.end())
-    {
-        log(LOG_WARNING, "No action registered with id #%llu", id2);
-        result = false;
-        return;
-    }
+    result = shortcutAndActionById.value().second->profiles();
+}
 
-    if (shortcutAndActionById1.value().first != shortcutAndActionById2.value().first)
+void Core::setActionContext(bool &result, const qulonglong &id, const QString &context)
+{
+    log(LOG_INFO, "setActionContext id:%llu context:'%s'", id, qPrintable(context));
+
+    QMutexLocker lock(&mDataMutex);
+
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
     {
-        log(LOG_WARNING, "swapActions attempts to swap action assigned to different shortcuts");
+        log(LOG_WARNING, "No action registered with id #%llu", id);
         result = false;
         return;
     }
 
-    std::swap(shortcutAndActionById1.value().second, shortcutAndActionById2.value().second);
+    shortcutAndActionById.value().second->setContext(context);
+
+    // the grab mode follows whether a press may be left to the focused window
+    syncGrab(shortcutAndActionById.value().first);
 
     saveConfig();
 
+    actionChanged(ACTION_CHANGE_MODIFIED, id);
+
     result = true;
 }
 
-void Core::removeClientAction(bool &result, const QDBusObjectPath &path, const QString &sender)
+void Core::getActionContext(QString &result, const qulonglong &id) const
 {
-    log(LOG_INFO, "removeClientAction path:'%s' sender:'%s'", qPrintable(path.path()), qPrintable(sender));
+    log(LOG_INFO, "getActionContext id:%llu", id);
+
+    result.clear();
 
     QMutexLocker lock(&mDataMutex);
 
-    IdByClientPath::iterator idByNativeClient = mIdByClientPath.find(path);
-    if (idByNativeClient == mIdByClientPath.end())
+    ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
     {
-        log(LOG_WARNING, "No action registered for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
-        result = false;
+        log(LOG_WARNING, "No action registered with id #%llu", id);
         return;
     }
 
-    SenderByClientPath::Iterator senderByClientPath = mSenderByClientPath.find(path);
-    if (senderByClientPath == mSenderByClientPath.end())
-    {
-        log(LOG_WARNING, "No action activated for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
-        result = false;
-        return;
-    }
+    result = shortcutAndActionById.value().second->context();
+}
 
-    if (senderByClientPath.value() != sender)
+void Core::setMethodActionAllowActivation(bool &result, const qulonglong &id, bool allow)
+{
+    log(LOG_INFO, "setMethodActionAllowActivation id:%llu allow:%s", id, allow ? "true" : "false");
+
+    QMutexLocker lock(&mDataMutex);
+
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
     {
-        log(LOG_WARNING, "Sender mismatch: caller: %s owner: %s", qPrintable(senderByClientPath.value()), qPrintable(sender));
+        log(LOG_WARNING, "No action registered with id #%llu", id);
         result = false;
         return;
     }
 
-    qulonglong id = idByNativeClient.value();
-
-    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
-    QString shortcut = shortcutAndActionById.value().first;
-
-    X11Shortcut X11shortcut = mX11ByShortcut[shortcut];
-
-    delete shortcutAndActionById.value().second;
-    mShortcutAndActionById.erase(shortcutAndActionById);
-    mIdByClientPath.remove(path);
+    BaseAction *action = shortcutAndActionById.value().second;
 
-    IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(shortcut);
-    if (idsByShortcut != mIdsByShortcut.end())
+    if (strcmp(action->type(), MethodAction::id()))
     {
-        idsByShortcut.value().remove(id);
-        if (idsByShortcut.value().isEmpty())
-        {
-            mIdsByShortcut.erase(idsByShortcut);
-
-            if (!remoteXUngrabKey(X11shortcut))
-            {
-                log(LOG_WARNING, "Cannot ungrab shortcut '%s'", qPrintable(shortcut));
-            }
-        }
+        log(LOG_WARNING, "setMethodActionAllowActivation attempts to modify action of type '%s'", action->type());
+        result = false;
+        return;
     }
 
-    mSenderByClientPath.remove(path);
-
-    mClientPathsBySender[sender].remove(path);
-    if (mClientPathsBySender[sender].isEmpty())
-        mClientPathsBySender.remove(sender);
+    dynamic_cast<MethodAction *>(action)->setAllowActivation(allow);
 
     saveConfig();
 
-    result = true;
+    actionChanged(ACTION_CHANGE_MODIFIED, id);
 
-    mDaemonAdaptor->emit_actionRemoved(id);
+    result = true;
 }
 
-void Core::removeAction(bool &result, const qulonglong &id)
+void Core::getMethodActionAllowActivation(QPair<bool, bool> &result, const qulonglong &id) const
 {
-    log(LOG_INFO, "removeAction id:%llu", id);
+    log(LOG_INFO, "getMethodActionAllowActivation id:%llu", id);
+
+    result = qMakePair(false, false);
 
     QMutexLocker lock(&mDataMutex);
 
-    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.find(id);
     if (shortcutAndActionById == mShortcutAndActionById.end())
     {
         log(LOG_WARNING, "No action registered with id #%llu", id);
-        result = false;
         return;
     }
 
-    BaseAction *action = shortcutAndActionById.value().second;
-
-    bool isClientAction = !strcmp(action->type(), ClientAction::id());
+    const BaseAction *action = shortcutAndActionById.value().second;
 
-    if (isClientAction)
+    if (strcmp(action->type(), MethodAction::id()))
     {
-        ClientAction *clientAction = dynamic_cast<ClientAction*>(action);
-        if (clientAction->isPresent())
-        {
-            log(LOG_WARNING, "Cannot remove active client action by id");
-            result = false;
-            return;
-        }
-        else
-        {
-            const QDBusObjectPath &path = clientAction->path();
+        log(LOG_WARNING, "getMethodActionAllowActivation attempts to query action of type '%s'", action->type());
+        return;
+    }
 
-            SenderByClientPath::Iterator senderByClientPath = mSenderByClientPath.find(path);
-            if (senderByClientPath != mSenderByClientPath.end())
-            {
-                log(LOG_WARNING, "Action is currently registered for '%s'", qPrintable(path.path()));
-                result = false;
-                return;
-            }
-        }
+    result = qMakePair(true, dynamic_cast<const MethodAction *>(action)->allowActivation());
+}
+
+void Core::setCommandActionLaunchPolicy(bool &result, const qulonglong &id, const QString &policy)
+{
+    log(LOG_INFO, "setCommandActionLaunchPolicy id:%llu policy:'%s'", id, qPrintable(policy));
+
+    CommandAction::LaunchPolicy launchPolicy;
+    if (!CommandAction::launchPolicyFromName(policy, launchPolicy))
+    {
+        log(LOG_WARNING, "Unknown launch policy '%s'", qPrintable(policy));
+        result = false;
+        return;
     }
 
-    QString shortcut = shortcutAndActionById.value().first;
+    QMutexLocker lock(&mDataMutex);
 
-    X11Shortcut X11shortcut = mX11ByShortcut[shortcut];
+    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
+    {
+        log(LOG_WARNING, "No action registered with id #%llu", id);
+        result = false;
+        return;
+    }
 
-    delete action;
-    mShortcutAndActionById.erase(shortcutAndActionById);
+    BaseAction *action = shortcutAndActionById.value().second;
 
-    IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(shortcut);
-    if (idsByShortcut != mIdsByShortcut.end())
+    if (strcmp(action->type(), CommandAction::id()))
     {
-        idsByShortcut.value().remove(id);
-        if (idsByShortcut.value().isEmpty())
-        {
-            mIdsByShortcut.erase(idsByShortcut);
-
-            if (!remoteXUngrabKey(X11shortcut))
-            {
-                log(LOG_WARNING, "Cannot ungrab shortcut '%s'", qPrintable(shortcut));
-            }
-        }
+        log(LOG_WARNING, "setCommandActionLaunchPolicy attempts to modify action of type '%s'", action->type());
+        result = false;
+        return;
     }
 
+    dynamic_cast<CommandAction *>(action)->setLaunchPolicy(launchPolicy);
+
     saveConfig();
 
+    actionChanged(ACTION_CHANGE_MODIFIED, id);
+
     result = true;
 }
 
-void Core::deactivateClientAction(bool &result, const QDBusObjectPath &path, const QString &sender)
+void Core::getCommandActionLaunchPolicy(QString &result, const qulonglong &id) const
 {
-    log(LOG_INFO, "deactivateClientAction path:'%s' sender:'%s'", qPrintable(path.path()), qPrintable(sender));
+    log(LOG_INFO, "getCommandActionLaunchPolicy id:%llu", id);
+
+    result.clear();
 
     QMutexLocker lock(&mDataMutex);
 
-    IdByClientPath::iterator idByNativeClient = mIdByClientPath.find(path);
-    if (idByNativeClient == mIdByClientPath.end())
+    ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
     {
-        log(LOG_WARNING, "No action registered for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
-        result = false;
+        log(LOG_WARNING, "No action registered with id #%llu", id);
         return;
     }
 
-    SenderByClientPath::Iterator senderByClientPath = mSenderByClientPath.find(path);
-    if (senderByClientPath == mSenderByClientPath.end())
-    {
-        log(LOG_WARNING, "No action activated for '%s' (sender: %s)", qPrintable(path.path()), qPrintable(sender));
-        result = false;
-        return;
-    }
+    const BaseAction *action = shortcutAndActionById.value().second;
 
-    if (senderByClientPath.value() != sender)
+    if (strcmp(action->type(), CommandAction::id()))
     {
-        log(LOG_WARNING, "Sender mismatch: caller: %s owner: %s", qPrintable(senderByClientPath.value()), qPrintable(sender));
-        result = false;
+        log(LOG_WARNING, "getCommandActionLaunchPolicy attempts to query action of type '%s'", action->type());
         return;
     }
 
-    qulonglong id = idByNativeClient.value();
+    result = CommandAction::launchPolicyName(dynamic_cast<const CommandAction *>(action)->launchPolicy());
+}
 
-    ShortcutAndActionById::iterator shortcutAndActionById = mShortcutAndActionById.find(id);
-    QString shortcut = shortcutAndActionById.value().first;
+void Core::getRunningProcesses(QMap<qulonglong, uint> &result) const
+{
+    QMutexLocker lock(&mDataMutex);
 
-    dynamic_cast<ClientAction*>(shortcutAndActionById.value().second)->disappeared();
+    result.clear();
 
-    IdsByShortcut::iterator idsByShortcut = mIdsByShortcut.find(shortcut);
-    if (idsByShortcut != mIdsByShortcut.end())
+    ShortcutAndActionById::const_iterator lastShortcutAndActionById = mShortcutAndActionById.end();
+    for (ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.begin(); shortcutAndActionById != lastShortcutAndActionById; ++shortcutAndActionById)
     {
-        idsByShortcut.value().remove(id);
-        if (idsByShortcut.value().isEmpty())
+        const BaseAction *action = shortcutAndActionById.value().second;
+        if (!strcmp(action->type(), CommandAction::id()))
         {
-            mIdsByShortcut.erase(idsByShortcut);
-
-            if (!remoteXUngrabKey(mX11ByShortcut[shortcut]))
+            int running = dynamic_cast<const CommandAction *>(action)->running();
+            if (running > 0)
             {
-                log(LOG_WARNING, "Cannot ungrab shortcut '%s'", qPrintable(shortcut));
+                result[shortcutAndActionById.key()] = running;
             }
         }
     }
-
-    mSenderByClientPath.remove(path);
-
-    mClientPathsBySender[sender].remove(path);
-    if (mClientPathsBySender[sender].isEmpty())
-        mClientPathsBySender.remove(sender);
-
-    result = true;
-
-    mDaemonAdaptor->emit_clientActionSenderChanged(id, QString());
 }
 
-void Core::setMultipleActionsBehaviour(const MultipleActionsBehaviour &behaviour)
+void Core::getCommandActionsUsage(QMap<qulonglong, CommandActionUsage> &result) const
 {
     QMutexLocker lock(&mDataMutex);
 
-    mMultipleActionsBehaviour = behaviour;
+    result.clear();
 
-    saveConfig();
+    ShortcutAndActionById::const_iterator lastShortcutAndActionById = mShortcutAndActionById.end();
+    for (ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.begin(); shortcutAndActionById != lastShortcutAndActionById; ++shortcutAndActionById)
+    {
+        const BaseAction *action = shortcutAndActionById.value().second;
+        if (!strcmp(action->type(), CommandAction::id()))
+        {
+            result[shortcutAndActionById.key()] = dynamic_cast<const CommandAction *>(action)->usage();
+        }
+    }
 }
 
-void Core::getMultipleActionsBehaviour(MultipleActionsBehaviour &result) const
+void Core::getCommandActionUsage(QPair<bool, CommandActionUsage> &result, const qulonglong &id) const
 {
+    result = qMakePair(false, CommandActionUsage());
+
     QMutexLocker lock(&mDataMutex);
 
-    result = mMultipleActionsBehaviour;
+    ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.find(id);
+    if (shortcutAndActionById == mShortcutAndActionById.end())
+    {
+        log(LOG_WARNING, "No action registered with id #%llu", id);
+        return;
+    }
+
+    const BaseAction *action = shortcutAndActionById.value().second;
+
+    if (strcmp(action->type(), CommandAction::id()))
+    {
+        log(LOG_WARNING, "getCommandActionUsage attempts to query action of type '%s'", action->type());
+        return;
+    }
+
+    result = qMakePair(true, dynamic_cast<const CommandAction *>(action)->usage());
 }
 
 void Core::getAllActionIds(QList<qulonglong> &result) const
@@ -2944,6 +3570,144 @@ GeneralActionInfo Core::actionInfo(const ShortcutAndAction &shortcutAndAction) c
     return result;
 }
 
+void Core::actionChanged(ActionChangeKind kind, qulonglong id)
+{
+    if (!mDaemonAdaptor || !id)
+    {
+        return;
+    }
+
+    PendingActionChanges::iterator pendingActionChange = mPendingActionChanges.find(id);
+    if (pendingActionChange == mPendingActionChanges.end())
+    {
+        mPendingActionChanges.insert(id, kind);
+    }
+    else if (kind == ACTION_CHANGE_REMOVED)
+    {
+        pendingActionChange.value() = kind;
+    }
+
+    if (!mActionChangesFlushQueued)
+    {
+        mActionChangesFlushQueued = true;
+        QMetaObject::invokeMethod(this, "flushActionChanges", Qt::QueuedConnection);
+    }
+}
+
+void Core::flushActionChanges()
+{
+    TRACE_SPAN("core", "flush action changes");
+
+    QList_ActionChange changes;
+
+    {
+        QMutexLocker lock(&mDataMutex);
+
+        mActionChangesFlushQueued = false;
+
+        PendingActionChanges::const_iterator lastPendingActionChange = mPendingActionChanges.constEnd();
+        for (PendingActionChanges::const_iterator pendingActionChange = mPendingActionChanges.constBegin(); pendingActionChange != lastPendingActionChange; ++pendingActionChange)
+        {
+            ActionChange change;
+            change.id = pendingActionChange.key();
+            change.generation = ++mActionsGeneration;
+
+            ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.find(change.id);
+            if (shortcutAndActionById == mShortcutAndActionById.end())
+            {
+                change.kind = ACTION_CHANGE_REMOVED;
+                changes.push_back(change);
+                continue;
+            }
+
+            change.kind = pendingActionChange.value();
+            change.general = actionInfo(shortcutAndActionById.value());
+
+            const BaseAction *action = shortcutAndActionById.value().second;
+
+            if (!strcmp(action->type(), ClientAction::id()))
+            {
+                const ClientAction *clientAction = dynamic_cast<const ClientAction *>(action);
+                change.path = clientAction->path();
+                change.sender = mSenderByClientPath.value(change.path);
+            }
+            else if (!strcmp(action->type(), MethodAction::id()))
+            {
+                const MethodAction *methodAction = dynamic_cast<const MethodAction *>(action);
+                change.service = methodAction->service();
+                change.path = methodAction->path();
+                change.interface = methodAction->interface();
+                change.method = methodAction->method();
+            }
+            else if (!strcmp(action->type(), CommandAction::id()))
+            {
+                const CommandAction *commandAction = dynamic_cast<const CommandAction *>(action);
+                change.command = commandAction->command();
+                change.arguments = commandAction->args();
+            }
+
+            changes.push_back(change);
+        }
+        mPendingActionChanges.clear();
+
+        mActionChangeJournal.append(changes);
+        while (mActionChangeJournal.size() > actionChangeJournalSize)
+        {
+            mActionChangeJournal.removeFirst();
+        }
+
+        // strings of removed or modified actions may have lost their last user
+        StringPool::purge();
+    }
+
+    if (!changes.isEmpty())
+    {
+        mDaemonAdaptor->emit_actionsChanged(changes.last().generation, changes);
+    }
+}
+
+void Core::getActionsGeneration(qulonglong &result) const
+{
+    QMutexLocker lock(&mDataMutex);
+
+    result = mActionsGeneration;
+}
+
+void Core::getChangesSince(QPair<bool, QList_ActionChange> &result, const qulonglong &generation) const
+{
+    log(LOG_INFO, "getChangesSince generation:%llu", generation);
+
+    QMutexLocker lock(&mDataMutex);
+
+    result = qMakePair(true, QList_ActionChange());
+
+    if (generation == mActionsGeneration)
+    {
+        return;
+    }
+
+    // older than the journal, or from another daemon instance
+    qulonglong oldestKnown = mActionChangeJournal.isEmpty() ? mActionsGeneration : mActionChangeJournal.first().generation - 1;
+    if ((generation < oldestKnown) || (generation > mActionsGeneration))
+    {
+        log(LOG_INFO, "getChangesSince generation %llu is out of journal (%llu..%llu)", generation, oldestKnown, mActionsGeneration);
+        result.first = false;
+        return;
+    }
+
+    // each record holds the whole action, so only the latest one per id matters
+    QSet<qulonglong> seenIds;
+    for (int i = mActionChangeJournal.size() - 1; (i >= 0) && (mActionChangeJournal[i].generation > generation); --i)
+    {
+        const ActionChange &change = mActionChangeJournal[i];
+        if (!seenIds.contains(change.id))
+        {
+            seenIds.insert(change.id);
+            result.second.prepend(change);
+        }
+    }
+}
+
 void Core::getActionById(QPair<bool, GeneralActionInfo> &result, const qulonglong &id) const
 {
     log(LOG_INFO, "getActionById id:%llu", id);
@@ -3083,6 +3847,78 @@ void Core::getCommandActionInfoById(QPair<bool, CommandActionInfo> &result, cons
     result = qMakePair(true, info);
 }
 
+void Core::isReady(bool &result) const
+{
+    result = mReady;
+}
+
+void Core::getMemoryUsage(QMap<QString, qulonglong> &result) const
+{
+    QMutexLocker lock(&mDataMutex);
+
+    result.clear();
+
+    qulonglong actions = 0;
+    qulonglong actionStrings = 0;
+
+    ShortcutAndActionById::const_iterator lastShortcutAndActionById = mShortcutAndActionById.end();
+    for (ShortcutAndActionById::const_iterator shortcutAndActionById = mShortcutAndActionById.begin(); shortcutAndActionById != lastShortcutAndActionById; ++shortcutAndActionById)
+    {
+        const BaseAction *action = shortcutAndActionById.value().second;
+
+        // what the strings would take if every action kept its own copy
+        actionStrings += StringPool::bytes(action->description()) + StringPool::bytes(action->profiles()) + StringPool::bytes(action->context());
+
+        if (!strcmp(action->type(), ClientAction::id()))
+        {
+            const ClientAction *clientAction = dynamic_cast<const ClientAction *>(action);
+            actions += sizeof(ClientAction);
+            actionStrings += StringPool::bytes(clientAction->path().path());
+        }
+        else if (!strcmp(action->type(), MethodAction::id()))
+        {
+            const MethodAction *methodAction = dynamic_cast<const MethodAction *>(action);
+            actions += sizeof(MethodAction);
+            actionStrings += StringPool::bytes(methodAction->service()) + StringPool::bytes(methodAction->path().path()) + StringPool::bytes(methodAction->interface()) + StringPool::bytes(methodAction->method());
+        }
+        else if (!strcmp(action->type(), CommandAction::id()))
+        {
+            const CommandAction *commandAction = dynamic_cast<const CommandAction *>(action);
+            actions += sizeof(CommandAction);
+            actionStrings += StringPool::bytes(commandAction->command()) + StringPool::bytes(commandAction->args());
+        }
+    }
+
+    // node payloads only, the allocator overhead is not counted
+    qulonglong tables = 0;
+    tables += mShortcutAndActionById.size() * (sizeof(qulonglong) + sizeof(ShortcutAndAction));
+    tables += mIdByClientPath.size() * (sizeof(ClientPath) + sizeof(qulonglong));
+    tables += mSenderByClientPath.size() * (sizeof(ClientPath) + sizeof(QString));
+    foreach(const X11Connection *connection, mX11Connections)
+    {
+        X11ByShortcut::const_iterator lastX11ByShortcut = connection->mX11ByShortcut.constEnd();
+        for (X11ByShortcut::const_iterator x11ByShortcut = connection->mX11ByShortcut.constBegin(); x11ByShortcut != lastX11ByShortcut; ++x11ByShortcut)
+        {
+            tables += sizeof(QString) + sizeof(X11Shortcuts) + x11ByShortcut.value().size() * sizeof(X11Shortcut);
+        }
+        tables += connection->mShortcutsByX11.size() * (sizeof(X11Shortcut) + sizeof(QStringList));
+        tables += connection->mGrabs.size() * (sizeof(X11Shortcut) + sizeof(bool));
+        tables += connection->mPendingGrabs.size() * (sizeof(X11Shortcut) + sizeof(qulonglong));
+    }
+    tables += mShortcutByKeySym.size() * (sizeof(KeySymShortcut) + sizeof(QString));
+    IdsByShortcut::const_iterator lastIdsByShortcut = mIdsByShortcut.end();
+    for (IdsByShortcut::const_iterator idsByShortcut = mIdsByShortcut.begin(); idsByShortcut != lastIdsByShortcut; ++idsByShortcut)
+    {
+        tables += sizeof(QString) + sizeof(Ids) + idsByShortcut.value().size() * 2 * sizeof(qulonglong);
+    }
+
+    result["actions"] = actions;
+    result["action_strings"] = actionStrings;
+    result["string_pool"] = StringPool::bytes();
+    result["tables"] = tables;
+    result["change_journal"] = mActionChangeJournal.size() * sizeof(ActionChange);
+}
+
 void Core::grabShortcut(const uint &timeout, QString &/*shortcut*/, bool &failed, bool &cancelled, bool &timedout, const QDBusMessage &message)
 {
     log(LOG_INFO, "grabShortcut timeout:%u", timeout);
@@ -3093,7 +3929,8 @@ void Core::grabShortcut(const uint &timeout, QString &/*shortcut*/, bool &failed
 
     QMutexLocker lock(&mDataMutex);
 
-    if (mGrabbingShortcut)
+    // the X11 thread only knows once it got to the request
+    if (mShortcutGrabRequested || primaryConnection()->mGrabbingShortcut)
     {
         failed = true;
         log(LOG_DEBUG, "grabShortcut failed: already grabbing");
@@ -3107,23 +3944,9 @@ void Core::grabShortcut(const uint &timeout, QString &/*shortcut*/, bool &failed
         return;
     }
 
-    size_t X11Operation = X11_OP_XGrabKeyboard;
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11Operation, sizeof(X11Operation)))
-    {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return;
-    }
-    wakeX11Thread();
-
-    int x11result;
-    if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &x11result, sizeof(x11result)))
-    {
-        log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-        qApp->quit();
-        return;
-    }
-    if (x11result)
+    // the keyboard of the first display is the one that gets recorded;
+    // a refused grab is answered through shortcutGrabbed like a recorded shortcut
+    if (!primaryConnection()->remoteXGrabKeyboard())
     {
         failed = true;
         log(LOG_DEBUG, "grabShortcut failed: grab failed");
@@ -3152,45 +3975,24 @@ void Core::shortcutGrabbed()
 
     QMutexLocker lock(&mDataMutex);
 
-    mShortcutGrabTimeout->stop();
-
-    if (!mShortcutGrabRequested)
+    // every onShortcutGrabbed comes with its answer in the pipe, even for a call given up since
+    if (!primaryConnection()->readGrabbedShortcut(failed, cancelled, shortcut))
     {
         return;
     }
 
-    if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &cancelled, sizeof(cancelled)))
+    if (!mShortcutGrabRequested)
     {
-        log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-        qApp->quit();
         return;
     }
-    if (!cancelled)
-    {
-        size_t length;
-        if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &length, sizeof(length)))
-        {
-            log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-            qApp->quit();
-            return;
-        }
-        if (length)
-        {
-            char *str = new char[length + 1];
-            str[length] = '\0';
-            if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], str, length))
-            {
-                log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-                qApp->quit();
-                return;
-            }
-            shortcut = str;
 
-            delete[] str;
-        }
-    }
+    mShortcutGrabTimeout->stop();
 
-    if (cancelled)
+    if (failed)
+    {
+        log(LOG_DEBUG, "grabShortcut failed: grab failed");
+    }
+    else if (cancelled)
     {
         log(LOG_DEBUG, "grabShortcut: cancelled");
     }
@@ -3220,22 +4022,7 @@ void Core::shortcutGrabTimedout()
         return;
     }
 
-    size_t X11Operation = X11_OP_XUngrabKeyboard;
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11Operation, sizeof(X11Operation)))
-    {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return;
-    }
-    wakeX11Thread();
-    char signal;
-    if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &signal, sizeof(signal)))
-    {
-        log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-        qApp->quit();
-        return;
-    }
-    if (signal)
+    if (!primaryConnection()->remoteXUngrabKeyboard())
     {
         failed = true;
     }
@@ -3258,7 +4045,7 @@ void Core::cancelShortcutGrab()
 
     QMutexLocker lock(&mDataMutex);
 
-    if (!mGrabbingShortcut)
+    if (!mShortcutGrabRequested)
     {
         log(LOG_DEBUG, "cancelShortcutGrab failed: not grabbing");
         return;
@@ -3266,27 +4053,7 @@ void Core::cancelShortcutGrab()
 
     mShortcutGrabTimeout->stop();
 
-    if (!mShortcutGrabRequested)
-    {
-        return;
-    }
-
-    size_t X11Operation = X11_OP_XUngrabKeyboard;
-    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11Operation, sizeof(X11Operation)))
-    {
-        log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
-        qApp->quit();
-        return;
-    }
-    wakeX11Thread();
-    char signal;
-    if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &signal, sizeof(signal)))
-    {
-        log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
-        qApp->quit();
-        return;
-    }
-    if (signal)
+    if (!primaryConnection()->remoteXUngrabKeyboard())
     {
         failed = true;
     }
@@ -3297,3 +4064,22 @@ void Core::cancelShortcutGrab()
     QDBusConnection::sessionBus().send(mShortcutGrabRequest);
     mShortcutGrabRequested = false;
 }
+
+void Core::dumpMetrics()
+{
+    // write aside and rename, so a scraper never reads a half-written file
+    QString temporaryFile = mMetricsFile + ".tmp";
+    QFile file(temporaryFile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        log(LOG_WARNING, "Cannot write metrics to '%s': %s", qPrintable(temporaryFile), qPrintable(file.errorString()));
+        return;
+    }
+    file.write(mMetrics.text().toUtf8());
+    file.close();
+
+    if (rename(QFile::encodeName(temporaryFile).constData(), QFile::encodeName(mMetricsFile).constData()) < 0)
+    {
+        log(LOG_WARNING, "Cannot write metrics to '%s': %s", qPrintable(mMetricsFile), strerror(errno));
+    }
+}
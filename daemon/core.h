@@ -29,10 +29,12 @@
 #define GLOBAL_ACTION_DAEMON__CORE__INCLUDED
 
 
-#include <QThread>
+#include <QObject>
 #include <QMap>
 #include <QSet>
 #include <QString>
+#include <QStringList>
+#include <QByteArray>
 #include <QQueue>
 #include <QMutex>
 #include <QList>
@@ -43,21 +45,35 @@
 
 #include "meta_types.h"
 #include "log_target.h"
+#include "metrics.h"
+#include "action_executor.h"
+#include "x11_connection.h"
 
 extern "C" {
 #include <X11/X.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xproto.h>
+#include <X11/Xatom.h>
+#include <X11/XKBlib.h>
 #undef Bool
 }
 
 
 class QTimer;
+class QSettings;
+class QFileSystemWatcher;
+class ConfigSaver;
+class ActionChain;
+class NameOwnerCache;
+class ExecutableResolver;
+class ProcessTracker;
 class DaemonAdaptor;
 class NativeAdaptor;
+class MetricsAdaptor;
 class DBusProxy;
 class BaseAction;
+class ClientProxy;
 
 template<class Key>
 class QOrderedSet : public QMap<Key, Key>
@@ -69,28 +85,35 @@ public:
     }
 };
 
-class Core : public QThread, public LogTarget
+class Core : public QObject, public LogTarget
 {
     Q_OBJECT
 public:
-    Core(bool useSyslog, bool minLogLevelSet, int minLogLevel, const QStringList &configFiles, bool multipleActionsBehaviourSet, MultipleActionsBehaviour multipleActionsBehaviour, QObject *parent = 0);
+    Core(bool useSyslog, bool minLogLevelSet, int minLogLevel, bool multipleActionsBehaviourSet, MultipleActionsBehaviour multipleActionsBehaviour, const QString &metricsFile, QObject *parent = 0);
     ~Core();
 
+    // connects to the displays, loads the config and registers on D-Bus; no display names: $DISPLAY
+    bool start(const QStringList &configFiles, const QStringList &displayNames, uint metricsInterval);
+
     bool ready() const { return mReady; }
 
     virtual void log(int level, const char *format, ...) const;
 
 signals:
     void onShortcutGrabbed();
+    void onGrabsSwitched();
 
 private:
     Core(const Core &);
     Core &operator = (const Core &);
 
 private:
-    typedef QPair<KeyCode, unsigned int> X11Shortcut;
-    typedef QMap<X11Shortcut, QString> ShortcutByX11;
-    typedef QMap<QString, X11Shortcut> X11ByShortcut;
+    typedef X11Connection::X11Shortcut X11Shortcut;
+    typedef X11Connection::X11Shortcuts X11Shortcuts;
+    typedef X11Connection::X11ByShortcut X11ByShortcut;
+    typedef X11Connection::ShortcutsByX11 ShortcutsByX11;
+    typedef QPair<KeySym, unsigned int> KeySymShortcut; // the name of the key and the modifiers
+    typedef QMap<KeySymShortcut, QString> ShortcutByKeySym;
     typedef QOrderedSet<qulonglong> Ids;
     typedef QMap<QString, Ids> IdsByShortcut;
     typedef QDBusObjectPath ClientPath;
@@ -100,14 +123,73 @@ private:
     typedef QMap<ClientPath, QString> SenderByClientPath;
     typedef QSet<ClientPath> ClientPaths;
     typedef QMap<QString, ClientPaths> ClientPathsBySender;
+    typedef QMap<QString, ClientProxy *> ClientProxyBySender;
+    typedef QMap<qulonglong, ActionChangeKind> PendingActionChanges;
+
+    typedef enum KeyGrab
+    {
+        KEY_GRABBED = 0,
+        KEY_NOT_GRABBED,
+        KEY_GRAB_PENDING
+    } KeyGrab;
+
+    typedef enum GrabReplyKind
+    {
+        GRAB_REPLY_ADD_ACTION = 0,
+        GRAB_REPLY_ADD_CLIENT_ACTION,
+        GRAB_REPLY_REGISTER_CLIENT_ACTION,
+        GRAB_REPLY_CHANGE_SHORTCUT
+    } GrabReplyKind;
+
+    // a D-Bus call answered once every display answered the grabs of its shortcut
+    typedef struct GrabReply
+    {
+        GrabReplyKind kind;
+        QDBusMessage reply;
+        qulonglong id;
+        QString shortcut;
+        QString oldShortcut;
+    } GrabReply;
+    typedef QList<GrabReply> GrabReplies;
+
+    // one binding as stored in the config file
+    struct ConfigEntry
+    {
+        enum Type
+        {
+            CLIENT,
+            METHOD,
+            COMMAND
+        };
+
+        qulonglong id; // from the section name, 0 if there is none
+        QString shortcut;
+        bool enabled;
+        QString description;
+        QStringList exec;
+        QString service;
+        QString path;
+        QString interface;
+        QString method;
+        bool allowActivation; // method actions only
+        QString launchPolicy; // command actions only
+        QStringList profiles;
+        QString context;
+
+        Type type() const { return !exec.isEmpty() ? COMMAND : (!service.isEmpty() ? METHOD : CLIENT); }
+        // client actions are identified by their path, everything else can be modified in place
+        bool sameAction(const ConfigEntry &other) const { return (type() == other.type()) && ((type() != CLIENT) || (path == other.path)); }
+    };
+    typedef QList<ConfigEntry> ConfigEntries;
+    typedef QMap<qulonglong, ConfigEntry> ConfigEntryById;
 
 private slots:
     void serviceOwnerChanged(const QString &name, const QString &oldOwner, const QString &newOwner);
     void serviceDisappeared(const QString &sender);
 
-    void addClientAction(QPair<QString, qulonglong> &result, const QString &shortcut, const QDBusObjectPath &path, const QString &description, const QString &sender);
-    void addMethodAction(QPair<QString, qulonglong> &result, const QString &shortcut, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description);
-    void addCommandAction(QPair<QString, qulonglong> &result, const QString &shortcut, const QString &command, const QStringList &arguments, const QString &description);
+    void addClientAction(QPair<QString, qulonglong> &result, const QString &shortcut, const QDBusObjectPath &path, const QString &description, const QString &sender, const QDBusMessage &message);
+    void addMethodAction(QPair<QString, qulonglong> &result, const QString &shortcut, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description, const QDBusMessage &message);
+    void addCommandAction(QPair<QString, qulonglong> &result, const QString &shortcut, const QString &command, const QStringList &arguments, const QString &description, const QDBusMessage &message);
 
     void modifyClientAction(qulonglong &result, const QDBusObjectPath &path, const QString &description, const QString &sender);
     void modifyActionDescription(bool &result, const qulonglong &id, const QString &description);
@@ -122,8 +204,8 @@ private slots:
     void getClientActionSender(QString &sender, qulonglong id);
 
 
-    void changeClientActionShortcut(QPair<QString, qulonglong> &result, const QDBusObjectPath &path, const QString &shortcut, const QString &sender);
-    void changeShortcut(QString &result, const qulonglong &id, const QString &shortcut);
+    void changeClientActionShortcut(QPair<QString, qulonglong> &result, const QDBusObjectPath &path, const QString &shortcut, const QString &sender, const QDBusMessage &message);
+    void changeShortcut(QString &result, const qulonglong &id, const QString &shortcut, const QDBusMessage &message);
 
     void swapActions(bool &result, const qulonglong &id1, const qulonglong &id2);
 
@@ -135,6 +217,27 @@ private slots:
     void setMultipleActionsBehaviour(const MultipleActionsBehaviour &behaviour);
     void getMultipleActionsBehaviour(MultipleActionsBehaviour &result) const;
 
+    void setActiveProfile(bool &result, const QString &profile);
+    void getActiveProfile(QString &result) const;
+    void getProfiles(QStringList &result) const;
+    void setActionProfiles(bool &result, const qulonglong &id, const QStringList &profiles);
+    void getActionProfiles(QStringList &result, const qulonglong &id) const;
+
+    void setActionContext(bool &result, const qulonglong &id, const QString &context);
+    void getActionContext(QString &result, const qulonglong &id) const;
+
+    void setMethodActionAllowActivation(bool &result, const qulonglong &id, bool allow);
+    void getMethodActionAllowActivation(QPair<bool, bool> &result, const qulonglong &id) const;
+
+    void setCommandActionLaunchPolicy(bool &result, const qulonglong &id, const QString &policy);
+    void getCommandActionLaunchPolicy(QString &result, const qulonglong &id) const;
+    void getRunningProcesses(QMap<qulonglong, uint> &result) const;
+    void getCommandActionsUsage(QMap<qulonglong, CommandActionUsage> &result) const;
+    void getCommandActionUsage(QPair<bool, CommandActionUsage> &result, const qulonglong &id) const;
+
+    void getActionsGeneration(qulonglong &result) const;
+    void getChangesSince(QPair<bool, QList_ActionChange> &result, const qulonglong &generation) const;
+
     void getAllActionIds(QList<qulonglong> &result) const;
     void getActionById(QPair<bool, GeneralActionInfo> &result, const qulonglong &id) const;
     void getAllActions(QMap<qulonglong, GeneralActionInfo> &result) const;
@@ -143,85 +246,142 @@ private slots:
     void getMethodActionInfoById(QPair<bool, MethodActionInfo> &result, const qulonglong &id) const;
     void getCommandActionInfoById(QPair<bool, CommandActionInfo> &result, const qulonglong &id) const;
 
+    void getMemoryUsage(QMap<QString, qulonglong> &result) const;
+
+    void isReady(bool &result) const;
+
     void grabShortcut(const uint &timeout, QString &shortcut, bool &failed, bool &cancelled, bool &timedout, const QDBusMessage &message);
     void cancelShortcutGrab();
 
+    void openActivationChannel(QPair<int, int> &result, const QString &sender);
+    void activationChannelAccepted(const QString &sender);
+
     void shortcutGrabbed();
     void shortcutGrabTimedout();
 
+    void grabsSwitched();
+
+    void flushActionChanges();
+
+    void configFileChanged();
+    void reloadConfig();
+
+    void dumpMetrics();
+    void writeTrace();
+
 private:
-    QPair<QString, qulonglong> addOrRegisterClientAction(const QString &shortcut, const QDBusObjectPath &path, const QString &description, const QString &sender);
+    QPair<QString, qulonglong> addOrRegisterClientAction(const QString &shortcut, const QDBusObjectPath &path, const QString &description, const QString &sender, KeyGrab &keyGrab);
     qulonglong registerClientAction(const QString &shortcut, const QDBusObjectPath &path, const QString &description);
     qulonglong registerMethodAction(const QString &shortcut, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description);
     qulonglong registerCommandAction(const QString &shortcut, const QString &command, const QStringList &arguments, const QString &description);
 
     GeneralActionInfo actionInfo(const ShortcutAndAction &shortcutAndAction) const;
 
+    void actionChanged(ActionChangeKind kind, qulonglong id);
+
+    ClientProxy *clientProxy(const QString &sender);
+
     friend void unixSignalHandler(int signalNumber);
     void unixSignalHandler(int signalNumber);
 
     friend int x11ErrorHandler(Display *display, XErrorEvent *errorEvent);
     int x11ErrorHandler(Display *display, XErrorEvent *errorEvent);
 
-    X11Shortcut ShortcutToX11(const QString &shortcut);
-    QString X11ToShortcut(const X11Shortcut &X11shortcut);
-
-    void wakeX11Thread();
-
-    void run();
-
-    KeyCode remoteStringToKeycode(const QString &str);
-    QString remoteKeycodeToString(KeyCode keyCode);
-    bool remoteXGrabKey(const X11Shortcut &X11shortcut);
-    bool remoteXUngrabKey(const X11Shortcut &X11shortcut);
-
-    QString grabOrReuseKey(const X11Shortcut &X11shortcut, const QString &shortcut);
-
-    QString checkShortcut(const QString &shortcut, X11Shortcut &X11shortcut);
+    friend class X11Connection;
+    friend class CoreBenchmark;
+
+    X11Connection *primaryConnection() const { return mX11Connections.first(); }
+
+    // throw false
+    KeySymShortcut ShortcutToKeySym(X11Connection *connection, const QString &shortcut);
+    QString KeySymToShortcut(const KeySymShortcut &keySymShortcut);
+
+    // after the action got bound to the shortcut; pending until grabsSwitched gets the answers of the displays
+    KeyGrab grabOrReuseKey(const QString &shortcut, bool wanted = true);
+    void unbindShortcut(const QString &shortcut, qulonglong id);
+    // message is answered by grabsSwitched, false if it is no D-Bus call that can wait
+    bool awaitGrab(const QDBusMessage &message, GrabReplyKind kind, qulonglong id, const QString &shortcut, const QString &oldShortcut = QString());
+    void answerGrabReply(const GrabReply &grabReply);
+    // the second halves of the calls, once the grab of the new shortcut is answered
+    QPair<QString, qulonglong> finishAddAction(qulonglong id, const QString &shortcut, bool grabbed);
+    QString finishChangeShortcut(qulonglong id, const QString &oldShortcut, const QString &newShortcut, bool grabbed);
+
+    // X11 thread, mDataMutex held; keySym names the key in the group of the press;
+    // false if nothing is bound to the key at all
+    bool resolveKeyPress(KeySym keySym, unsigned int state, const QString &activeWindowClass, QString &shortcut, ActionExecutor::IdsAndActions &actions) const;
+    // X11 thread, mDataMutex held; runs the actions of a key press according to the behaviour,
+    // eventTime is the X server time of the press
+    void dispatch(const QString &shortcut, qulonglong eventTime, ActionExecutor::IdsAndActions &actions);
+
+    bool isActive(const BaseAction *action) const;
+    bool isShortcutWanted(const QString &shortcut) const;
+    // all its active actions are restricted to a window context, so a press may have to be replayed
+    bool isShortcutContextBound(const QString &shortcut) const;
+    // one of its keys at least is grabbed on one display
+    bool isShortcutGrabbed(const QString &shortcut) const;
+    // one of its keys is still to be answered by a display
+    bool isShortcutGrabPending(const QString &shortcut) const;
+    void updateGrabbedShortcuts(X11Connection *connection, const QSet<QString> &shortcuts, bool answered);
+    void syncGrab(const QString &shortcut);
+    void syncGrabs();
+    void syncGrabs(const QSet<QString> &shortcuts);
+
+    QString checkShortcut(const QString &shortcut);
 
     bool isEscape(KeySym keySym, unsigned int modifiers);
     bool isModifier(KeySym keySym);
     bool isAllowed(KeySym keySym, unsigned int modifiers);
 
-    void saveConfig();
+    static ConfigEntries readConfigEntries(QSettings &settings);
+    // General/AllowGrab*, under mDataMutex once key presses are handled
+    void readAllowGrab(QSettings &settings);
+    qulonglong registerConfigEntry(const ConfigEntry &entry);
+    ConfigEntry configEntry(qulonglong id, const ShortcutAndAction &shortcutAndAction) const;
+    void applyConfigEntry(const ConfigEntry &current, const ConfigEntry &candidate);
+    qulonglong addConfigEntry(const ConfigEntry &entry);
 
-    void lockX11Error();
-    bool checkX11Error(int level = LOG_NOTICE, uint timeout = 10);
+    QByteArray configFileHash() const;
+    void watchConfigFile();
 
-    bool waitForX11Error(int level, uint timeout);
+    void saveConfig();
+
+    void startupPhaseDone(const char *phase, quint64 &phaseStart) const;
 
 private:
     bool mReady;
     bool mUseSyslog;
 
     int mMinLogLevel;
+    bool mMinLogLevelSet; // on the command line, the config file does not override it
 
-    int mX11ErrorPipe[2];
-    int mX11RequestPipe[2];
-    int mX11ResponsePipe[2];
-    Display *mDisplay;
-    Window mInterClientCommunicationWindow;
-    bool mX11EventLoopActive;
-
-    mutable QMutex mX11ErrorMutex;
+    // the first one normalizes shortcuts and serves interactive grabs
+    QList<X11Connection *> mX11Connections;
+    int (*mOldX11ErrorHandler)(Display *display, XErrorEvent *errorEvent);
 
     QDBusConnection *mSessionConnection;
     DaemonAdaptor *mDaemonAdaptor;
     NativeAdaptor *mNativeAdaptor;
+    MetricsAdaptor *mMetricsAdaptor;
 
     mutable QMutex mDataMutex;
 
     qulonglong mLastId;
 
-    bool mGrabbingShortcut;
-
-    X11ByShortcut mX11ByShortcut;
-    ShortcutByX11 mShortcutByX11;
     IdsByShortcut mIdsByShortcut;
+    ShortcutByKeySym mShortcutByKeySym; // the same on every display, never shrinks
     ShortcutAndActionById mShortcutAndActionById;
     IdByClientPath mIdByClientPath;
     SenderByClientPath mSenderByClientPath; // add: path->sender
     ClientPathsBySender mClientPathsBySender; // disappear: sender->[path]
+    ClientProxyBySender mClientProxyBySender; // activate: sender->proxy
+
+    QString mActiveProfile;
+    bool mGrabSyncDeferred; // while loading the config, grabs are synced once at the end
+
+    qulonglong mActionsGeneration;
+    PendingActionChanges mPendingActionChanges; // flushed as one actionsChanged signal
+    QList_ActionChange mActionChangeJournal; // last flushed records, oldest first
+    bool mActionChangesFlushQueued;
 
 
     unsigned int NumLockMask;
@@ -233,6 +393,18 @@ private:
     unsigned int Level5Mask;
 
     MultipleActionsBehaviour mMultipleActionsBehaviour;
+    bool mMultipleActionsBehaviourSet; // on the command line, config file changes do not override it
+
+    // runs the actions of MULTIPLE_ACTIONS_BEHAVIOUR_ALL
+    ActionExecutor *mActionExecutor;
+    QSet<QString> mStrictOrderShortcuts; // their actions run one after another in binding order
+    // falls through the actions of MULTIPLE_ACTIONS_BEHAVIOUR_FIRST/LAST without waiting for replies
+    ActionChain *mActionChain;
+    // services of the method actions, owned by the Core so it outlives them
+    NameOwnerCache *mNameOwners;
+    // executables of the command actions, owned the same way
+    ExecutableResolver *mExecutables;
+    ProcessTracker *mProcesses;
 
     bool mAllowGrabLocks;
     bool mAllowGrabBaseSpecial;
@@ -243,11 +415,21 @@ private:
 
     QString mConfigFile;
     bool mSaveAllowed;
+    ConfigSaver *mConfigSaver;
+    QFileSystemWatcher *mConfigWatcher;
+    QTimer *mConfigReloadTimer;
+    QByteArray mConfigFileHash; // of the file as we last read it
 
     QTimer *mShortcutGrabTimeout;
     QDBusMessage mShortcutGrabRequest;
     bool mShortcutGrabRequested;
 
+    GrabReplies mGrabReplies;
+
+    Metrics mMetrics;
+    QString mMetricsFile;
+    QTimer *mMetricsTimer;
+
     bool mSuppressX11ErrorMessages;
 };
 
@@ -26,21 +26,27 @@
  * END_COMMON_COPYRIGHT_HEADER */
 
 #include "daemon_adaptor.h"
+#include "metrics.h"
+#include "trace.h"
 
 #include "org.lxqt.global_key_shortcuts.daemon.h"
 
 
-DaemonAdaptor::DaemonAdaptor(QObject *parent)
+DaemonAdaptor::DaemonAdaptor(Metrics *metrics, QObject *parent)
     : QObject(parent)
     , QDBusContext()
+    , mMetrics(metrics)
 {
     new OrgLxqtGlobalActionDaemonAdaptor(this);
 }
 
 QString DaemonAdaptor::addMethodAction(const QString &shortcut, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description, qulonglong &id)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QPair<QString, qulonglong> result;
-    emit onAddMethodAction(result, shortcut, service, path, interface, method, description);
+    emit onAddMethodAction(result, shortcut, service, path, interface, method, description, message());
     QString usedShortcut = result.first;
     id = result.second;
     if (id)
@@ -52,8 +58,11 @@ QString DaemonAdaptor::addMethodAction(const QString &shortcut, const QString &s
 
 QString DaemonAdaptor::addCommandAction(const QString &shortcut, const QString &command, const QStringList &arguments, const QString &description, qulonglong &id)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QPair<QString, qulonglong> result;
-    emit onAddCommandAction(result, shortcut, command, arguments, description);
+    emit onAddCommandAction(result, shortcut, command, arguments, description, message());
     QString usedShortcut = result.first;
     id = result.second;
     if (id)
@@ -65,6 +74,9 @@ QString DaemonAdaptor::addCommandAction(const QString &shortcut, const QString &
 
 bool DaemonAdaptor::modifyActionDescription(qulonglong id, const QString &description)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     bool result;
     emit onModifyActionDescription(result, id, description);
     if (result)
@@ -76,6 +88,9 @@ bool DaemonAdaptor::modifyActionDescription(qulonglong id, const QString &descri
 
 bool DaemonAdaptor::modifyMethodAction(qulonglong id, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     bool result;
     emit onModifyMethodAction(result, id, service, path, interface, method, description);
     if (result)
@@ -87,6 +102,9 @@ bool DaemonAdaptor::modifyMethodAction(qulonglong id, const QString &service, co
 
 bool DaemonAdaptor::modifyCommandAction(qulonglong id, const QString &command, const QStringList &arguments, const QString &description)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     bool result;
     emit onModifyCommandAction(result, id, command, arguments, description);
     if (result)
@@ -98,6 +116,9 @@ bool DaemonAdaptor::modifyCommandAction(qulonglong id, const QString &command, c
 
 bool DaemonAdaptor::enableAction(qulonglong id, bool enabled)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     bool result;
     emit onEnableAction(result, id, enabled);
     if (result)
@@ -109,6 +130,9 @@ bool DaemonAdaptor::enableAction(qulonglong id, bool enabled)
 
 bool DaemonAdaptor::isActionEnabled(qulonglong id)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     bool enabled;
     emit onIsActionEnabled(enabled, id);
     return enabled;
@@ -116,6 +140,9 @@ bool DaemonAdaptor::isActionEnabled(qulonglong id)
 
 QString DaemonAdaptor::getClientActionSender(qulonglong id)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QString sender;
     emit onGetClientActionSender(sender, id);
     return sender;
@@ -123,8 +150,11 @@ QString DaemonAdaptor::getClientActionSender(qulonglong id)
 
 QString DaemonAdaptor::changeShortcut(qulonglong id, const QString &shortcut)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QString result;
-    emit onChangeShortcut(result, id, shortcut);
+    emit onChangeShortcut(result, id, shortcut, message());
     if (!result.isEmpty())
     {
         emit actionShortcutChanged(id);
@@ -134,6 +164,9 @@ QString DaemonAdaptor::changeShortcut(qulonglong id, const QString &shortcut)
 
 bool DaemonAdaptor::swapActions(qulonglong id1, qulonglong id2)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     bool result;
     emit onSwapActions(result, id1, id2);
     if (result)
@@ -145,6 +178,9 @@ bool DaemonAdaptor::swapActions(qulonglong id1, qulonglong id2)
 
 bool DaemonAdaptor::removeAction(qulonglong id)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     bool result;
     emit onRemoveAction(result, id);
     if (result)
@@ -156,6 +192,9 @@ bool DaemonAdaptor::removeAction(qulonglong id)
 
 bool DaemonAdaptor::setMultipleActionsBehaviour(uint behaviour)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     if (behaviour >= MULTIPLE_ACTIONS_BEHAVIOUR__COUNT)
     {
         return false;
@@ -167,13 +206,182 @@ bool DaemonAdaptor::setMultipleActionsBehaviour(uint behaviour)
 
 uint DaemonAdaptor::getMultipleActionsBehaviour()
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     MultipleActionsBehaviour result;
     emit onGetMultipleActionsBehaviour(result);
     return result;
 }
 
+bool DaemonAdaptor::setActiveProfile(const QString &profile)
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    bool result;
+    emit onSetActiveProfile(result, profile);
+    return result;
+}
+
+QString DaemonAdaptor::getActiveProfile()
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    QString result;
+    emit onGetActiveProfile(result);
+    return result;
+}
+
+QStringList DaemonAdaptor::getProfiles()
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    QStringList result;
+    emit onGetProfiles(result);
+    return result;
+}
+
+bool DaemonAdaptor::setActionProfiles(qulonglong id, const QStringList &profiles)
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    bool result;
+    emit onSetActionProfiles(result, id, profiles);
+    return result;
+}
+
+QStringList DaemonAdaptor::getActionProfiles(qulonglong id)
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    QStringList result;
+    emit onGetActionProfiles(result, id);
+    return result;
+}
+
+bool DaemonAdaptor::setActionContext(qulonglong id, const QString &context)
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    bool result;
+    emit onSetActionContext(result, id, context);
+    return result;
+}
+
+QString DaemonAdaptor::getActionContext(qulonglong id)
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    QString result;
+    emit onGetActionContext(result, id);
+    return result;
+}
+
+bool DaemonAdaptor::setMethodActionAllowActivation(qulonglong id, bool allow)
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    bool result;
+    emit onSetMethodActionAllowActivation(result, id, allow);
+    return result;
+}
+
+bool DaemonAdaptor::getMethodActionAllowActivation(qulonglong id, bool &allow)
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    QPair<bool, bool> result;
+    emit onGetMethodActionAllowActivation(result, id);
+    allow = result.second;
+    return result.first;
+}
+
+bool DaemonAdaptor::setCommandActionLaunchPolicy(qulonglong id, const QString &policy)
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    bool result;
+    emit onSetCommandActionLaunchPolicy(result, id, policy);
+    return result;
+}
+
+QString DaemonAdaptor::getCommandActionLaunchPolicy(qulonglong id)
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    QString result;
+    emit onGetCommandActionLaunchPolicy(result, id);
+    return result;
+}
+
+QMap<qulonglong, uint> DaemonAdaptor::getRunningProcesses()
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    QMap<qulonglong, uint> result;
+    emit onGetRunningProcesses(result);
+    return result;
+}
+
+QMap<qulonglong, CommandActionUsage> DaemonAdaptor::getCommandActionsUsage()
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    QMap<qulonglong, CommandActionUsage> result;
+    emit onGetCommandActionsUsage(result);
+    return result;
+}
+
+bool DaemonAdaptor::getCommandActionUsage(qulonglong id, CommandActionUsage &usage)
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    QPair<bool, CommandActionUsage> result;
+    emit onGetCommandActionUsage(result, id);
+    usage = result.second;
+    return result.first;
+}
+
+qulonglong DaemonAdaptor::getActionsGeneration()
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    qulonglong result = 0ull;
+    emit onGetActionsGeneration(result);
+    return result;
+}
+
+bool DaemonAdaptor::getChangesSince(qulonglong generation, QList_ActionChange &changes)
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    QPair<bool, QList_ActionChange> result;
+    emit onGetChangesSince(result, generation);
+    changes = result.second;
+    return result.first;
+}
+
 QList<qulonglong> DaemonAdaptor::getAllActionIds()
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QList<qulonglong> result;
     emit onGetAllActionIds(result);
     return result;
@@ -181,6 +389,9 @@ QList<qulonglong> DaemonAdaptor::getAllActionIds()
 
 bool DaemonAdaptor::getActionById(qulonglong id, QString &shortcut, QString &description, bool &enabled, QString &type, QString &info)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QPair<bool, GeneralActionInfo> result;
     emit onGetActionById(result, id);
     bool success = result.first;
@@ -197,6 +408,9 @@ bool DaemonAdaptor::getActionById(qulonglong id, QString &shortcut, QString &des
 
 QMap<qulonglong, GeneralActionInfo> DaemonAdaptor::getAllActions()
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QMap<qulonglong, GeneralActionInfo> result;
     emit onGetAllActions(result);
     return result;
@@ -204,6 +418,9 @@ QMap<qulonglong, GeneralActionInfo> DaemonAdaptor::getAllActions()
 
 bool DaemonAdaptor::getClientActionInfoById(qulonglong id, QString &shortcut, QString &description, bool &enabled, QDBusObjectPath &path)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QPair<bool, ClientActionInfo> result;
     emit onGetClientActionInfoById(result, id);
     bool success = result.first;
@@ -219,6 +436,9 @@ bool DaemonAdaptor::getClientActionInfoById(qulonglong id, QString &shortcut, QS
 
 bool DaemonAdaptor::getMethodActionInfoById(qulonglong id, QString &shortcut, QString &description, bool &enabled, QString &service, QDBusObjectPath &path, QString &interface, QString &method)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QPair<bool, MethodActionInfo> result;
     emit onGetMethodActionInfoById(result, id);
     bool success = result.first;
@@ -237,6 +457,9 @@ bool DaemonAdaptor::getMethodActionInfoById(qulonglong id, QString &shortcut, QS
 
 bool DaemonAdaptor::getCommandActionInfoById(qulonglong id, QString &shortcut, QString &description, bool &enabled, QString &command, QStringList &arguments)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QPair<bool, CommandActionInfo> result;
     emit onGetCommandActionInfoById(result, id);
     bool success = result.first;
@@ -251,8 +474,31 @@ bool DaemonAdaptor::getCommandActionInfoById(qulonglong id, QString &shortcut, Q
     return success;
 }
 
+QMap<QString, qulonglong> DaemonAdaptor::getMemoryUsage()
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    QMap<QString, qulonglong> result;
+    emit onGetMemoryUsage(result);
+    return result;
+}
+
+bool DaemonAdaptor::isReady()
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    bool result = false;
+    emit onIsReady(result);
+    return result;
+}
+
 QString DaemonAdaptor::grabShortcut(uint timeout, bool &failed, bool &cancelled, bool &timedout)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QString shortcut;
     emit onGrabShortcut(timeout, shortcut, failed, cancelled, timedout, message());
     return shortcut;
@@ -260,11 +506,17 @@ QString DaemonAdaptor::grabShortcut(uint timeout, bool &failed, bool &cancelled,
 
 void DaemonAdaptor::cancelShortcutGrab()
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     emit onCancelShortcutGrab();
 }
 
 void DaemonAdaptor::quit()
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     emit onQuit();
 }
 
@@ -297,3 +549,31 @@ void DaemonAdaptor::emit_clientActionSenderChanged(qulonglong id, const QString
 {
     emit clientActionSenderChanged(id, sender);
 }
+
+void DaemonAdaptor::emit_actionsChanged(qulonglong generation, const QList_ActionChange &changes)
+{
+    emit actionsChanged(generation, changes);
+}
+
+void DaemonAdaptor::emit_multipleActionsBehaviourChanged(uint behaviour)
+{
+    emit multipleActionsBehaviourChanged(behaviour);
+}
+
+void DaemonAdaptor::emit_activeProfileChanged(const QString &profile)
+{
+    emit activeProfileChanged(profile);
+}
+
+void DaemonAdaptor::emit_ready()
+{
+    emit ready();
+}
+
+void DaemonAdaptor::countCall()
+{
+    if (calledFromDBus())
+    {
+        mMetrics->dbusCall(message().path(), message().member());
+    }
+}
@@ -39,11 +39,13 @@
 #include "meta_types.h"
 
 
+class Metrics;
+
 class DaemonAdaptor : public QObject, protected QDBusContext
 {
     Q_OBJECT
 public:
-    DaemonAdaptor(QObject *parent = 0);
+    DaemonAdaptor(Metrics *metrics, QObject *parent = 0);
 
 public slots:
     QString addMethodAction(const QString &shortcut, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description, qulonglong &id);
@@ -67,6 +69,27 @@ public slots:
     bool setMultipleActionsBehaviour(uint behaviour);
     uint getMultipleActionsBehaviour();
 
+    bool setActiveProfile(const QString &profile);
+    QString getActiveProfile();
+    QStringList getProfiles();
+    bool setActionProfiles(qulonglong id, const QStringList &profiles);
+    QStringList getActionProfiles(qulonglong id);
+
+    bool setActionContext(qulonglong id, const QString &context);
+    QString getActionContext(qulonglong id);
+
+    bool setMethodActionAllowActivation(qulonglong id, bool allow);
+    bool getMethodActionAllowActivation(qulonglong id, bool &allow);
+
+    bool setCommandActionLaunchPolicy(qulonglong id, const QString &policy);
+    QString getCommandActionLaunchPolicy(qulonglong id);
+    QMap<qulonglong, uint> getRunningProcesses();
+    QMap<qulonglong, CommandActionUsage> getCommandActionsUsage();
+    bool getCommandActionUsage(qulonglong id, CommandActionUsage &usage);
+
+    qulonglong getActionsGeneration();
+    bool getChangesSince(qulonglong generation, QList_ActionChange &changes);
+
     QList<qulonglong> getAllActionIds();
     QMap<qulonglong, GeneralActionInfo> getAllActions();
     bool getActionById(qulonglong id, QString &shortcut, QString &description, bool &enabled, QString &type, QString &info);
@@ -74,6 +97,10 @@ public slots:
     bool getMethodActionInfoById(qulonglong id, QString &shortcut, QString &description, bool &enabled, QString &service, QDBusObjectPath &path, QString &interface, QString &method);
     bool getCommandActionInfoById(qulonglong id, QString &shortcut, QString &description, bool &enabled, QString &command, QStringList &arguments);
 
+    QMap<QString, qulonglong> getMemoryUsage();
+
+    bool isReady();
+
     QString grabShortcut(uint timeout, bool &failed, bool &cancelled, bool &timedout);
     void cancelShortcutGrab();
 
@@ -85,6 +112,10 @@ public slots:
     void emit_actionShortcutChanged(qulonglong id);
     void emit_actionEnabled(qulonglong id, bool enabled);
     void emit_clientActionSenderChanged(qulonglong id, const QString &sender);
+    void emit_actionsChanged(qulonglong generation, const QList_ActionChange &changes);
+    void emit_multipleActionsBehaviourChanged(uint behaviour);
+    void emit_activeProfileChanged(const QString &profile);
+    void emit_ready();
 
 signals:
     void actionAdded(qulonglong id);
@@ -95,10 +126,13 @@ signals:
     void clientActionSenderChanged(qulonglong id, const QString &sender);
     void actionsSwapped(qulonglong id1, qulonglong id2);
     void multipleActionsBehaviourChanged(uint behaviour);
+    void activeProfileChanged(const QString &profile);
+    void actionsChanged(qulonglong generation, const QList_ActionChange &changes);
+    void ready();
 
 signals:
-    void onAddMethodAction(QPair<QString, qulonglong> &, const QString &, const QString &, const QDBusObjectPath &, const QString &, const QString &, const QString &);
-    void onAddCommandAction(QPair<QString, qulonglong> &, const QString &, const QString &, const QStringList &, const QString &);
+    void onAddMethodAction(QPair<QString, qulonglong> &, const QString &, const QString &, const QDBusObjectPath &, const QString &, const QString &, const QString &, const QDBusMessage &);
+    void onAddCommandAction(QPair<QString, qulonglong> &, const QString &, const QString &, const QStringList &, const QString &, const QDBusMessage &);
 
     void onModifyActionDescription(bool &, qulonglong, const QString &);
     void onModifyMethodAction(bool &, qulonglong, const QString &, const QDBusObjectPath &, const QString &, const QString &, const QString &);
@@ -109,7 +143,7 @@ signals:
 
     void onGetClientActionSender(QString &, qulonglong);
 
-    void onChangeShortcut(QString &, qulonglong, const QString &);
+    void onChangeShortcut(QString &, qulonglong, const QString &, const QDBusMessage &);
 
     void onSwapActions(bool &, qulonglong, qulonglong);
 
@@ -118,6 +152,27 @@ signals:
     void onSetMultipleActionsBehaviour(const MultipleActionsBehaviour &);
     void onGetMultipleActionsBehaviour(MultipleActionsBehaviour &);
 
+    void onSetActiveProfile(bool &, const QString &);
+    void onGetActiveProfile(QString &);
+    void onGetProfiles(QStringList &);
+    void onSetActionProfiles(bool &, qulonglong, const QStringList &);
+    void onGetActionProfiles(QStringList &, qulonglong);
+
+    void onSetActionContext(bool &, qulonglong, const QString &);
+    void onGetActionContext(QString &, qulonglong);
+
+    void onSetMethodActionAllowActivation(bool &, qulonglong, bool);
+    void onGetMethodActionAllowActivation(QPair<bool, bool> &, qulonglong);
+
+    void onSetCommandActionLaunchPolicy(bool &, qulonglong, const QString &);
+    void onGetCommandActionLaunchPolicy(QString &, qulonglong);
+    void onGetRunningProcesses(QMap<qulonglong, uint> &);
+    void onGetCommandActionsUsage(QMap<qulonglong, CommandActionUsage> &);
+    void onGetCommandActionUsage(QPair<bool, CommandActionUsage> &, qulonglong);
+
+    void onGetActionsGeneration(qulonglong &);
+    void onGetChangesSince(QPair<bool, QList_ActionChange> &, qulonglong);
+
     void onGetAllActionIds(QList<qulonglong> &);
     void onGetActionById(QPair<bool, GeneralActionInfo> &, qulonglong);
     void onGetAllActions(QMap<qulonglong, GeneralActionInfo> &);
@@ -126,10 +181,19 @@ signals:
     void onGetMethodActionInfoById(QPair<bool, MethodActionInfo> &, qulonglong);
     void onGetCommandActionInfoById(QPair<bool, CommandActionInfo> &, qulonglong);
 
+    void onGetMemoryUsage(QMap<QString, qulonglong> &);
+    void onIsReady(bool &);
+
     void onGrabShortcut(uint, QString &, bool &, bool &, bool &, const QDBusMessage &);
     void onCancelShortcutGrab();
 
     void onQuit();
+
+private:
+    void countCall();
+
+private:
+    Metrics *mMetrics;
 };
 
 #endif // GLOBAL_ACTION_DAEMON__DAEMON_ADAPTOR__INCLUDED
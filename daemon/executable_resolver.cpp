@@ -0,0 +1,244 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "executable_resolver.h"
+#include "log_target.h"
+#include "trace.h"
+
+#include <QMutexLocker>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QFileInfo>
+#include <QDir>
+
+
+ExecutableResolver::ExecutableResolver(LogTarget *logTarget, QObject *parent)
+    : QObject(parent)
+    , mLogTarget(logTarget)
+    , mWatcher(new QFileSystemWatcher(this))
+    , mRefreshTimer(new QTimer(this))
+{
+    foreach(const QString &directory, QString::fromLocal8Bit(qgetenv("PATH")).split(':', QString::SkipEmptyParts))
+    {
+        if (!mSearchPath.contains(directory))
+        {
+            mSearchPath.push_back(directory);
+        }
+    }
+
+    // package managers touch many files at once, search again once they are done
+    mRefreshTimer->setSingleShot(true);
+    mRefreshTimer->setInterval(500);
+    connect(mRefreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+    connect(mWatcher, SIGNAL(directoryChanged(QString)), this, SLOT(pathChanged()));
+    connect(mWatcher, SIGNAL(fileChanged(QString)), this, SLOT(pathChanged()));
+
+    updateWatchedPaths();
+}
+
+void ExecutableResolver::registerCommand(const QString &command)
+{
+    {
+        QMutexLocker lock(&mMutex);
+
+        Entries::iterator entry = mEntries.find(command);
+        if (entry != mEntries.end())
+        {
+            ++entry.value().refs;
+            return;
+        }
+    }
+
+    Entry entry;
+    entry.refs = 1;
+    entry.executable = resolve(command);
+
+    if (entry.executable.isEmpty())
+    {
+        mLogTarget->log(LOG_WARNING, "Command \"%s\" cannot be found in PATH", qPrintable(command));
+    }
+
+    {
+        QMutexLocker lock(&mMutex);
+
+        mEntries.insert(command, entry);
+    }
+
+    updateWatchedPaths();
+}
+
+void ExecutableResolver::unregisterCommand(const QString &command)
+{
+    QMutexLocker lock(&mMutex);
+
+    // dropped by the next refresh, so the watcher is only touched on the main thread
+    Entries::iterator entry = mEntries.find(command);
+    if (entry != mEntries.end())
+    {
+        --entry.value().refs;
+    }
+}
+
+QString ExecutableResolver::executable(const QString &command) const
+{
+    QMutexLocker lock(&mMutex);
+
+    Entries::const_iterator entry = mEntries.constFind(command);
+    return (entry != mEntries.constEnd()) ? entry.value().executable : QString();
+}
+
+void ExecutableResolver::pathChanged()
+{
+    mRefreshTimer->start();
+}
+
+void ExecutableResolver::refresh()
+{
+    TRACE_SPAN("config", "resolve executables");
+
+    QStringList commands;
+    {
+        QMutexLocker lock(&mMutex);
+
+        Entries::iterator entry = mEntries.begin();
+        while (entry != mEntries.end())
+        {
+            if (entry.value().refs <= 0)
+            {
+                entry = mEntries.erase(entry);
+                continue;
+            }
+            commands.push_back(entry.key());
+            ++entry;
+        }
+    }
+
+    // searched without the lock held, key presses keep using the previous result meanwhile
+    QHash<QString, QString> executables;
+    foreach(const QString &command, commands)
+    {
+        executables.insert(command, resolve(command));
+    }
+
+    {
+        QMutexLocker lock(&mMutex);
+
+        QHash<QString, QString>::const_iterator lastExecutables = executables.constEnd();
+        for (QHash<QString, QString>::const_iterator executable = executables.constBegin(); executable != lastExecutables; ++executable)
+        {
+            Entries::iterator entry = mEntries.find(executable.key());
+            if ((entry == mEntries.end()) || (entry.value().executable == executable.value()))
+            {
+                continue;
+            }
+
+            if (executable.value().isEmpty())
+            {
+                mLogTarget->log(LOG_WARNING, "Command \"%s\" cannot be found in PATH any more", qPrintable(executable.key()));
+            }
+            else
+            {
+                mLogTarget->log(LOG_INFO, "Command \"%s\" resolved to \"%s\"", qPrintable(executable.key()), qPrintable(executable.value()));
+            }
+            entry.value().executable = executable.value();
+        }
+    }
+
+    updateWatchedPaths();
+}
+
+QString ExecutableResolver::resolve(const QString &command) const
+{
+    if (command.contains('/'))
+    {
+        QFileInfo fileInfo(command);
+        return (fileInfo.isFile() && fileInfo.isExecutable()) ? fileInfo.absoluteFilePath() : QString();
+    }
+
+    foreach(const QString &directory, mSearchPath)
+    {
+        QFileInfo fileInfo(QDir(directory), command);
+        if (fileInfo.isFile() && fileInfo.isExecutable())
+        {
+            return fileInfo.absoluteFilePath();
+        }
+    }
+
+    return QString();
+}
+
+void ExecutableResolver::updateWatchedPaths()
+{
+    QSet<QString> directories;
+    QSet<QString> files;
+
+    foreach(const QString &directory, mSearchPath)
+    {
+        if (QFileInfo(directory).isDir())
+        {
+            directories.insert(directory);
+        }
+    }
+
+    {
+        QMutexLocker lock(&mMutex);
+
+        Entries::const_iterator lastEntries = mEntries.constEnd();
+        for (Entries::const_iterator entry = mEntries.constBegin(); entry != lastEntries; ++entry)
+        {
+            // a command given with a path is looked for in its own directory
+            if (entry.key().contains('/'))
+            {
+                QString directory = QFileInfo(entry.key()).absolutePath();
+                if (QFileInfo(directory).isDir())
+                {
+                    directories.insert(directory);
+                }
+            }
+            // replaced in place or made non-executable
+            if (!entry.value().executable.isEmpty())
+            {
+                files.insert(entry.value().executable);
+            }
+        }
+    }
+
+    QSet<QString> watchedDirectories = mWatcher->directories().toSet();
+    QSet<QString> watchedFiles = mWatcher->files().toSet();
+
+    QStringList removed = (QSet<QString>(watchedDirectories) - directories).toList() + (QSet<QString>(watchedFiles) - files).toList();
+    if (!removed.isEmpty())
+    {
+        mWatcher->removePaths(removed);
+    }
+
+    QStringList added = (directories - watchedDirectories).toList() + (files - watchedFiles).toList();
+    if (!added.isEmpty())
+    {
+        mWatcher->addPaths(added);
+    }
+}
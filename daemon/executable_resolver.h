@@ -0,0 +1,88 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__EXECUTABLE_RESOLVER__INCLUDED
+#define GLOBAL_ACTION_DAEMON__EXECUTABLE_RESOLVER__INCLUDED
+
+
+#include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+
+class QFileSystemWatcher;
+class QTimer;
+class LogTarget;
+
+// Absolute paths of the commands of command actions, searched in PATH once and again only
+// when a PATH directory or a resolved file changes, so launching a command does not touch the disk.
+class ExecutableResolver : public QObject
+{
+    Q_OBJECT
+public:
+    ExecutableResolver(LogTarget *logTarget, QObject *parent = 0);
+
+    // reference counted; resolves right away and warns about a command that cannot be found
+    void registerCommand(const QString &command);
+    // may be called from any thread
+    void unregisterCommand(const QString &command);
+
+    // empty if the command cannot be found, may be called from any thread
+    QString executable(const QString &command) const;
+
+private slots:
+    void pathChanged();
+    void refresh();
+
+private:
+    typedef struct Entry
+    {
+        int refs;
+        QString executable;
+    } Entry;
+
+    typedef QHash<QString, Entry> Entries;
+
+    QString resolve(const QString &command) const;
+    void updateWatchedPaths();
+
+private:
+    LogTarget *mLogTarget;
+
+    QStringList mSearchPath;
+
+    QFileSystemWatcher *mWatcher;
+    QTimer *mRefreshTimer;
+
+    mutable QMutex mMutex;
+    Entries mEntries;
+};
+
+#endif // GLOBAL_ACTION_DAEMON__EXECUTABLE_RESOLVER__INCLUDED
@@ -0,0 +1,276 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+extern "C" {
+#include <X11/Xutil.h>
+#include <X11/XKBlib.h>
+}
+
+#include <QMutexLocker>
+
+#include "keycode_table.h"
+
+
+// a KeyCode is a byte
+static const int keycodeCount = 256;
+
+
+KeycodeTable::KeycodeTable()
+    : mKeySyms(keycodeCount * XkbNumKbdGroups, NoSymbol)
+    , mGroups(0)
+{
+}
+
+bool KeycodeTable::rebuild(Display *display)
+{
+    QHash<KeyCode, KeySymsByGroup> keys;
+    QHash<KeyCode, unsigned char> groupInfo;
+
+    // the key types too, XkbKeyGroupWidth looks up the number of levels in them
+    XkbDescPtr xkb = XkbGetMap(display, XkbKeyTypesMask | XkbKeySymsMask, XkbUseCoreKbd);
+    if (xkb && xkb->map && xkb->map->types)
+    {
+        for (int keyCode = xkb->min_key_code; keyCode <= xkb->max_key_code; ++keyCode)
+        {
+            KeySymsByGroup &groups = keys[static_cast<KeyCode>(keyCode)];
+            int keyGroups = XkbKeyNumGroups(xkb, keyCode);
+            for (int group = 0; group < keyGroups; ++group)
+            {
+                QList<KeySym> levels;
+                int width = XkbKeyGroupWidth(xkb, keyCode, group);
+                for (int level = 0; level < width; ++level)
+                {
+                    levels.push_back(XkbKeySymEntry(xkb, keyCode, level, group));
+                }
+                groups.push_back(levels);
+            }
+            groupInfo[static_cast<KeyCode>(keyCode)] = XkbKeyGroupInfo(xkb, keyCode);
+        }
+        XkbFreeKeyboard(xkb, 0, True);
+
+        build(keys, groupInfo);
+        return true;
+    }
+    if (xkb)
+    {
+        XkbFreeKeyboard(xkb, 0, True);
+    }
+
+    // the core mapping starts with two levels of the first group and two of the second one
+    int minKeyCode = 0;
+    int maxKeyCode = 0;
+    XDisplayKeycodes(display, &minKeyCode, &maxKeyCode);
+    int keysymsPerKeycode = 0;
+    KeySym *keySyms = XGetKeyboardMapping(display, minKeyCode, maxKeyCode - minKeyCode + 1, &keysymsPerKeycode);
+    if (!keySyms)
+    {
+        build(keys, groupInfo);
+        return false;
+    }
+
+    for (int keyCode = minKeyCode; keyCode <= maxKeyCode; ++keyCode)
+    {
+        const KeySym *keyKeySyms = keySyms + (keyCode - minKeyCode) * keysymsPerKeycode;
+        KeySymsByGroup &groups = keys[static_cast<KeyCode>(keyCode)];
+        for (int group = 0; (group < 2) && (group * 2 < keysymsPerKeycode); ++group)
+        {
+            QList<KeySym> levels;
+            for (int level = 0; (level < 2) && (group * 2 + level < keysymsPerKeycode); ++level)
+            {
+                levels.push_back(keyKeySyms[group * 2 + level]);
+            }
+            if (group && (levels.first() == NoSymbol) && (levels.last() == NoSymbol))
+            {
+                break;
+            }
+            groups.push_back(levels);
+        }
+    }
+    XFree(keySyms);
+
+    build(keys, groupInfo);
+    return true;
+}
+
+void KeycodeTable::rebuild(const QHash<KeyCode, KeySymsByGroup> &keys)
+{
+    build(keys, QHash<KeyCode, unsigned char>());
+}
+
+void KeycodeTable::build(const QHash<KeyCode, KeySymsByGroup> &keys, const QHash<KeyCode, unsigned char> &groupInfo)
+{
+    QMutexLocker lock(&mMutex);
+
+    mKeySyms.fill(NoSymbol);
+    mNames.clear();
+    mKeycodes.clear();
+    mGroups = 0;
+
+    QList<KeyCode> keyCodes = keys.keys();
+    qSort(keyCodes);
+
+    int levels = 0;
+    foreach(KeyCode keyCode, keyCodes)
+    {
+        const KeySymsByGroup &groups = keys[keyCode];
+        int keyGroups = qMin(groups.size(), static_cast<int>(XkbNumKbdGroups));
+        if (!keyGroups)
+        {
+            continue;
+        }
+        mGroups = qMax(mGroups, keyGroups);
+
+        for (int group = 0; group < XkbNumKbdGroups; ++group)
+        {
+            // a group the key lacks is brought into its range the way XKB does it for a key press
+            int effectiveGroup = group;
+            if (group >= keyGroups)
+            {
+                unsigned char info = groupInfo.value(keyCode, 0);
+                switch (XkbOutOfRangeGroupAction(info))
+                {
+                case XkbRedirectIntoRange:
+                    effectiveGroup = XkbOutOfRangeGroupNumber(info);
+                    if (effectiveGroup >= keyGroups)
+                    {
+                        effectiveGroup = 0;
+                    }
+                    break;
+
+                case XkbClampIntoRange:
+                    effectiveGroup = keyGroups - 1;
+                    break;
+
+                default:
+                    effectiveGroup = group % keyGroups;
+                }
+            }
+
+            KeySym name = keyName(groups[effectiveGroup]);
+            mKeySyms[keyCode * XkbNumKbdGroups + group] = name;
+
+            if ((group < keyGroups) && (name != NoSymbol))
+            {
+                QList<KeyCode> &nameKeycodes = mKeycodes[name];
+                if (!nameKeycodes.contains(keyCode))
+                {
+                    nameKeycodes.push_back(keyCode);
+                }
+            }
+        }
+
+        for (int group = 0; group < keyGroups; ++group)
+        {
+            levels = qMax(levels, groups[group].size());
+        }
+    }
+
+    // group first, then level, then keycode, the first key found for a keysym names it
+    for (int group = 0; group < mGroups; ++group)
+    {
+        for (int level = 0; level < levels; ++level)
+        {
+            foreach(KeyCode keyCode, keyCodes)
+            {
+                const KeySymsByGroup &groups = keys[keyCode];
+                if ((group >= groups.size()) || (level >= groups[group].size()))
+                {
+                    continue;
+                }
+                KeySym keySym = groups[group][level];
+                KeySym name = mKeySyms[keyCode * XkbNumKbdGroups + group];
+                if ((keySym != NoSymbol) && (name != NoSymbol) && !mNames.contains(keySym))
+                {
+                    mNames.insert(keySym, name);
+                }
+            }
+        }
+    }
+}
+
+KeySym KeycodeTable::keyName(const QList<KeySym> &levels)
+{
+    if (levels.isEmpty())
+    {
+        return NoSymbol;
+    }
+
+    KeySym first = levels[0];
+    if ((levels.size() >= 2) && (levels[1] != NoSymbol))
+    {
+        KeySym lower;
+        KeySym upper;
+        XConvertCase(first, &lower, &upper);
+        if ((first == lower) && (lower != upper))
+        {
+            return levels[1];
+        }
+    }
+    return first;
+}
+
+KeySym KeycodeTable::keySym(KeyCode keyCode, int group) const
+{
+    QMutexLocker lock(&mMutex);
+    return mKeySyms[keyCode * XkbNumKbdGroups + (group % XkbNumKbdGroups)];
+}
+
+KeySym KeycodeTable::name(KeySym keySym) const
+{
+    QMutexLocker lock(&mMutex);
+    return mNames.value(keySym, NoSymbol);
+}
+
+QList<KeyCode> KeycodeTable::keycodes(KeySym name) const
+{
+    QMutexLocker lock(&mMutex);
+    return mKeycodes.value(name);
+}
+
+bool KeycodeTable::changesWithGroup(KeyCode keyCode) const
+{
+    QMutexLocker lock(&mMutex);
+    for (int group = 1; group < mGroups; ++group)
+    {
+        if (mKeySyms[keyCode * XkbNumKbdGroups + group] != mKeySyms[keyCode * XkbNumKbdGroups])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int KeycodeTable::groups() const
+{
+    QMutexLocker lock(&mMutex);
+    return mGroups;
+}
+
+int KeycodeTable::size() const
+{
+    QMutexLocker lock(&mMutex);
+    return mNames.size();
+}
@@ -0,0 +1,83 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+#ifndef GLOBAL_ACTION_DAEMON__KEYCODE_TABLE__INCLUDED
+#define GLOBAL_ACTION_DAEMON__KEYCODE_TABLE__INCLUDED
+
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QMutex>
+
+extern "C" {
+#include <X11/X.h>
+#include <X11/Xlib.h>
+}
+
+
+// The names of the keys in every XKB group of the keyboard. A key is named by the keysym on its
+// first level, or by the upper case one on the second level for a letter, as shortcuts name it.
+// Rebuilt by the X11 thread and read by the main thread as well, so every call locks.
+class KeycodeTable
+{
+public:
+    // the keysyms of a key by group, then by level
+    typedef QList<QList<KeySym> > KeySymsByGroup;
+
+    KeycodeTable();
+
+    // from XKB, or from the core keyboard mapping without it; false if neither can be read,
+    // the table is empty then
+    bool rebuild(Display *display);
+    // for a keyboard that is no X display
+    void rebuild(const QHash<KeyCode, KeySymsByGroup> &keys);
+
+    // the name of the key in the group, NoSymbol if it has none
+    KeySym keySym(KeyCode keyCode, int group) const;
+    // the name of the key keySym is on, in the lowest group, then at the lowest level, then with the lowest keycode
+    KeySym name(KeySym keySym) const;
+    // every key called name in any group
+    QList<KeyCode> keycodes(KeySym name) const;
+    // the key has different names in different groups, so a press of it may mean another shortcut
+    bool changesWithGroup(KeyCode keyCode) const;
+
+    int groups() const;
+    int size() const;
+
+private:
+    void build(const QHash<KeyCode, KeySymsByGroup> &keys, const QHash<KeyCode, unsigned char> &groupInfo);
+    static KeySym keyName(const QList<KeySym> &levels);
+
+private:
+    mutable QMutex mMutex;
+    QVector<KeySym> mKeySyms; // by keycode and effective group, for every group XKB can switch to
+    QHash<KeySym, KeySym> mNames;
+    QHash<KeySym, QList<KeyCode> > mKeycodes;
+    int mGroups;
+};
+
+#endif // GLOBAL_ACTION_DAEMON__KEYCODE_TABLE__INCLUDED
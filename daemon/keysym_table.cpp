@@ -0,0 +1,190 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+#include <string.h>
+
+#include <algorithm>
+
+extern "C" {
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+}
+
+#include "keysym_table.h"
+
+
+namespace
+{
+
+typedef struct KeysymName
+{
+    const char *name;
+    unsigned long keySym;
+} KeysymName;
+
+#include "keysym_table_data.h"
+
+const KeysymName *keysymsByNameEnd = keysymsByName + sizeof(keysymsByName) / sizeof(keysymsByName[0]);
+const KeysymName *keysymsByValueEnd = keysymsByValue + sizeof(keysymsByValue) / sizeof(keysymsByValue[0]);
+
+bool nameLess(const KeysymName &entry, const char *name)
+{
+    return strcmp(entry.name, name) < 0;
+}
+
+bool valueLess(const KeysymName &entry, unsigned long keySym)
+{
+    return entry.keySym < keySym;
+}
+
+
+// Only Latin 1 and the function keys take part in the classes,
+// so two pages of one byte per keysym cover them.
+const KeySym latin1End = 0x0100;
+const KeySym functionBegin = 0xfe00;
+const KeySym functionEnd = 0x10000;
+
+unsigned char keysymClasses[(latin1End - 0) + (functionEnd - functionBegin)];
+
+inline int classIndex(KeySym keySym)
+{
+    if (keySym < latin1End)
+    {
+        return static_cast<int>(keySym);
+    }
+    if ((keySym >= functionBegin) && (keySym < functionEnd))
+    {
+        return static_cast<int>(latin1End + (keySym - functionBegin));
+    }
+    return -1;
+}
+
+void setClass(const KeySym *keySyms, size_t count, KeysymClass keyClass)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        keysymClasses[classIndex(keySyms[i])] = static_cast<unsigned char>(keyClass);
+    }
+}
+
+#define SET_CLASS(keySyms, keyClass) setClass(keySyms, sizeof(keySyms) / sizeof(keySyms[0]), keyClass)
+
+const KeySym modifierKeysyms[] =
+{
+    XK_Shift_L, XK_Shift_R, XK_Control_L, XK_Control_R, XK_Meta_L, XK_Meta_R, XK_Alt_L, XK_Alt_R,
+    XK_Super_L, XK_Super_R, XK_Hyper_L, XK_Hyper_R, XK_ISO_Level3_Shift, XK_ISO_Level5_Shift, XK_ISO_Group_Shift
+};
+
+const KeySym lockKeysyms[] =
+{
+    XK_Scroll_Lock, XK_Num_Lock, XK_Caps_Lock, XK_ISO_Lock, XK_ISO_Level3_Lock, XK_ISO_Level5_Lock,
+    XK_ISO_Group_Lock, XK_ISO_Next_Group_Lock, XK_ISO_Prev_Group_Lock, XK_ISO_First_Group_Lock, XK_ISO_Last_Group_Lock
+};
+
+const KeySym baseSpecialKeysyms[] =
+{
+    XK_Home, XK_Left, XK_Up, XK_Right, XK_Down, XK_Page_Up, XK_Page_Down, XK_End,
+    XK_Delete, XK_Insert, XK_BackSpace, XK_Tab, XK_Return, XK_space
+};
+
+const KeySym miscSpecialKeysyms[] =
+{
+    XK_Pause, XK_Print, XK_Linefeed, XK_Clear, XK_Multi_key, XK_Codeinput, XK_SingleCandidate,
+    XK_MultipleCandidate, XK_PreviousCandidate, XK_Begin, XK_Select, XK_Execute, XK_Undo, XK_Redo,
+    XK_Menu, XK_Find, XK_Cancel, XK_Help, XK_Sys_Req, XK_Break
+};
+
+const KeySym baseKeypadKeysyms[] =
+{
+    XK_KP_Enter, XK_KP_Home, XK_KP_Left, XK_KP_Up, XK_KP_Right, XK_KP_Down, XK_KP_Page_Up, XK_KP_Page_Down,
+    XK_KP_End, XK_KP_Begin, XK_KP_Insert, XK_KP_Delete, XK_KP_Multiply, XK_KP_Add, XK_KP_Subtract,
+    XK_KP_Decimal, XK_KP_Divide, XK_KP_0, XK_KP_1, XK_KP_2, XK_KP_3, XK_KP_4, XK_KP_5, XK_KP_6, XK_KP_7,
+    XK_KP_8, XK_KP_9
+};
+
+const KeySym miscKeypadKeysyms[] =
+{
+    XK_KP_Space, XK_KP_Tab, XK_KP_F1, XK_KP_F2, XK_KP_F3, XK_KP_F4, XK_KP_Equal, XK_KP_Separator
+};
+
+// the keys of the main block as the keycode's first (or, for letters, shifted) keysym reports them
+const KeySym printableKeysyms[] =
+{
+    XK_grave, XK_1, XK_2, XK_3, XK_4, XK_5, XK_6, XK_7, XK_8, XK_9, XK_0, XK_minus, XK_equal,
+    XK_Q, XK_W, XK_E, XK_R, XK_T, XK_Y, XK_U, XK_I, XK_O, XK_P, XK_bracketleft, XK_bracketright, XK_backslash,
+    XK_A, XK_S, XK_D, XK_F, XK_G, XK_H, XK_J, XK_K, XK_L, XK_semicolon, XK_apostrophe,
+    XK_Z, XK_X, XK_C, XK_V, XK_B, XK_N, XK_M, XK_comma, XK_period, XK_slash
+};
+
+// fills the class pages during static initialisation, before any thread can look at them
+struct KeysymClassesInit
+{
+    KeysymClassesInit()
+    {
+        SET_CLASS(modifierKeysyms, KEYSYM_CLASS_MODIFIER);
+        SET_CLASS(lockKeysyms, KEYSYM_CLASS_LOCK);
+        SET_CLASS(baseSpecialKeysyms, KEYSYM_CLASS_BASE_SPECIAL);
+        SET_CLASS(miscSpecialKeysyms, KEYSYM_CLASS_MISC_SPECIAL);
+        SET_CLASS(baseKeypadKeysyms, KEYSYM_CLASS_BASE_KEYPAD);
+        SET_CLASS(miscKeypadKeysyms, KEYSYM_CLASS_MISC_KEYPAD);
+        SET_CLASS(printableKeysyms, KEYSYM_CLASS_PRINTABLE);
+    }
+} keysymClassesInit;
+
+#undef SET_CLASS
+
+}
+
+KeySym keysymFromString(const char *name)
+{
+    const KeysymName *entry = std::lower_bound(keysymsByName, keysymsByNameEnd, name, nameLess);
+    if ((entry != keysymsByNameEnd) && !strcmp(entry->name, name))
+    {
+        return entry->keySym;
+    }
+    return XStringToKeysym(name);
+}
+
+const char *keysymToString(KeySym keySym)
+{
+    // the first of equal keysyms is the first alias in the header, the one Xlib would return
+    const KeysymName *entry = std::lower_bound(keysymsByValue, keysymsByValueEnd, static_cast<unsigned long>(keySym), valueLess);
+    if ((entry != keysymsByValueEnd) && (entry->keySym == keySym))
+    {
+        return entry->name;
+    }
+    return XKeysymToString(keySym);
+}
+
+unsigned int keysymClass(KeySym keySym)
+{
+    int index = classIndex(keySym);
+    if (index < 0)
+    {
+        return KEYSYM_CLASS_NONE;
+    }
+    return keysymClasses[index];
+}
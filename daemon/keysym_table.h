@@ -0,0 +1,56 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+#ifndef GLOBAL_ACTION_DAEMON__KEYSYM_TABLE__INCLUDED
+#define GLOBAL_ACTION_DAEMON__KEYSYM_TABLE__INCLUDED
+
+
+extern "C" {
+#include <X11/X.h>
+}
+
+
+// Keysym names from the tables generated out of the X11 keysym headers at build time,
+// only names missing from them (vendor keysyms, "0x..." and "U..." forms) go to Xlib.
+KeySym keysymFromString(const char *name); // NoSymbol if unknown
+const char *keysymToString(KeySym keySym); // NULL if unknown
+
+// The classes of keys the AllowGrab* settings gate, a keysym is in at most one of them.
+enum KeysymClass
+{
+    KEYSYM_CLASS_NONE          = 0,
+    KEYSYM_CLASS_MODIFIER      = 1 << 0,
+    KEYSYM_CLASS_LOCK          = 1 << 1,
+    KEYSYM_CLASS_BASE_SPECIAL  = 1 << 2,
+    KEYSYM_CLASS_MISC_SPECIAL  = 1 << 3,
+    KEYSYM_CLASS_BASE_KEYPAD   = 1 << 4,
+    KEYSYM_CLASS_MISC_KEYPAD   = 1 << 5,
+    KEYSYM_CLASS_PRINTABLE     = 1 << 6
+};
+
+unsigned int keysymClass(KeySym keySym);
+
+#endif // GLOBAL_ACTION_DAEMON__KEYSYM_TABLE__INCLUDED
@@ -29,9 +29,11 @@
 
 #include <QString>
 #include <QStringList>
+#include <QFileInfo>
 
 #include "meta_types.h"
 #include "core.h"
+#include "trace.h"
 
 #include <errno.h>
 #include <getopt.h>
@@ -40,6 +42,7 @@
 #include <stdio.h>
 #include <syslog.h>
 #include <stdlib.h>
+#include <limits.h>
 
 
 #define DEFAULT_CONFIG ".config/lxqt/globalkeyshortcuts.conf"
@@ -56,6 +59,10 @@ int main(int argc, char *argv[])
     bool multipleActionsBehaviourSet = false;
     MultipleActionsBehaviour multipleActionsBehaviour = MULTIPLE_ACTIONS_BEHAVIOUR_FIRST;
     QStringList configFiles;
+    QString metricsFile;
+    uint metricsInterval = 60;
+    QString traceFile;
+    QStringList displayNames;
 
     static struct option longOptions[] =
     {
@@ -65,6 +72,10 @@ int main(int argc, char *argv[])
         {"log-level", required_argument, 0, 'l'},
         {"multiple-actions-behaviour", required_argument, 0, 'm'},
         {"config-file", required_argument, 0, 'f'},
+        {"metrics-file", required_argument, 0, 'M'},
+        {"metrics-interval", required_argument, 0, 'I'},
+        {"trace", required_argument, 0, 'T'},
+        {"display", required_argument, 0, 'D'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -156,6 +167,34 @@ int main(int argc, char *argv[])
             configFiles.push_back(QString::fromLocal8Bit(optarg));
             break;
 
+        case 'M':
+            metricsFile = QFileInfo(QString::fromLocal8Bit(optarg)).absoluteFilePath(); // we chdir("/") later
+            break;
+
+        case 'I':
+        {
+            char *end;
+            unsigned long value = strtoul(optarg, &end, 10);
+            // the timer takes milliseconds as an int
+            if (*end || !value || (value > static_cast<unsigned long>(INT_MAX / 1000)))
+            {
+                fprintf(stderr, "Invalid metrics interval: %s\n", optarg);
+                wrongArgs = true;
+                printHelp = true;
+                break;
+            }
+            metricsInterval = value;
+        }
+        break;
+
+        case 'T':
+            traceFile = QFileInfo(QString::fromLocal8Bit(optarg)).absoluteFilePath();
+            break;
+
+        case 'D':
+            displayNames.push_back(QString::fromLocal8Bit(optarg));
+            break;
+
         case '?':
         case 'h':
             printHelp = true;
@@ -213,6 +252,23 @@ int main(int argc, char *argv[])
                "      The last loaded file is used to save settings.\n"
                "      Default is: ${HOME}/" DEFAULT_CONFIG "\n"
                "\n"
+               "  --metrics-file=FILENAME\n"
+               "      Periodically dump metrics to FILENAME\n"
+               "      in Prometheus text exposition format.\n"
+               "\n"
+               "  --metrics-interval=SECONDS\n"
+               "      Set metrics dump interval. Default is 60.\n"
+               "\n"
+               "  --trace=FILENAME\n"
+               "      Record a timeline of startup, grabs, key presses\n"
+               "      and D-Bus calls, and write it to FILENAME\n"
+               "      as Chrome trace-event JSON on exit and on SIGUSR1.\n"
+               "\n"
+               "  --display=NAME\n"
+               "      Grab shortcuts on X display NAME. Can be used several times,\n"
+               "      the first display is used to record shortcuts.\n"
+               "      Default is: ${DISPLAY}\n"
+               "\n"
                "  --help\n"
                "  -h\n"
                "  -?\n"
@@ -238,14 +294,25 @@ int main(int argc, char *argv[])
         configFiles.push_back(QString::fromLocal8Bit(getenv("HOME")) + "/" DEFAULT_CONFIG);
     }
 
+    if (!traceFile.isEmpty())
+    {
+        Trace::enable(traceFile);
+        Trace::setThreadName("main");
+    }
+
     QCoreApplication app(argc, argv);
 
-    Core core(runAsDaemon || useSyslog, minLogLevelSet, minLogLevel, configFiles, multipleActionsBehaviourSet, multipleActionsBehaviour);
+    Core core(runAsDaemon || useSyslog, minLogLevelSet, minLogLevel, multipleActionsBehaviourSet, multipleActionsBehaviour, metricsFile);
 
-    if (!core.ready())
+    if (!core.start(configFiles, displayNames, metricsInterval))
     {
+        Trace::write();
         return EXIT_FAILURE;
     }
 
-    return app.exec();
+    int result = app.exec();
+
+    Trace::write();
+
+    return result;
 }
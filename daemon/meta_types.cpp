@@ -44,6 +44,43 @@ const QDBusArgument &operator >> (const QDBusArgument &argument, GeneralActionIn
     return argument;
 }
 
+QDBusArgument &operator << (QDBusArgument &argument, const ActionChange &actionChange)
+{
+    argument.beginStructure();
+    argument << actionChange.kind << actionChange.id << actionChange.generation << actionChange.general << actionChange.sender;
+    // an empty object path is not a valid D-Bus value
+    argument << (actionChange.path.path().isEmpty() ? QDBusObjectPath("/") : actionChange.path);
+    argument << actionChange.service << actionChange.interface << actionChange.method << actionChange.command << actionChange.arguments;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator >> (const QDBusArgument &argument, ActionChange &actionChange)
+{
+    argument.beginStructure();
+    argument >> actionChange.kind >> actionChange.id >> actionChange.generation >> actionChange.general >> actionChange.sender;
+    argument >> actionChange.path;
+    argument >> actionChange.service >> actionChange.interface >> actionChange.method >> actionChange.command >> actionChange.arguments;
+    argument.endStructure();
+    return argument;
+}
+
+QDBusArgument &operator << (QDBusArgument &argument, const CommandActionUsage &usage)
+{
+    argument.beginStructure();
+    argument << usage.launches << usage.exited << usage.wallTime << usage.cpuTime << usage.maxRss << usage.lastExitStatus;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator >> (const QDBusArgument &argument, CommandActionUsage &usage)
+{
+    argument.beginStructure();
+    argument >> usage.launches >> usage.exited >> usage.wallTime >> usage.cpuTime >> usage.maxRss >> usage.lastExitStatus;
+    argument.endStructure();
+    return argument;
+}
+
 namespace
 {
 
@@ -57,6 +94,12 @@ public:
 #endif
         qDBusRegisterMetaType<GeneralActionInfo>();
         qDBusRegisterMetaType<QMap_qulonglong_GeneralActionInfo>();
+        qDBusRegisterMetaType<QMap_QString_qulonglong>();
+        qDBusRegisterMetaType<QMap_qulonglong_uint>();
+        qDBusRegisterMetaType<ActionChange>();
+        qDBusRegisterMetaType<QList_ActionChange>();
+        qDBusRegisterMetaType<CommandActionUsage>();
+        qDBusRegisterMetaType<QMap_qulonglong_CommandActionUsage>();
     }
 
     ~TypeRegistrator()
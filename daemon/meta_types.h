@@ -74,20 +74,73 @@ typedef struct CommandActionInfo : CommonActionInfo
     QStringList arguments;
 } CommandActionInfo;
 
+typedef enum ActionChangeKind
+{
+    ACTION_CHANGE_ADDED = 0,
+    ACTION_CHANGE_MODIFIED,
+    ACTION_CHANGE_REMOVED,
+    ACTION_CHANGE__COUNT
+} ActionChangeKind;
+
+// The whole state of one action after a change, so that listeners never have to ask for it.
+// Type specific fields are filled according to general.type, the rest stay empty.
+typedef struct ActionChange
+{
+    uint kind;
+    qulonglong id;
+    qulonglong generation;
+    GeneralActionInfo general;
+    QString sender;
+    QDBusObjectPath path;
+    QString service;
+    QString interface;
+    QString method;
+    QString command;
+    QStringList arguments;
+} ActionChange;
+
+// What the processes launched by one command action have used so far.
+// The times and the memory cover the processes that have exited.
+typedef struct CommandActionUsage
+{
+    qulonglong launches;
+    qulonglong exited;
+    qulonglong wallTime; // ms
+    qulonglong cpuTime;  // ms, user and system
+    qulonglong maxRss;   // KiB, of the largest process
+    int lastExitStatus;  // negative: killed by that signal
+} CommandActionUsage;
+
 
 
 typedef QMap<qulonglong, GeneralActionInfo> QMap_qulonglong_GeneralActionInfo;
+typedef QMap<QString, qulonglong> QMap_QString_qulonglong;
+typedef QMap<qulonglong, uint> QMap_qulonglong_uint;
+typedef QMap<qulonglong, CommandActionUsage> QMap_qulonglong_CommandActionUsage;
+typedef QList<ActionChange> QList_ActionChange;
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 Q_DECLARE_METATYPE(QList<qulonglong>)
 #endif
 Q_DECLARE_METATYPE(GeneralActionInfo)
 Q_DECLARE_METATYPE(QMap_qulonglong_GeneralActionInfo)
+Q_DECLARE_METATYPE(QMap_QString_qulonglong)
+Q_DECLARE_METATYPE(QMap_qulonglong_uint)
+Q_DECLARE_METATYPE(ActionChange)
+Q_DECLARE_METATYPE(QList_ActionChange)
+Q_DECLARE_METATYPE(CommandActionUsage)
+Q_DECLARE_METATYPE(QMap_qulonglong_CommandActionUsage)
 
 
 
 QDBusArgument &operator << (QDBusArgument &argument, const GeneralActionInfo &generalActionInfo);
 const QDBusArgument &operator >> (const QDBusArgument &argument, GeneralActionInfo &generalActionInfo);
 
+QDBusArgument &operator << (QDBusArgument &argument, const ActionChange &actionChange);
+const QDBusArgument &operator >> (const QDBusArgument &argument, ActionChange &actionChange);
+
+QDBusArgument &operator << (QDBusArgument &argument, const CommandActionUsage &usage);
+const QDBusArgument &operator >> (const QDBusArgument &argument, CommandActionUsage &usage);
+
 #endif // GLOBAL_ACTION_MANAGER__META_TYPES__INCLUDED
 
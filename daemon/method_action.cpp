@@ -26,31 +26,61 @@
  * END_COMMON_COPYRIGHT_HEADER */
 
 #include "method_action.h"
+#include "name_owner_cache.h"
 #include "log_target.h"
+#include "trace.h"
 
 
-MethodAction::MethodAction(LogTarget *logTarget, const QDBusConnection &connection, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description)
+// a service that has not answered by then counts as failed, so FIRST/LAST fall through to the next action
+static const int replyTimeout = 2000; // ms
+
+
+MethodAction::MethodAction(LogTarget *logTarget, const QDBusConnection &connection, NameOwnerCache *nameOwners, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description)
     : BaseAction(logTarget, description)
     , mConnection(connection)
-    , mService(service)
-    , mPath(path)
-    , mInterface(interface)
-    , mMethodName(method)
+    , mNameOwners(nameOwners)
+    , mService(StringPool::intern(service))
+    , mPath(StringPool::intern(path))
+    , mInterface(StringPool::intern(interface))
+    , mMethodName(StringPool::intern(method))
+    , mAllowActivation(true)
+{
+    mNameOwners->watch(mService);
+}
+
+MethodAction::~MethodAction()
 {
+    mNameOwners->unwatch(mService);
 }
 
-bool MethodAction::call()
+ActionCompletion MethodAction::call(qulonglong eventTime)
 {
+    Q_UNUSED(eventTime);
+
     if (!isEnabled())
     {
         return false;
     }
 
-    bool result = mConnection.call(QDBusMessage::createMethodCall(mService, mPath.path(), mInterface, mMethodName), QDBus::BlockWithGui).type() == QDBusMessage::ReplyMessage;
-    if (!result)
+    TRACE_SPAN("dispatch", "method action");
+
+    QDBusMessage message = QDBusMessage::createMethodCall(mService, mPath.path(), mInterface, mMethodName);
+    if (!mAllowActivation)
+    {
+        if (mNameOwners->isAbsent(mService))
+        {
+            mLogTarget->log(LOG_DEBUG, "Service '%s' is not running, skipping method '%s'", qPrintable(mService), qPrintable(mMethodName));
+            return false;
+        }
+        // the owner may have gone before the cache learns about it
+        message.setAutoStartService(false);
+    }
+
+    QDBusPendingCall call = mConnection.asyncCall(message, replyTimeout);
+    if (call.isFinished() && call.isError())
     {
         mLogTarget->log(LOG_WARNING, "Failed to call dbus method: service:'%s' path:'%s' interface:'%s' method:'%s'", qPrintable(mService), qPrintable(mPath.path()), qPrintable(mInterface), qPrintable(mMethodName));
     }
 
-    return result;
+    return call;
 }
@@ -37,16 +37,19 @@
 #include <QDBusMessage>
 
 
+class NameOwnerCache;
+
 class MethodAction : public BaseAction
 {
 public:
-    MethodAction(LogTarget *logTarget, const QDBusConnection &connection, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description);
+    MethodAction(LogTarget *logTarget, const QDBusConnection &connection, NameOwnerCache *nameOwners, const QString &service, const QDBusObjectPath &path, const QString &interface, const QString &method, const QString &description);
+    ~MethodAction();
 
     static const char *id() { return "method"; }
 
     virtual const char *type() const { return id(); }
 
-    virtual bool call();
+    virtual ActionCompletion call(qulonglong eventTime);
 
     QString service() const { return mService; }
 
@@ -56,12 +59,18 @@ public:
 
     QString method() const { return mMethodName; }
 
+    // otherwise the call is skipped while the service has no owner, and never starts it
+    bool allowActivation() const { return mAllowActivation; }
+    void setAllowActivation(bool value) { mAllowActivation = value; }
+
 private:
     QDBusConnection mConnection;
+    NameOwnerCache *mNameOwners;
     QString mService;
     QDBusObjectPath mPath;
     QString mInterface;
     QString mMethodName;
+    bool mAllowActivation;
 };
 
 #endif // GLOBAL_ACTION_DAEMON__METHOD_ACTION__INCLUDED
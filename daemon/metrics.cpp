@@ -0,0 +1,137 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "metrics.h"
+
+#include <QStringList>
+#include <QTextStream>
+
+
+const char *x11opcodeToString(unsigned char opcode); // core.cpp
+
+
+namespace
+{
+
+typedef struct CounterInfo
+{
+    const char *name;
+    const char *help;
+} CounterInfo;
+
+const CounterInfo counterInfo[Metrics::COUNTER__COUNT] =
+{
+    {"key_events",            "Key presses received on grabbed shortcuts."},
+    {"key_events_dispatched", "Key presses matched to at least one action."},
+    {"key_events_unmatched",  "Key presses that matched no action."},
+    {"grab_requests",         "Shortcut grab requests sent to the X server."},
+    {"grab_failures",         "Shortcut grab requests rejected by the X server."},
+    {"ungrab_requests",       "Shortcut ungrab requests sent to the X server."},
+    {"ungrab_failures",       "Shortcut ungrab requests rejected by the X server."},
+    {"config_saves",          "Configuration file writes."},
+    {"spawn_failures",        "Command actions that failed to start."},
+    {"clients_connected",     "Native clients that registered their first action."},
+    {"clients_disconnected",  "Native clients that left the bus with actions registered."}
+};
+
+const char *metricPrefix = "lxqt_globalkeys_";
+
+}
+
+
+Metrics::Metrics()
+{
+}
+
+void Metrics::dbusCall(const QString &object, const QString &method)
+{
+    QMutexLocker lock(&mDBusCallsMutex);
+    ++mDBusCalls[object + "/" + method];
+}
+
+QMap<QString, qulonglong> Metrics::counters() const
+{
+    QMap<QString, qulonglong> result;
+
+    for (int counter = 0; counter < COUNTER__COUNT; ++counter)
+    {
+        result[counterInfo[counter].name] = static_cast<uint>(int(mCounters[counter]));
+    }
+
+    for (int opcode = 0; opcode < 256; ++opcode)
+    {
+        if (int count = mX11ErrorsByOpcode[opcode])
+        {
+            result[QString("x11_errors/") + x11opcodeToString(opcode)] += static_cast<uint>(count);
+        }
+    }
+
+    QMutexLocker lock(&mDBusCallsMutex);
+    QMap<QString, qulonglong>::const_iterator lastDBusCall = mDBusCalls.end();
+    for (QMap<QString, qulonglong>::const_iterator dbusCall = mDBusCalls.begin(); dbusCall != lastDBusCall; ++dbusCall)
+    {
+        result["dbus_calls" + dbusCall.key()] = dbusCall.value();
+    }
+
+    return result;
+}
+
+QString Metrics::text() const
+{
+    QString result;
+    QTextStream stream(&result);
+
+    for (int counter = 0; counter < COUNTER__COUNT; ++counter)
+    {
+        stream << "# HELP " << metricPrefix << counterInfo[counter].name << "_total " << counterInfo[counter].help << "\n";
+        stream << "# TYPE " << metricPrefix << counterInfo[counter].name << "_total counter\n";
+        stream << metricPrefix << counterInfo[counter].name << "_total " << static_cast<uint>(int(mCounters[counter])) << "\n";
+    }
+
+    stream << "# HELP " << metricPrefix << "x11_errors_total X errors by failed request.\n";
+    stream << "# TYPE " << metricPrefix << "x11_errors_total counter\n";
+    for (int opcode = 0; opcode < 256; ++opcode)
+    {
+        if (int count = mX11ErrorsByOpcode[opcode])
+        {
+            stream << metricPrefix << "x11_errors_total{request=\"" << x11opcodeToString(opcode) << "\",opcode=\"" << opcode << "\"} " << static_cast<uint>(count) << "\n";
+        }
+    }
+
+    stream << "# HELP " << metricPrefix << "dbus_calls_total D-Bus method calls by object and method.\n";
+    stream << "# TYPE " << metricPrefix << "dbus_calls_total counter\n";
+    QMutexLocker lock(&mDBusCallsMutex);
+    QMap<QString, qulonglong>::const_iterator lastDBusCall = mDBusCalls.end();
+    for (QMap<QString, qulonglong>::const_iterator dbusCall = mDBusCalls.begin(); dbusCall != lastDBusCall; ++dbusCall)
+    {
+        int separator = dbusCall.key().lastIndexOf('/');
+        stream << metricPrefix << "dbus_calls_total{object=\"" << dbusCall.key().left(separator) << "\",method=\"" << dbusCall.key().mid(separator + 1) << "\"} " << dbusCall.value() << "\n";
+    }
+
+    stream.flush();
+    return result;
+}
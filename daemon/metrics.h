@@ -0,0 +1,84 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__METRICS__INCLUDED
+#define GLOBAL_ACTION_DAEMON__METRICS__INCLUDED
+
+
+#include <QtGlobal>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMap>
+#include <QString>
+
+
+// Counters are lock-free, so the X11 event loop can bump them without contention.
+// Only the labelled D-Bus call counters take a mutex; they are never touched on key press.
+class Metrics
+{
+public:
+    typedef enum Counter
+    {
+        KEY_EVENTS = 0,
+        KEY_EVENTS_DISPATCHED,
+        KEY_EVENTS_UNMATCHED,
+        GRAB_REQUESTS,
+        GRAB_FAILURES,
+        UNGRAB_REQUESTS,
+        UNGRAB_FAILURES,
+        CONFIG_SAVES,
+        SPAWN_FAILURES,
+        CLIENTS_CONNECTED,
+        CLIENTS_DISCONNECTED,
+        COUNTER__COUNT
+    } Counter;
+
+    Metrics();
+
+    void increment(Counter counter) { mCounters[counter].ref(); }
+    void increment(Counter counter, int value) { mCounters[counter].fetchAndAddOrdered(value); }
+    void x11Error(unsigned char opcode) { mX11ErrorsByOpcode[opcode].ref(); }
+    void dbusCall(const QString &object, const QString &method);
+
+    // flat name -> value, labelled counters are keyed as "name/label"
+    QMap<QString, qulonglong> counters() const;
+    // Prometheus text exposition format
+    QString text() const;
+
+private:
+    Metrics(const Metrics &);
+    Metrics &operator = (const Metrics &);
+
+private:
+    QAtomicInt mCounters[COUNTER__COUNT];
+    QAtomicInt mX11ErrorsByOpcode[256];
+
+    mutable QMutex mDBusCallsMutex;
+    QMap<QString, qulonglong> mDBusCalls; // "object/method"
+};
+
+#endif // GLOBAL_ACTION_DAEMON__METRICS__INCLUDED
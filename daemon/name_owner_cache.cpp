@@ -0,0 +1,175 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "name_owner_cache.h"
+
+#include <QMutexLocker>
+#include <QStringList>
+#include <QDBusServiceWatcher>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusMessage>
+
+
+NameOwnerCache::NameOwnerCache(const QDBusConnection &connection, QObject *parent)
+    : QObject(parent)
+    , mConnection(connection)
+    , mWatcher(new QDBusServiceWatcher(this))
+    , mUpdateQueued(false)
+{
+    mWatcher->setConnection(mConnection);
+    mWatcher->setWatchMode(QDBusServiceWatcher::WatchForOwnerChange);
+    connect(mWatcher, SIGNAL(serviceOwnerChanged(QString, QString, QString)), this, SLOT(serviceOwnerChanged(QString, QString, QString)));
+}
+
+void NameOwnerCache::watch(const QString &service)
+{
+    QMutexLocker lock(&mMutex);
+
+    Entries::iterator entry = mEntries.find(service);
+    if (entry != mEntries.end())
+    {
+        ++entry.value().refs;
+        return;
+    }
+
+    Entry newEntry;
+    newEntry.refs = 1;
+    newEntry.owner = OWNER_UNKNOWN;
+    newEntry.watched = false;
+    mEntries.insert(service, newEntry);
+
+    if (!mUpdateQueued)
+    {
+        mUpdateQueued = true;
+        QMetaObject::invokeMethod(this, "updateWatchedServices", Qt::QueuedConnection);
+    }
+}
+
+void NameOwnerCache::unwatch(const QString &service)
+{
+    QMutexLocker lock(&mMutex);
+
+    Entries::iterator entry = mEntries.find(service);
+    if ((entry == mEntries.end()) || (--entry.value().refs > 0))
+    {
+        return;
+    }
+
+    // the match rule is dropped on the main thread, the entry goes with it
+    if (!mUpdateQueued)
+    {
+        mUpdateQueued = true;
+        QMetaObject::invokeMethod(this, "updateWatchedServices", Qt::QueuedConnection);
+    }
+}
+
+bool NameOwnerCache::isAbsent(const QString &service) const
+{
+    QMutexLocker lock(&mMutex);
+
+    Entries::const_iterator entry = mEntries.constFind(service);
+    return (entry != mEntries.constEnd()) && (entry.value().owner == OWNER_ABSENT);
+}
+
+void NameOwnerCache::updateWatchedServices()
+{
+    QStringList added;
+    QStringList removed;
+    {
+        QMutexLocker lock(&mMutex);
+
+        mUpdateQueued = false;
+
+        Entries::iterator entry = mEntries.begin();
+        while (entry != mEntries.end())
+        {
+            if (entry.value().refs <= 0)
+            {
+                if (entry.value().watched)
+                {
+                    removed.push_back(entry.key());
+                }
+                entry = mEntries.erase(entry);
+                continue;
+            }
+            if (!entry.value().watched)
+            {
+                entry.value().watched = true;
+                added.push_back(entry.key());
+            }
+            ++entry;
+        }
+    }
+
+    foreach(const QString &service, removed)
+    {
+        mWatcher->removeWatchedService(service);
+    }
+
+    foreach(const QString &service, added)
+    {
+        // the match rule goes first, so an owner change racing with the query is not missed
+        mWatcher->addWatchedService(service);
+
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(mConnection.asyncCall(QDBusMessage::createMethodCall("org.freedesktop.DBus", "/org/freedesktop/DBus", "org.freedesktop.DBus", "NameHasOwner") << service), this);
+        connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher *)), this, SLOT(nameHasOwnerFinished(QDBusPendingCallWatcher *)));
+        mNameHasOwnerCalls.insert(watcher, service);
+    }
+}
+
+void NameOwnerCache::serviceOwnerChanged(const QString &service, const QString &/*oldOwner*/, const QString &newOwner)
+{
+    QMutexLocker lock(&mMutex);
+
+    Entries::iterator entry = mEntries.find(service);
+    if (entry != mEntries.end())
+    {
+        entry.value().owner = newOwner.isEmpty() ? OWNER_ABSENT : OWNER_PRESENT;
+    }
+}
+
+void NameOwnerCache::nameHasOwnerFinished(QDBusPendingCallWatcher *watcher)
+{
+    QString service = mNameHasOwnerCalls.take(watcher);
+    watcher->deleteLater();
+
+    QDBusPendingReply<bool> reply = *watcher;
+    if (reply.isError())
+    {
+        return;
+    }
+
+    QMutexLocker lock(&mMutex);
+
+    Entries::iterator entry = mEntries.find(service);
+    // an owner change that arrived in the meantime is newer
+    if ((entry != mEntries.end()) && (entry.value().owner == OWNER_UNKNOWN))
+    {
+        entry.value().owner = reply.value() ? OWNER_PRESENT : OWNER_ABSENT;
+    }
+}
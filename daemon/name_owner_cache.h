@@ -0,0 +1,90 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__NAME_OWNER_CACHE__INCLUDED
+#define GLOBAL_ACTION_DAEMON__NAME_OWNER_CACHE__INCLUDED
+
+
+#include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QString>
+#include <QDBusConnection>
+
+
+class QDBusServiceWatcher;
+class QDBusPendingCallWatcher;
+
+// Whether the services called by method actions currently have an owner, kept up to date
+// by a NameOwnerChanged match rule per service instead of asking the bus on every key press.
+class NameOwnerCache : public QObject
+{
+    Q_OBJECT
+public:
+    NameOwnerCache(const QDBusConnection &connection, QObject *parent = 0);
+
+    // reference counted, may be called from any thread
+    void watch(const QString &service);
+    void unwatch(const QString &service);
+
+    // a service whose owner is not known yet is not absent
+    bool isAbsent(const QString &service) const;
+
+private slots:
+    void updateWatchedServices();
+    void serviceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner);
+    void nameHasOwnerFinished(QDBusPendingCallWatcher *watcher);
+
+private:
+    enum Owner
+    {
+        OWNER_UNKNOWN,
+        OWNER_PRESENT,
+        OWNER_ABSENT
+    };
+
+    typedef struct Entry
+    {
+        int refs;
+        Owner owner;
+        bool watched; // has its match rule
+    } Entry;
+
+    typedef QHash<QString, Entry> Entries;
+
+private:
+    QDBusConnection mConnection;
+    QDBusServiceWatcher *mWatcher;
+
+    mutable QMutex mMutex;
+    Entries mEntries;
+    bool mUpdateQueued;
+
+    QHash<QDBusPendingCallWatcher *, QString> mNameHasOwnerCalls;
+};
+
+#endif // GLOBAL_ACTION_DAEMON__NAME_OWNER_CACHE__INCLUDED
@@ -26,21 +26,27 @@
  * END_COMMON_COPYRIGHT_HEADER */
 
 #include "native_adaptor.h"
+#include "metrics.h"
+#include "trace.h"
 
 #include "org.lxqt.global_key_shortcuts.native.h"
 
 
-NativeAdaptor::NativeAdaptor(QObject *parent)
+NativeAdaptor::NativeAdaptor(Metrics *metrics, QObject *parent)
     : QObject(parent)
     , QDBusContext()
+    , mMetrics(metrics)
 {
     new OrgLxqtGlobalActionNativeAdaptor(this);
 }
 
 QString NativeAdaptor::addClientAction(const QString &shortcut, const QDBusObjectPath &path, const QString &description, qulonglong &id)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QPair<QString, qulonglong> result;
-    emit onAddClientAction(result, shortcut, path, description, calledFromDBus() ? message().service() : QString());
+    emit onAddClientAction(result, shortcut, path, description, calledFromDBus() ? message().service() : QString(), calledFromDBus() ? message() : QDBusMessage());
     QString usedShortcut = result.first;
     id = result.second;
     return usedShortcut;
@@ -48,6 +54,9 @@ QString NativeAdaptor::addClientAction(const QString &shortcut, const QDBusObjec
 
 bool NativeAdaptor::modifyClientAction(const QDBusObjectPath &path, const QString &description)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     qulonglong result;
     emit onModifyClientAction(result, path, description, calledFromDBus() ? message().service() : QString());
     return result;
@@ -55,14 +64,20 @@ bool NativeAdaptor::modifyClientAction(const QDBusObjectPath &path, const QStrin
 
 QString NativeAdaptor::changeClientActionShortcut(const QDBusObjectPath &path, const QString &shortcut)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QPair<QString, qulonglong> result;
-    emit onChangeClientActionShortcut(result, path, shortcut, calledFromDBus() ? message().service() : QString());
+    emit onChangeClientActionShortcut(result, path, shortcut, calledFromDBus() ? message().service() : QString(), calledFromDBus() ? message() : QDBusMessage());
     QString usedShortcut = result.first;
     return usedShortcut;
 }
 
 bool NativeAdaptor::removeClientAction(const QDBusObjectPath &path)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     bool result;
     emit onRemoveClientAction(result, path, calledFromDBus() ? message().service() : QString());
     return result;
@@ -70,6 +85,9 @@ bool NativeAdaptor::removeClientAction(const QDBusObjectPath &path)
 
 bool NativeAdaptor::deactivateClientAction(const QDBusObjectPath &path)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     bool result;
     emit onDeactivateClientAction(result, path, calledFromDBus() ? message().service() : QString());
     return result;
@@ -77,6 +95,9 @@ bool NativeAdaptor::deactivateClientAction(const QDBusObjectPath &path)
 
 bool NativeAdaptor::enableClientAction(const QDBusObjectPath &path, bool enabled)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     bool result;
     emit onEnableClientAction(result, path, enabled, calledFromDBus() ? message().service() : QString());
     return result;
@@ -84,6 +105,9 @@ bool NativeAdaptor::enableClientAction(const QDBusObjectPath &path, bool enabled
 
 bool NativeAdaptor::isClientActionEnabled(const QDBusObjectPath &path)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     bool enabled;
     emit onIsClientActionEnabled(enabled, path, calledFromDBus() ? message().service() : QString());
     return enabled;
@@ -91,6 +115,9 @@ bool NativeAdaptor::isClientActionEnabled(const QDBusObjectPath &path)
 
 QString NativeAdaptor::grabShortcut(uint timeout, bool &failed, bool &cancelled, bool &timedout)
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     QString shortcut;
     emit onGrabShortcut(timeout, shortcut, failed, cancelled, timedout, message());
     return shortcut;
@@ -98,5 +125,52 @@ QString NativeAdaptor::grabShortcut(uint timeout, bool &failed, bool &cancelled,
 
 void NativeAdaptor::cancelShortcutGrab()
 {
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
     emit onCancelShortcutGrab();
 }
+
+QDBusUnixFileDescriptor NativeAdaptor::openActivationChannel(QDBusUnixFileDescriptor &event)
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    if (!calledFromDBus() || !(connection().connectionCapabilities() & QDBusConnection::UnixFileDescriptorPassing))
+    {
+        sendErrorReply(QDBusError::NotSupported, "Unix file descriptor passing is not available");
+        return QDBusUnixFileDescriptor();
+    }
+
+    QPair<int, int> result(-1, -1);
+    emit onOpenActivationChannel(result, message().service());
+    if ((result.first == -1) || (result.second == -1))
+    {
+        sendErrorReply(QDBusError::Failed, "Cannot create activation channel");
+        return QDBusUnixFileDescriptor();
+    }
+    // QDBusUnixFileDescriptor duplicates, the daemon keeps its own descriptors
+    event = QDBusUnixFileDescriptor(result.second);
+    return QDBusUnixFileDescriptor(result.first);
+}
+
+void NativeAdaptor::activationChannelAccepted()
+{
+    TRACE_SPAN("dbus", __FUNCTION__);
+    countCall();
+
+    if (!calledFromDBus())
+    {
+        return;
+    }
+
+    emit onActivationChannelAccepted(message().service());
+}
+
+void NativeAdaptor::countCall()
+{
+    if (calledFromDBus())
+    {
+        mMetrics->dbusCall(message().path(), message().member());
+    }
+}
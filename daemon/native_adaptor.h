@@ -32,14 +32,17 @@
 #include <QObject>
 #include <QDBusObjectPath>
 #include <QDBusContext>
+#include <QDBusUnixFileDescriptor>
 #include <QPair>
 
 
+class Metrics;
+
 class NativeAdaptor : public QObject, protected QDBusContext
 {
     Q_OBJECT
 public:
-    NativeAdaptor(QObject *parent = 0);
+    NativeAdaptor(Metrics *metrics, QObject *parent = 0);
 
     QString addClientAction(const QString &shortcut, const QDBusObjectPath &path, const QString &description, qulonglong &id);
     bool modifyClientAction(const QDBusObjectPath &path, const QString &description);
@@ -52,10 +55,13 @@ public:
     QString grabShortcut(uint timeout, bool &failed, bool &cancelled, bool &timedout);
     void cancelShortcutGrab();
 
+    QDBusUnixFileDescriptor openActivationChannel(QDBusUnixFileDescriptor &event);
+    void activationChannelAccepted();
+
 signals:
-    void onAddClientAction(QPair<QString, qulonglong> &, const QString &, const QDBusObjectPath &, const QString &, const QString &);
+    void onAddClientAction(QPair<QString, qulonglong> &, const QString &, const QDBusObjectPath &, const QString &, const QString &, const QDBusMessage &);
     void onModifyClientAction(qulonglong &, const QDBusObjectPath &, const QString &, const QString &);
-    void onChangeClientActionShortcut(QPair<QString, qulonglong> &, const QDBusObjectPath &, const QString &, const QString &);
+    void onChangeClientActionShortcut(QPair<QString, qulonglong> &, const QDBusObjectPath &, const QString &, const QString &, const QDBusMessage &);
     void onRemoveClientAction(bool &, const QDBusObjectPath &, const QString &);
     void onDeactivateClientAction(bool &, const QDBusObjectPath &, const QString &);
     void onEnableClientAction(bool &, const QDBusObjectPath &, bool, const QString &);
@@ -64,6 +70,15 @@ signals:
     void onGrabShortcut(uint, QString &, bool &, bool &, bool &, const QDBusMessage &);
     void onCancelShortcutGrab();
 
+    void onOpenActivationChannel(QPair<int, int> &, const QString &);
+    void onActivationChannelAccepted(const QString &);
+
+
+private:
+    void countCall();
+
+private:
+    Metrics *mMetrics;
 };
 
 #endif // GLOBAL_ACTION_DAEMON__NATIVE_ADAPTOR__INCLUDED
@@ -39,16 +39,12 @@ void initBothPipeEnds(int fd[2])
 
 error_t createPipe(int fd[2])
 {
+    // atomically close-on-exec, a fork on another thread must not inherit the ends in between
     error_t result = 0;
-    if (pipe(fd) < 0)
+    if (pipe2(fd, O_CLOEXEC) < 0)
     {
         result = errno;
     }
-    if (!result)
-    {
-        fcntl(fd[STDIN_FILENO], F_SETFD, FD_CLOEXEC);
-        fcntl(fd[STDOUT_FILENO], F_SETFD, FD_CLOEXEC);
-    }
     return result;
 }
 
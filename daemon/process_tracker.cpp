@@ -0,0 +1,309 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "process_tracker.h"
+#include "pipe_utils.h"
+#include "log_target.h"
+#include "trace.h"
+
+#include <QMutexLocker>
+#include <QSocketNotifier>
+#include <QFile>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <string.h>
+
+
+// written to by the SIGCHLD handler, read on the main thread
+static int s_childPipe[2] = { -1, -1 };
+
+static void childSignalHandler(int /*signalNumber*/)
+{
+    int savedErrno = errno;
+    char signal = 0;
+    if (write(s_childPipe[STDOUT_FILENO], &signal, sizeof(signal)) < 0)
+    {
+        ; // the pipe is full, a reap is pending anyway
+    }
+    errno = savedErrno;
+}
+
+
+ProcessTracker::ProcessTracker(LogTarget *logTarget, QObject *parent)
+    : QObject(parent)
+    , mLogTarget(logTarget)
+    , mChildNotifier(0)
+{
+    if (error_t error = createPipe(s_childPipe))
+    {
+        // the kernel reaps them then, nothing is counted
+        mLogTarget->log(LOG_WARNING, "Cannot create child signal pipe, children will not be tracked: %s", strerror(error));
+        ::signal(SIGCHLD, SIG_IGN);
+        return;
+    }
+    fcntl(s_childPipe[STDIN_FILENO], F_SETFL, O_NONBLOCK);
+    fcntl(s_childPipe[STDOUT_FILENO], F_SETFL, O_NONBLOCK);
+
+    mChildNotifier = new QSocketNotifier(s_childPipe[STDIN_FILENO], QSocketNotifier::Read, this);
+    connect(mChildNotifier, SIGNAL(activated(int)), this, SLOT(reap()));
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = childSignalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &action, 0);
+}
+
+ProcessTracker::~ProcessTracker()
+{
+    // the children outlive the daemon, whoever adopts them reaps them
+    ::signal(SIGCHLD, SIG_DFL);
+
+    delete mChildNotifier;
+    closeBothPipeEnds(s_childPipe);
+}
+
+pid_t ProcessTracker::spawn(Owner owner, const QString &executable, const QStringList &args, error_t &error)
+{
+    // everything the child needs is prepared before forking, it may only call async-signal-safe functions
+    QByteArray path = QFile::encodeName(executable);
+    QList<QByteArray> arguments;
+    arguments.push_back(path);
+    foreach(const QString &arg, args)
+    {
+        arguments.push_back(arg.toLocal8Bit());
+    }
+    QVector<char *> argv;
+    for (QList<QByteArray>::iterator argument = arguments.begin(); argument != arguments.end(); ++argument)
+    {
+        argv.push_back(argument->data());
+    }
+    argv.push_back(0);
+
+    // closed on exec, so reading it tells whether exec succeeded; createPipe sets close-on-exec atomically,
+    // so children forked meanwhile by other threads do not hold the write end open
+    int execPipe[2];
+    initBothPipeEnds(execPipe);
+    if ((error = createPipe(execPipe)))
+    {
+        return 0;
+    }
+
+    // the lock makes sure the reaper knows the pid before the child can be reaped
+    QMutexLocker lock(&mMutex);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        error = errno;
+        closeBothPipeEnds(execPipe);
+        return 0;
+    }
+
+    if (!pid)
+    {
+        setsid();
+        execv(path.constData(), argv.data());
+        error_t execError = errno;
+        if (write(execPipe[STDOUT_FILENO], &execError, sizeof(execError)) < 0)
+        {
+            ;
+        }
+        _exit(127);
+    }
+
+    close(execPipe[STDOUT_FILENO]);
+    execPipe[STDOUT_FILENO] = -1;
+
+    Child child;
+    child.owner = owner;
+    child.started = Trace::now();
+
+    error_t execError = 0;
+    if (!readAll(execPipe[STDIN_FILENO], &execError, sizeof(execError)))
+    {
+        // reaped by the next SIGCHLD
+        error = execError;
+        if (mChildNotifier)
+        {
+            child.owner = 0;
+            mChildByPid.insert(pid, child);
+        }
+        closeBothPipeEnds(execPipe);
+        return 0;
+    }
+    closeBothPipeEnds(execPipe);
+
+    if (mChildNotifier)
+    {
+        mChildByPid.insert(pid, child);
+        ++mRunningByOwner[owner];
+    }
+    ++usageOf(owner).launches;
+
+    error = 0;
+    return pid;
+}
+
+int ProcessTracker::running(Owner owner) const
+{
+    QMutexLocker lock(&mMutex);
+
+    return mRunningByOwner.value(owner);
+}
+
+CommandActionUsage ProcessTracker::usage(Owner owner) const
+{
+    QMutexLocker lock(&mMutex);
+
+    QHash<Owner, CommandActionUsage>::const_iterator usage = mUsageByOwner.constFind(owner);
+    if (usage != mUsageByOwner.constEnd())
+    {
+        return usage.value();
+    }
+
+    CommandActionUsage result;
+    memset(&result, 0, sizeof(result));
+    return result;
+}
+
+void ProcessTracker::transfer(Owner from, Owner to)
+{
+    QMutexLocker lock(&mMutex);
+
+    QHash<Owner, int>::iterator running = mRunningByOwner.find(from);
+    if (running != mRunningByOwner.end())
+    {
+        mRunningByOwner[to] += running.value();
+        mRunningByOwner.erase(running);
+    }
+
+    QHash<Owner, CommandActionUsage>::iterator usage = mUsageByOwner.find(from);
+    if (usage != mUsageByOwner.end())
+    {
+        mUsageByOwner.insert(to, usage.value());
+        mUsageByOwner.erase(usage);
+    }
+
+    QHash<pid_t, Child>::iterator lastChildByPid = mChildByPid.end();
+    for (QHash<pid_t, Child>::iterator childByPid = mChildByPid.begin(); childByPid != lastChildByPid; ++childByPid)
+    {
+        if (childByPid.value().owner == from)
+        {
+            childByPid.value().owner = to;
+        }
+    }
+}
+
+void ProcessTracker::forget(Owner owner)
+{
+    QMutexLocker lock(&mMutex);
+
+    mRunningByOwner.remove(owner);
+    mUsageByOwner.remove(owner);
+
+    QHash<pid_t, Child>::iterator lastChildByPid = mChildByPid.end();
+    for (QHash<pid_t, Child>::iterator childByPid = mChildByPid.begin(); childByPid != lastChildByPid; ++childByPid)
+    {
+        if (childByPid.value().owner == owner)
+        {
+            childByPid.value().owner = 0;
+        }
+    }
+}
+
+void ProcessTracker::reap()
+{
+    char signals[64];
+    while (read(s_childPipe[STDIN_FILENO], signals, sizeof(signals)) > 0)
+    {
+        ;
+    }
+
+    QMutexLocker lock(&mMutex);
+
+    // only our own children are waited for, anything else may belong to someone else in the process
+    QHash<pid_t, Child>::iterator childByPid = mChildByPid.begin();
+    while (childByPid != mChildByPid.end())
+    {
+        int status = 0;
+        struct rusage resources;
+        memset(&resources, 0, sizeof(resources));
+        pid_t pid = wait4(childByPid.key(), &status, WNOHANG, &resources);
+        if ((pid == 0) || ((pid < 0) && (errno == EINTR)))
+        {
+            ++childByPid;
+            continue;
+        }
+
+        Owner owner = childByPid.value().owner;
+
+        if ((pid > 0) && owner)
+        {
+            int exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : (WIFSIGNALED(status) ? -WTERMSIG(status) : 0);
+
+            CommandActionUsage &usage = usageOf(owner);
+            ++usage.exited;
+            usage.wallTime += (Trace::now() - childByPid.value().started) / 1000;
+            usage.cpuTime += (resources.ru_utime.tv_sec + resources.ru_stime.tv_sec) * 1000ull + (resources.ru_utime.tv_usec + resources.ru_stime.tv_usec) / 1000;
+            usage.maxRss = qMax(usage.maxRss, static_cast<qulonglong>(resources.ru_maxrss));
+            usage.lastExitStatus = exitStatus;
+
+            mLogTarget->log(LOG_DEBUG, "Child %d exited with status %d", static_cast<int>(pid), exitStatus);
+        }
+
+        if (owner)
+        {
+            QHash<Owner, int>::iterator running = mRunningByOwner.find(owner);
+            if ((running != mRunningByOwner.end()) && (--running.value() <= 0))
+            {
+                mRunningByOwner.erase(running);
+            }
+        }
+        childByPid = mChildByPid.erase(childByPid);
+    }
+}
+
+CommandActionUsage &ProcessTracker::usageOf(Owner owner)
+{
+    QHash<Owner, CommandActionUsage>::iterator usage = mUsageByOwner.find(owner);
+    if (usage == mUsageByOwner.end())
+    {
+        CommandActionUsage empty;
+        memset(&empty, 0, sizeof(empty));
+        usage = mUsageByOwner.insert(owner, empty);
+    }
+    return usage.value();
+}
@@ -0,0 +1,94 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__PROCESS_TRACKER__INCLUDED
+#define GLOBAL_ACTION_DAEMON__PROCESS_TRACKER__INCLUDED
+
+
+#include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <sys/types.h>
+#include <errno.h>
+
+#include "meta_types.h"
+
+
+class QSocketNotifier;
+class LogTarget;
+
+// Spawns the processes of command actions in their own session and reaps them on SIGCHLD,
+// so the daemon knows how many children each action has running.
+class ProcessTracker : public QObject
+{
+    Q_OBJECT
+public:
+    typedef const void *Owner;
+
+    ProcessTracker(LogTarget *logTarget, QObject *parent = 0);
+    ~ProcessTracker();
+
+    // may be called from any thread, returns 0 and sets error if the process could not be started
+    pid_t spawn(Owner owner, const QString &executable, const QStringList &args, error_t &error);
+
+    // may be called from any thread
+    int running(Owner owner) const;
+    CommandActionUsage usage(Owner owner) const;
+
+    // an owner replaced by another one, its children and usage move over
+    void transfer(Owner from, Owner to);
+    // the owner goes away, its children are still reaped
+    void forget(Owner owner);
+
+private slots:
+    void reap();
+
+private:
+    // under mMutex
+    CommandActionUsage &usageOf(Owner owner);
+
+private:
+    LogTarget *mLogTarget;
+
+    QSocketNotifier *mChildNotifier;
+
+    typedef struct Child
+    {
+        Owner owner;
+        quint64 started; // us, Trace::now()
+    } Child;
+
+    mutable QMutex mMutex;
+    QHash<pid_t, Child> mChildByPid;
+    QHash<Owner, int> mRunningByOwner;
+    QHash<Owner, CommandActionUsage> mUsageByOwner;
+};
+
+#endif // GLOBAL_ACTION_DAEMON__PROCESS_TRACKER__INCLUDED
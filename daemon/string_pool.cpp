@@ -0,0 +1,135 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "string_pool.h"
+
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+
+
+namespace
+{
+
+QMutex poolMutex;
+QSet<QString> pool;
+
+}
+
+
+QString StringPool::intern(const QString &string)
+{
+    if (string.isEmpty())
+    {
+        return QString();
+    }
+
+    QMutexLocker lock(&poolMutex);
+
+    QSet<QString>::const_iterator interned = pool.constFind(string);
+    if (interned != pool.constEnd())
+    {
+        return *interned;
+    }
+
+    pool.insert(string);
+    return string;
+}
+
+QStringList StringPool::intern(const QStringList &strings)
+{
+    QStringList result;
+#if QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
+    result.reserve(strings.size());
+#endif
+
+    QStringList::const_iterator lastString = strings.constEnd();
+    for (QStringList::const_iterator string = strings.constBegin(); string != lastString; ++string)
+    {
+        result.push_back(intern(*string));
+    }
+
+    return result;
+}
+
+QDBusObjectPath StringPool::intern(const QDBusObjectPath &path)
+{
+    return QDBusObjectPath(intern(path.path()));
+}
+
+void StringPool::purge()
+{
+    QMutexLocker lock(&poolMutex);
+
+    QSet<QString>::iterator string = pool.begin();
+    while (string != pool.end())
+    {
+        if (string->isDetached())
+        {
+            string = pool.erase(string);
+        }
+        else
+        {
+            ++string;
+        }
+    }
+}
+
+int StringPool::count()
+{
+    QMutexLocker lock(&poolMutex);
+
+    return pool.size();
+}
+
+qulonglong StringPool::bytes()
+{
+    QMutexLocker lock(&poolMutex);
+
+    qulonglong result = 0;
+
+    QSet<QString>::const_iterator lastString = pool.constEnd();
+    for (QSet<QString>::const_iterator string = pool.constBegin(); string != lastString; ++string)
+    {
+        result += bytes(*string);
+    }
+
+    return result;
+}
+
+qulonglong StringPool::bytes(const QStringList &strings)
+{
+    qulonglong result = 0;
+
+    QStringList::const_iterator lastString = strings.constEnd();
+    for (QStringList::const_iterator string = strings.constBegin(); string != lastString; ++string)
+    {
+        result += bytes(*string);
+    }
+
+    return result;
+}
@@ -0,0 +1,59 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__STRING_POOL__INCLUDED
+#define GLOBAL_ACTION_DAEMON__STRING_POOL__INCLUDED
+
+
+#include <QtGlobal>
+#include <QString>
+#include <QStringList>
+#include <QDBusObjectPath>
+
+
+// Equal strings handed out by the pool share one implicitly shared buffer,
+// so action metadata takes memory per distinct string rather than per action.
+// Shared by the daemon and the config tool; thread safe.
+class StringPool
+{
+public:
+    static QString intern(const QString &string);
+    static QStringList intern(const QStringList &strings);
+    static QDBusObjectPath intern(const QDBusObjectPath &path);
+
+    // drops the strings only the pool still refers to
+    static void purge();
+
+    static int count();
+    // bytes held by the distinct strings
+    static qulonglong bytes();
+    // bytes a string would take on its own
+    static qulonglong bytes(const QString &string) { return static_cast<qulonglong>(string.capacity() + 1) * sizeof(QChar); }
+    static qulonglong bytes(const QStringList &strings);
+};
+
+#endif // GLOBAL_ACTION_DAEMON__STRING_POOL__INCLUDED
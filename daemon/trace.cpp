@@ -0,0 +1,218 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "trace.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <QList>
+#include <QByteArray>
+#include <QFile>
+
+#include <unistd.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+
+namespace
+{
+
+typedef struct TraceEvent
+{
+    const char *category;
+    const char *name;
+    quint64 start;
+    quint64 duration;
+    char phase;
+} TraceEvent;
+
+class ThreadBuffer
+{
+public:
+    ThreadBuffer()
+        : tid(syscall(SYS_gettid))
+        , dropped(0)
+    {
+    }
+
+    QMutex mutex; // only contended while write() runs
+    long tid;
+    QByteArray name;
+    QVector<TraceEvent> events;
+    quint64 dropped;
+};
+
+// buffers live until exit: threads may end before the trace is written
+__thread ThreadBuffer *currentBuffer = 0;
+
+QMutex buffersMutex;
+QList<ThreadBuffer *> buffers;
+QString traceFile;
+quint64 origin = 0;
+
+const int maxEventsPerThread = 1 << 20;
+
+ThreadBuffer *threadBuffer()
+{
+    if (!currentBuffer)
+    {
+        currentBuffer = new ThreadBuffer;
+        QMutexLocker lock(&buffersMutex);
+        buffers << currentBuffer;
+    }
+    return currentBuffer;
+}
+
+void record(const char *category, const char *name, quint64 start, quint64 duration, char phase)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    QMutexLocker lock(&buffer->mutex);
+    if (buffer->events.size() >= maxEventsPerThread)
+    {
+        ++buffer->dropped;
+        return;
+    }
+    TraceEvent event = {category, name, start, duration, phase};
+    buffer->events << event;
+}
+
+QByteArray escape(const char *str)
+{
+    QByteArray result(str);
+    result.replace('\\', "\\\\");
+    result.replace('"', "\\\"");
+    return result;
+}
+
+}
+
+
+bool Trace::sEnabled = false;
+
+void Trace::enable(const QString &fileName)
+{
+    traceFile = fileName;
+    origin = now();
+    sEnabled = true;
+}
+
+quint64 Trace::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<quint64>(ts.tv_sec) * 1000000ull + ts.tv_nsec / 1000;
+}
+
+void Trace::setThreadName(const char *name)
+{
+    if (!sEnabled)
+    {
+        return;
+    }
+    ThreadBuffer *buffer = threadBuffer();
+    QMutexLocker lock(&buffer->mutex);
+    buffer->name = name;
+}
+
+void Trace::complete(const char *category, const char *name, quint64 start, quint64 end)
+{
+    record(category, name, start, end - start, 'X');
+}
+
+void Trace::instant(const char *category, const char *name)
+{
+    record(category, name, now(), 0, 'i');
+}
+
+bool Trace::write()
+{
+    if (!sEnabled)
+    {
+        return false;
+    }
+
+    QString temporaryFile = traceFile + ".tmp";
+    QFile file(temporaryFile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    long pid = getpid();
+    const char *separator = "";
+    char line[256];
+
+    file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    QMutexLocker buffersLock(&buffersMutex);
+    QList<ThreadBuffer *>::const_iterator lastBuffer = buffers.end();
+    for (QList<ThreadBuffer *>::const_iterator bufferI = buffers.begin(); bufferI != lastBuffer; ++bufferI)
+    {
+        ThreadBuffer *buffer = *bufferI;
+        QMutexLocker lock(&buffer->mutex);
+
+        if (!buffer->name.isEmpty())
+        {
+            file.write(separator);
+            file.write("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":");
+            file.write(QByteArray::number(static_cast<qlonglong>(pid)) + ",\"tid\":" + QByteArray::number(static_cast<qlonglong>(buffer->tid)) + ",\"args\":{\"name\":\"" + escape(buffer->name.constData()) + "\"}}");
+            separator = ",\n";
+        }
+
+        QVector<TraceEvent>::const_iterator lastEvent = buffer->events.end();
+        for (QVector<TraceEvent>::const_iterator event = buffer->events.begin(); event != lastEvent; ++event)
+        {
+            file.write(separator);
+            file.write("{\"cat\":\"" + escape(event->category) + "\",\"name\":\"" + escape(event->name) + "\",");
+            if (event->phase == 'X')
+            {
+                snprintf(line, sizeof(line), "\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":%ld,\"tid\":%ld}", event->start - origin, event->duration, pid, buffer->tid);
+            }
+            else
+            {
+                snprintf(line, sizeof(line), "\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu,\"pid\":%ld,\"tid\":%ld}", event->start - origin, pid, buffer->tid);
+            }
+            file.write(line);
+            separator = ",\n";
+        }
+
+        if (buffer->dropped)
+        {
+            file.write(separator);
+            snprintf(line, sizeof(line), "{\"ph\":\"M\",\"name\":\"dropped_events\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"count\":%llu}}", pid, buffer->tid, buffer->dropped);
+            file.write(line);
+            separator = ",\n";
+        }
+    }
+
+    file.write("\n]}\n");
+    file.close();
+
+    return rename(QFile::encodeName(temporaryFile).constData(), QFile::encodeName(traceFile).constData()) == 0;
+}
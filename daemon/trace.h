@@ -0,0 +1,93 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__TRACE__INCLUDED
+#define GLOBAL_ACTION_DAEMON__TRACE__INCLUDED
+
+
+#include <QtGlobal>
+#include <QString>
+
+
+// Chrome trace-event recorder. Events go to per-thread buffers and are written
+// as JSON (loadable in Perfetto or about:tracing) by write().
+// When tracing is off every probe costs one test of a static bool.
+class Trace
+{
+public:
+    static bool isEnabled() { return sEnabled; }
+
+    // must be called before any other thread is started
+    static void enable(const QString &fileName);
+    static bool write();
+
+    static void setThreadName(const char *name);
+
+    static quint64 now();
+    static void complete(const char *category, const char *name, quint64 start, quint64 end);
+    static void instant(const char *category, const char *name);
+
+private:
+    static bool sEnabled;
+};
+
+class TraceSpan
+{
+public:
+    TraceSpan(const char *category, const char *name)
+        : mCategory(category)
+        , mName(Trace::isEnabled() ? name : 0)
+        , mStart(mName ? Trace::now() : 0)
+    {
+    }
+
+    ~TraceSpan()
+    {
+        if (mName)
+        {
+            Trace::complete(mCategory, mName, mStart, Trace::now());
+        }
+    }
+
+private:
+    TraceSpan(const TraceSpan &);
+    TraceSpan &operator = (const TraceSpan &);
+
+private:
+    const char *mCategory;
+    const char *mName;
+    quint64 mStart;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// 'category' and 'name' must be string literals or otherwise outlive the trace
+#define TRACE_SPAN(category, name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(category, name)
+#define TRACE_INSTANT(category, name) do { if (Trace::isEnabled()) Trace::instant(category, name); } while (0)
+
+#endif // GLOBAL_ACTION_DAEMON__TRACE__INCLUDED
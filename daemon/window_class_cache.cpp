@@ -0,0 +1,91 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "window_class_cache.h"
+
+
+WindowClassCache::WindowClassCache(int capacity)
+    : mCapacity(capacity)
+{
+}
+
+bool WindowClassCache::find(WindowId window, QString &windowClass)
+{
+    Entries::iterator entry = mEntries.find(window);
+    if (entry == mEntries.end())
+    {
+        return false;
+    }
+
+    mRecent.erase(entry.value().recent);
+    mRecent.prepend(window);
+    entry.value().recent = mRecent.begin();
+
+    windowClass = entry.value().windowClass;
+    return true;
+}
+
+WindowClassCache::WindowId WindowClassCache::insert(WindowId window, const QString &windowClass)
+{
+    Entries::iterator entry = mEntries.find(window);
+    if (entry != mEntries.end())
+    {
+        mRecent.erase(entry.value().recent);
+        mRecent.prepend(window);
+        entry.value().recent = mRecent.begin();
+        entry.value().windowClass = windowClass;
+        return 0;
+    }
+
+    WindowId evicted = 0;
+    if (mEntries.size() >= mCapacity)
+    {
+        evicted = mRecent.takeLast();
+        mEntries.remove(evicted);
+    }
+
+    mRecent.prepend(window);
+    Entry newEntry;
+    newEntry.windowClass = windowClass;
+    newEntry.recent = mRecent.begin();
+    mEntries.insert(window, newEntry);
+
+    return evicted;
+}
+
+bool WindowClassCache::remove(WindowId window)
+{
+    Entries::iterator entry = mEntries.find(window);
+    if (entry == mEntries.end())
+    {
+        return false;
+    }
+
+    mRecent.erase(entry.value().recent);
+    mEntries.erase(entry);
+    return true;
+}
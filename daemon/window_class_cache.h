@@ -0,0 +1,69 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__WINDOW_CLASS_CACHE__INCLUDED
+#define GLOBAL_ACTION_DAEMON__WINDOW_CLASS_CACHE__INCLUDED
+
+
+#include <QHash>
+#include <QLinkedList>
+#include <QString>
+
+
+// WM_CLASS by window id, least recently used windows are dropped first.
+// Only used by the X11 thread, so it is not locked.
+class WindowClassCache
+{
+public:
+    typedef unsigned long WindowId;
+
+    explicit WindowClassCache(int capacity);
+
+    bool find(WindowId window, QString &windowClass);
+    // returns the window that had to make room, or 0
+    WindowId insert(WindowId window, const QString &windowClass);
+    bool remove(WindowId window);
+
+    int size() const { return mEntries.size(); }
+
+private:
+    typedef QLinkedList<WindowId> Recent;
+
+    typedef struct Entry
+    {
+        QString windowClass;
+        Recent::iterator recent;
+    } Entry;
+
+    typedef QHash<WindowId, Entry> Entries;
+
+    int mCapacity;
+    Entries mEntries;
+    Recent mRecent; // most recently used first
+};
+
+#endif // GLOBAL_ACTION_DAEMON__WINDOW_CLASS_CACHE__INCLUDED
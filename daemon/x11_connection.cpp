@@ -0,0 +1,1005 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+
+#include <stdexcept>
+
+#include "pipe_utils.h"
+#include "trace.h"
+#include "keysym_table.h"
+#include "core.h"
+
+#include "x11_connection.h"
+
+extern "C" {
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include <X11/XKBlib.h>
+#undef Bool
+}
+
+
+enum
+{
+    X11_OP_XSwitchGrabs,
+    X11_OP_XGrabKeyboard,
+    X11_OP_XUngrabKeyboard
+};
+
+
+// number of windows whose WM_CLASS is remembered for context bindings
+static const int windowClassCacheSize = 64;
+
+// shortcuts per grab switch request, the X11 thread only reads the pipe once it is woken,
+// so a request has to fit into the pipe buffer (at least 64 KiB on Linux, up to 6 bytes per shortcut)
+static const int switchGrabsChunkSize = 4096;
+
+// milliseconds a key press waits for a request from the main thread before trying mDataMutex again
+static const int keyPressLockPollInterval = 10;
+
+
+const char *x11opcodeToString(unsigned char opcode); // core.cpp
+
+
+X11Connection::X11Connection(Core *core, const QString &displayName)
+    : QThread()
+    , mCore(core)
+    , mDisplayName(displayName)
+    , mThreadName(displayName.isEmpty() ? QByteArray("X11") : "X11 " + displayName.toLocal8Bit())
+    , mDisplay(0)
+    , mInterClientCommunicationWindow(0)
+    , mX11EventLoopActive(true)
+    , mLastGrabTicket(0)
+    , mGrabbingShortcut(false)
+    , mAllShifts(0)
+    , mWindowClassCache(windowClassCacheSize)
+{
+    initBothPipeEnds(mX11ErrorPipe);
+    initBothPipeEnds(mX11RequestPipe);
+    initBothPipeEnds(mX11ResponsePipe);
+
+    error_t c_error;
+
+    if ((c_error = createPipe(mX11ErrorPipe)))
+    {
+        throw std::runtime_error(std::string("Cannot create error signal pipe: ") + std::string(strerror(c_error)));
+    }
+
+    if ((c_error = createPipe(mX11RequestPipe)))
+    {
+        throw std::runtime_error(std::string("Cannot create X11 request pipe: ") + std::string(strerror(c_error)));
+    }
+
+    if ((c_error = createPipe(mX11ResponsePipe)))
+    {
+        throw std::runtime_error(std::string("Cannot create X11 response pipe: ") + std::string(strerror(c_error)));
+    }
+
+    // opened here rather than on the thread, so the error handler can tell the connections apart from the start
+    {
+        TRACE_SPAN("startup", "open X display");
+        QByteArray name = mDisplayName.toLocal8Bit();
+        mDisplay = XOpenDisplay(name.isEmpty() ? NULL : name.constData());
+    }
+    if (!mDisplay)
+    {
+        throw std::runtime_error(std::string("Cannot open display '") + std::string(XDisplayName(mDisplayName.isEmpty() ? NULL : qPrintable(mDisplayName))) + std::string("'"));
+    }
+    XSynchronize(mDisplay, True);
+}
+
+X11Connection::X11Connection(Core *core)
+    : QThread()
+    , mCore(core)
+    , mDisplay(0)
+    , mInterClientCommunicationWindow(0)
+    , mX11EventLoopActive(false)
+    , mLastGrabTicket(0)
+    , mGrabbingShortcut(false)
+    , mAllShifts(0)
+    , mWindowClassCache(windowClassCacheSize)
+{
+    initBothPipeEnds(mX11ErrorPipe);
+    initBothPipeEnds(mX11RequestPipe);
+    initBothPipeEnds(mX11ResponsePipe);
+}
+
+X11Connection::~X11Connection()
+{
+    stop();
+
+    if (mDisplay)
+    {
+        XCloseDisplay(mDisplay);
+    }
+}
+
+void X11Connection::waitStarted()
+{
+    char signal;
+    error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &signal, sizeof(signal));
+    if (error > 0)
+    {
+        throw std::runtime_error(std::string("Cannot read X11 start signal: ") + std::string(strerror(error)));
+    }
+    if (error < 0)
+    {
+        throw std::runtime_error(std::string("Cannot read X11 start signal"));
+    }
+    if (signal)
+    {
+        throw std::runtime_error(std::string("Cannot start X11 thread for display '") + std::string(DisplayString(mDisplay)) + std::string("'"));
+    }
+}
+
+void X11Connection::stop()
+{
+    closeBothPipeEnds(mX11ErrorPipe);
+    closeBothPipeEnds(mX11RequestPipe);
+    closeBothPipeEnds(mX11ResponsePipe);
+
+    mX11EventLoopActive = false;
+    wakeX11Thread();
+    wait();
+}
+
+int X11Connection::x11ErrorHandler(XErrorEvent *errorEvent)
+{
+    mCore->mMetrics.x11Error(errorEvent->request_code);
+
+    if (error_t error = writeAll(mX11ErrorPipe[STDOUT_FILENO], errorEvent, sizeof(XErrorEvent)))
+    {
+        mCore->log(LOG_CRIT, "Cannot write to error signal pipe: %s", strerror(error));
+        qApp->quit();
+        return 0;
+    }
+
+    return 0;
+}
+
+bool X11Connection::waitForX11Error(int level, uint timeout)
+{
+    pollfd fds[1];
+    fds[0].fd = mX11ErrorPipe[STDIN_FILENO];
+    fds[0].events = POLLIN | POLLERR | POLLHUP;
+    if (poll(fds, 1, timeout) < 0)
+    {
+        return true;
+    }
+
+    bool result = false;
+
+    while (fds[0].revents & POLLIN)
+    {
+        XErrorEvent errorEvent;
+        if (error_t error = readAll(mX11ErrorPipe[STDIN_FILENO], &errorEvent, sizeof(errorEvent)))
+        {
+            mCore->log(LOG_CRIT, "Cannot read from error signal pipe: %s", strerror(error));
+            qApp->quit();
+        }
+
+        char errorString[1024];
+        XGetErrorText(errorEvent.display, errorEvent.error_code, errorString, 1023);
+        mCore->log(level, "X11 error: type: %d, serial: %lu, error_code: %d '%s', request_code: %d (%s), minor_code: %d, resourceid: %lu", errorEvent.type, errorEvent.serial, errorEvent.error_code, errorString, errorEvent.request_code, x11opcodeToString(errorEvent.request_code), errorEvent.minor_code, errorEvent.resourceid);
+
+        result = true;
+
+        if (poll(fds, 1, 0) < 0)
+        {
+            return true;
+        }
+    }
+
+    return result;
+}
+
+void X11Connection::lockX11Error()
+{
+    mX11ErrorMutex.lock();
+    waitForX11Error(false, 0);
+}
+
+bool X11Connection::checkX11Error(int level, uint timeout)
+{
+//    unsigned long serial = NextRequest(mDisplay);
+//    mCore->log(LOG_DEBUG, "X11 error: serial: %lu", serial);
+
+    bool result = waitForX11Error(level, timeout);
+    mX11ErrorMutex.unlock();
+    return result;
+}
+
+void X11Connection::wakeX11Thread()
+{
+    if (mInterClientCommunicationWindow)
+    {
+        XClientMessageEvent dummyEvent;
+        memset(&dummyEvent, 0, sizeof(dummyEvent));
+        dummyEvent.type = ClientMessage;
+        dummyEvent.window = mInterClientCommunicationWindow;
+        dummyEvent.format = 32;
+
+        lockX11Error();
+        XSendEvent(mDisplay, mInterClientCommunicationWindow, 0, 0, reinterpret_cast<XEvent *>(&dummyEvent));
+        checkX11Error();
+        XFlush(mDisplay);
+    }
+}
+
+Window X11Connection::activeWindow(Window rootWindow, Atom netActiveWindowAtom)
+{
+    Window result = None;
+
+    Atom type;
+    int format;
+    unsigned long items;
+    unsigned long bytesAfter;
+    unsigned char *data = 0;
+
+    lockX11Error();
+    if ((XGetWindowProperty(mDisplay, rootWindow, netActiveWindowAtom, 0, 1, False, XA_WINDOW, &type, &format, &items, &bytesAfter, &data) == Success) && data)
+    {
+        if ((type == XA_WINDOW) && (format == 32) && items)
+        {
+            result = *reinterpret_cast<Window *>(data);
+        }
+        XFree(data);
+    }
+    checkX11Error(LOG_DEBUG);
+
+    return result;
+}
+
+QString X11Connection::windowClass(Window window)
+{
+    if (window == None)
+    {
+        return QString();
+    }
+
+    QString result;
+    if (mWindowClassCache.find(window, result))
+    {
+        return result;
+    }
+
+    TRACE_SPAN("dispatch", "read WM_CLASS");
+
+    XClassHint classHint;
+    classHint.res_name = 0;
+    classHint.res_class = 0;
+
+    lockX11Error();
+    if (XGetClassHint(mDisplay, window, &classHint))
+    {
+        result = QString::fromLocal8Bit(classHint.res_class);
+        XFree(classHint.res_name);
+        XFree(classHint.res_class);
+    }
+    // StructureNotifyMask delivers DestroyNotify for the window, so the cache entry can be dropped
+    XSelectInput(mDisplay, window, StructureNotifyMask);
+    if (checkX11Error(LOG_DEBUG))
+    {
+        // the window is already gone
+        return result;
+    }
+
+    Window evicted = mWindowClassCache.insert(window, result);
+    if (evicted)
+    {
+        lockX11Error();
+        XSelectInput(mDisplay, evicted, NoEventMask);
+        checkX11Error(LOG_DEBUG);
+    }
+
+    return result;
+}
+
+void X11Connection::rebuildKeycodeTable()
+{
+    TRACE_SPAN("grab", "rebuild keycode table");
+
+    lockX11Error();
+    bool rebuilt = mKeycodeTable.rebuild(mDisplay);
+    checkX11Error(LOG_DEBUG);
+
+    if (rebuilt)
+    {
+        mCore->log(LOG_DEBUG, "Keycode table: %d keysyms in %d groups", mKeycodeTable.size(), mKeycodeTable.groups());
+    }
+    else
+    {
+        mCore->log(LOG_WARNING, "Cannot read the keyboard mapping, no shortcut can be resolved");
+    }
+}
+
+void X11Connection::run()
+{
+    Trace::setThreadName(mThreadName.constData());
+
+    lockX11Error();
+
+    // with several screens on the display (Zaphod mode) each has its own root window and window manager,
+    // shortcuts are grabbed on all of them and each screen keeps its own active window
+    mRootWindows.clear();
+    for (int screen = 0; screen < ScreenCount(mDisplay); ++screen)
+    {
+        Window screenRootWindow = RootWindow(mDisplay, screen);
+        mRootWindows.push_back(screenRootWindow);
+
+        // PropertyChangeMask to follow _NET_ACTIVE_WINDOW
+        XSelectInput(mDisplay, screenRootWindow, KeyPressMask | PropertyChangeMask);
+    }
+    QList<Window>::const_iterator lastRootWindow = mRootWindows.constEnd();
+
+    // XKB reports new keyboards and keymaps, the keycode table is rebuilt from them;
+    // switching between the groups of a keymap rebuilds nothing, a key press carries its group
+    int xkbEventBase = -1;
+    {
+        int xkbOpcode;
+        int xkbErrorBase;
+        int xkbMajor = XkbMajorVersion;
+        int xkbMinor = XkbMinorVersion;
+        if (XkbQueryExtension(mDisplay, &xkbOpcode, &xkbEventBase, &xkbErrorBase, &xkbMajor, &xkbMinor))
+        {
+            XkbSelectEvents(mDisplay, XkbUseCoreKbd, XkbNewKeyboardNotifyMask | XkbMapNotifyMask, XkbNewKeyboardNotifyMask | XkbMapNotifyMask);
+        }
+        else
+        {
+            xkbEventBase = -1;
+        }
+    }
+
+    Atom netActiveWindowAtom = XInternAtom(mDisplay, "_NET_ACTIVE_WINDOW", False);
+
+    mInterClientCommunicationWindow = XCreateSimpleWindow(mDisplay, DefaultRootWindow(mDisplay), 0, 0, 1, 1, 0, 0, 0);
+
+    XSelectInput(mDisplay, mInterClientCommunicationWindow, StructureNotifyMask);
+
+    char signal = 0;
+    if (checkX11Error())
+    {
+        signal = 1;
+        if (write(mX11ResponsePipe[STDOUT_FILENO], &signal, sizeof(signal)) != sizeof(signal))
+        {
+            mCore->log(LOG_CRIT, "Cannot write X11 start signal");
+        }
+        return;
+    }
+
+    mAllModifiers.clear();
+    mAllShifts = ShiftMask | ControlMask | mCore->AltMask | mCore->MetaMask | mCore->Level3Mask | mCore->Level5Mask;
+    unsigned int ignoreMask = 0xff ^ mAllShifts;
+    for (unsigned int i = 0; i < 0x100; ++i)
+    {
+        unsigned int ignoreLocks = i & ignoreMask;
+        mAllModifiers.insert(ignoreLocks);
+    }
+
+    for (QList<Window>::const_iterator screenRootWindow = mRootWindows.constBegin(); screenRootWindow != lastRootWindow; ++screenRootWindow)
+    {
+        mActiveWindowClasses[*screenRootWindow] = windowClass(activeWindow(*screenRootWindow, netActiveWindowAtom));
+    }
+
+    rebuildKeycodeTable();
+
+
+    if (write(mX11ResponsePipe[STDOUT_FILENO], &signal, sizeof(signal)) == sizeof(signal))
+    {
+        XEvent event;
+        while (mX11EventLoopActive)
+        {
+            XNextEvent(mDisplay, &event);
+            if (!mX11EventLoopActive)
+            {
+                break;
+            }
+
+            if ((xkbEventBase >= 0) && (event.type == xkbEventBase))
+            {
+                // shortcuts registered from now on resolve against the new keymap,
+                // the ones already grabbed keep their keycodes
+                rebuildKeycodeTable();
+                continue;
+            }
+
+            switch (event.type)
+            {
+            case KeyPress:
+            {
+                TRACE_SPAN("dispatch", "KeyPress");
+
+                // only the shortcuts bound to a window context are grabbed in sync mode, their presses
+                // stay frozen until keyPressed knows whether the focused window gets them back
+                bool keyboardFrozen = mSyncGrabs.contains(qMakePair(static_cast<KeyCode>(event.xkey.keycode), event.xkey.state & mAllShifts));
+
+                // main thread slots keep mDataMutex while they write their requests to this thread, a request
+                // pipe filled up would deadlock, so the requests are served meanwhile
+                bool locked = mCore->mDataMutex.tryLock();
+                while (!locked && mX11EventLoopActive)
+                {
+                    serveX11Request(keyPressLockPollInterval);
+                    locked = mCore->mDataMutex.tryLock();
+                }
+                if (locked)
+                {
+                    keyPressed(event.xkey, keyboardFrozen);
+                    mCore->mDataMutex.unlock();
+                }
+                else if (keyboardFrozen)
+                {
+                    // stopping, the press is nobody's business any more
+                    XAllowEvents(mDisplay, ReplayKeyboard, event.xkey.time);
+                }
+            }
+            break;
+
+            case MappingNotify:
+                // XKB reports its keymaps itself
+                if ((xkbEventBase < 0) && (event.xmapping.request == MappingKeyboard))
+                {
+                    XRefreshKeyboardMapping(&event.xmapping);
+                    rebuildKeycodeTable();
+                }
+                break;
+
+            case PropertyNotify:
+                if ((event.xproperty.atom == netActiveWindowAtom) && mActiveWindowClasses.contains(event.xproperty.window))
+                {
+                    QString activeWindowClass = windowClass(activeWindow(event.xproperty.window, netActiveWindowAtom));
+                    QString &screenActiveWindowClass = mActiveWindowClasses[event.xproperty.window];
+                    if (activeWindowClass != screenActiveWindowClass)
+                    {
+                        mCore->log(LOG_DEBUG, "Active window class on root %08lx: '%s'", event.xproperty.window, qPrintable(activeWindowClass));
+                        screenActiveWindowClass = activeWindowClass;
+                    }
+                }
+                break;
+
+            // the rest of what StructureNotifyMask on the windows in the class cache delivers
+            case ConfigureNotify:
+            case MapNotify:
+            case UnmapNotify:
+            case ReparentNotify:
+            case GravityNotify:
+            case CirculateNotify:
+                break;
+
+            case DestroyNotify:
+                // window ids get reused, a stale class would match the wrong window
+                if (event.xdestroywindow.window != mInterClientCommunicationWindow)
+                {
+                    mWindowClassCache.remove(event.xdestroywindow.window);
+                    break;
+                }
+                // fall through
+
+            default:
+                serveX11Request(0);
+            }
+        }
+    }
+
+    lockX11Error();
+    for (QList<Window>::const_iterator screenRootWindow = mRootWindows.constBegin(); screenRootWindow != lastRootWindow; ++screenRootWindow)
+    {
+        XUngrabKey(mDisplay, AnyKey, AnyModifier, *screenRootWindow);
+    }
+    checkX11Error(0);
+}
+
+void X11Connection::keyPressed(const XKeyEvent &event, bool keyboardFrozen)
+{
+    Window rootWindow = DefaultRootWindow(mDisplay);
+
+    if (mGrabbingShortcut)
+    {
+        // the press may have come through a passive grab, which froze the keyboard
+        if (keyboardFrozen)
+        {
+            XAllowEvents(mDisplay, AsyncKeyboard, event.time);
+        }
+
+//        mCore->log(LOG_DEBUG, "KeyPress %08x %08x", event.state, event.keycode);
+
+        bool ignoreKey = false;
+        bool cancel = false;
+        QString shortcut;
+
+        // named as in the group the keyboard is in, the way the press is dispatched later
+        KeySym keySym = mKeycodeTable.keySym(static_cast<KeyCode>(event.keycode), XkbGroupForCoreState(event.state));
+        if (keySym != NoSymbol)
+        {
+            if (mCore->isEscape(keySym, event.state & mAllShifts))
+            {
+                cancel = true;
+            }
+            else
+            {
+                if (mCore->isModifier(keySym) || !mCore->isAllowed(keySym, event.state & mAllShifts))
+                {
+                    ignoreKey = true;
+                }
+                else
+                {
+                    const char *str = keysymToString(keySym);
+
+                    if (str && *str)
+                    {
+                        if (event.state & ShiftMask)
+                        {
+                            shortcut += "Shift+";
+                        }
+                        if (event.state & ControlMask)
+                        {
+                            shortcut += "Control+";
+                        }
+                        if (event.state & mCore->AltMask)
+                        {
+                            shortcut += "Alt+";
+                        }
+                        if (event.state & mCore->MetaMask)
+                        {
+                            shortcut += "Meta+";
+                        }
+                        if (event.state & mCore->Level3Mask)
+                        {
+                            shortcut += "Level3+";
+                        }
+                        if (event.state & mCore->Level5Mask)
+                        {
+                            shortcut += "Level5+";
+                        }
+
+                        shortcut += str;
+                    }
+                }
+            }
+        }
+        if (!ignoreKey)
+        {
+            if (!mGrabbedShortcuts.contains(shortcut))
+            {
+                mCore->log(LOG_DEBUG, "grabShortcut: checking %s", qPrintable(shortcut));
+                lockX11Error();
+                XUngrabKeyboard(mDisplay, CurrentTime);
+                checkX11Error();
+
+                QSet<unsigned int>::const_iterator lastAllModifiers = mAllModifiers.end();
+                for (QSet<unsigned int>::const_iterator modifiers = mAllModifiers.begin(); modifiers != lastAllModifiers; ++modifiers)
+                {
+                    mCore->log(LOG_DEBUG, "grabShortcut: checking %02x + %02x", event.keycode, event.state | *modifiers);
+                    lockX11Error();
+                    XGrabKey(mDisplay, event.keycode, event.state | *modifiers, rootWindow, False, GrabModeAsync, GrabModeAsync);
+                    ignoreKey |= checkX11Error(LOG_DEBUG);
+                }
+
+                lockX11Error();
+                XUngrabKey(mDisplay, event.keycode, event.state, rootWindow);
+                checkX11Error();
+
+                if (ignoreKey)
+                {
+                    lockX11Error();
+                    XGrabKeyboard(mDisplay, rootWindow, False, GrabModeAsync, GrabModeAsync, CurrentTime);
+                    checkX11Error();
+                }
+            }
+            else
+            {
+                mCore->log(LOG_DEBUG, "grabShortcut: already grabbed %s", qPrintable(shortcut));
+                lockX11Error();
+                XUngrabKeyboard(mDisplay, CurrentTime);
+                checkX11Error();
+            }
+        }
+        if (!ignoreKey)
+        {
+            mGrabbingShortcut = false;
+
+            if (!writeGrabbedShortcut(false, cancel, shortcut))
+            {
+                return;
+            }
+
+            emit mCore->onShortcutGrabbed();
+        }
+    }
+    else
+    {
+        // the same key means another shortcut in another group of the keymap
+        KeySym keySym = mKeycodeTable.keySym(static_cast<KeyCode>(event.keycode), XkbGroupForCoreState(event.state));
+
+        QString shortcut;
+        ActionExecutor::IdsAndActions actions;
+        bool bound = mCore->resolveKeyPress(keySym, event.state & mAllShifts, mActiveWindowClasses.value(event.root), shortcut, actions);
+        mCore->log(LOG_DEBUG, "KeyPress %08x %08x %s", event.state & mAllShifts, event.keycode, qPrintable(shortcut));
+
+        mCore->mMetrics.increment(Metrics::KEY_EVENTS);
+
+        if (!bound)
+        {
+            if (keyboardFrozen)
+            {
+                XAllowEvents(mDisplay, ReplayKeyboard, event.time);
+            }
+
+            mCore->mMetrics.increment(Metrics::KEY_EVENTS_UNMATCHED);
+        }
+        else
+        {
+            mCore->mMetrics.increment(Metrics::KEY_EVENTS_DISPATCHED);
+
+            // the grab froze the keyboard, nothing to do for us means the focused window gets the key
+            if (keyboardFrozen)
+            {
+                XAllowEvents(mDisplay, actions.isEmpty() ? ReplayKeyboard : AsyncKeyboard, event.time);
+            }
+
+            mCore->dispatch(shortcut, event.time, actions);
+        }
+    }
+}
+
+void X11Connection::serveX11Request(int timeout)
+{
+    Window rootWindow = DefaultRootWindow(mDisplay);
+    QList<Window>::const_iterator lastRootWindow = mRootWindows.constEnd();
+
+    pollfd fds[1];
+    fds[0].fd = mX11RequestPipe[STDIN_FILENO];
+    fds[0].events = POLLIN | POLLERR | POLLHUP;
+    if (poll(fds, 1, timeout) >= 0)
+    {
+        if (fds[0].revents & POLLIN)
+        {
+            size_t X11Operation;
+            if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &X11Operation, sizeof(X11Operation)))
+            {
+                mCore->log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
+                close(mX11ResponsePipe[STDIN_FILENO]);
+                mX11EventLoopActive = false;
+                return;
+            }
+//            mCore->log(LOG_DEBUG, "X11Operation: %d", X11Operation);
+
+            switch (X11Operation)
+            {
+            case X11_OP_XSwitchGrabs:
+            {
+                // ungrabs first, so a key moving between two profiles can be grabbed again
+                qulonglong ticket;
+                QList<X11Shortcut> X11shortcuts[2];
+                QList<bool> sync;
+                bool readFailed = false;
+                if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &ticket, sizeof(ticket)))
+                {
+                    mCore->log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
+                    readFailed = true;
+                }
+                for (int list = 0; (list < 2) && !readFailed; ++list)
+                {
+                    size_t count;
+                    if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &count, sizeof(count)))
+                    {
+                        mCore->log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
+                        readFailed = true;
+                        break;
+                    }
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        X11Shortcut X11shortcut;
+                        if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &X11shortcut.first, sizeof(X11shortcut.first)))
+                        {
+                            mCore->log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
+                            readFailed = true;
+                            break;
+                        }
+                        if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &X11shortcut.second, sizeof(X11shortcut.second)))
+                        {
+                            mCore->log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
+                            readFailed = true;
+                            break;
+                        }
+                        X11shortcuts[list].push_back(X11shortcut);
+                        if (list)
+                        {
+                            char mode;
+                            if (error_t error = readAll(mX11RequestPipe[STDIN_FILENO], &mode, sizeof(mode)))
+                            {
+                                mCore->log(LOG_CRIT, "Cannot read from X11 request pipe: %s", strerror(error));
+                                readFailed = true;
+                                break;
+                            }
+                            sync.push_back(mode);
+                        }
+                    }
+                }
+                if (readFailed)
+                {
+                    close(mX11ResponsePipe[STDIN_FILENO]);
+                    mX11EventLoopActive = false;
+                    break;
+                }
+
+                TRACE_SPAN("grab", "switch grabs");
+                QSet<unsigned int>::const_iterator lastAllModifiers = mAllModifiers.end();
+
+                lockX11Error();
+                QList<X11Shortcut>::const_iterator lastUngrab = X11shortcuts[0].constEnd();
+                for (QList<X11Shortcut>::const_iterator ungrab = X11shortcuts[0].constBegin(); ungrab != lastUngrab; ++ungrab)
+                {
+                    for (QList<Window>::const_iterator screenRootWindow = mRootWindows.constBegin(); screenRootWindow != lastRootWindow; ++screenRootWindow)
+                    {
+                        for (QSet<unsigned int>::const_iterator modifiers = mAllModifiers.begin(); modifiers != lastAllModifiers; ++modifiers)
+                        {
+                            XUngrabKey(mDisplay, ungrab->first, ungrab->second | *modifiers, *screenRootWindow);
+                        }
+                    }
+                }
+                if (checkX11Error())
+                {
+                    mCore->mMetrics.increment(Metrics::UNGRAB_FAILURES);
+                }
+
+                GrabResults results;
+                for (int i = 0; i < X11shortcuts[1].size(); ++i)
+                {
+                    const X11Shortcut &grab = X11shortcuts[1][i];
+                    bool x11Error = false;
+                    // a key named differently in another group may be pressed for a shortcut nobody has,
+                    // so it is replayed then as well
+                    bool grabSync = sync[i] || mKeycodeTable.changesWithGroup(grab.first);
+                    if (grabSync)
+                    {
+                        mSyncGrabs.insert(grab);
+                    }
+                    for (QList<Window>::const_iterator screenRootWindow = mRootWindows.constBegin(); screenRootWindow != lastRootWindow; ++screenRootWindow)
+                    {
+                        for (QSet<unsigned int>::const_iterator modifiers = mAllModifiers.begin(); modifiers != lastAllModifiers; ++modifiers)
+                        {
+                            lockX11Error();
+                            XGrabKey(mDisplay, grab.first, grab.second | *modifiers, *screenRootWindow, False, GrabModeAsync, grabSync ? GrabModeSync : GrabModeAsync);
+                            x11Error |= checkX11Error();
+                        }
+                    }
+                    GrabResult result = {ticket, grab, !x11Error};
+                    results.push_back(result);
+                }
+
+                // the main thread may be busy, it takes them whenever it gets to them
+                if (!results.isEmpty())
+                {
+                    mGrabResultsMutex.lock();
+                    mGrabResults += results;
+                    mGrabResultsMutex.unlock();
+
+                    emit mCore->onGrabsSwitched();
+                }
+            }
+            break;
+
+            case X11_OP_XGrabKeyboard:
+            {
+                lockX11Error();
+                int result = XGrabKeyboard(mDisplay, rootWindow, False, GrabModeAsync, GrabModeAsync, CurrentTime);
+                bool x11Error = checkX11Error();
+                if (result || x11Error)
+                {
+                    // answered the way a recorded shortcut is
+                    mCore->log(LOG_DEBUG, "XGrabKeyboard failed: %d", result);
+                    if (writeGrabbedShortcut(true, false, QString()))
+                    {
+                        emit mCore->onShortcutGrabbed();
+                    }
+                    break;
+                }
+
+                mCore->mDataMutex.lock();
+                mGrabbingShortcut = true;
+                mCore->mDataMutex.unlock();
+            }
+            break;
+
+            case X11_OP_XUngrabKeyboard:
+            {
+                // nobody waits for it, checkX11Error logs a failure
+                lockX11Error();
+                XUngrabKeyboard(mDisplay, CurrentTime);
+                checkX11Error();
+
+                mCore->mDataMutex.lock();
+                mGrabbingShortcut = false;
+                mCore->mDataMutex.unlock();
+            }
+            break;
+
+            }
+        }
+    }
+}
+
+qulonglong X11Connection::remoteXSwitchGrabs(const QList<X11Shortcut> &ungrab, const QList<X11Shortcut> &grab, const QList<bool> &sync)
+{
+    mCore->mMetrics.increment(Metrics::UNGRAB_REQUESTS, ungrab.size());
+    mCore->mMetrics.increment(Metrics::GRAB_REQUESTS, grab.size());
+
+    qulonglong ticket = ++mLastGrabTicket;
+
+    // all ungrabs before any grab, so a key moving between two profiles can be grabbed again
+    for (int offset = 0; offset < ungrab.size(); offset += switchGrabsChunkSize)
+    {
+        if (!remoteXSwitchGrabsChunk(ticket, ungrab.mid(offset, switchGrabsChunkSize), QList<X11Shortcut>(), QList<bool>()))
+        {
+            return 0;
+        }
+    }
+    for (int offset = 0; offset < grab.size(); offset += switchGrabsChunkSize)
+    {
+        if (!remoteXSwitchGrabsChunk(ticket, QList<X11Shortcut>(), grab.mid(offset, switchGrabsChunkSize), sync.mid(offset, switchGrabsChunkSize)))
+        {
+            return 0;
+        }
+    }
+
+    return ticket;
+}
+
+bool X11Connection::remoteXSwitchGrabsChunk(qulonglong ticket, const QList<X11Shortcut> &ungrab, const QList<X11Shortcut> &grab, const QList<bool> &sync)
+{
+    // the whole chunk goes down the pipe at once, so the X11 thread handles it in one go
+    QByteArray request;
+    size_t X11Operation = X11_OP_XSwitchGrabs;
+    request.append(reinterpret_cast<const char *>(&X11Operation), sizeof(X11Operation));
+    request.append(reinterpret_cast<const char *>(&ticket), sizeof(ticket));
+    const QList<X11Shortcut> *lists[2] = {&ungrab, &grab};
+    for (int list = 0; list < 2; ++list)
+    {
+        size_t count = lists[list]->size();
+        request.append(reinterpret_cast<const char *>(&count), sizeof(count));
+        for (size_t i = 0; i < count; ++i)
+        {
+            const X11Shortcut &X11shortcut = lists[list]->at(i);
+            request.append(reinterpret_cast<const char *>(&X11shortcut.first), sizeof(X11shortcut.first));
+            request.append(reinterpret_cast<const char *>(&X11shortcut.second), sizeof(X11shortcut.second));
+            if (list)
+            {
+                request.append(sync[i] ? '\1' : '\0');
+            }
+        }
+    }
+    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], request.constData(), request.size()))
+    {
+        mCore->log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
+        qApp->quit();
+        return false;
+    }
+    wakeX11Thread();
+
+    return true;
+}
+
+X11Connection::GrabResults X11Connection::takeGrabResults()
+{
+    QMutexLocker lock(&mGrabResultsMutex);
+
+    GrabResults result = mGrabResults;
+    mGrabResults.clear();
+    return result;
+}
+
+bool X11Connection::remoteXGrabKeyboard()
+{
+    size_t X11Operation = X11_OP_XGrabKeyboard;
+    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11Operation, sizeof(X11Operation)))
+    {
+        mCore->log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
+        qApp->quit();
+        return false;
+    }
+    wakeX11Thread();
+
+    return true;
+}
+
+bool X11Connection::remoteXUngrabKeyboard()
+{
+    size_t X11Operation = X11_OP_XUngrabKeyboard;
+    if (error_t error = writeAll(mX11RequestPipe[STDOUT_FILENO], &X11Operation, sizeof(X11Operation)))
+    {
+        mCore->log(LOG_CRIT, "Cannot write to X11 request pipe: %s", strerror(error));
+        qApp->quit();
+        return false;
+    }
+    wakeX11Thread();
+
+    return true;
+}
+
+bool X11Connection::writeGrabbedShortcut(bool failed, bool cancelled, const QString &shortcut)
+{
+    QByteArray response;
+    response.append(failed ? '\1' : '\0');
+    response.append(cancelled ? '\1' : '\0');
+    if (!failed && !cancelled)
+    {
+        QByteArray str = shortcut.toLatin1();
+        size_t length = str.length();
+        response.append(reinterpret_cast<const char *>(&length), sizeof(length));
+        response.append(str);
+    }
+    if (error_t error = writeAll(mX11ResponsePipe[STDOUT_FILENO], response.constData(), response.size()))
+    {
+        mCore->log(LOG_CRIT, "Cannot write to X11 response pipe: %s", strerror(error));
+        close(mX11RequestPipe[STDIN_FILENO]);
+        mX11EventLoopActive = false;
+        return false;
+    }
+    return true;
+}
+
+bool X11Connection::readGrabbedShortcut(bool &failed, bool &cancelled, QString &shortcut)
+{
+    char flags[2];
+    if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], flags, sizeof(flags)))
+    {
+        mCore->log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
+        qApp->quit();
+        return false;
+    }
+    failed = flags[0];
+    cancelled = flags[1];
+    if (!failed && !cancelled)
+    {
+        size_t length;
+        if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], &length, sizeof(length)))
+        {
+            mCore->log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
+            qApp->quit();
+            return false;
+        }
+        if (length)
+        {
+            QByteArray str(length, '\0');
+            if (error_t error = readAll(mX11ResponsePipe[STDIN_FILENO], str.data(), length))
+            {
+                mCore->log(LOG_CRIT, "Cannot read from X11 response pipe: %s", strerror(error));
+                qApp->quit();
+                return false;
+            }
+            shortcut = QString::fromLatin1(str);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,175 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * Razor - a lightweight, Qt based, desktop toolset
+ * http://razor-qt.org
+ *
+ * Copyright: 2013 Razor team
+ * Authors:
+ *   Kuzma Shapran <kuzma.shapran@gmail.com>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef GLOBAL_ACTION_DAEMON__X11_CONNECTION__INCLUDED
+#define GLOBAL_ACTION_DAEMON__X11_CONNECTION__INCLUDED
+
+
+#include <QThread>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QMutex>
+#include <QList>
+#include <QPair>
+
+#include "log_target.h"
+#include "window_class_cache.h"
+#include "keycode_table.h"
+
+extern "C" {
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#undef Bool
+}
+
+
+class Core;
+
+// One X display: its connection, the thread running its event loop, its keymap and what is grabbed on it.
+// The shortcut tables and the grab set are guarded by the Core data mutex.
+class X11Connection : public QThread
+{
+public:
+    typedef QPair<KeyCode, unsigned int> X11Shortcut;
+    typedef QList<X11Shortcut> X11Shortcuts;
+    typedef QMap<QString, X11Shortcuts> X11ByShortcut;
+    typedef QMap<X11Shortcut, QStringList> ShortcutsByX11;
+
+    // how the X11 thread answered one grab of remoteXSwitchGrabs
+    struct GrabResult
+    {
+        qulonglong ticket;
+        X11Shortcut key;
+        bool grabbed;
+    };
+    typedef QList<GrabResult> GrabResults;
+
+    // opens the display, empty name: $DISPLAY; throws std::runtime_error
+    X11Connection(Core *core, const QString &displayName);
+    ~X11Connection();
+
+    const QString &displayName() const { return mDisplayName; }
+    Display *display() const { return mDisplay; }
+
+    // blocks until the event loop runs; throws std::runtime_error
+    void waitStarted();
+    void stop();
+
+    int x11ErrorHandler(XErrorEvent *errorEvent);
+
+protected:
+    // no display and no thread, for a subclass that fills the keycode table itself
+    explicit X11Connection(Core *core);
+
+    KeycodeTable &keycodeTable() { return mKeycodeTable; }
+
+private:
+    X11Connection(const X11Connection &);
+    X11Connection &operator = (const X11Connection &);
+
+    friend class Core;
+    friend class CoreBenchmark;
+
+    void run();
+    // X11 thread, mDataMutex held
+    void keyPressed(const XKeyEvent &event, bool keyboardFrozen);
+    // X11 thread, serves the main thread request arriving on the request pipe within timeout milliseconds
+    void serveX11Request(int timeout);
+
+    // main thread, mDataMutex held; sync holds the grab mode of each of grab, in sync mode the press
+    // freezes the keyboard until it is claimed or replayed to the focused window; nothing waits for X,
+    // the grabs are answered with the returned ticket by takeGrabResults after onGrabsSwitched;
+    // 0 if the request cannot be sent
+    qulonglong remoteXSwitchGrabs(const QList<X11Shortcut> &ungrab, const QList<X11Shortcut> &grab, const QList<bool> &sync);
+    bool remoteXSwitchGrabsChunk(qulonglong ticket, const QList<X11Shortcut> &ungrab, const QList<X11Shortcut> &grab, const QList<bool> &sync);
+    // main thread
+    GrabResults takeGrabResults();
+    // neither waits for X, a refused grab is answered by onShortcutGrabbed with failed set;
+    // false if the request cannot be sent
+    bool remoteXGrabKeyboard();
+    bool remoteXUngrabKeyboard();
+    // after onShortcutGrabbed, false if the pipe broke
+    bool readGrabbedShortcut(bool &failed, bool &cancelled, QString &shortcut);
+    // X11 thread
+    bool writeGrabbedShortcut(bool failed, bool cancelled, const QString &shortcut);
+
+    void wakeX11Thread();
+
+    Window activeWindow(Window rootWindow, Atom netActiveWindowAtom);
+    QString windowClass(Window window);
+    void rebuildKeycodeTable();
+
+    void lockX11Error();
+    bool checkX11Error(int level = LOG_NOTICE, uint timeout = 10);
+
+    bool waitForX11Error(int level, uint timeout);
+
+private:
+    Core *mCore;
+    QString mDisplayName;
+    QByteArray mThreadName; // kept alive for the trace
+
+    int mX11ErrorPipe[2];
+    int mX11RequestPipe[2];
+    int mX11ResponsePipe[2];
+    Display *mDisplay;
+    Window mInterClientCommunicationWindow;
+    bool mX11EventLoopActive;
+
+    mutable QMutex mX11ErrorMutex;
+
+    // mDataMutex
+    X11ByShortcut mX11ByShortcut; // the keys of a shortcut in every group, never shrinks
+    ShortcutsByX11 mShortcutsByX11; // a key is shared by the shortcuts it is called for in the groups
+    QMap<X11Shortcut, bool> mGrabs; // what is requested from this display, true in sync mode
+    QMap<X11Shortcut, qulonglong> mPendingGrabs; // the ticket of the last grab of a key not answered yet
+    qulonglong mLastGrabTicket;
+    QSet<QString> mGrabbedShortcuts; // the ones with a key whose grab is answered
+    bool mGrabbingShortcut;
+
+    // filled by the X11 thread, taken by the main thread
+    QMutex mGrabResultsMutex;
+    GrabResults mGrabResults;
+
+    // rebuilt by the X11 thread, main thread shortcuts are resolved with it as well
+    KeycodeTable mKeycodeTable;
+
+    // X11 thread only
+    QList<Window> mRootWindows; // of all screens
+    QSet<unsigned int> mAllModifiers; // lock combinations a shortcut is grabbed with
+    unsigned int mAllShifts;
+    // ever grabbed in sync mode, a press of one of them may have frozen the keyboard; a key grabbed async
+    // since stays, a press queued before the switch still needs XAllowEvents, a spare one is ignored
+    QSet<X11Shortcut> mSyncGrabs;
+    WindowClassCache mWindowClassCache;
+    QMap<Window, QString> mActiveWindowClasses; // by screen root window
+};
+
+#endif // GLOBAL_ACTION_DAEMON__X11_CONNECTION__INCLUDED